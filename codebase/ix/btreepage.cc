@@ -0,0 +1,240 @@
+#include "btreepage.h"
+
+//header at the start of every node
+struct NodeHeader {
+	unsigned char leaf;
+	unsigned short count;      // number of entries
+	unsigned short freeOffset; // end of the entries
+	PageNum next;              // right sibling, or first child
+};
+
+#define SLOT_SIZE ((int) sizeof(unsigned short))
+
+BTreePage::BTreePage(char *page, AttrType keyType) {
+	this->page = page;
+	this->keyType = keyType;
+}
+
+void BTreePage::initialize(bool leaf) {
+	NodeHeader header;
+	memset(&header, 0, sizeof(NodeHeader));
+	header.leaf = leaf;
+	header.count = 0;
+	header.freeOffset = sizeof(NodeHeader);
+	header.next = NO_PAGE;
+	memcpy(page, &header, sizeof(NodeHeader));
+}
+
+bool BTreePage::isLeaf() const {
+	return ((const NodeHeader*) page)->leaf;
+}
+
+int BTreePage::getCount() const {
+	return ((const NodeHeader*) page)->count;
+}
+
+PageNum BTreePage::getNext() const {
+	return ((const NodeHeader*) page)->next;
+}
+
+void BTreePage::setNext(PageNum next) {
+	((NodeHeader*) page)->next = next;
+}
+
+short BTreePage::getFreeSpace() const {
+	return PAGE_SIZE - getFreeOffset() - getCount() * SLOT_SIZE;
+}
+
+const char* BTreePage::key(int slot) const {
+	return entry(slot);
+}
+
+RID BTreePage::rid(int slot) const {
+	const char *ridData = entry(slot) + keyLength(entry(slot), keyType);
+	RID rid;
+	memcpy(&rid.pageNum, ridData, sizeof(unsigned));
+	memcpy(&rid.slotNum, ridData + sizeof(unsigned), sizeof(unsigned));
+	return rid;
+}
+
+PageNum BTreePage::child(int slot) const {
+	PageNum child;
+	memcpy(&child, entry(slot) + keyLength(entry(slot), keyType)
+			+ 2 * sizeof(unsigned), sizeof(PageNum));
+	return child;
+}
+
+/*
+ * Binary search of the slot directory.
+ */
+int BTreePage::lowerBound(const char *key, const RID &rid) const {
+	int low = 0;
+	int high = getCount();
+	while (low < high) {
+		int middle = (low + high) / 2;
+		if (compareEntries(this->key(middle), this->rid(middle), key, rid,
+				keyType) < 0)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+	return low;
+}
+
+/*
+ * The entries of the child of an entry are not below it, so the child is the
+ * one of the last entry not above (key, rid), or the first child if there is
+ * none.
+ */
+PageNum BTreePage::findChild(const char *key, const RID &rid) const {
+	int slot = lowerBound(key, rid);
+	if (slot < getCount() && equals(slot, key, rid))
+		return child(slot);
+	return slot == 0 ? getNext() : child(slot - 1);
+}
+
+bool BTreePage::equals(int slot, const char *key, const RID &rid) const {
+	return compareEntries(this->key(slot), this->rid(slot), key, rid, keyType)
+			== 0;
+}
+
+bool BTreePage::insert(int slot, const char *key, const RID &rid,
+		PageNum child) {
+	int length = keyLength(key, keyType);
+	int size = entryLength(length, isLeaf());
+	if (getFreeSpace() < size + SLOT_SIZE)
+		return false;
+
+	char *newEntry = page + getFreeOffset();
+	memcpy(newEntry, key, length);
+	memcpy(newEntry + length, &rid.pageNum, sizeof(unsigned));
+	memcpy(newEntry + length + sizeof(unsigned), &rid.slotNum,
+			sizeof(unsigned));
+	if (!isLeaf())
+		memcpy(newEntry + length + 2 * sizeof(unsigned), &child,
+				sizeof(PageNum));
+
+	//the slots from slot on move one place towards the start of the page
+	int count = getCount();
+	char *directory = page + PAGE_SIZE - count * SLOT_SIZE;
+	memmove(directory - SLOT_SIZE, directory, (count - slot) * SLOT_SIZE);
+	setCount(count + 1);
+	setOffset(slot, getFreeOffset());
+	setFreeOffset(getFreeOffset() + size);
+	return true;
+}
+
+/*
+ * Remove the entry of the slot and close the gap it leaves.
+ */
+void BTreePage::erase(int slot) {
+	unsigned short removed = offset(slot);
+	int size = entryLength(keyLength(entry(slot), keyType), isLeaf());
+	memmove(page + removed, page + removed + size,
+			getFreeOffset() - removed - size);
+	setFreeOffset(getFreeOffset() - size);
+
+	int count = getCount();
+	char *directory = page + PAGE_SIZE - count * SLOT_SIZE;
+	memmove(directory + SLOT_SIZE, directory, (count - slot - 1) * SLOT_SIZE);
+	setCount(count - 1);
+	for (int i = 0; i < count - 1; ++i)
+		if (offset(i) > removed)
+			setOffset(i, offset(i) - size);
+}
+
+void BTreePage::moveTo(int slot, BTreePage &right) {
+	int count = getCount();
+	for (int i = slot; i < count; ++i)
+		right.insert(i - slot, key(i), rid(i), isLeaf() ? NO_PAGE : child(i));
+	while (getCount() > slot)
+		erase(getCount() - 1);
+}
+
+int BTreePage::splitSlot() const {
+	int half = (getFreeOffset() - sizeof(NodeHeader)) / 2;
+	int bytes = 0;
+	int slot = 0;
+	while (slot < getCount() - 1 && bytes < half) {
+		bytes += entryLength(keyLength(key(slot), keyType), isLeaf());
+		slot++;
+	}
+	return max(slot, 1);
+}
+
+int BTreePage::keyLength(const char *key, AttrType type) {
+	return RecordBasedFileManager::fieldLength(key, type);
+}
+
+/*
+ * Ints and reals compare by value, varchars byte by byte, a prefix first.
+ */
+int BTreePage::compareKeys(const char *key1, const char *key2, AttrType type) {
+	switch (type) {
+	case TypeInt: {
+		int value1, value2;
+		memcpy(&value1, key1, sizeof(int));
+		memcpy(&value2, key2, sizeof(int));
+		return value1 < value2 ? -1 : value1 > value2;
+	}
+	case TypeReal: {
+		float value1, value2;
+		memcpy(&value1, key1, sizeof(float));
+		memcpy(&value2, key2, sizeof(float));
+		return value1 < value2 ? -1 : value1 > value2;
+	}
+	case TypeVarChar: {
+		int length1, length2;
+		memcpy(&length1, key1, sizeof(int));
+		memcpy(&length2, key2, sizeof(int));
+		int result = memcmp(key1 + sizeof(int), key2 + sizeof(int),
+				min(length1, length2));
+		if (result != 0)
+			return result;
+		return length1 < length2 ? -1 : length1 > length2;
+	}
+	}
+	return 0;
+}
+
+int BTreePage::compareEntries(const char *key1, const RID &rid1,
+		const char *key2, const RID &rid2, AttrType type) {
+	int result = compareKeys(key1, key2, type);
+	if (result != 0)
+		return result;
+	if (rid1.pageNum != rid2.pageNum)
+		return rid1.pageNum < rid2.pageNum ? -1 : 1;
+	if (rid1.slotNum != rid2.slotNum)
+		return rid1.slotNum < rid2.slotNum ? -1 : 1;
+	return 0;
+}
+
+int BTreePage::entryLength(int keyLength, bool leaf) {
+	return keyLength + 2 * sizeof(unsigned) + (leaf ? 0 : sizeof(PageNum));
+}
+
+char* BTreePage::entry(int slot) const {
+	return page + offset(slot);
+}
+
+unsigned short BTreePage::offset(int slot) const {
+	unsigned short offset;
+	memcpy(&offset, page + PAGE_SIZE - (slot + 1) * SLOT_SIZE, SLOT_SIZE);
+	return offset;
+}
+
+void BTreePage::setOffset(int slot, unsigned short offset) {
+	memcpy(page + PAGE_SIZE - (slot + 1) * SLOT_SIZE, &offset, SLOT_SIZE);
+}
+
+unsigned short BTreePage::getFreeOffset() const {
+	return ((const NodeHeader*) page)->freeOffset;
+}
+
+void BTreePage::setFreeOffset(unsigned short freeOffset) {
+	((NodeHeader*) page)->freeOffset = freeOffset;
+}
+
+void BTreePage::setCount(int count) {
+	((NodeHeader*) page)->count = count;
+}
@@ -0,0 +1,74 @@
+#ifndef _btreepage_h_
+#define _btreepage_h_
+
+#include <cstring>
+
+#include "../rbf/rbfm.h"
+
+using namespace std;
+
+#define NO_PAGE UINT_MAX          // no sibling / no child
+#define MAX_KEY_SIZE (PAGE_SIZE / 8) // longest key, with the length of a varchar
+
+/*
+ * BTreePage is the format of the nodes of a B+tree index. The entries are
+ * (key, rid) pairs, so that the duplicates of a key are ordered by their rid
+ * and every entry is unique; an internal node also keeps, with each entry,
+ * the child holding the entries from it on. The entries are packed after the
+ * header, in the order they were inserted, and the slot directory at the end
+ * of the page keeps their offsets in the order of the keys:
+ *
+ *   [header][entry][entry]...free space...[offset of slot n-1]...[slot 0]
+ *
+ * A key is in the format of the API: an int, a real, or the length of a
+ * varchar followed by its characters. In a leaf, next is the right sibling; in
+ * an internal node, it is the child holding the entries before the first one.
+ */
+class BTreePage {
+public:
+	BTreePage(char *page, AttrType keyType);
+
+	void initialize(bool leaf);
+
+	bool isLeaf() const;
+	int getCount() const;
+	PageNum getNext() const;
+	void setNext(PageNum next);
+	short getFreeSpace() const;
+
+	const char* key(int slot) const;
+	RID rid(int slot) const;
+	PageNum child(int slot) const; // internal nodes only
+
+	// first slot whose entry is not below (key, rid)
+	int lowerBound(const char *key, const RID &rid) const;
+	// child of an internal node where the entry (key, rid) belongs
+	PageNum findChild(const char *key, const RID &rid) const;
+	bool equals(int slot, const char *key, const RID &rid) const;
+
+	// false if the page has no room left for the entry
+	bool insert(int slot, const char *key, const RID &rid, PageNum child);
+	void erase(int slot);
+	// move the entries from slot on to the empty node right, keeping their order
+	void moveTo(int slot, BTreePage &right);
+	int splitSlot() const; // first slot of the right half of the bytes
+
+	static int keyLength(const char *key, AttrType type);
+	static int compareKeys(const char *key1, const char *key2, AttrType type);
+	static int compareEntries(const char *key1, const RID &rid1,
+			const char *key2, const RID &rid2, AttrType type);
+	static int entryLength(int keyLength, bool leaf);
+
+private:
+	char *page;
+	AttrType keyType;
+
+	char* entry(int slot) const;
+	unsigned short offset(int slot) const;
+	void setOffset(int slot, unsigned short offset);
+	unsigned short getFreeOffset() const;
+	void setFreeOffset(unsigned short freeOffset);
+	void setCount(int count);
+};
+
+#endif
@@ -0,0 +1,113 @@
+#include "hashpage.h"
+
+//header at the start of every page of a bucket
+struct BucketHeader {
+	unsigned short count;      // number of entries
+	unsigned short freeOffset; // end of the entries
+	PageNum next;              // next page of the chain
+};
+
+HashPage::HashPage(char *page, AttrType keyType) {
+	this->page = page;
+	this->keyType = keyType;
+}
+
+void HashPage::initialize() {
+	BucketHeader header;
+	memset(&header, 0, sizeof(BucketHeader));
+	header.count = 0;
+	header.freeOffset = sizeof(BucketHeader);
+	header.next = NO_PAGE;
+	memcpy(page, &header, sizeof(BucketHeader));
+}
+
+int HashPage::getCount() const {
+	return ((const BucketHeader*) page)->count;
+}
+
+PageNum HashPage::getNext() const {
+	return ((const BucketHeader*) page)->next;
+}
+
+void HashPage::setNext(PageNum next) {
+	((BucketHeader*) page)->next = next;
+}
+
+short HashPage::getFreeSpace() const {
+	return PAGE_SIZE - end();
+}
+
+int HashPage::begin() const {
+	return sizeof(BucketHeader);
+}
+
+int HashPage::end() const {
+	return ((const BucketHeader*) page)->freeOffset;
+}
+
+int HashPage::nextEntry(int offset) const {
+	return offset + entryLength(keyLength(offset));
+}
+
+const char* HashPage::key(int offset) const {
+	return page + offset;
+}
+
+RID HashPage::rid(int offset) const {
+	const char *ridData = page + offset + keyLength(offset);
+	RID rid;
+	memcpy(&rid.pageNum, ridData, sizeof(unsigned));
+	memcpy(&rid.slotNum, ridData + sizeof(unsigned), sizeof(unsigned));
+	return rid;
+}
+
+int HashPage::find(const char *key, const RID &rid) const {
+	for (int offset = begin(); offset < end(); offset = nextEntry(offset)) {
+		RID entryRid = this->rid(offset);
+		if (entryRid.pageNum == rid.pageNum && entryRid.slotNum == rid.slotNum
+				&& BTreePage::compareKeys(this->key(offset), key, keyType) == 0)
+			return offset;
+	}
+	return -1;
+}
+
+bool HashPage::insert(const char *key, const RID &rid) {
+	int length = BTreePage::keyLength(key, keyType);
+	if (getFreeSpace() < entryLength(length))
+		return false;
+
+	char *entry = page + end();
+	memcpy(entry, key, length);
+	memcpy(entry + length, &rid.pageNum, sizeof(unsigned));
+	memcpy(entry + length + sizeof(unsigned), &rid.slotNum, sizeof(unsigned));
+	setFreeOffset(end() + entryLength(length));
+	setCount(getCount() + 1);
+	return true;
+}
+
+void HashPage::erase(int offset) {
+	int next = nextEntry(offset);
+	memmove(page + offset, page + next, end() - next);
+	setFreeOffset(end() - (next - offset));
+	setCount(getCount() - 1);
+}
+
+int HashPage::entryLength(int keyLength) {
+	return keyLength + 2 * sizeof(unsigned);
+}
+
+int HashPage::capacity() {
+	return PAGE_SIZE - sizeof(BucketHeader);
+}
+
+int HashPage::keyLength(int offset) const {
+	return BTreePage::keyLength(page + offset, keyType);
+}
+
+void HashPage::setCount(int count) {
+	((BucketHeader*) page)->count = count;
+}
+
+void HashPage::setFreeOffset(int freeOffset) {
+	((BucketHeader*) page)->freeOffset = freeOffset;
+}
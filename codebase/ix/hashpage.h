@@ -0,0 +1,54 @@
+#ifndef _hashpage_h_
+#define _hashpage_h_
+
+#include <cstring>
+
+#include "btreepage.h"
+
+using namespace std;
+
+/*
+ * HashPage is the format of the pages of a bucket of a hash index: the primary
+ * page of the bucket and its chain of overflow pages. The (key, rid) entries are
+ * packed after the header in no particular order, and an entry is found by
+ * going through them; a key is in the format of the API. The same header links
+ * the free pages of the file.
+ *
+ *   [count][freeOffset][next page of the chain][key][rid][key][rid]...
+ */
+class HashPage {
+public:
+	HashPage(char *page, AttrType keyType);
+
+	void initialize();
+
+	int getCount() const;
+	PageNum getNext() const; // NO_PAGE at the end of the chain
+	void setNext(PageNum next);
+	short getFreeSpace() const;
+
+	// entries are at offsets from begin() to end(), each one at the end of the
+	// previous one
+	int begin() const;
+	int end() const;
+	int nextEntry(int offset) const;
+	const char* key(int offset) const;
+	RID rid(int offset) const;
+
+	int find(const char *key, const RID &rid) const; // offset, -1 if none
+	bool insert(const char *key, const RID &rid); // false if there is no room
+	void erase(int offset);
+
+	static int entryLength(int keyLength);
+	static int capacity(); // bytes of entries of an empty page
+
+private:
+	char *page;
+	AttrType keyType;
+
+	int keyLength(int offset) const;
+	void setCount(int count);
+	void setFreeOffset(int freeOffset);
+};
+
+#endif
@@ -0,0 +1,614 @@
+#include "ix.h"
+#include "btreepage.h"
+
+//page 0 of an index file
+struct IndexHeader {
+	PageNum root;
+	int keyType;     // -1 until the first entry
+	unsigned height; // levels of the tree
+};
+
+#define ROOT_PAGE 1 // root of a new tree, and first leaf of a bulk load
+
+IndexManager* IndexManager::_index_manager = 0;
+
+IndexManager* IndexManager::instance() {
+	if (!_index_manager)
+		_index_manager = new IndexManager();
+
+	return _index_manager;
+}
+
+IndexManager::IndexManager() {
+	pfm = PagedFileManager::instance();
+}
+
+IndexManager::~IndexManager() {
+}
+
+static RC readIndexHeader(IXFileHandle &ixfileHandle, IndexHeader &header) {
+	char *page;
+	if (ixfileHandle.fetchPage(0, page) != 0)
+		return -1;
+	memcpy(&header, page, sizeof(IndexHeader));
+	return ixfileHandle.unpinPage(0, false);
+}
+
+static RC writeIndexHeader(IXFileHandle &ixfileHandle,
+		const IndexHeader &header) {
+	char *page;
+	if (ixfileHandle.fetchPage(0, page) != 0)
+		return -1;
+	memcpy(page, &header, sizeof(IndexHeader));
+	return ixfileHandle.unpinPage(0, true);
+}
+
+/*
+ * The file starts with its header page and an empty leaf as the root.
+ */
+RC IndexManager::createFile(const string &fileName) {
+	if (pfm->createFile(fileName, INDEX_FILE_TYPE) != 0)
+		return -1;
+
+	FileHandle fileHandle;
+	if (pfm->openFile(fileName, fileHandle) != 0)
+		return -1;
+
+	char page[PAGE_SIZE];
+	memset(page, 0, PAGE_SIZE);
+	IndexHeader header;
+	header.root = ROOT_PAGE;
+	header.keyType = -1;
+	header.height = 1;
+	memcpy(page, &header, sizeof(IndexHeader));
+	RC rc = fileHandle.appendPage(page);
+
+	memset(page, 0, PAGE_SIZE);
+	BTreePage(page, TypeInt).initialize(true);
+	if (rc == 0)
+		rc = fileHandle.appendPage(page);
+
+	if (pfm->closeFile(fileHandle) != 0)
+		return -1;
+	return rc;
+}
+
+RC IndexManager::destroyFile(const string &fileName) {
+	return pfm->destroyFile(fileName);
+}
+
+RC IndexManager::openFile(const string &fileName, IXFileHandle &ixfileHandle) {
+	if (ixfileHandle.fileHandle.hasOpenFile()) {
+		cout << "ERROR: the handle is already open on a file" << endl;
+		return -1;
+	}
+	if (pfm->openFile(fileName, ixfileHandle.fileHandle) != 0)
+		return -1;
+	if (ixfileHandle.fileHandle.getFileType() != INDEX_FILE_TYPE) {
+		cout << "ERROR: " << fileName << " is not an index file" << endl;
+		pfm->closeFile(ixfileHandle.fileHandle);
+		return -1;
+	}
+	return 0;
+}
+
+RC IndexManager::closeFile(IXFileHandle &ixfileHandle) {
+	return pfm->closeFile(ixfileHandle.fileHandle);
+}
+
+static RC validKey(AttrType type, const void *key);
+
+/*
+ * The key has to be of the type of the index, and short enough for a node
+ * to hold several of them. With setType, the first key gives its type to the
+ * index.
+ */
+RC IndexManager::checkKey(IXFileHandle &ixfileHandle,
+		const Attribute &attribute, const void *key, bool setType) {
+	IndexHeader header;
+	if (readIndexHeader(ixfileHandle, header) != 0)
+		return -1;
+	if (header.keyType == -1 && setType) {
+		header.keyType = attribute.type;
+		if (writeIndexHeader(ixfileHandle, header) != 0)
+			return -1;
+	}
+	if (header.keyType != -1 && header.keyType != attribute.type) {
+		cout << "ERROR: the attribute " << attribute.name
+				<< " is not of the type of the keys of the index" << endl;
+		return -1;
+	}
+	return key == NULL ? 0 : validKey(attribute.type, key);
+}
+
+static RC validKey(AttrType type, const void *key) {
+	if (type == TypeVarChar) {
+		int length;
+		memcpy(&length, key, sizeof(int));
+		if (length < 0 || length + (int) sizeof(int) > MAX_KEY_SIZE) {
+			cout << "ERROR: keys are at most " << MAX_KEY_SIZE - sizeof(int)
+					<< " characters long" << endl;
+			return -1;
+		}
+	} else if (type == TypeReal) {
+		float real;
+		memcpy(&real, key, sizeof(float));
+		if (real != real) {
+			cout << "ERROR: NaN cannot be a key" << endl;
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/*
+ * Go down from the root to the leaf where the entry (key, rid) belongs. With a
+ * path, the internal nodes on the way are added to it.
+ */
+RC IndexManager::findLeaf(IXFileHandle &ixfileHandle, AttrType keyType,
+		const char *key, const RID &rid, PageNum &leaf, vector<PageNum> *path) {
+	IndexHeader header;
+	if (readIndexHeader(ixfileHandle, header) != 0)
+		return -1;
+
+	PageNum pageNum = header.root;
+	for (unsigned level = 1; level < header.height; ++level) {
+		char *page;
+		if (ixfileHandle.fetchPage(pageNum, page) != 0)
+			return -1;
+		BTreePage node(page, keyType);
+		PageNum child = key == NULL ? node.getNext() : node.findChild(key, rid);
+		ixfileHandle.unpinPage(pageNum, false);
+		if (path != NULL)
+			path->push_back(pageNum);
+		pageNum = child;
+	}
+	leaf = pageNum;
+	return 0;
+}
+
+RC IndexManager::insertEntry(IXFileHandle &ixfileHandle,
+		const Attribute &attribute, const void *key, const RID &rid) {
+	unique_lock<shared_mutex> fileLock(
+			ixfileHandle.fileHandle.getRecordLock());
+	if (checkKey(ixfileHandle, attribute, key, true) != 0)
+		return -1;
+
+	vector<PageNum> path;
+	PageNum leaf;
+	if (findLeaf(ixfileHandle, attribute.type, (const char*) key, rid, leaf,
+			&path) != 0)
+		return -1;
+	return insertInto(ixfileHandle, attribute.type, path, leaf,
+			(const char*) key, rid);
+}
+
+/*
+ * Insert the entry into the leaf, splitting the nodes that are full on the way
+ * up: the right half of a node moves to a new node, whose first entry goes up
+ * to the parent (for an internal node, the entry itself goes up and its child
+ * becomes the first child of the new node). Splitting the root adds a level.
+ */
+RC IndexManager::insertInto(IXFileHandle &ixfileHandle, AttrType keyType,
+		vector<PageNum> &path, PageNum pageNum, const char *key,
+		const RID &rid) {
+	char entryKey[MAX_KEY_SIZE];
+	memcpy(entryKey, key, BTreePage::keyLength(key, keyType));
+	RID entryRid = rid;
+	PageNum entryChild = NO_PAGE;
+
+	while (true) {
+		char *page;
+		if (ixfileHandle.fetchPage(pageNum, page) != 0)
+			return -1;
+		BTreePage node(page, keyType);
+		int slot = node.lowerBound(entryKey, entryRid);
+		if (node.isLeaf() && slot < node.getCount()
+				&& node.equals(slot, entryKey, entryRid)) {
+			ixfileHandle.unpinPage(pageNum, false);
+			cout << "ERROR: the entry is already in the index" << endl;
+			return -1;
+		}
+		if (node.insert(slot, entryKey, entryRid, entryChild))
+			return ixfileHandle.unpinPage(pageNum, true);
+
+		//split the node into a new page, added before anything moves
+		char newNode[PAGE_SIZE];
+		memset(newNode, 0, PAGE_SIZE);
+		BTreePage(newNode, keyType).initialize(node.isLeaf());
+		PageNum newPageNum;
+		char *newPage;
+		if (ixfileHandle.appendPage(newNode, newPageNum) != 0) {
+			ixfileHandle.unpinPage(pageNum, false);
+			return -1;
+		}
+		if (ixfileHandle.fetchPage(newPageNum, newPage) != 0) {
+			ixfileHandle.unpinPage(pageNum, false);
+			return -1;
+		}
+		BTreePage right(newPage, keyType);
+		int middle = node.splitSlot();
+
+		char separatorKey[MAX_KEY_SIZE];
+		memcpy(separatorKey, node.key(middle),
+				BTreePage::keyLength(node.key(middle), keyType));
+		RID separatorRid = node.rid(middle);
+		if (node.isLeaf()) {
+			node.moveTo(middle, right);
+			right.setNext(node.getNext());
+			node.setNext(newPageNum);
+		} else {
+			right.setNext(node.child(middle));
+			node.moveTo(middle + 1, right);
+			node.erase(middle);
+		}
+		BTreePage &target =
+				BTreePage::compareEntries(entryKey, entryRid, separatorKey,
+						separatorRid, keyType) < 0 ? node : right;
+		target.insert(target.lowerBound(entryKey, entryRid), entryKey,
+				entryRid, entryChild);
+		ixfileHandle.unpinPage(newPageNum, true);
+		ixfileHandle.unpinPage(pageNum, true);
+
+		memcpy(entryKey, separatorKey,
+				BTreePage::keyLength(separatorKey, keyType));
+		entryRid = separatorRid;
+		entryChild = newPageNum;
+		if (!path.empty()) {
+			pageNum = path.back();
+			path.pop_back();
+			continue;
+		}
+
+		//new root
+		memset(newNode, 0, PAGE_SIZE);
+		BTreePage root(newNode, keyType);
+		root.initialize(false);
+		root.setNext(pageNum);
+		root.insert(0, entryKey, entryRid, entryChild);
+		IndexHeader header;
+		if (readIndexHeader(ixfileHandle, header) != 0
+				|| ixfileHandle.appendPage(newNode, header.root) != 0)
+			return -1;
+		header.height++;
+		return writeIndexHeader(ixfileHandle, header);
+	}
+}
+
+RC IndexManager::deleteEntry(IXFileHandle &ixfileHandle,
+		const Attribute &attribute, const void *key, const RID &rid) {
+	unique_lock<shared_mutex> fileLock(
+			ixfileHandle.fileHandle.getRecordLock());
+	if (checkKey(ixfileHandle, attribute, key, false) != 0)
+		return -1;
+
+	PageNum leaf;
+	if (findLeaf(ixfileHandle, attribute.type, (const char*) key, rid, leaf,
+			NULL) != 0)
+		return -1;
+	char *page;
+	if (ixfileHandle.fetchPage(leaf, page) != 0)
+		return -1;
+	BTreePage node(page, attribute.type);
+	int slot = node.lowerBound((const char*) key, rid);
+	if (slot == node.getCount() || !node.equals(slot, (const char*) key, rid)) {
+		ixfileHandle.unpinPage(leaf, false);
+		cout << "ERROR: the entry is not in the index" << endl;
+		return -1;
+	}
+	node.erase(slot);
+	return ixfileHandle.unpinPage(leaf, true);
+}
+
+RC IndexManager::findEntries(IXFileHandle &ixfileHandle,
+		const Attribute &attribute, const void *key, vector<RID> &rids) {
+	rids.clear();
+	IX_ScanIterator ix_ScanIterator;
+	if (scan(ixfileHandle, attribute, key, key, true, true, ix_ScanIterator)
+			!= 0)
+		return -1;
+
+	RID rid;
+	char entryKey[MAX_KEY_SIZE];
+	RC rc;
+	while ((rc = ix_ScanIterator.getNextEntry(rid, entryKey)) == 0)
+		rids.push_back(rid);
+	ix_ScanIterator.close();
+	return rc == IX_EOF ? 0 : -1;
+}
+
+/*
+ * Write a node built by bulkLoad: the first one replaces the empty root, the
+ * others are appended.
+ */
+RC IndexManager::appendNode(IXFileHandle &ixfileHandle, const char *node,
+		bool first, PageNum &pageNum) {
+	if (!first)
+		return ixfileHandle.appendPage(node, pageNum);
+
+	char *page;
+	if (ixfileHandle.fetchPage(ROOT_PAGE, page) != 0)
+		return -1;
+	memcpy(page, node, PAGE_SIZE);
+	pageNum = ROOT_PAGE;
+	return ixfileHandle.unpinPage(ROOT_PAGE, true);
+}
+
+/*
+ * Build the tree bottom up: the entries fill the leaves one after the other,
+ * each one up to BULK_LOAD_FREE_SPACE bytes left for later inserts, and then
+ * each level is built in the same way from the first entries of the nodes of
+ * the level below, until one node is left, which is the root. The nodes of a
+ * level are appended one after the other, so each leaf knows its sibling
+ * before it is written. If the entries are not sorted, the index is left
+ * empty.
+ */
+RC IndexManager::bulkLoad(IXFileHandle &ixfileHandle,
+		const Attribute &attribute, IndexEntrySource source, void *context) {
+	unique_lock<shared_mutex> fileLock(
+			ixfileHandle.fileHandle.getRecordLock());
+	IndexHeader header;
+	if (readIndexHeader(ixfileHandle, header) != 0)
+		return -1;
+	char *page;
+	if (ixfileHandle.fetchPage(header.root, page) != 0)
+		return -1;
+	bool empty = header.height == 1
+			&& BTreePage(page, attribute.type).getCount() == 0;
+	ixfileHandle.unpinPage(header.root, false);
+	if (!empty) {
+		cout << "ERROR: only an empty index can be bulk-loaded" << endl;
+		return -1;
+	}
+
+	if (checkKey(ixfileHandle, attribute, NULL, true) != 0)
+		return -1;
+
+	AttrType keyType = attribute.type;
+	//first entry and page of each node of the level being built
+	vector<pair<vector<char>, RID> > firstEntries;
+	vector<PageNum> pages;
+
+	char node[PAGE_SIZE];
+	memset(node, 0, PAGE_SIZE);
+	BTreePage leaf(node, keyType);
+	leaf.initialize(true);
+	char key[MAX_KEY_SIZE];
+	char lastKey[MAX_KEY_SIZE];
+	RID rid;
+	RID lastRid;
+	bool sorted = true;
+	while (sorted && source(context, key, rid)) {
+		if (validKey(keyType, key) != 0)
+			return -1;
+		int length = BTreePage::keyLength(key, keyType);
+		if (leaf.getCount() > 0 || !firstEntries.empty())
+			sorted = BTreePage::compareEntries(lastKey, lastRid, key, rid,
+					keyType) < 0;
+		if (!sorted)
+			break;
+		memcpy(lastKey, key, length);
+		lastRid = rid;
+
+		if (leaf.getCount() > 0
+				&& leaf.getFreeSpace() - BTreePage::entryLength(length, true)
+						< BULK_LOAD_FREE_SPACE) {
+			//the next leaf is the page appended right after this one
+			bool first = pages.empty();
+			leaf.setNext(
+					ixfileHandle.fileHandle.getNumberOfPages() + (first ? 0 : 1));
+			PageNum pageNum;
+			if (appendNode(ixfileHandle, node, first, pageNum) != 0)
+				return -1;
+			pages.push_back(pageNum);
+			leaf.initialize(true);
+		}
+		if (leaf.getCount() == 0)
+			firstEntries.push_back(
+					make_pair(vector<char>(key, key + length), rid));
+		leaf.insert(leaf.getCount(), key, rid, NO_PAGE);
+	}
+
+	if (!sorted) {
+		cout << "ERROR: the entries of a bulk load must be sorted" << endl;
+		leaf.initialize(true);
+		PageNum pageNum;
+		appendNode(ixfileHandle, node, true, pageNum);
+		return -1;
+	}
+	PageNum pageNum;
+	if (appendNode(ixfileHandle, node, pages.empty(), pageNum) != 0)
+		return -1;
+	pages.push_back(pageNum);
+
+	//the levels above the leaves
+	unsigned height = 1;
+	while (pages.size() > 1) {
+		vector<pair<vector<char>, RID> > levelEntries;
+		vector<PageNum> levelPages;
+		BTreePage internal(node, keyType);
+		for (unsigned i = 0; i < pages.size(); ++i) {
+			const char *firstKey = &firstEntries[i].first[0];
+			int length = firstEntries[i].first.size();
+			if (i > 0
+					&& internal.getFreeSpace()
+							- BTreePage::entryLength(length, false)
+							>= BULK_LOAD_FREE_SPACE) {
+				internal.insert(internal.getCount(), firstKey,
+						firstEntries[i].second, pages[i]);
+				continue;
+			}
+			if (i > 0) {
+				if (ixfileHandle.appendPage(node, pageNum) != 0)
+					return -1;
+				levelPages.push_back(pageNum);
+			}
+			internal.initialize(false);
+			internal.setNext(pages[i]);
+			levelEntries.push_back(firstEntries[i]);
+		}
+		if (ixfileHandle.appendPage(node, pageNum) != 0)
+			return -1;
+		levelPages.push_back(pageNum);
+
+		firstEntries.swap(levelEntries);
+		pages.swap(levelPages);
+		height++;
+	}
+
+	if (readIndexHeader(ixfileHandle, header) != 0)
+		return -1;
+	header.root = pages[0];
+	header.height = height;
+	return writeIndexHeader(ixfileHandle, header);
+}
+
+/*
+ * Position the iterator on the first entry not below the low key, in the leaf
+ * where it belongs.
+ */
+RC IndexManager::scan(IXFileHandle &ixfileHandle, const Attribute &attribute,
+		const void *lowKey, const void *highKey, bool lowKeyInclusive,
+		bool highKeyInclusive, IX_ScanIterator &ix_ScanIterator) {
+	if (!ixfileHandle.fileHandle.hasOpenFile()) {
+		cout << "ERROR: the index file is not open" << endl;
+		return -1;
+	}
+	shared_lock<shared_mutex> fileLock(
+			ixfileHandle.fileHandle.getRecordLock());
+	if (checkKey(ixfileHandle, attribute, lowKey, false) != 0
+			|| (highKey != NULL && validKey(attribute.type, highKey) != 0))
+		return -1;
+
+	AttrType keyType = attribute.type;
+	ix_ScanIterator.close();
+	ix_ScanIterator.keyType = keyType;
+	ix_ScanIterator.highKeyInclusive = highKeyInclusive;
+	if (highKey != NULL)
+		ix_ScanIterator.highKey.assign((const char*) highKey,
+				(const char*) highKey
+						+ BTreePage::keyLength((const char*) highKey, keyType));
+
+	//the first entry of the low key has the lowest rid, and the last one the
+	//highest
+	RID lowRid;
+	lowRid.pageNum = lowKeyInclusive ? 0 : UINT_MAX;
+	lowRid.slotNum = lowKeyInclusive ? 0 : UINT_MAX;
+	PageNum leaf;
+	char *page;
+	if (findLeaf(ixfileHandle, keyType, (const char*) lowKey, lowRid, leaf,
+			NULL) != 0 || ixfileHandle.fetchPage(leaf, page) != 0)
+		return -1;
+	ix_ScanIterator.leaf.assign(page, page + PAGE_SIZE);
+	ixfileHandle.unpinPage(leaf, false);
+
+	BTreePage node(&ix_ScanIterator.leaf[0], keyType);
+	ix_ScanIterator.currentSlot = 0;
+	if (lowKey != NULL) {
+		int slot = node.lowerBound((const char*) lowKey, lowRid);
+		while (!lowKeyInclusive && slot < node.getCount()
+				&& BTreePage::compareKeys(node.key(slot), (const char*) lowKey,
+						keyType) == 0)
+			slot++;
+		ix_ScanIterator.currentSlot = slot;
+	}
+	ix_ScanIterator.ixfileHandle = &ixfileHandle;
+	return 0;
+}
+
+RC IndexManager::getHeight(IXFileHandle &ixfileHandle, unsigned &height) {
+	shared_lock<shared_mutex> fileLock(
+			ixfileHandle.fileHandle.getRecordLock());
+	IndexHeader header;
+	if (readIndexHeader(ixfileHandle, header) != 0)
+		return -1;
+	height = header.height;
+	return 0;
+}
+
+IX_ScanIterator::IX_ScanIterator() {
+	ixfileHandle = NULL;
+	keyType = TypeInt;
+	highKeyInclusive = false;
+	currentSlot = 0;
+}
+
+IX_ScanIterator::~IX_ScanIterator() {
+}
+
+/*
+ * The iterator goes through a copy of the current leaf, so the entries it
+ * returns can be deleted during the scan; the changes to the next leaves are
+ * seen when the scan gets to them.
+ */
+RC IX_ScanIterator::getNextEntry(RID &rid, void *key) {
+	if (ixfileHandle == NULL)
+		return IX_EOF;
+
+	shared_lock<shared_mutex> fileLock(
+			ixfileHandle->fileHandle.getRecordLock());
+	BTreePage node(&leaf[0], keyType);
+	while (currentSlot >= node.getCount()) {
+		PageNum next = node.getNext();
+		if (next == NO_PAGE)
+			return IX_EOF;
+		char *page;
+		if (ixfileHandle->fetchPage(next, page) != 0)
+			return -1;
+		memcpy(&leaf[0], page, PAGE_SIZE);
+		ixfileHandle->unpinPage(next, false);
+		currentSlot = 0;
+	}
+
+	const char *entryKey = node.key(currentSlot);
+	if (!highKey.empty()) {
+		int result = BTreePage::compareKeys(entryKey, &highKey[0], keyType);
+		if (result > 0 || (result == 0 && !highKeyInclusive))
+			return IX_EOF;
+	}
+	memcpy(key, entryKey, BTreePage::keyLength(entryKey, keyType));
+	rid = node.rid(currentSlot);
+	currentSlot++;
+	return 0;
+}
+
+RC IX_ScanIterator::close() {
+	ixfileHandle = NULL;
+	highKey.clear();
+	leaf.clear();
+	currentSlot = 0;
+	return 0;
+}
+
+IXFileHandle::IXFileHandle() {
+	ixReadPageCounter = 0;
+	ixWritePageCounter = 0;
+	ixAppendPageCounter = 0;
+}
+
+IXFileHandle::~IXFileHandle() {
+}
+
+RC IXFileHandle::collectCounterValues(unsigned &readPageCount,
+		unsigned &writePageCount, unsigned &appendPageCount) {
+	readPageCount = ixReadPageCounter;
+	writePageCount = ixWritePageCounter;
+	appendPageCount = ixAppendPageCounter;
+	return 0;
+}
+
+RC IXFileHandle::fetchPage(PageNum pageNum, char *&data) {
+	ixReadPageCounter++;
+	return BufferManager::instance()->fetchPage(fileHandle, pageNum, data);
+}
+
+RC IXFileHandle::unpinPage(PageNum pageNum, bool dirty) {
+	if (dirty)
+		ixWritePageCounter++;
+	return BufferManager::instance()->unpinPage(fileHandle, pageNum, dirty);
+}
+
+RC IXFileHandle::appendPage(const void *data, PageNum &pageNum) {
+	ixAppendPageCounter++;
+	return BufferManager::instance()->appendPage(fileHandle, data, pageNum);
+}
@@ -0,0 +1,149 @@
+#ifndef _ix_h_
+#define _ix_h_
+
+#include <vector>
+#include <string>
+
+#include "../rbf/rbfm.h"
+#include "../rbf/bpm.h"
+
+using namespace std;
+
+#define IX_EOF (-1)  // end of the index scan
+#define INDEX_FILE_TYPE 16 // file type of the index files, apart from the layouts
+#define BULK_LOAD_FREE_SPACE (PAGE_SIZE / 10) // left free in bulk-loaded nodes
+
+class IX_ScanIterator;
+class IXFileHandle;
+
+// Gives the next entry of a bulk load in key, rid order: false when there is
+// none left
+typedef bool (*IndexEntrySource)(void *context, void *key, RID &rid);
+
+/*
+ * The IndexManager keeps B+tree indexes of the records of a file, in index
+ * files of their own. An entry maps a key (an int, a real or a varchar, in the
+ * format of the API) to the rid of a record; a key may have any number of rids.
+ * The nodes are pages of the index file (see BTreePage), accessed through the
+ * buffer pool, so that finding a key reads one page per level of the tree. Page
+ * 0 of the file keeps the root and the type of the keys, which is the type of
+ * the attribute of the first entry.
+ *
+ * The deleted entries are removed from their leaf, and the nodes are never
+ * merged, so an empty leaf stays in the chain of the leaves until the index is
+ * bulk-loaded again.
+ */
+class IndexManager {
+
+public:
+	static IndexManager* instance();
+
+	// Create an index file, with an empty tree
+	RC createFile(const string &fileName);
+
+	// Delete an index file
+	RC destroyFile(const string &fileName);
+
+	// Open an index and return an ixfileHandle
+	RC openFile(const string &fileName, IXFileHandle &ixfileHandle);
+
+	// Close an ixfileHandle for an index.
+	RC closeFile(IXFileHandle &ixfileHandle);
+
+	// Insert an entry into the given index that is indicated by the given ixfileHandle
+	RC insertEntry(IXFileHandle &ixfileHandle, const Attribute &attribute,
+			const void *key, const RID &rid);
+
+	// Delete an entry from the given index that is indicated by the given ixfileHandle
+	RC deleteEntry(IXFileHandle &ixfileHandle, const Attribute &attribute,
+			const void *key, const RID &rid);
+
+	// Get the rids of the entries of the key, in their order
+	RC findEntries(IXFileHandle &ixfileHandle, const Attribute &attribute,
+			const void *key, vector<RID> &rids);
+
+	// Build the tree of an empty index from its entries, sorted by key and rid
+	RC bulkLoad(IXFileHandle &ixfileHandle, const Attribute &attribute,
+			IndexEntrySource source, void *context);
+
+	// Initialize and IX_ScanIterator to support a range search. A NULL key has
+	// no bound on its side
+	RC scan(IXFileHandle &ixfileHandle, const Attribute &attribute,
+			const void *lowKey, const void *highKey, bool lowKeyInclusive,
+			bool highKeyInclusive, IX_ScanIterator &ix_ScanIterator);
+
+	// Number of levels of the tree, 1 if the root is a leaf
+	RC getHeight(IXFileHandle &ixfileHandle, unsigned &height);
+
+protected:
+	IndexManager();
+	~IndexManager();
+
+private:
+	static IndexManager *_index_manager;
+	PagedFileManager *pfm;
+
+	RC checkKey(IXFileHandle &ixfileHandle, const Attribute &attribute,
+			const void *key, bool setType);
+	RC findLeaf(IXFileHandle &ixfileHandle, AttrType keyType, const char *key,
+			const RID &rid, PageNum &leaf, vector<PageNum> *path);
+	RC insertInto(IXFileHandle &ixfileHandle, AttrType keyType,
+			vector<PageNum> &path, PageNum pageNum, const char *key,
+			const RID &rid);
+	RC appendNode(IXFileHandle &ixfileHandle, const char *node, bool first,
+			PageNum &pageNum);
+};
+
+class IXFileHandle {
+public:
+
+	// variables to keep counter for each operation
+	atomic<unsigned> ixReadPageCounter;
+	atomic<unsigned> ixWritePageCounter;
+	atomic<unsigned> ixAppendPageCounter;
+
+	// Constructor
+	IXFileHandle();
+
+	// Destructor
+	~IXFileHandle();
+
+	// Put the current counter values of associated PF FileHandles into variables
+	RC collectCounterValues(unsigned &readPageCount, unsigned &writePageCount,
+			unsigned &appendPageCount);
+
+	// Pages of the index through the buffer pool, counted by the handle
+	RC fetchPage(PageNum pageNum, char *&data);
+	RC unpinPage(PageNum pageNum, bool dirty);
+	RC appendPage(const void *data, PageNum &pageNum);
+
+	FileHandle fileHandle;
+};
+
+class IX_ScanIterator {
+public:
+
+	// Constructor
+	IX_ScanIterator();
+
+	// Destructor
+	~IX_ScanIterator();
+
+	// Get next matching entry
+	RC getNextEntry(RID &rid, void *key);
+
+	// Terminate index scan
+	RC close();
+
+private:
+	friend class IndexManager;
+
+	IXFileHandle *ixfileHandle;
+	AttrType keyType;
+	vector<char> highKey; // empty if there is no upper bound
+	bool highKeyInclusive;
+	vector<char> leaf;    // copy of the current leaf
+	int currentSlot;
+};
+
+#endif
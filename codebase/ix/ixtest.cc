@@ -0,0 +1,341 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cassert>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "ix.h"
+#include "linearhash.h"
+#include "../rbf/test_util.h"
+
+using namespace std;
+
+// Tests of the index manager. This file has its own main and is not part of
+// the test build.
+
+int IXTest_1(IndexManager *indexManager) {
+	// Functions tested
+	// 1. Create Index File
+	// 2. Insert entries with duplicate keys, splitting the nodes
+	// 3. Find the rids of a key, reading one page per level
+	// 4. Scan a range of keys and delete the entries during the scan
+	// 5. Insert and find varchar keys
+	// 6. Destroy Index File
+	cout << endl << "***** In IX Test Case 1 *****" << endl;
+
+	RC rc;
+	string indexFileName = "ix_test1";
+
+	rc = indexManager->createFile(indexFileName);
+	assert(rc == success && "Creating the index file should not fail.");
+
+	IXFileHandle ixfileHandle;
+	rc = indexManager->openFile(indexFileName, ixfileHandle);
+	assert(rc == success && "Opening the index file should not fail.");
+
+	Attribute attribute;
+	attribute.name = "Age";
+	attribute.type = TypeInt;
+	attribute.length = 4;
+
+	// Keys 0 to 999, each one with 10 rids, in no particular order
+	int numKeys = 1000;
+	RID rid;
+	for (int i = 0; i < numKeys * 10; i++) {
+		int key = (i * 7919) % numKeys;
+		rid.pageNum = i;
+		rid.slotNum = i % 10;
+		rc = indexManager->insertEntry(ixfileHandle, attribute, &key, rid);
+		assert(rc == success && "Inserting an entry should not fail.");
+	}
+	int key = (17 * 7919) % numKeys;
+	rid.pageNum = 17;
+	rid.slotNum = 7;
+	assert(indexManager->insertEntry(ixfileHandle, attribute, &key, rid) != success && "Inserting an entry twice should fail.");
+
+	unsigned height;
+	rc = indexManager->getHeight(ixfileHandle, height);
+	assert(rc == success && height > 1 && "The root should have been split.");
+
+	unsigned readPages, writePages, appendPages;
+	ixfileHandle.collectCounterValues(readPages, writePages, appendPages);
+	vector<RID> rids;
+	key = 500;
+	rc = indexManager->findEntries(ixfileHandle, attribute, &key, rids);
+	assert(rc == success && rids.size() == 10 && "The key should have all its rids.");
+	for (unsigned i = 1; i < rids.size(); i++)
+		assert(rids[i - 1].pageNum < rids[i].pageNum && "The rids should be in order.");
+	unsigned lookupPages = ixfileHandle.ixReadPageCounter - readPages;
+	assert(lookupPages <= height + 3 && "Finding a key should read one page per level.");
+
+	// Delete the keys from 100 to 199 while scanning them
+	int lowKey = 100;
+	int highKey = 200;
+	IX_ScanIterator ix_ScanIterator;
+	rc = indexManager->scan(ixfileHandle, attribute, &lowKey, &highKey, true,
+			false, ix_ScanIterator);
+	assert(rc == success && "Scanning the index should not fail.");
+	int count = 0;
+	int lastKey = lowKey;
+	while (ix_ScanIterator.getNextEntry(rid, &key) != IX_EOF) {
+		assert(key >= lastKey && key < highKey && "The scan should return the keys of the range in order.");
+		lastKey = key;
+		rc = indexManager->deleteEntry(ixfileHandle, attribute, &key, rid);
+		assert(rc == success && "Deleting an entry should not fail.");
+		count++;
+	}
+	ix_ScanIterator.close();
+	assert(count == 1000 && "The scan should return every entry of the range.");
+
+	rc = indexManager->scan(ixfileHandle, attribute, NULL, NULL, true, true,
+			ix_ScanIterator);
+	assert(rc == success && "Scanning the index should not fail.");
+	count = 0;
+	while (ix_ScanIterator.getNextEntry(rid, &key) != IX_EOF) {
+		assert((key < 100 || key >= 200) && "The deleted entries should be gone.");
+		count++;
+	}
+	ix_ScanIterator.close();
+	assert(count == numKeys * 10 - 1000 && "The other entries should be left.");
+
+	rc = indexManager->closeFile(ixfileHandle);
+	assert(rc == success && "Closing the index file should not fail.");
+	rc = indexManager->destroyFile(indexFileName);
+	assert(rc == success && "Destroying the index file should not fail.");
+
+	// Varchar keys, in an index of their own
+	rc = indexManager->createFile(indexFileName);
+	assert(rc == success && "Creating the index file should not fail.");
+	rc = indexManager->openFile(indexFileName, ixfileHandle);
+	assert(rc == success && "Opening the index file should not fail.");
+
+	attribute.name = "EmpName";
+	attribute.type = TypeVarChar;
+	attribute.length = 100;
+	char varcharKey[PAGE_SIZE];
+	for (int i = 0; i < 2000; i++) {
+		string name = string(i % 90 + 1, 'a' + i % 26) + to_string(i % 500);
+		int length = name.size();
+		memcpy(varcharKey, &length, sizeof(int));
+		memcpy(varcharKey + sizeof(int), name.c_str(), length);
+		rid.pageNum = i;
+		rid.slotNum = 1;
+		rc = indexManager->insertEntry(ixfileHandle, attribute, varcharKey, rid);
+		assert(rc == success && "Inserting an entry should not fail.");
+	}
+	string name = string(1, 'a') + "0";
+	int length = name.size();
+	memcpy(varcharKey, &length, sizeof(int));
+	memcpy(varcharKey + sizeof(int), name.c_str(), length);
+	rc = indexManager->findEntries(ixfileHandle, attribute, varcharKey, rids);
+	assert(rc == success && rids.size() == 1 && rids[0].pageNum == 0 && "The varchar key should be found.");
+
+	rc = indexManager->closeFile(ixfileHandle);
+	assert(rc == success && "Closing the index file should not fail.");
+	rc = indexManager->destroyFile(indexFileName);
+	assert(rc == success && "Destroying the index file should not fail.");
+
+	cout << "[PASS] IX Test Case 1 Passed!" << endl << endl;
+
+	return 0;
+}
+
+// Entries of the bulk load: keys 0 to count - 1, with the rid (key, 1)
+struct SortedKeys {
+	int next;
+	int count;
+};
+
+static bool nextSortedKey(void *context, void *key, RID &rid) {
+	SortedKeys *keys = (SortedKeys*) context;
+	if (keys->next == keys->count)
+		return false;
+	memcpy(key, &keys->next, sizeof(int));
+	rid.pageNum = keys->next;
+	rid.slotNum = 1;
+	keys->next++;
+	return true;
+}
+
+int IXTest_2(IndexManager *indexManager) {
+	// Functions tested
+	// 1. Create Index File
+	// 2. Bulk-load sorted entries
+	// 3. Scan the whole index and a range of it
+	// 4. Insert entries into the loaded tree
+	// 5. Destroy Index File
+	cout << endl << "***** In IX Test Case 2 *****" << endl;
+
+	RC rc;
+	string indexFileName = "ix_test2";
+
+	rc = indexManager->createFile(indexFileName);
+	assert(rc == success && "Creating the index file should not fail.");
+
+	IXFileHandle ixfileHandle;
+	rc = indexManager->openFile(indexFileName, ixfileHandle);
+	assert(rc == success && "Opening the index file should not fail.");
+
+	Attribute attribute;
+	attribute.name = "Salary";
+	attribute.type = TypeInt;
+	attribute.length = 4;
+
+	SortedKeys keys;
+	keys.next = 0;
+	keys.count = 100000;
+	rc = indexManager->bulkLoad(ixfileHandle, attribute, nextSortedKey, &keys);
+	assert(rc == success && "Bulk-loading the index should not fail.");
+	keys.next = 0;
+	assert(indexManager->bulkLoad(ixfileHandle, attribute, nextSortedKey, &keys) != success && "Only an empty index can be bulk-loaded.");
+
+	unsigned height;
+	rc = indexManager->getHeight(ixfileHandle, height);
+	assert(rc == success && height == 3 && "The tree should have three levels.");
+
+	IX_ScanIterator ix_ScanIterator;
+	rc = indexManager->scan(ixfileHandle, attribute, NULL, NULL, true, true,
+			ix_ScanIterator);
+	assert(rc == success && "Scanning the index should not fail.");
+	RID rid;
+	int key;
+	int count = 0;
+	while (ix_ScanIterator.getNextEntry(rid, &key) != IX_EOF) {
+		assert(key == count && (int) rid.pageNum == count && "The scan should return the entries in order.");
+		count++;
+	}
+	ix_ScanIterator.close();
+	assert(count == keys.count && "The scan should return every entry.");
+
+	// Inserting into the loaded tree splits its nodes
+	for (int i = 0; i < 10000; i++) {
+		key = 50000;
+		rid.pageNum = i;
+		rid.slotNum = 2;
+		rc = indexManager->insertEntry(ixfileHandle, attribute, &key, rid);
+		assert(rc == success && "Inserting an entry should not fail.");
+	}
+
+	int lowKey = 49999;
+	int highKey = 50001;
+	rc = indexManager->scan(ixfileHandle, attribute, &lowKey, &highKey, false,
+			false, ix_ScanIterator);
+	assert(rc == success && "Scanning the index should not fail.");
+	count = 0;
+	while (ix_ScanIterator.getNextEntry(rid, &key) != IX_EOF) {
+		assert(key == 50000 && "The scan should only return the keys of the range.");
+		count++;
+	}
+	ix_ScanIterator.close();
+	assert(count == 10001 && "The scan should return every entry of the key.");
+
+	rc = indexManager->closeFile(ixfileHandle);
+	assert(rc == success && "Closing the index file should not fail.");
+	rc = indexManager->destroyFile(indexFileName);
+	assert(rc == success && "Destroying the index file should not fail.");
+
+	cout << "[PASS] IX Test Case 2 Passed!" << endl << endl;
+
+	return 0;
+}
+
+int IXTest_3(HashIndexManager *hashIndexManager) {
+	// Functions tested
+	// 1. Create Hash Index File
+	// 2. Insert ids, splitting the buckets one at a time
+	// 3. Insert many rids of one key, chaining overflow pages
+	// 4. Close and open the index, and find every id with about one page read
+	// 5. Delete the rids of the key
+	// 6. Destroy Hash Index File
+	cout << endl << "***** In IX Test Case 3 *****" << endl;
+
+	RC rc;
+	string indexFileName = "ix_test3";
+
+	rc = hashIndexManager->createFile(indexFileName);
+	assert(rc == success && "Creating the index file should not fail.");
+
+	IXFileHandle ixfileHandle;
+	rc = hashIndexManager->openFile(indexFileName, ixfileHandle);
+	assert(rc == success && "Opening the index file should not fail.");
+
+	Attribute attribute;
+	attribute.name = "Id";
+	attribute.type = TypeInt;
+	attribute.length = 4;
+
+	int numKeys = 300000;
+	RID rid;
+	for (int key = 0; key < numKeys; key++) {
+		rid.pageNum = key;
+		rid.slotNum = 1;
+		rc = hashIndexManager->insertEntry(ixfileHandle, attribute, &key, rid);
+		assert(rc == success && "Inserting an entry should not fail.");
+	}
+	int key = 7;
+	for (int i = 0; i < 1000; i++) {
+		rid.pageNum = i;
+		rid.slotNum = 2;
+		rc = hashIndexManager->insertEntry(ixfileHandle, attribute, &key, rid);
+		assert(rc == success && "Inserting an entry should not fail.");
+	}
+	assert(hashIndexManager->insertEntry(ixfileHandle, attribute, &key, rid) != success && "Inserting an entry twice should fail.");
+	unsigned buckets = hashIndexManager->getBucketCount(ixfileHandle);
+	assert(buckets > 1000 && "The buckets should have been split.");
+
+	// The directory is kept while the file is closed
+	rc = hashIndexManager->closeFile(ixfileHandle);
+	assert(rc == success && "Closing the index file should not fail.");
+	rc = hashIndexManager->openFile(indexFileName, ixfileHandle);
+	assert(rc == success && "Opening the index file should not fail.");
+	assert(hashIndexManager->getBucketCount(ixfileHandle) == buckets);
+
+	unsigned readPages, writePages, appendPages;
+	ixfileHandle.collectCounterValues(readPages, writePages, appendPages);
+	vector<RID> rids;
+	for (key = 100; key < numKeys; key++) {
+		rc = hashIndexManager->findEntries(ixfileHandle, attribute, &key, rids);
+		assert(rc == success && rids.size() == 1 && (int) rids[0].pageNum == key && "The id should be found.");
+	}
+	double pagesPerLookup = (double) (ixfileHandle.ixReadPageCounter
+			- readPages) / (numKeys - 100);
+	cout << "pages read per lookup: " << pagesPerLookup << endl;
+	assert(pagesPerLookup < 1.2 && "Finding an id should read about one page.");
+
+	key = 7;
+	rc = hashIndexManager->findEntries(ixfileHandle, attribute, &key, rids);
+	assert(rc == success && rids.size() == 1001 && "The key should have all its rids.");
+	for (int i = 0; i < 1000; i++) {
+		rid.pageNum = i;
+		rid.slotNum = 2;
+		rc = hashIndexManager->deleteEntry(ixfileHandle, attribute, &key, rid);
+		assert(rc == success && "Deleting an entry should not fail.");
+	}
+	assert(hashIndexManager->deleteEntry(ixfileHandle, attribute, &key, rid) != success && "Deleting an entry twice should fail.");
+	rc = hashIndexManager->findEntries(ixfileHandle, attribute, &key, rids);
+	assert(rc == success && rids.size() == 1 && rids[0].slotNum == 1 && "Only the id should be left.");
+
+	rc = hashIndexManager->closeFile(ixfileHandle);
+	assert(rc == success && "Closing the index file should not fail.");
+	rc = hashIndexManager->destroyFile(indexFileName);
+	assert(rc == success && "Destroying the index file should not fail.");
+
+	cout << "[PASS] IX Test Case 3 Passed!" << endl << endl;
+
+	return 0;
+}
+
+int main() {
+
+	IndexManager *indexManager = IndexManager::instance();
+
+	RC rcmain = IXTest_1(indexManager);
+	if (rcmain == success)
+		rcmain = IXTest_2(indexManager);
+	if (rcmain == success)
+		rcmain = IXTest_3(HashIndexManager::instance());
+
+	return rcmain;
+}
@@ -0,0 +1,588 @@
+#include "linearhash.h"
+#include "hashpage.h"
+
+//page 0 of a hash index file
+struct HashHeader {
+	int keyType;
+	unsigned level;
+	unsigned next;
+	unsigned bucketCount;
+	unsigned long long entryBytes;
+	PageNum freePages;
+	PageNum directory; // first page of the directory
+};
+
+//header of a page of the directory, followed by the primary pages of the buckets
+struct DirectoryHeader {
+	PageNum next;   // next page of the directory
+	unsigned count; // buckets in the page
+};
+
+#define DIRECTORY_PAGE 1
+#define DIRECTORY_ENTRIES ((PAGE_SIZE - sizeof(DirectoryHeader)) / sizeof(PageNum))
+
+HashIndexManager* HashIndexManager::_hash_manager = 0;
+
+HashIndexManager* HashIndexManager::instance() {
+	if (!_hash_manager)
+		_hash_manager = new HashIndexManager();
+
+	return _hash_manager;
+}
+
+HashIndexManager::HashIndexManager() {
+	pfm = PagedFileManager::instance();
+}
+
+HashIndexManager::~HashIndexManager() {
+}
+
+/*
+ * 64 bits of hash of a key: the bytes of a varchar go through FNV-1a, and the
+ * result (or the value of an int or a real) through the finalizer of splitmix64
+ * so that the low bits, which choose the bucket, depend on all of them.
+ */
+static unsigned long long hashKey(const char *key, AttrType type) {
+	unsigned long long hash;
+	if (type == TypeVarChar) {
+		int length;
+		memcpy(&length, key, sizeof(int));
+		hash = 14695981039346656037ULL;
+		for (int i = 0; i < length; ++i) {
+			hash ^= (unsigned char) key[sizeof(int) + i];
+			hash *= 1099511628211ULL;
+		}
+	} else {
+		unsigned value;
+		memcpy(&value, key, sizeof(unsigned));
+		if (type == TypeReal && value == 0x80000000u)
+			value = 0; //-0.0 is the key 0.0
+		hash = value;
+	}
+	hash ^= hash >> 30;
+	hash *= 0xbf58476d1ce4e5b9ULL;
+	hash ^= hash >> 27;
+	hash *= 0x94d049bb133111ebULL;
+	hash ^= hash >> 31;
+	return hash;
+}
+
+/*
+ * The header page, the first page of the directory and the empty buckets.
+ */
+RC HashIndexManager::createFile(const string &fileName) {
+	if (pfm->createFile(fileName, HASH_FILE_TYPE) != 0)
+		return -1;
+
+	FileHandle fileHandle;
+	if (pfm->openFile(fileName, fileHandle) != 0)
+		return -1;
+
+	char page[PAGE_SIZE];
+	memset(page, 0, PAGE_SIZE);
+	HashHeader header;
+	memset(&header, 0, sizeof(HashHeader));
+	header.keyType = -1;
+	header.bucketCount = HASH_INITIAL_BUCKETS;
+	header.freePages = NO_PAGE;
+	header.directory = DIRECTORY_PAGE;
+	memcpy(page, &header, sizeof(HashHeader));
+	RC rc = fileHandle.appendPage(page);
+
+	memset(page, 0, PAGE_SIZE);
+	DirectoryHeader directoryHeader;
+	directoryHeader.next = NO_PAGE;
+	directoryHeader.count = HASH_INITIAL_BUCKETS;
+	memcpy(page, &directoryHeader, sizeof(DirectoryHeader));
+	for (unsigned i = 0; i < HASH_INITIAL_BUCKETS; ++i) {
+		PageNum bucketPage = DIRECTORY_PAGE + 1 + i;
+		memcpy(page + sizeof(DirectoryHeader) + i * sizeof(PageNum),
+				&bucketPage, sizeof(PageNum));
+	}
+	if (rc == 0)
+		rc = fileHandle.appendPage(page);
+
+	memset(page, 0, PAGE_SIZE);
+	HashPage(page, TypeInt).initialize();
+	for (unsigned i = 0; i < HASH_INITIAL_BUCKETS && rc == 0; ++i)
+		rc = fileHandle.appendPage(page);
+
+	if (pfm->closeFile(fileHandle) != 0)
+		return -1;
+	return rc;
+}
+
+RC HashIndexManager::destroyFile(const string &fileName) {
+	return pfm->destroyFile(fileName);
+}
+
+/*
+ * The first handle opened on the file reads its directory.
+ */
+RC HashIndexManager::openFile(const string &fileName,
+		IXFileHandle &ixfileHandle) {
+	if (ixfileHandle.fileHandle.hasOpenFile()) {
+		cout << "ERROR: the handle is already open on a file" << endl;
+		return -1;
+	}
+	if (pfm->openFile(fileName, ixfileHandle.fileHandle) != 0)
+		return -1;
+	if (ixfileHandle.fileHandle.getFileType() != HASH_FILE_TYPE) {
+		cout << "ERROR: " << fileName << " is not a hash index file" << endl;
+		pfm->closeFile(ixfileHandle.fileHandle);
+		return -1;
+	}
+
+	lock_guard<mutex> lock(directoriesMutex);
+	HashDirectory *&fileDirectory = directories[fileName];
+	if (fileDirectory == NULL) {
+		fileDirectory = new HashDirectory();
+		if (loadDirectory(ixfileHandle, *fileDirectory) != 0) {
+			delete fileDirectory;
+			directories.erase(fileName);
+			pfm->closeFile(ixfileHandle.fileHandle);
+			return -1;
+		}
+	}
+	fileDirectory->handleCount++;
+	return 0;
+}
+
+/*
+ * The last handle closed on the file writes its directory back.
+ */
+RC HashIndexManager::closeFile(IXFileHandle &ixfileHandle) {
+	string fileName = ixfileHandle.fileHandle.getFileName();
+	RC rc = 0;
+	{
+		lock_guard<mutex> lock(directoriesMutex);
+		map<string, HashDirectory*>::iterator it = directories.find(fileName);
+		if (it != directories.end() && --it->second->handleCount == 0) {
+			rc = saveDirectory(ixfileHandle, *it->second);
+			delete it->second;
+			directories.erase(it);
+		}
+	}
+	if (pfm->closeFile(ixfileHandle.fileHandle) != 0)
+		return -1;
+	return rc;
+}
+
+HashDirectory* HashIndexManager::directory(IXFileHandle &ixfileHandle) {
+	lock_guard<mutex> lock(directoriesMutex);
+	map<string, HashDirectory*>::iterator it = directories.find(
+			ixfileHandle.fileHandle.getFileName());
+	if (it == directories.end()) {
+		cout << "ERROR: the hash index is not open" << endl;
+		return NULL;
+	}
+	return it->second;
+}
+
+RC HashIndexManager::loadDirectory(IXFileHandle &ixfileHandle,
+		HashDirectory &directory) {
+	char *page;
+	if (ixfileHandle.fetchPage(0, page) != 0)
+		return -1;
+	HashHeader header;
+	memcpy(&header, page, sizeof(HashHeader));
+	ixfileHandle.unpinPage(0, false);
+
+	directory.handleCount = 0;
+	directory.keyType = header.keyType;
+	directory.level = header.level;
+	directory.next = header.next;
+	directory.entryBytes = header.entryBytes;
+	directory.freePages = header.freePages;
+	directory.buckets.clear();
+	directory.directoryPages.clear();
+
+	PageNum pageNum = header.directory;
+	while (pageNum != NO_PAGE) {
+		if (ixfileHandle.fetchPage(pageNum, page) != 0)
+			return -1;
+		DirectoryHeader directoryHeader;
+		memcpy(&directoryHeader, page, sizeof(DirectoryHeader));
+		const char *entries = page + sizeof(DirectoryHeader);
+		for (unsigned i = 0; i < directoryHeader.count; ++i) {
+			PageNum bucketPage;
+			memcpy(&bucketPage, entries + i * sizeof(PageNum), sizeof(PageNum));
+			directory.buckets.push_back(bucketPage);
+		}
+		ixfileHandle.unpinPage(pageNum, false);
+		directory.directoryPages.push_back(pageNum);
+		pageNum = directoryHeader.next;
+	}
+	directory.savedBuckets = directory.buckets.size();
+
+	if (directory.buckets.size() != header.bucketCount) {
+		cout << "ERROR: the directory of the hash index is corrupted" << endl;
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * The buckets are only ever added, so only the pages of the directory from
+ * the first bucket not saved yet on are written, and new pages are added at
+ * its end.
+ */
+RC HashIndexManager::saveDirectory(IXFileHandle &ixfileHandle,
+		HashDirectory &directory) {
+	unsigned bucketCount = directory.buckets.size();
+	for (unsigned index = directory.savedBuckets / DIRECTORY_ENTRIES;
+			index * DIRECTORY_ENTRIES < bucketCount; ++index) {
+		PageNum pageNum;
+		char *page;
+		if (index == directory.directoryPages.size()) {
+			char newPage[PAGE_SIZE];
+			memset(newPage, 0, PAGE_SIZE);
+			DirectoryHeader directoryHeader;
+			directoryHeader.next = NO_PAGE;
+			directoryHeader.count = 0;
+			memcpy(newPage, &directoryHeader, sizeof(DirectoryHeader));
+			if (ixfileHandle.appendPage(newPage, pageNum) != 0)
+				return -1;
+
+			PageNum previous = directory.directoryPages.back();
+			if (ixfileHandle.fetchPage(previous, page) != 0)
+				return -1;
+			memcpy(page, &pageNum, sizeof(PageNum));
+			ixfileHandle.unpinPage(previous, true);
+			directory.directoryPages.push_back(pageNum);
+		}
+		pageNum = directory.directoryPages[index];
+
+		if (ixfileHandle.fetchPage(pageNum, page) != 0)
+			return -1;
+		unsigned first = index * DIRECTORY_ENTRIES;
+		unsigned count = min((unsigned) DIRECTORY_ENTRIES, bucketCount - first);
+		memcpy(page + sizeof(PageNum), &count, sizeof(unsigned));
+		memcpy(page + sizeof(DirectoryHeader), &directory.buckets[first],
+				count * sizeof(PageNum));
+		ixfileHandle.unpinPage(pageNum, true);
+	}
+	directory.savedBuckets = bucketCount;
+
+	char *page;
+	if (ixfileHandle.fetchPage(0, page) != 0)
+		return -1;
+	HashHeader header;
+	memcpy(&header, page, sizeof(HashHeader));
+	header.keyType = directory.keyType;
+	header.level = directory.level;
+	header.next = directory.next;
+	header.bucketCount = bucketCount;
+	header.entryBytes = directory.entryBytes;
+	header.freePages = directory.freePages;
+	memcpy(page, &header, sizeof(HashHeader));
+	return ixfileHandle.unpinPage(0, true);
+}
+
+/*
+ * The key has to be of the type of the index, and short enough for a page to
+ * hold several of them. With setType, the first key gives its type to the
+ * index.
+ */
+RC HashIndexManager::checkKey(HashDirectory &directory,
+		const Attribute &attribute, const void *key, bool setType) {
+	if (directory.keyType == -1 && setType)
+		directory.keyType = attribute.type;
+	if (directory.keyType != -1 && directory.keyType != attribute.type) {
+		cout << "ERROR: the attribute " << attribute.name
+				<< " is not of the type of the keys of the index" << endl;
+		return -1;
+	}
+
+	if (attribute.type == TypeVarChar) {
+		int length;
+		memcpy(&length, key, sizeof(int));
+		if (length < 0 || length + (int) sizeof(int) > MAX_KEY_SIZE) {
+			cout << "ERROR: keys are at most " << MAX_KEY_SIZE - sizeof(int)
+					<< " characters long" << endl;
+			return -1;
+		}
+	} else if (attribute.type == TypeReal) {
+		float real;
+		memcpy(&real, key, sizeof(float));
+		if (real != real) {
+			cout << "ERROR: NaN cannot be a key" << endl;
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/*
+ * The buckets before next are already split in this round, so their keys are
+ * spread over twice as many buckets.
+ */
+unsigned HashIndexManager::bucketOf(const HashDirectory &directory,
+		const char *key) {
+	unsigned long long hash = hashKey(key, (AttrType) directory.keyType);
+	unsigned long long roundBuckets =
+			(unsigned long long) HASH_INITIAL_BUCKETS << directory.level;
+	unsigned long long bucket = hash & (roundBuckets - 1);
+	if (bucket < directory.next)
+		bucket = hash & (2 * roundBuckets - 1);
+	return bucket;
+}
+
+RC HashIndexManager::insertEntry(IXFileHandle &ixfileHandle,
+		const Attribute &attribute, const void *key, const RID &rid) {
+	HashDirectory *fileDirectory = directory(ixfileHandle);
+	if (fileDirectory == NULL)
+		return -1;
+
+	unique_lock<shared_mutex> fileLock(
+			ixfileHandle.fileHandle.getRecordLock());
+	if (checkKey(*fileDirectory, attribute, key, true) != 0)
+		return -1;
+	if (addToBucket(ixfileHandle, *fileDirectory,
+			bucketOf(*fileDirectory, (const char*) key), (const char*) key, rid,
+			true) != 0)
+		return -1;
+	fileDirectory->entryBytes += HashPage::entryLength(
+			BTreePage::keyLength((const char*) key, attribute.type));
+
+	unsigned long long capacity = (unsigned long long) HashPage::capacity()
+			* fileDirectory->buckets.size();
+	if (fileDirectory->entryBytes * 100 > capacity * HASH_MAX_FILL)
+		return splitBucket(ixfileHandle, *fileDirectory);
+	return 0;
+}
+
+/*
+ * Add the entry to the first page of the bucket with room for it, or to a new
+ * overflow page at the end of its chain. With checkDuplicate, the whole chain
+ * is checked first.
+ */
+RC HashIndexManager::addToBucket(IXFileHandle &ixfileHandle,
+		HashDirectory &directory, unsigned bucket, const char *key,
+		const RID &rid, bool checkDuplicate) {
+	AttrType keyType = (AttrType) directory.keyType;
+	int length = HashPage::entryLength(BTreePage::keyLength(key, keyType));
+	PageNum target = NO_PAGE;
+	PageNum last = NO_PAGE;
+	PageNum pageNum = directory.buckets[bucket];
+	while (pageNum != NO_PAGE) {
+		char *page;
+		if (ixfileHandle.fetchPage(pageNum, page) != 0)
+			return -1;
+		HashPage hashPage(page, keyType);
+		if (checkDuplicate && hashPage.find(key, rid) != -1) {
+			ixfileHandle.unpinPage(pageNum, false);
+			cout << "ERROR: the entry is already in the index" << endl;
+			return -1;
+		}
+		if (target == NO_PAGE && hashPage.getFreeSpace() >= length) {
+			if (!checkDuplicate) {
+				hashPage.insert(key, rid);
+				return ixfileHandle.unpinPage(pageNum, true);
+			}
+			target = pageNum;
+		}
+		last = pageNum;
+		PageNum next = hashPage.getNext();
+		ixfileHandle.unpinPage(pageNum, false);
+		pageNum = next;
+	}
+
+	if (target == NO_PAGE) {
+		if (allocatePage(ixfileHandle, directory, target) != 0)
+			return -1;
+		char *page;
+		if (ixfileHandle.fetchPage(last, page) != 0)
+			return -1;
+		HashPage(page, keyType).setNext(target);
+		ixfileHandle.unpinPage(last, true);
+	}
+
+	char *page;
+	if (ixfileHandle.fetchPage(target, page) != 0)
+		return -1;
+	HashPage(page, keyType).insert(key, rid);
+	return ixfileHandle.unpinPage(target, true);
+}
+
+/*
+ * Split the next bucket of the round: its entries are spread between it and a
+ * new bucket at the end, according to one more bit of their hash. Its overflow
+ * pages are freed first, so that they can be reused right away.
+ */
+RC HashIndexManager::splitBucket(IXFileHandle &ixfileHandle,
+		HashDirectory &directory) {
+	AttrType keyType = (AttrType) directory.keyType;
+	unsigned bucket = directory.next;
+
+	//take the entries out of the bucket
+	vector<char> entries;
+	PageNum pageNum = directory.buckets[bucket];
+	while (pageNum != NO_PAGE) {
+		char *page;
+		if (ixfileHandle.fetchPage(pageNum, page) != 0)
+			return -1;
+		HashPage hashPage(page, keyType);
+		entries.insert(entries.end(), page + hashPage.begin(),
+				page + hashPage.end());
+		PageNum next = hashPage.getNext();
+		hashPage.initialize();
+		ixfileHandle.unpinPage(pageNum, true);
+		if (pageNum != directory.buckets[bucket]
+				&& freePage(ixfileHandle, directory, pageNum) != 0)
+			return -1;
+		pageNum = next;
+	}
+
+	PageNum newBucket;
+	if (allocatePage(ixfileHandle, directory, newBucket) != 0)
+		return -1;
+	directory.buckets.push_back(newBucket);
+	directory.next++;
+	if (directory.next == (unsigned) HASH_INITIAL_BUCKETS << directory.level) {
+		directory.level++;
+		directory.next = 0;
+	}
+
+	for (unsigned offset = 0; offset < entries.size();) {
+		const char *key = &entries[offset];
+		int keyLength = BTreePage::keyLength(key, keyType);
+		RID rid;
+		memcpy(&rid.pageNum, key + keyLength, sizeof(unsigned));
+		memcpy(&rid.slotNum, key + keyLength + sizeof(unsigned),
+				sizeof(unsigned));
+		if (addToBucket(ixfileHandle, directory, bucketOf(directory, key), key,
+				rid, false) != 0)
+			return -1;
+		offset += HashPage::entryLength(keyLength);
+	}
+	return 0;
+}
+
+/*
+ * An empty page, taken from the free pages if there are any.
+ */
+RC HashIndexManager::allocatePage(IXFileHandle &ixfileHandle,
+		HashDirectory &directory, PageNum &pageNum) {
+	char *page;
+	if (directory.freePages != NO_PAGE) {
+		pageNum = directory.freePages;
+		if (ixfileHandle.fetchPage(pageNum, page) != 0)
+			return -1;
+		HashPage hashPage(page, (AttrType) directory.keyType);
+		directory.freePages = hashPage.getNext();
+		hashPage.initialize();
+		return ixfileHandle.unpinPage(pageNum, true);
+	}
+
+	char newPage[PAGE_SIZE];
+	memset(newPage, 0, PAGE_SIZE);
+	HashPage(newPage, (AttrType) directory.keyType).initialize();
+	return ixfileHandle.appendPage(newPage, pageNum);
+}
+
+RC HashIndexManager::freePage(IXFileHandle &ixfileHandle,
+		HashDirectory &directory, PageNum pageNum) {
+	char *page;
+	if (ixfileHandle.fetchPage(pageNum, page) != 0)
+		return -1;
+	HashPage hashPage(page, (AttrType) directory.keyType);
+	hashPage.initialize();
+	hashPage.setNext(directory.freePages);
+	directory.freePages = pageNum;
+	return ixfileHandle.unpinPage(pageNum, true);
+}
+
+/*
+ * An overflow page left empty leaves the chain of its bucket.
+ */
+RC HashIndexManager::deleteEntry(IXFileHandle &ixfileHandle,
+		const Attribute &attribute, const void *key, const RID &rid) {
+	HashDirectory *fileDirectory = directory(ixfileHandle);
+	if (fileDirectory == NULL)
+		return -1;
+
+	unique_lock<shared_mutex> fileLock(
+			ixfileHandle.fileHandle.getRecordLock());
+	if (checkKey(*fileDirectory, attribute, key, false) != 0)
+		return -1;
+
+	AttrType keyType = attribute.type;
+	PageNum previous = NO_PAGE;
+	PageNum pageNum = fileDirectory->buckets[bucketOf(*fileDirectory,
+			(const char*) key)];
+	while (pageNum != NO_PAGE) {
+		char *page;
+		if (ixfileHandle.fetchPage(pageNum, page) != 0)
+			return -1;
+		HashPage hashPage(page, keyType);
+		int offset = hashPage.find((const char*) key, rid);
+		PageNum next = hashPage.getNext();
+		if (offset == -1) {
+			ixfileHandle.unpinPage(pageNum, false);
+			previous = pageNum;
+			pageNum = next;
+			continue;
+		}
+
+		hashPage.erase(offset);
+		fileDirectory->entryBytes -= HashPage::entryLength(
+				BTreePage::keyLength((const char*) key, keyType));
+		bool unlink = previous != NO_PAGE && hashPage.getCount() == 0;
+		ixfileHandle.unpinPage(pageNum, true);
+		if (!unlink)
+			return 0;
+
+		if (ixfileHandle.fetchPage(previous, page) != 0)
+			return -1;
+		HashPage(page, keyType).setNext(next);
+		ixfileHandle.unpinPage(previous, true);
+		return freePage(ixfileHandle, *fileDirectory, pageNum);
+	}
+
+	cout << "ERROR: the entry is not in the index" << endl;
+	return -1;
+}
+
+RC HashIndexManager::findEntries(IXFileHandle &ixfileHandle,
+		const Attribute &attribute, const void *key, vector<RID> &rids) {
+	rids.clear();
+	HashDirectory *fileDirectory = directory(ixfileHandle);
+	if (fileDirectory == NULL)
+		return -1;
+
+	shared_lock<shared_mutex> fileLock(
+			ixfileHandle.fileHandle.getRecordLock());
+	if (checkKey(*fileDirectory, attribute, key, false) != 0)
+		return -1;
+	if (fileDirectory->keyType == -1)
+		return 0;
+
+	AttrType keyType = attribute.type;
+	PageNum pageNum = fileDirectory->buckets[bucketOf(*fileDirectory,
+			(const char*) key)];
+	while (pageNum != NO_PAGE) {
+		char *page;
+		if (ixfileHandle.fetchPage(pageNum, page) != 0)
+			return -1;
+		HashPage hashPage(page, keyType);
+		for (int offset = hashPage.begin(); offset < hashPage.end(); offset =
+				hashPage.nextEntry(offset))
+			if (BTreePage::compareKeys(hashPage.key(offset), (const char*) key,
+					keyType) == 0)
+				rids.push_back(hashPage.rid(offset));
+		PageNum next = hashPage.getNext();
+		ixfileHandle.unpinPage(pageNum, false);
+		pageNum = next;
+	}
+	return 0;
+}
+
+unsigned HashIndexManager::getBucketCount(IXFileHandle &ixfileHandle) {
+	HashDirectory *fileDirectory = directory(ixfileHandle);
+	if (fileDirectory == NULL)
+		return 0;
+	shared_lock<shared_mutex> fileLock(
+			ixfileHandle.fileHandle.getRecordLock());
+	return fileDirectory->buckets.size();
+}
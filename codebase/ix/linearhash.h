@@ -0,0 +1,107 @@
+#ifndef _linearhash_h_
+#define _linearhash_h_
+
+#include <vector>
+#include <string>
+#include <map>
+#include <mutex>
+
+#include "ix.h"
+
+using namespace std;
+
+#define HASH_FILE_TYPE 17        // file type of the hash index files
+#define HASH_INITIAL_BUCKETS 4   // buckets of a new index, a power of two
+#define HASH_MAX_FILL 60         // percentage of the bucket pages used before a split
+
+// Buckets of an open hash index, shared by the handles open on it. The
+// directory is read when the first handle is opened, and written back when the
+// last one is closed.
+struct HashDirectory {
+	int handleCount;
+	int keyType;                  // -1 until the first entry
+	unsigned level;               // HASH_INITIAL_BUCKETS << level buckets at the start
+	unsigned next;                // of the round, of which next are already split
+	unsigned long long entryBytes; // size of all the entries
+	PageNum freePages;            // chain of the overflow pages no longer used
+	vector<PageNum> buckets;      // primary page of each bucket
+	vector<PageNum> directoryPages; // pages of the file that keep buckets
+	unsigned savedBuckets;        // buckets already in directoryPages
+};
+
+/*
+ * The HashIndexManager keeps linear hash indexes of the records of a file, for
+ * lookups of a key, in index files of their own. An entry maps a key (an int, a
+ * real or a varchar, in the format of the API) to a rid; a key may have any
+ * number of rids. The entries of a bucket are in its primary page, and then in
+ * a chain of overflow pages when it is full (see HashPage).
+ *
+ * The number of buckets grows one bucket at a time: when the entries would fill
+ * more than HASH_MAX_FILL percent of the bucket pages, the next bucket of the
+ * round is split in two, so an insert never moves more than one bucket. With
+ * the primary page of every bucket known from the directory, kept in memory,
+ * finding a key reads one page unless its bucket has overflowed.
+ *
+ * The buckets don't merge back when entries are deleted; the overflow pages
+ * left empty are reused.
+ */
+class HashIndexManager {
+
+public:
+	static HashIndexManager* instance();
+
+	// Create a hash index file, with HASH_INITIAL_BUCKETS empty buckets
+	RC createFile(const string &fileName);
+
+	// Delete a hash index file
+	RC destroyFile(const string &fileName);
+
+	// Open a hash index and return an ixfileHandle
+	RC openFile(const string &fileName, IXFileHandle &ixfileHandle);
+
+	// Close an ixfileHandle, writing the directory back with the last one
+	RC closeFile(IXFileHandle &ixfileHandle);
+
+	// Insert an entry into the index of the ixfileHandle
+	RC insertEntry(IXFileHandle &ixfileHandle, const Attribute &attribute,
+			const void *key, const RID &rid);
+
+	// Delete an entry from the index of the ixfileHandle
+	RC deleteEntry(IXFileHandle &ixfileHandle, const Attribute &attribute,
+			const void *key, const RID &rid);
+
+	// Get the rids of the entries of the key
+	RC findEntries(IXFileHandle &ixfileHandle, const Attribute &attribute,
+			const void *key, vector<RID> &rids);
+
+	unsigned getBucketCount(IXFileHandle &ixfileHandle);
+
+protected:
+	HashIndexManager();
+	~HashIndexManager();
+
+private:
+	static HashIndexManager *_hash_manager;
+	PagedFileManager *pfm;
+
+	map<string, HashDirectory*> directories; // of the open files, by file name
+	mutex directoriesMutex;
+
+	HashDirectory* directory(IXFileHandle &ixfileHandle);
+	RC loadDirectory(IXFileHandle &ixfileHandle, HashDirectory &directory);
+	RC saveDirectory(IXFileHandle &ixfileHandle, HashDirectory &directory);
+
+	RC checkKey(HashDirectory &directory, const Attribute &attribute,
+			const void *key, bool setType);
+	unsigned bucketOf(const HashDirectory &directory, const char *key);
+	RC addToBucket(IXFileHandle &ixfileHandle, HashDirectory &directory,
+			unsigned bucket, const char *key, const RID &rid,
+			bool checkDuplicate);
+	RC splitBucket(IXFileHandle &ixfileHandle, HashDirectory &directory);
+	RC allocatePage(IXFileHandle &ixfileHandle, HashDirectory &directory,
+			PageNum &pageNum);
+	RC freePage(IXFileHandle &ixfileHandle, HashDirectory &directory,
+			PageNum pageNum);
+};
+
+#endif
@@ -0,0 +1,441 @@
+#include "bpm.h"
+
+/****************************************************************************
+ ******************************* CLOCK POLICY *******************************
+ ****************************************************************************/
+
+ClockPolicy::ClockPolicy(unsigned numFrames) {
+	reset(numFrames);
+}
+
+void ClockPolicy::reset(unsigned numFrames) {
+	referenced.assign(numFrames, false);
+	evictable.assign(numFrames, false);
+	hand = 0;
+	evictableCount = 0;
+}
+
+void ClockPolicy::recordAccess(FrameId frameId) {
+	referenced[frameId] = true;
+}
+
+void ClockPolicy::setEvictable(FrameId frameId, bool evictable) {
+	if (this->evictable[frameId] != evictable) {
+		this->evictable[frameId] = evictable;
+		if (evictable)
+			evictableCount++;
+		else
+			evictableCount--;
+	}
+}
+
+/*
+ * Sweep the frames starting from the clock hand. A referenced frame gets
+ * a second chance (its bit is cleared), the first evictable frame found with
+ * its bit cleared is the victim.
+ */
+bool ClockPolicy::evict(FrameId &frameId) {
+	if (evictableCount == 0)
+		return false;
+
+	unsigned n = evictable.size();
+	while (true) {
+		if (evictable[hand]) {
+			if (referenced[hand]) {
+				referenced[hand] = false;
+			} else {
+				frameId = hand;
+				evictable[hand] = false;
+				evictableCount--;
+				hand = (hand + 1) % n;
+				return true;
+			}
+		}
+		hand = (hand + 1) % n;
+	}
+}
+
+void ClockPolicy::remove(FrameId frameId) {
+	setEvictable(frameId, false);
+	referenced[frameId] = false;
+}
+
+/****************************************************************************
+ ******************************* LRU-K POLICY *******************************
+ ****************************************************************************/
+
+LRUKPolicy::LRUKPolicy(unsigned numFrames, unsigned k) {
+	this->k = k > 0 ? k : 1;
+	reset(numFrames);
+}
+
+void LRUKPolicy::reset(unsigned numFrames) {
+	currentTime = 0;
+	history.assign(numFrames, vector<unsigned long long>());
+	evictable.assign(numFrames, false);
+	evictableCount = 0;
+}
+
+void LRUKPolicy::recordAccess(FrameId frameId) {
+	vector<unsigned long long> &h = history[frameId];
+	if (h.size() == k)
+		h.erase(h.begin());
+	h.push_back(currentTime++);
+}
+
+void LRUKPolicy::setEvictable(FrameId frameId, bool evictable) {
+	if (this->evictable[frameId] != evictable) {
+		this->evictable[frameId] = evictable;
+		if (evictable)
+			evictableCount++;
+		else
+			evictableCount--;
+	}
+}
+
+/*
+ * The victim is the evictable frame with the largest backward K-distance.
+ * Frames with less than K recorded accesses have an infinite distance, and
+ * among them we pick the one whose first access is the oldest.
+ */
+bool LRUKPolicy::evict(FrameId &frameId) {
+	if (evictableCount == 0)
+		return false;
+
+	int victim = -1;
+	bool victimInfinite = false;
+	unsigned long long victimTime = 0;
+
+	for (unsigned i = 0; i < history.size(); ++i) {
+		if (!evictable[i])
+			continue;
+		bool infinite = history[i].size() < k;
+		//the oldest access kept is the k-th most recent one
+		unsigned long long t = history[i].empty() ? 0 : history[i].front();
+		if (victim == -1 || (infinite && !victimInfinite)
+				|| (infinite == victimInfinite && t < victimTime)) {
+			victim = i;
+			victimInfinite = infinite;
+			victimTime = t;
+		}
+	}
+
+	frameId = victim;
+	remove(victim);
+	return true;
+}
+
+void LRUKPolicy::remove(FrameId frameId) {
+	setEvictable(frameId, false);
+	history[frameId].clear();
+}
+
+/****************************************************************************
+ ****************************** BUFFER MANAGER ******************************
+ ****************************************************************************/
+
+BufferManager* BufferManager::_bp_manager = NULL;
+
+BufferManager* BufferManager::instance() {
+	if (!_bp_manager)
+		_bp_manager = new BufferManager();
+
+	return _bp_manager;
+}
+
+BufferManager::BufferManager() {
+	numFrames = DEFAULT_POOL_SIZE;
+	frameData = (char*) malloc(numFrames * PAGE_SIZE);
+	frames.resize(numFrames);
+	policy = new ClockPolicy(numFrames);
+	resetPool();
+}
+
+BufferManager::~BufferManager() {
+	free(frameData);
+	delete policy;
+}
+
+char* BufferManager::frameAddress(FrameId frameId) {
+	return frameData + (size_t) frameId * PAGE_SIZE;
+}
+
+/*
+ * Empty every frame. All the frames are expected to be clean and unpinned.
+ */
+RC BufferManager::resetPool() {
+	pageTable.clear();
+	freeFrames.clear();
+	for (int i = numFrames - 1; i >= 0; --i) {
+		frames[i].used = false;
+		frames[i].dirty = false;
+		frames[i].pinCount = 0;
+		frames[i].fileHandle = NULL;
+		frames[i].fileName.clear();
+		freeFrames.push_back(i);
+	}
+	policy->reset(numFrames);
+	return 0;
+}
+
+/*
+ * Write the page cached in the frame back to its file, if it is dirty. If the
+ * file handle has a write back hook and the page is not pinned, the hook gets
+ * to modify the page first.
+ */
+RC BufferManager::writeBack(FrameId frameId) {
+	Frame &frame = frames[frameId];
+	if (frame.used && frame.dirty) {
+		if (frame.fileHandle != NULL && frame.pinCount == 0
+				&& frame.fileHandle->getWriteBackHook() != NULL)
+			frame.fileHandle->getWriteBackHook()(*frame.fileHandle,
+					frameAddress(frameId));
+		if (frame.fileHandle == NULL
+				|| frame.fileHandle->writePage(frame.pageNum,
+						frameAddress(frameId)) != 0) {
+			cout << "ERROR: could not write back page " << frame.pageNum
+					<< " of file " << frame.fileName << endl;
+			return -1;
+		}
+		frame.dirty = false;
+	}
+	return 0;
+}
+
+/*
+ * Get a frame to load a new page into: either a free one or one chosen
+ * by the replacement policy (whose page is written back if dirty).
+ */
+RC BufferManager::getVictimFrame(FrameId &frameId) {
+	if (!freeFrames.empty()) {
+		frameId = freeFrames.back();
+		freeFrames.pop_back();
+		return 0;
+	}
+
+	if (!policy->evict(frameId)) {
+		cout << "ERROR: all the " << numFrames
+				<< " frames of the buffer pool are pinned" << endl;
+		return -1;
+	}
+
+	if (writeBack(frameId) != 0) {
+		policy->setEvictable(frameId, true);
+		return -1;
+	}
+
+	Frame &frame = frames[frameId];
+	pageTable.erase(make_pair(frame.fileName, frame.pageNum));
+	frame.used = false;
+	frame.fileHandle = NULL;
+	return 0;
+}
+
+RC BufferManager::fetchPage(FileHandle &fileHandle, PageNum pageNum,
+		char *&data) {
+	lock_guard<mutex> lock(poolMutex);
+
+	pair<string, PageNum> key(fileHandle.getFileName(), pageNum);
+	map<pair<string, PageNum>, FrameId>::iterator it = pageTable.find(key);
+
+	//hit: the page is already cached
+	if (it != pageTable.end()) {
+		FrameId frameId = it->second;
+		Frame &frame = frames[frameId];
+		frame.pinCount++;
+		policy->recordAccess(frameId);
+		policy->setEvictable(frameId, false);
+		data = frameAddress(frameId);
+		return 0;
+	}
+
+	//memory-mapped files are not cached: the page is used in place
+	if (fileHandle.isMemoryMapped()) {
+		data = fileHandle.getPagePointer(pageNum);
+		return data != NULL ? 0 : -1;
+	}
+
+	//miss: bring the page into a frame
+	FrameId frameId;
+	if (getVictimFrame(frameId) != 0)
+		return -1;
+
+	if (fileHandle.readPage(pageNum, frameAddress(frameId)) != 0) {
+		freeFrames.push_back(frameId);
+		return -1;
+	}
+
+	Frame &frame = frames[frameId];
+	frame.fileName = key.first;
+	frame.pageNum = pageNum;
+	frame.fileHandle = &fileHandle;
+	frame.pinCount = 1;
+	frame.dirty = false;
+	frame.used = true;
+	pageTable[key] = frameId;
+
+	policy->recordAccess(frameId);
+	policy->setEvictable(frameId, false);
+	data = frameAddress(frameId);
+	return 0;
+}
+
+RC BufferManager::unpinPage(FileHandle &fileHandle, PageNum pageNum,
+		bool dirty) {
+	lock_guard<mutex> lock(poolMutex);
+
+	map<pair<string, PageNum>, FrameId>::iterator it = pageTable.find(
+			make_pair(fileHandle.getFileName(), pageNum));
+
+	if (it == pageTable.end()) {
+		//a page used in place in the mapping of the file: changes made
+		//to it are written back by the kernel
+		if (fileHandle.isMemoryMapped())
+			return 0;
+		cout << "ERROR: page " << pageNum << " of file "
+				<< fileHandle.getFileName() << " is not in the buffer pool"
+				<< endl;
+		return -1;
+	}
+
+	Frame &frame = frames[it->second];
+	if (frame.pinCount <= 0) {
+		cout << "ERROR: page " << pageNum << " is not pinned" << endl;
+		return -1;
+	}
+
+	if (dirty) {
+		frame.dirty = true;
+		//the page will be written back through the last handle that modified it
+		frame.fileHandle = &fileHandle;
+	}
+
+	frame.pinCount--;
+	if (frame.pinCount == 0)
+		policy->setEvictable(it->second, true);
+
+	return 0;
+}
+
+/*
+ * The page is appended right away (so that it exists on disk), and a copy
+ * is kept in the pool since new pages are likely to be used again soon.
+ */
+RC BufferManager::appendPage(FileHandle &fileHandle, const void *data,
+		PageNum &pageNum) {
+	lock_guard<mutex> lock(poolMutex);
+
+	if (fileHandle.appendPage(data) != 0)
+		return -1;
+
+	pageNum = fileHandle.getNumberOfPages() - 1;
+
+	if (fileHandle.isMemoryMapped())
+		return 0;
+
+	FrameId frameId;
+	if (getVictimFrame(frameId) != 0)
+		return 0; //the page is on disk anyway, we just don't cache it
+
+	memcpy(frameAddress(frameId), data, PAGE_SIZE);
+
+	Frame &frame = frames[frameId];
+	frame.fileName = fileHandle.getFileName();
+	frame.pageNum = pageNum;
+	frame.fileHandle = &fileHandle;
+	frame.pinCount = 0;
+	frame.dirty = false;
+	frame.used = true;
+	pageTable[make_pair(frame.fileName, pageNum)] = frameId;
+
+	policy->recordAccess(frameId);
+	policy->setEvictable(frameId, true);
+	return 0;
+}
+
+/*
+ * Every dirty page of the file is written back through the given handle
+ * (any handle open on the file will do).
+ */
+RC BufferManager::flushFile(FileHandle &fileHandle) {
+	lock_guard<mutex> lock(poolMutex);
+	string fileName = fileHandle.getFileName();
+	RC rc = 0;
+	for (unsigned i = 0; i < numFrames; ++i) {
+		Frame &frame = frames[i];
+		if (frame.used && frame.dirty && frame.fileName == fileName) {
+			frame.fileHandle = &fileHandle;
+			if (writeBack(i) != 0)
+				rc = -1;
+		}
+	}
+	return rc;
+}
+
+void BufferManager::discardFile(const string &fileName) {
+	lock_guard<mutex> lock(poolMutex);
+	for (unsigned i = 0; i < numFrames; ++i) {
+		Frame &frame = frames[i];
+		if (frame.used && frame.fileName == fileName) {
+			if (frame.pinCount > 0)
+				cout << "WARNING: discarding page " << frame.pageNum
+						<< " of file " << fileName << " while it is pinned"
+						<< endl;
+			pageTable.erase(make_pair(frame.fileName, frame.pageNum));
+			policy->remove(i);
+			frame.used = false;
+			frame.dirty = false;
+			frame.pinCount = 0;
+			frame.fileHandle = NULL;
+			frame.fileName.clear();
+			freeFrames.push_back(i);
+		}
+	}
+}
+
+RC BufferManager::setPoolSize(unsigned numFrames) {
+	lock_guard<mutex> lock(poolMutex);
+	if (numFrames == 0)
+		return -1;
+
+	for (unsigned i = 0; i < this->numFrames; ++i) {
+		if (frames[i].used && frames[i].pinCount > 0) {
+			cout << "ERROR: cannot resize the buffer pool while pages are pinned"
+					<< endl;
+			return -1;
+		}
+		if (writeBack(i) != 0)
+			return -1;
+	}
+
+	free(frameData);
+	this->numFrames = numFrames;
+	frameData = (char*) malloc(numFrames * PAGE_SIZE);
+	frames.resize(numFrames);
+	return resetPool();
+}
+
+RC BufferManager::setReplacementPolicy(ReplacementPolicy *policy) {
+	lock_guard<mutex> lock(poolMutex);
+	if (policy == NULL)
+		return -1;
+
+	for (unsigned i = 0; i < numFrames; ++i) {
+		if (frames[i].used && frames[i].pinCount > 0) {
+			cout
+					<< "ERROR: cannot change the replacement policy while pages are pinned"
+					<< endl;
+			return -1;
+		}
+		if (writeBack(i) != 0)
+			return -1;
+	}
+
+	delete this->policy;
+	this->policy = policy;
+	return resetPool();
+}
+
+unsigned BufferManager::getPoolSize() {
+	return numFrames;
+}
@@ -0,0 +1,133 @@
+#ifndef _bpm_h_
+#define _bpm_h_
+
+#include <vector>
+#include <map>
+#include <mutex>
+
+#include "pfm.h"
+
+using namespace std;
+
+#define DEFAULT_POOL_SIZE 256 // number of frames (1 MB of pages)
+#define DEFAULT_LRU_K 2
+
+typedef int FrameId;
+
+/*
+ * A replacement policy decides which frame of the buffer pool is evicted
+ * when a page has to be brought in and there are no free frames. The buffer
+ * manager tells the policy every time a frame is accessed and whether the
+ * frame can be evicted (i.e. it is not pinned).
+ */
+class ReplacementPolicy {
+public:
+	virtual ~ReplacementPolicy() {
+	}
+	virtual void reset(unsigned numFrames) = 0; // forget everything, resize
+	virtual void recordAccess(FrameId frameId) = 0; // the frame was pinned
+	virtual void setEvictable(FrameId frameId, bool evictable) = 0;
+	virtual bool evict(FrameId &frameId) = 0; // pick a victim, false if none
+	virtual void remove(FrameId frameId) = 0; // the frame became free
+};
+
+// Second chance (CLOCK) replacement
+class ClockPolicy: public ReplacementPolicy {
+public:
+	ClockPolicy(unsigned numFrames);
+	void reset(unsigned numFrames);
+	void recordAccess(FrameId frameId);
+	void setEvictable(FrameId frameId, bool evictable);
+	bool evict(FrameId &frameId);
+	void remove(FrameId frameId);
+
+private:
+	vector<bool> referenced;
+	vector<bool> evictable;
+	unsigned hand;
+	unsigned evictableCount;
+};
+
+// LRU-K replacement: evicts the frame whose K-th most recent access is the
+// oldest. Frames with less than K accesses are evicted first, in LRU order
+// of their earliest access.
+class LRUKPolicy: public ReplacementPolicy {
+public:
+	LRUKPolicy(unsigned numFrames, unsigned k = DEFAULT_LRU_K);
+	void reset(unsigned numFrames);
+	void recordAccess(FrameId frameId);
+	void setEvictable(FrameId frameId, bool evictable);
+	bool evict(FrameId &frameId);
+	void remove(FrameId frameId);
+
+private:
+	unsigned k;
+	unsigned long long currentTime;
+	vector<vector<unsigned long long> > history; // last k accesses, oldest first
+	vector<bool> evictable;
+	unsigned evictableCount;
+};
+
+// A frame of the buffer pool
+struct Frame {
+	string fileName;        // file the cached page belongs to
+	PageNum pageNum;        // cached page
+	FileHandle *fileHandle; // handle used to write the page back
+	int pinCount;
+	bool dirty;
+	bool used;              // whether the frame holds a page at all
+};
+
+/*
+ * The BufferManager caches data pages between the RecordBasedFileManager and
+ * the FileHandle. Pages are pinned with fetchPage and released with
+ * unpinPage; a pinned page is never evicted. Dirty pages are written back
+ * when they are evicted and when their file is closed. All the methods are
+ * thread safe; a page with several pins may be used by several threads.
+ * Pages of memory-mapped files are not cached, unless another handle already
+ * brought them into the pool: fetchPage returns their address in the mapping.
+ */
+class BufferManager {
+public:
+	static BufferManager* instance();
+
+	// Pin the page pageNum of the file and return a pointer to its frame
+	RC fetchPage(FileHandle &fileHandle, PageNum pageNum, char *&data);
+	// Release a page pinned by fetchPage, marking it dirty if it was modified
+	RC unpinPage(FileHandle &fileHandle, PageNum pageNum, bool dirty);
+	// Append a page to the file and cache it (unpinned)
+	RC appendPage(FileHandle &fileHandle, const void *data, PageNum &pageNum);
+
+	// Write back all the dirty pages of the file
+	RC flushFile(FileHandle &fileHandle);
+	// Drop every cached page of the file, without writing them back
+	void discardFile(const string &fileName);
+
+	// Both flush and empty the pool. They fail if some page is still pinned.
+	RC setPoolSize(unsigned numFrames);
+	RC setReplacementPolicy(ReplacementPolicy *policy); // takes ownership
+
+	unsigned getPoolSize();
+
+protected:
+	BufferManager();
+	~BufferManager();
+
+private:
+	static BufferManager *_bp_manager;
+
+	unsigned numFrames;
+	char *frameData;
+	vector<Frame> frames;
+	vector<FrameId> freeFrames;
+	map<pair<string, PageNum>, FrameId> pageTable; // (file, page) -> frame
+	ReplacementPolicy *policy;
+	mutex poolMutex; // protects the frames, the page table and the policy
+
+	RC getVictimFrame(FrameId &frameId);
+	RC writeBack(FrameId frameId);
+	RC resetPool();
+	char* frameAddress(FrameId frameId);
+};
+
+#endif
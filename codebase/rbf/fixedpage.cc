@@ -0,0 +1,203 @@
+#include "fixedpage.h"
+
+typedef void (*FixedEncoder)(const char *data, char *values,
+		unsigned char *nulls);
+typedef void (*FixedDecoder)(const char *values, const unsigned char *nulls,
+		char *data);
+
+//encodeFixedRecord and decodeFixedRecord of every number of fields up to
+//MAX_UNROLLED_FIELDS, indexed by the number of fields
+template<int N>
+struct FixedCodecTable {
+	static void fill(FixedEncoder *encoders, FixedDecoder *decoders) {
+		encoders[N] = encodeFixedRecord<N>;
+		decoders[N] = decodeFixedRecord<N>;
+		FixedCodecTable<N - 1>::fill(encoders, decoders);
+	}
+};
+
+template<>
+struct FixedCodecTable<0> {
+	static void fill(FixedEncoder *encoders, FixedDecoder *decoders) {
+		encoders[0] = NULL;
+		decoders[0] = NULL;
+	}
+};
+
+static FixedEncoder fixedEncoders[MAX_UNROLLED_FIELDS + 1];
+static FixedDecoder fixedDecoders[MAX_UNROLLED_FIELDS + 1];
+static bool fixedCodecsReady = (FixedCodecTable<MAX_UNROLLED_FIELDS>::fill(
+		fixedEncoders, fixedDecoders), true);
+
+//the same loops for wider schemas, with the number of fields known at run time
+static void encodeFixedRecord(int attrNum, const char *data, char *values,
+		unsigned char *nulls) {
+	static const char zeros[4] = { 0, 0, 0, 0 };
+	int nullsSize = (attrNum + 7) / 8;
+	memcpy(nulls, data, nullsSize);
+	const char *in = data + nullsSize;
+	for (int i = 0; i < attrNum; ++i) {
+		int null = (nulls[i >> 3] >> (7 - (i & 7))) & 1;
+		memcpy(values + 4 * i, null ? zeros : in, 4);
+		in += 4 - 4 * null;
+	}
+}
+
+static void decodeFixedRecord(int attrNum, const char *values,
+		const unsigned char *nulls, char *data) {
+	char skipped[4];
+	int nullsSize = (attrNum + 7) / 8;
+	memcpy(data, nulls, nullsSize);
+	char *out = data + nullsSize;
+	for (int i = 0; i < attrNum; ++i) {
+		int null = (nulls[i >> 3] >> (7 - (i & 7))) & 1;
+		memcpy(null ? skipped : out, values + 4 * i, 4);
+		out += 4 - 4 * null;
+	}
+}
+
+FixedPage::FixedPage(char *page, int attrNum) {
+	setLayout(page, attrNum);
+}
+
+FixedPage::FixedPage(char *page) {
+	short attrNum;
+	memcpy(&attrNum, page + PAGE_SIZE - 6, sizeof(short));
+	setLayout(page, attrNum);
+}
+
+void FixedPage::setLayout(char *page, int attrNum) {
+	this->page = page;
+	this->attrNum = attrNum;
+	nullsSize = (attrNum + 7) / 8;
+	stride = attrNum * sizeof(int);
+	slots = capacity(attrNum);
+	nullsArea = page + slots * stride;
+	usedBitmap = (unsigned char*) nullsArea + slots * nullsSize;
+}
+
+/*
+ * Largest number of slots whose values, null bits and bit in the bitmap of used
+ * slots fit in a page, along with the footer.
+ */
+int FixedPage::capacity(int attrNum) {
+	if (attrNum <= 0)
+		return 0;
+	int slotSize = attrNum * sizeof(int) + (attrNum + 7) / 8;
+	int slots = 8 * (PAGE_SIZE - 6) / (8 * slotSize + 1);
+	while (slots > 0 && slots * slotSize + (slots + 7) / 8 > PAGE_SIZE - 6)
+		slots--;
+	return slots;
+}
+
+void FixedPage::initialize() {
+	memset(usedBitmap, 0, (slots + 7) / 8);
+	setFooter(0, attrNum);
+	setFooter(1, 0);
+	setFooter(2, 0);
+}
+
+int FixedPage::getNumberOfFields() const {
+	return attrNum;
+}
+
+int FixedPage::getSlotsNumber() const {
+	return getFooter(1);
+}
+
+int FixedPage::getUsedCount() const {
+	return getFooter(2);
+}
+
+short FixedPage::getFreeSpace() const {
+	return (slots - getUsedCount()) * stride;
+}
+
+bool FixedPage::isUsed(int slot) const {
+	return slot >= 0 && slot < getSlotsNumber()
+			&& (usedBitmap[slot / 8] & (1 << (slot % 8))) != 0;
+}
+
+bool FixedPage::isNull(int slot, int fieldIndex) const {
+	return nullsArea[slot * nullsSize + fieldIndex / 8]
+			& (1 << (7 - fieldIndex % 8));
+}
+
+const char* FixedPage::field(int slot, int fieldIndex) const {
+	return page + slot * stride + fieldIndex * sizeof(int);
+}
+
+const unsigned char* FixedPage::nullBits(int slot) const {
+	return (const unsigned char*) nullsArea + slot * nullsSize;
+}
+
+/*
+ * Store the record in the first unused slot. Slots freed by deletions are
+ * reused before the ones never used.
+ */
+int FixedPage::insert(const void *data) {
+	int usedCount = getUsedCount();
+	if (usedCount == slots)
+		return -1;
+
+	int slotsNumber = getSlotsNumber();
+	int slot = slotsNumber;
+	if (usedCount < slotsNumber) {
+		for (int i = 0; i < (slotsNumber + 7) / 8; ++i) {
+			if (usedBitmap[i] != 0xFF) {
+				slot = i * 8 + __builtin_ctz(~usedBitmap[i]);
+				break;
+			}
+		}
+	}
+
+	write(slot, data);
+	setUsed(slot, true);
+	setFooter(2, usedCount + 1);
+	if (slot == slotsNumber)
+		setFooter(1, slotsNumber + 1);
+	return slot;
+}
+
+void FixedPage::write(int slot, const void *data) {
+	char *values = page + slot * stride;
+	unsigned char *nulls = (unsigned char*) nullsArea + slot * nullsSize;
+	if (attrNum <= MAX_UNROLLED_FIELDS)
+		fixedEncoders[attrNum]((const char*) data, values, nulls);
+	else
+		encodeFixedRecord(attrNum, (const char*) data, values, nulls);
+}
+
+void FixedPage::read(int slot, void *data) const {
+	const char *values = page + slot * stride;
+	const unsigned char *nulls = (const unsigned char*) nullsArea
+			+ slot * nullsSize;
+	if (attrNum <= MAX_UNROLLED_FIELDS)
+		fixedDecoders[attrNum](values, nulls, (char*) data);
+	else
+		decodeFixedRecord(attrNum, values, nulls, (char*) data);
+}
+
+void FixedPage::erase(int slot) {
+	setUsed(slot, false);
+	setFooter(2, getUsedCount() - 1);
+}
+
+void FixedPage::setUsed(int slot, bool used) {
+	if (used)
+		usedBitmap[slot / 8] |= 1 << (slot % 8);
+	else
+		usedBitmap[slot / 8] &= ~(1 << (slot % 8));
+}
+
+//footer entries: 0 = number of fields, 1 = slots ever used, 2 = records
+void FixedPage::setFooter(int index, short value) {
+	memcpy(page + PAGE_SIZE - 6 + index * sizeof(short), &value,
+			sizeof(short));
+}
+
+short FixedPage::getFooter(int index) const {
+	short value;
+	memcpy(&value, page + PAGE_SIZE - 6 + index * sizeof(short), sizeof(short));
+	return value;
+}
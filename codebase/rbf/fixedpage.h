@@ -0,0 +1,94 @@
+#ifndef _fixedpage_h_
+#define _fixedpage_h_
+
+#include <cstring>
+
+#include "pfm.h"
+
+using namespace std;
+
+#define MAX_UNROLLED_FIELDS 16 // widest schema with its own encode/decode
+
+/*
+ * FixedPage is the page format of the files created with the fixed layout, for
+ * records whose fields are all 4 bytes long (ints and reals). The records are
+ * stored at a fixed stride from the start of the page, without any header, so
+ * a slot is just a position in the page. Their null bits come next, one group
+ * of nullsSize bytes per slot, and then a bitmap of the slots in use:
+ *
+ *   [values of slot 0][values of slot 1]...[null bits of each slot][used slots]
+ *   ...[attrNum][slotsNumber][usedCount]
+ *
+ * The footer keeps the number of fields, the number of slots ever used (slots
+ * after it have never been used) and the number of records in the page.
+ * Slot i is rid.slotNum i + 1, as in the slotted pages.
+ */
+class FixedPage {
+public:
+	FixedPage(char *page, int attrNum); // view over a new page of this schema
+	FixedPage(char *page);              // view over an initialized page
+
+	static int capacity(int attrNum); // number of slots of a page
+
+	void initialize();
+
+	int getNumberOfFields() const;
+	int getSlotsNumber() const;
+	int getUsedCount() const;
+	short getFreeSpace() const; // bytes of the unused slots
+
+	bool isUsed(int slot) const;
+	bool isNull(int slot, int fieldIndex) const;
+	const char* field(int slot, int fieldIndex) const;
+	const unsigned char* nullBits(int slot) const;
+
+	int insert(const void *data);     // slot of the record, -1 if the page is full
+	void write(int slot, const void *data);
+	void read(int slot, void *data) const;
+	void erase(int slot);
+
+private:
+	char *page;
+	int attrNum;
+	int nullsSize;
+	int stride;
+	int slots;          // capacity of the page
+	char *nullsArea;
+	unsigned char *usedBitmap;
+
+	void setUsed(int slot, bool used);
+	void setLayout(char *page, int attrNum);
+	void setFooter(int index, short value);
+	short getFooter(int index) const;
+};
+
+//Translation of the fields of one record between the format of insertRecord and
+//the values and null bits of a slot. The loops have no branch on the null bits.
+template<int N>
+void encodeFixedRecord(const char *data, char *values, unsigned char *nulls) {
+	static const char zeros[4] = { 0, 0, 0, 0 };
+	const int nullsSize = (N + 7) / 8;
+	memcpy(nulls, data, nullsSize);
+	const char *in = data + nullsSize;
+	for (int i = 0; i < N; ++i) {
+		int null = (nulls[i >> 3] >> (7 - (i & 7))) & 1;
+		memcpy(values + 4 * i, null ? zeros : in, 4);
+		in += 4 - 4 * null;
+	}
+}
+
+template<int N>
+void decodeFixedRecord(const char *values, const unsigned char *nulls,
+		char *data) {
+	char skipped[4];
+	const int nullsSize = (N + 7) / 8;
+	memcpy(data, nulls, nullsSize);
+	char *out = data + nullsSize;
+	for (int i = 0; i < N; ++i) {
+		int null = (nulls[i >> 3] >> (7 - (i & 7))) & 1;
+		memcpy(null ? skipped : out, values + 4 * i, 4);
+		out += 4 - 4 * null;
+	}
+}
+
+#endif
@@ -0,0 +1,505 @@
+#include <algorithm>
+
+#include "paxpage.h"
+
+//the heap ends where the footer starts
+const int HEAP_LIMIT = PAGE_SIZE - PAX_FOOTER_SIZE;
+
+//heap bytes of a record in the format of insertRecord: the characters of its
+//varchars, at least PAX_MIN_CHUNK if the schema has varchars
+template<typename IsVarChar>
+static int recordChunk(const char *data, int attrNum, bool hasVarChars,
+		IsVarChar isVarChar) {
+	if (!hasVarChars)
+		return 0;
+	const unsigned char *nullbits = (const unsigned char*) data;
+	const char *field = data + (attrNum + 7) / 8;
+	int total = 0;
+	for (int i = 0; i < attrNum; ++i) {
+		if (nullbits[i / 8] & (0x80 >> (i % 8)))
+			continue;
+		if (!isVarChar(i)) {
+			field += sizeof(int);
+			continue;
+		}
+		int stringLength;
+		memcpy(&stringLength, field, sizeof(int));
+		if (stringLength < 0 || stringLength > PAGE_SIZE)
+			return PAGE_SIZE; //certainly too big
+		total += stringLength;
+		if (total > PAGE_SIZE)
+			return PAGE_SIZE;
+		field += sizeof(int) + stringLength;
+	}
+	return total < PAX_MIN_CHUNK ? PAX_MIN_CHUNK : total;
+}
+
+PaxPage::PaxPage(char *page, int attrNum, const vector<short> &varCharFields,
+		int chunkSize) {
+	memset(page, 0, maskBytes(attrNum));
+	for (unsigned i = 0; i < varCharFields.size(); ++i)
+		page[varCharFields[i] / 8] |= 1 << (varCharFields[i] % 8);
+
+	int capacity = bestCapacity(attrNum, chunkSize);
+	setLayout(page, attrNum, capacity > 0 ? capacity : 1);
+	clearSlots();
+	setFooter(0, attrNum);
+	setFooter(1, this->capacity);
+	setFooter(2, 0);
+	setFooter(3, 0);
+	setFooter(4, fixedBytes(attrNum, this->capacity));
+	setFooter(5, 0);
+}
+
+PaxPage::PaxPage(char *page) {
+	short attrNum;
+	short capacity;
+	memcpy(&attrNum, page + HEAP_LIMIT, sizeof(short));
+	memcpy(&capacity, page + HEAP_LIMIT + sizeof(short), sizeof(short));
+	setLayout(page, attrNum, capacity);
+}
+
+void PaxPage::setLayout(char *page, int attrNum, int capacity) {
+	this->page = page;
+	this->attrNum = attrNum;
+	this->capacity = capacity;
+	maskSize = maskBytes(attrNum);
+	bitmapSize = (capacity + 7) / 8;
+	varCharMask = (unsigned char*) page;
+	minipages = page + maskSize;
+	nulls = (unsigned char*) minipages + attrNum * sizeof(int) * capacity;
+	used = nulls + attrNum * bitmapSize;
+	forwarded = used + bitmapSize;
+	moved = forwarded + bitmapSize;
+
+	firstVarChar = -1;
+	for (int i = 0; i < (attrNum + 7) / 8 && firstVarChar == -1; ++i)
+		if (varCharMask[i] != 0)
+			firstVarChar = i * 8 + __builtin_ctz(varCharMask[i]);
+}
+
+void PaxPage::clearSlots() {
+	memset(nulls, 0, (attrNum + 3) * bitmapSize);
+}
+
+//the bitmap of varchar fields is padded so that the minipages start aligned
+int PaxPage::maskBytes(int attrNum) {
+	return ((attrNum + 7) / 8 + 15) & ~15;
+}
+
+int PaxPage::fixedBytes(int attrNum, int capacity) {
+	return maskBytes(attrNum) + attrNum * sizeof(int) * capacity
+			+ (attrNum + 3) * ((capacity + 7) / 8);
+}
+
+/*
+ * Largest number of slots whose minipages and bitmaps fit in a page along with
+ * heapPerRecord bytes of heap for each of them. Above 8, it is a multiple of 8,
+ * so that the minipages stay aligned.
+ */
+int PaxPage::bestCapacity(int attrNum, int heapPerRecord) {
+	int space = HEAP_LIMIT - maskBytes(attrNum);
+	int slots = 8 * space
+			/ (8 * (attrNum * (int) sizeof(int) + heapPerRecord) + attrNum + 3);
+	while (slots > 0
+			&& fixedBytes(attrNum, slots) + slots * heapPerRecord > HEAP_LIMIT)
+		slots--;
+	if (slots >= 8)
+		slots -= slots % 8;
+	return slots;
+}
+
+int PaxPage::chunkSize(const void *data, int attrNum,
+		const vector<short> &varCharFields) {
+	unsigned next = 0; //fields are visited in order, and so are the varchars
+	return recordChunk((const char*) data, attrNum, !varCharFields.empty(),
+			[&](int i) {
+				while (next < varCharFields.size() && varCharFields[next] < i)
+					next++;
+				return next < varCharFields.size() && varCharFields[next] == i;
+			});
+}
+
+/*
+ * A new slot grows every minipage by 4 bytes and every bitmap by at most a byte,
+ * so this much free space is always enough, whatever the layout of the page.
+ */
+short PaxPage::recordSpace(int attrNum, int chunkSize) {
+	return attrNum * (sizeof(int) + 1) + 3 + chunkSize;
+}
+
+bool PaxPage::fitsEmptyPage(int attrNum, int chunkSize) {
+	return attrNum > 0 && fixedBytes(attrNum, 1) + chunkSize <= HEAP_LIMIT;
+}
+
+bool PaxPage::hasSchema(int attrNum, const vector<short> &varCharFields) const {
+	if (attrNum != this->attrNum)
+		return false;
+	int varChars = 0;
+	for (int i = 0; i < (attrNum + 7) / 8; ++i)
+		varChars += __builtin_popcount(varCharMask[i]);
+	if (varChars != (int) varCharFields.size())
+		return false;
+	for (unsigned i = 0; i < varCharFields.size(); ++i)
+		if (!isVarChar(varCharFields[i]))
+			return false;
+	return true;
+}
+
+vector<short> PaxPage::getVarCharFields() const {
+	vector<short> varCharFields;
+	for (int i = 0; i < attrNum; ++i)
+		if (isVarChar(i))
+			varCharFields.push_back(i);
+	return varCharFields;
+}
+
+int PaxPage::getNumberOfFields() const {
+	return attrNum;
+}
+
+int PaxPage::getCapacity() const {
+	return capacity;
+}
+
+int PaxPage::getSlotsNumber() const {
+	return getFooter(2);
+}
+
+int PaxPage::getUsedCount() const {
+	return getFooter(3);
+}
+
+short PaxPage::getFreeSpace() const {
+	return HEAP_LIMIT - fixedBytes(attrNum, getSlotsNumber()) - getFooter(5);
+}
+
+bool PaxPage::isUsed(int slot) const {
+	return slot >= 0 && slot < getSlotsNumber()
+			&& (used[slot / 8] & (1 << (slot % 8))) != 0;
+}
+
+bool PaxPage::isForwarded(int slot) const {
+	return isUsed(slot) && (forwarded[slot / 8] & (1 << (slot % 8))) != 0;
+}
+
+bool PaxPage::isMoved(int slot) const {
+	return isUsed(slot) && (moved[slot / 8] & (1 << (slot % 8))) != 0;
+}
+
+bool PaxPage::isNull(int slot, int fieldIndex) const {
+	return nulls[fieldIndex * bitmapSize + slot / 8] & (1 << (slot % 8));
+}
+
+bool PaxPage::isVarChar(int fieldIndex) const {
+	return varCharMask[fieldIndex / 8] & (1 << (fieldIndex % 8));
+}
+
+const unsigned char* PaxPage::usedSlots() const {
+	return used;
+}
+
+const unsigned char* PaxPage::forwardedSlots() const {
+	return forwarded;
+}
+
+const unsigned char* PaxPage::movedSlots() const {
+	return moved;
+}
+
+const unsigned char* PaxPage::nullSlots(int fieldIndex) const {
+	return nulls + fieldIndex * bitmapSize;
+}
+
+const char* PaxPage::column(int fieldIndex) const {
+	return minipages + fieldIndex * sizeof(int) * capacity;
+}
+
+const char* PaxPage::field(int slot, int fieldIndex) const {
+	return column(fieldIndex) + slot * sizeof(int);
+}
+
+//the entry of a varchar in its minipage is [offset][length] in the heap
+const char* PaxPage::varChar(int slot, int fieldIndex, int &length) const {
+	short entry[2];
+	memcpy(entry, field(slot, fieldIndex), sizeof(entry));
+	length = entry[1];
+	return page + entry[0];
+}
+
+void PaxPage::getForwarding(int slot, unsigned &pageNum,
+		unsigned &slotNum) const {
+	const char *chunk = page + chunkStart(slot);
+	memcpy(&pageNum, chunk, sizeof(unsigned));
+	memcpy(&slotNum, chunk + sizeof(unsigned), sizeof(unsigned));
+}
+
+/*
+ * Store the record in the first unused slot. Slots freed by deletions are
+ * reused before the ones never used.
+ */
+int PaxPage::insert(const void *data) {
+	int slotsNumber = getSlotsNumber();
+	int slot = slotsNumber;
+	if (getUsedCount() < slotsNumber) {
+		for (int i = 0; i < (slotsNumber + 7) / 8; ++i) {
+			if (used[i] != 0xFF) {
+				slot = i * 8 + __builtin_ctz(~used[i]);
+				break;
+			}
+		}
+	}
+	return write(slot, data) ? slot : -1;
+}
+
+/*
+ * Store the record in the slot, replacing the record or the stub in it if any.
+ * Its varchars stay in the chunk of the previous record if they fit, and are
+ * otherwise appended to the heap. When the heap or the slots run out, the page
+ * is laid out again, without the holes of the heap.
+ */
+bool PaxPage::write(int slot, const void *data) {
+	int chunk = recordChunk((const char*) data, attrNum, firstVarChar != -1,
+			[this](int i) {return isVarChar(i);});
+	bool wasUsed = isUsed(slot);
+	int oldChunk = wasUsed ? chunkLength(slot) : 0;
+	short heapEnd = getFooter(4);
+	short heapUsed = getFooter(5);
+
+	short start;
+	if (wasUsed && chunk <= oldChunk) {
+		start = firstVarChar == -1 ? heapEnd : chunkStart(slot);
+		heapUsed -= oldChunk - chunk;
+	} else {
+		if (slot >= capacity || heapEnd + chunk > HEAP_LIMIT) {
+			//the old chunk of the slot is dropped by the new layout
+			if (!relayout(max(getSlotsNumber(), slot + 1),
+					heapUsed - oldChunk + chunk, getUsedCount() + !wasUsed,
+					wasUsed ? slot : -1))
+				return false;
+			heapEnd = getFooter(4);
+			heapUsed = getFooter(5);
+		} else {
+			heapUsed -= oldChunk;
+		}
+		start = heapEnd;
+		heapEnd += chunk;
+		heapUsed += chunk;
+	}
+	setFooter(4, heapEnd);
+	setFooter(5, heapUsed);
+
+	writeFields(slot, (const char*) data, start);
+	setBit(used, slot, true);
+	setBit(forwarded, slot, false);
+	setBit(moved, slot, false);
+	if (!wasUsed) {
+		setFooter(3, getUsedCount() + 1);
+		if (slot >= getSlotsNumber())
+			setFooter(2, slot + 1);
+	}
+	return true;
+}
+
+//spread the fields of the record over the minipages, its varchars from chunk on
+void PaxPage::writeFields(int slot, const char *data, short chunk) {
+	const unsigned char *nullbits = (const unsigned char*) data;
+	const char *in = data + (attrNum + 7) / 8;
+	short cursor = chunk;
+	for (int i = 0; i < attrNum; ++i) {
+		bool null = nullbits[i / 8] & (0x80 >> (i % 8));
+		setBit(nulls + i * bitmapSize, slot, null);
+		char *entry = minipages + i * sizeof(int) * capacity
+				+ slot * sizeof(int);
+		if (isVarChar(i)) {
+			int stringLength = 0;
+			if (!null) {
+				memcpy(&stringLength, in, sizeof(int));
+				memcpy(page + cursor, in + sizeof(int), stringLength);
+				in += sizeof(int) + stringLength;
+			}
+			short varChar[2] = { cursor, (short) stringLength };
+			memcpy(entry, varChar, sizeof(varChar));
+			cursor += stringLength;
+		} else if (null) {
+			memset(entry, 0, sizeof(int));
+		} else {
+			memcpy(entry, in, sizeof(int));
+			in += sizeof(int);
+		}
+	}
+}
+
+void PaxPage::read(int slot, void *data) const {
+	int nullsSize = (attrNum + 7) / 8;
+	memset(data, 0, nullsSize);
+	char *out = (char*) data + nullsSize;
+	for (int i = 0; i < attrNum; ++i) {
+		if (isNull(slot, i)) {
+			((unsigned char*) data)[i / 8] |= 0x80 >> (i % 8);
+			continue;
+		}
+		if (isVarChar(i)) {
+			int stringLength;
+			const char *chars = varChar(slot, i, stringLength);
+			memcpy(out, &stringLength, sizeof(int));
+			memcpy(out + sizeof(int), chars, stringLength);
+			out += sizeof(int) + stringLength;
+		} else {
+			memcpy(out, field(slot, i), sizeof(int));
+			out += sizeof(int);
+		}
+	}
+}
+
+void PaxPage::erase(int slot) {
+	setFooter(5, getFooter(5) - chunkLength(slot));
+	setBit(used, slot, false);
+	setBit(forwarded, slot, false);
+	setBit(moved, slot, false);
+	setFooter(3, getUsedCount() - 1);
+}
+
+/*
+ * Replace the record in the slot by a stub pointing to where it was moved. The
+ * rid takes the beginning of its chunk, which is never shorter.
+ */
+void PaxPage::forward(int slot, unsigned pageNum, unsigned slotNum) {
+	short start = chunkStart(slot);
+	int oldChunk = chunkLength(slot);
+	memcpy(page + start, &pageNum, sizeof(unsigned));
+	memcpy(page + start + sizeof(unsigned), &slotNum, sizeof(unsigned));
+	short varChar[2] = { start, 0 };
+	for (int i = firstVarChar; i < attrNum; ++i)
+		if (isVarChar(i))
+			memcpy(minipages + i * sizeof(int) * capacity + slot * sizeof(int),
+					varChar, sizeof(varChar));
+	setFooter(5, getFooter(5) - oldChunk + PAX_MIN_CHUNK);
+	setBit(forwarded, slot, true);
+	setBit(moved, slot, false);
+}
+
+void PaxPage::setMoved(int slot) {
+	setBit(moved, slot, true);
+}
+
+/*
+ * Reclaim the holes left in the heap by deletions and updates, and the unused
+ * slots after the last record. Returns whether the page changed.
+ */
+bool PaxPage::compact() {
+	int slotsNumber = getSlotsNumber();
+	while (slotsNumber > 0 && !isUsed(slotsNumber - 1))
+		slotsNumber--;
+	bool holes = getFooter(4) - fixedBytes(attrNum, capacity) > getFooter(5);
+	if (slotsNumber == getSlotsNumber() && !holes)
+		return false;
+
+	setFooter(2, slotsNumber);
+	relayout(slotsNumber, getFooter(5), getUsedCount(), -1);
+	return true;
+}
+
+/*
+ * Lay the page out again for at least minSlots slots and heapBytes bytes of heap
+ * in use, for that many records: the capacity is the one that leaves as much heap
+ * per slot as the records take on average. The records are copied over with
+ * their chunks one after the other, except the one in dropSlot (if not -1),
+ * whose slot is left unused. Returns false, without changing the page, if there
+ * isn't enough room.
+ */
+bool PaxPage::relayout(int minSlots, int heapBytes, int records,
+		int dropSlot) {
+	int heapPerRecord = (heapBytes + records - 1) / max(records, 1);
+	int newCapacity = bestCapacity(attrNum, heapPerRecord);
+	if (newCapacity < minSlots
+			|| fixedBytes(attrNum, newCapacity) + heapBytes > HEAP_LIMIT)
+		newCapacity = max(minSlots, 1);
+	if (fixedBytes(attrNum, newCapacity) + heapBytes > HEAP_LIMIT)
+		return false;
+
+	char oldPage[PAGE_SIZE];
+	memcpy(oldPage, page, PAGE_SIZE);
+	PaxPage before(oldPage);
+	int slotsNumber = getSlotsNumber();
+	int slotBytes = (slotsNumber + 7) / 8;
+
+	setLayout(page, attrNum, newCapacity);
+	clearSlots();
+	setFooter(1, newCapacity);
+	for (int i = 0; i < attrNum; ++i) {
+		memcpy((char*) column(i), before.column(i), slotsNumber * sizeof(int));
+		memcpy(nulls + i * bitmapSize, before.nullSlots(i), slotBytes);
+	}
+	memcpy(used, before.used, slotBytes);
+	memcpy(forwarded, before.forwarded, slotBytes);
+	memcpy(moved, before.moved, slotBytes);
+	if (dropSlot != -1) {
+		setBit(used, dropSlot, false);
+		setBit(forwarded, dropSlot, false);
+		setBit(moved, dropSlot, false);
+	}
+
+	short heapStart = fixedBytes(attrNum, newCapacity);
+	short heapEnd = heapStart;
+	for (int slot = 0; slot < slotsNumber && firstVarChar != -1; ++slot) {
+		if (!isUsed(slot))
+			continue;
+		short start = before.chunkStart(slot);
+		int length = before.chunkLength(slot);
+		memcpy(page + heapEnd, oldPage + start, length);
+		for (int i = firstVarChar; i < attrNum; ++i) {
+			if (!isVarChar(i))
+				continue;
+			char *entry = (char*) field(slot, i);
+			short offset;
+			memcpy(&offset, entry, sizeof(short));
+			offset += heapEnd - start;
+			memcpy(entry, &offset, sizeof(short));
+		}
+		heapEnd += length;
+	}
+	setFooter(4, heapEnd);
+	setFooter(5, heapEnd - heapStart);
+	return true;
+}
+
+//the chunk of a record starts with its first varchar, even if it is null
+short PaxPage::chunkStart(int slot) const {
+	short start;
+	memcpy(&start, field(slot, firstVarChar), sizeof(short));
+	return start;
+}
+
+int PaxPage::chunkLength(int slot) const {
+	if (firstVarChar == -1)
+		return 0;
+	int length = 0;
+	for (int i = firstVarChar; i < attrNum; ++i) {
+		if (isVarChar(i)) {
+			short stringLength;
+			memcpy(&stringLength, field(slot, i) + sizeof(short), sizeof(short));
+			length += stringLength;
+		}
+	}
+	return length < PAX_MIN_CHUNK ? PAX_MIN_CHUNK : length;
+}
+
+void PaxPage::setBit(unsigned char *bitmap, int slot, bool value) {
+	if (value)
+		bitmap[slot / 8] |= 1 << (slot % 8);
+	else
+		bitmap[slot / 8] &= ~(1 << (slot % 8));
+}
+
+//footer entries: 0 = number of fields, 1 = capacity, 2 = slots ever used,
+//3 = records, 4 = end of the heap, 5 = heap bytes in use
+void PaxPage::setFooter(int index, short value) {
+	memcpy(page + HEAP_LIMIT + index * sizeof(short), &value, sizeof(short));
+}
+
+short PaxPage::getFooter(int index) const {
+	short value;
+	memcpy(&value, page + HEAP_LIMIT + index * sizeof(short), sizeof(short));
+	return value;
+}
@@ -0,0 +1,113 @@
+#ifndef _paxpage_h_
+#define _paxpage_h_
+
+#include <cstring>
+#include <vector>
+
+#include "pfm.h"
+
+using namespace std;
+
+#define PAX_FOOTER_SIZE (6 * sizeof(short))
+#define PAX_MIN_CHUNK 8 // heap bytes of a record with varchars: room for a rid
+
+/*
+ * PaxPage is the page format of the files created with the PAX layout, which
+ * groups the records of each page by attribute: every attribute has its own
+ * minipage with a 4-byte entry per slot (the value of an int or a real, or the
+ * [offset][length] of a varchar in the heap) and its own bitmap of null slots.
+ * A scan that filters on one attribute only reads its minipage and its nulls,
+ * which are contiguous.
+ *
+ *   [varchar fields][minipage 0]...[minipage n-1][null bitmaps 0..n-1]
+ *   [used slots][forwarding stubs][moved records][heap] ...
+ *   [attrNum][capacity][slotsNumber][usedCount][heapEnd][heapUsed]
+ *
+ * The number of slots of the minipages (the capacity) is chosen from the
+ * varchars the records have, and the page is laid out again with another one
+ * when either the slots or the heap run out while the other has room left.
+ * The varchars of a record are kept together in the heap, in a chunk of at
+ * least PAX_MIN_CHUNK bytes, so that a record that grows too much for its page
+ * can always be replaced by a forwarding stub: a chunk holding the rid of the
+ * moved record. Moved records are marked as such, and are only reached through
+ * their stub. Slot i is rid.slotNum i + 1, as in the slotted pages.
+ */
+class PaxPage {
+public:
+	// formats a new page of this schema, for records of about chunkSize heap bytes
+	PaxPage(char *page, int attrNum, const vector<short> &varCharFields,
+			int chunkSize);
+	PaxPage(char *page); // view over an initialized page
+
+	// everything but the heap, for capacity slots
+	static int fixedBytes(int attrNum, int capacity);
+	// heap bytes the record takes, or PAGE_SIZE if its varchars are too long
+	static int chunkSize(const void *data, int attrNum,
+			const vector<short> &varCharFields);
+	// free space (see getFreeSpace) a page needs to take the record
+	static short recordSpace(int attrNum, int chunkSize);
+	static bool fitsEmptyPage(int attrNum, int chunkSize);
+
+	bool hasSchema(int attrNum, const vector<short> &varCharFields) const;
+	vector<short> getVarCharFields() const;
+
+	int getNumberOfFields() const;
+	int getCapacity() const;
+	int getSlotsNumber() const;
+	int getUsedCount() const;
+	short getFreeSpace() const; // bytes left if laid out for the slots in use
+
+	bool isUsed(int slot) const;
+	bool isForwarded(int slot) const;
+	bool isMoved(int slot) const;
+	bool isNull(int slot, int fieldIndex) const;
+	bool isVarChar(int fieldIndex) const;
+
+	// bitmaps of the slots, least significant bit first
+	const unsigned char* usedSlots() const;
+	const unsigned char* forwardedSlots() const;
+	const unsigned char* movedSlots() const;
+	const unsigned char* nullSlots(int fieldIndex) const;
+	const char* column(int fieldIndex) const; // minipage of the attribute
+
+	const char* field(int slot, int fieldIndex) const; // value of an int or real
+	const char* varChar(int slot, int fieldIndex, int &length) const;
+	void getForwarding(int slot, unsigned &pageNum, unsigned &slotNum) const;
+
+	int insert(const void *data); // slot of the record, -1 if it doesn't fit
+	bool write(int slot, const void *data); // false, leaving the page as it was,
+	                                        // if the record doesn't fit
+	void read(int slot, void *data) const;
+	void erase(int slot);
+	void forward(int slot, unsigned pageNum, unsigned slotNum);
+	void setMoved(int slot);
+	bool compact(); // drop the holes of the heap and the unused last slots
+
+private:
+	char *page;
+	int attrNum;
+	int capacity;
+	int maskSize;       // bytes of the bitmap of varchar fields
+	int bitmapSize;     // bytes of a bitmap of the slots
+	int firstVarChar;   // -1 if there are no varchars
+	unsigned char *varCharMask;
+	char *minipages;
+	unsigned char *nulls;
+	unsigned char *used;
+	unsigned char *forwarded;
+	unsigned char *moved;
+
+	void setLayout(char *page, int attrNum, int capacity);
+	void clearSlots();
+	static int maskBytes(int attrNum);
+	static int bestCapacity(int attrNum, int heapPerRecord);
+	bool relayout(int minSlots, int heapBytes, int records, int dropSlot);
+	short chunkStart(int slot) const;
+	int chunkLength(int slot) const;
+	void writeFields(int slot, const char *data, short chunk);
+	void setBit(unsigned char *bitmap, int slot, bool value);
+	void setFooter(int index, short value);
+	short getFooter(int index) const;
+};
+
+#endif
@@ -1,8 +1,12 @@
 #include "pfm.h"
+#include "bpm.h"
 
 PagedFileManager* PagedFileManager::_pf_manager = 0;
 
-const int maxPagesPerHeader = (PAGE_SIZE - 4) / sizeof(short);
+//every header page starts with a page count and the type of the file (only
+//meaningful in header page 0), followed by the free space of its data pages
+const int headerPrefixSize = 2 * sizeof(int);
+const int maxPagesPerHeader = (PAGE_SIZE - headerPrefixSize) / sizeof(short);
 
 PagedFileManager* PagedFileManager::instance() {
 	if (!_pf_manager)
@@ -12,7 +16,7 @@ PagedFileManager* PagedFileManager::instance() {
 }
 
 PagedFileManager::PagedFileManager() {
-
+	extentSize = DEFAULT_EXTENT_SIZE;
 }
 
 PagedFileManager::~PagedFileManager() {
@@ -31,7 +35,7 @@ bool PagedFileManager::FileExists(const string &fileName) {
  * The file should not already exist. This method should not
  * create any pages in the file.
  */
-RC PagedFileManager::createFile(const string &fileName) {
+RC PagedFileManager::createFile(const string &fileName, int fileType) {
 
 	//check that the file doesn't exist yet
 	if (FileExists(fileName))
@@ -44,14 +48,16 @@ RC PagedFileManager::createFile(const string &fileName) {
 		//register the page in the header file
 
 		//register the file in the fileTracker
-		fileTracker[fileName] = 0;
+		lock_guard<mutex> lock(trackerMutex);
+		fileTracker[fileName].handleCount = 0;
 
 		//create the first header page of the file
 		//by default (note that this is not a record page, just the
 		//first header page)
-		char* buff = (char*)malloc(PAGE_SIZE);
+		char* buff = (char*)calloc(PAGE_SIZE, 1);
 		int pageCount = 0;
 		memcpy(buff, &pageCount, sizeof(int));
+		memcpy(buff + sizeof(int), &fileType, sizeof(int));
 		fwrite(buff, 1, PAGE_SIZE, file);
 		free(buff);
 
@@ -69,10 +75,12 @@ RC PagedFileManager::createFile(const string &fileName) {
  * The file should already exist.
  */
 RC PagedFileManager::destroyFile(const string &fileName) {
-	map<string, int >::iterator it;
+	lock_guard<mutex> lock(trackerMutex);
+	map<string, FileInfo>::iterator it;
 	if ((it = fileTracker.find(fileName)) != fileTracker.end()
-			&& it->second == 0) {
+			&& it->second.handleCount == 0) {
 //		cout << "file " << fileName << " will be deleted" << endl;
+		BufferManager::instance()->discardFile(fileName);
 		fileTracker.erase(it->first);
 		return remove(fileName.c_str());
 	}
@@ -96,8 +104,11 @@ RC PagedFileManager::destroyFile(const string &fileName) {
  * may crash the PF component. (You do not need to try and prevent this, as you can assume
  * the layer above is "friendly" in that regard.) Opening a file more than once for reading
  * is no problem.
+ * If memoryMapped is set, the whole file is mapped in memory and pages are read
+ * in place (see FileHandle::getPagePointer), which suits read-mostly files.
  */
-RC PagedFileManager::openFile(const string &fileName, FileHandle &fileHandle) {
+RC PagedFileManager::openFile(const string &fileName, FileHandle &fileHandle,
+		bool memoryMapped) {
 	if(!FileExists(fileName)) {
 		cout << "ERROR: the file " <<fileName <<" does not exist" << endl;
 		return -1;
@@ -108,17 +119,29 @@ RC PagedFileManager::openFile(const string &fileName, FileHandle &fileHandle) {
 		return -1;
 	}
 
+	lock_guard<mutex> lock(trackerMutex);
+
 	//register file in the file tracker if it was not already there
-	if(fileTracker.find(fileName) == fileTracker.end()) {
-		fileTracker[fileName] = 0;
-	}
+	//(the metadata is loaded by the first handle opened on the file)
+	FileInfo &fileInfo = fileTracker[fileName];
 
 	fileHandle.setFileName(fileName);
-	fileHandle.openFile();
-	fileTracker[fileName]++; //increase the handle counter associated to this file
+	if (fileHandle.openFile(&fileInfo, memoryMapped) != 0) {
+		cout << "ERROR: the header of the file " << fileName << " could not be read" << endl;
+		return -1;
+	}
+	fileInfo.handleCount++; //increase the handle counter associated to this file
 	return 0;
 }
 
+void PagedFileManager::setExtentSize(unsigned numPages) {
+	extentSize = numPages;
+}
+
+unsigned PagedFileManager::getExtentSize() {
+	return extentSize;
+}
+
 /*
  * This method closes the open file instance referred to by fileHandle. (The file should have
  *  been opened using the openFile method.) All of the file's pages are flushed to disk when
@@ -126,11 +149,18 @@ RC PagedFileManager::openFile(const string &fileName, FileHandle &fileHandle) {
  */
 RC PagedFileManager::closeFile(FileHandle &fileHandle) {
 	if (fileHandle.hasOpenFile()) {
-		//close file
-		fileHandle.closeFile();
+		lock_guard<mutex> lock(trackerMutex);
+		//write back the pages modified in the buffer pool
+		BufferManager *bpm = BufferManager::instance();
+		RC rc = bpm->flushFile(fileHandle);
+		//close file (this also persists the page count if needed)
+		if (fileHandle.closeFile() != 0)
+			rc = -1;
 		//decrease the handle counter associated with the file
-		fileTracker[fileHandle.getFileName()]--;
-		return 0;
+		//and drop its cached pages if this was the last handle
+		if (--fileTracker[fileHandle.getFileName()].handleCount == 0)
+			bpm->discardFile(fileHandle.getFileName());
+		return rc;
 	}
 	return -1;
 }
@@ -138,21 +168,103 @@ RC PagedFileManager::closeFile(FileHandle &fileHandle) {
 void PagedFileManager::printfileTracker() {
 	int handleCounter;
 	string name;
-	for (std::map<string,int >::iterator it =
+	for (std::map<string, FileInfo>::iterator it =
 			fileTracker.begin(); it != fileTracker.end(); ++it) {
 		name = it->first;
-		handleCounter = it->second;
+		handleCounter = it->second.handleCount;
 		cout << "fileTracker[" << name << "] -> " << "handles="
 				<< handleCounter << endl;
 	}
 }
 
+FreeSpaceMap::FreeSpaceMap() {
+	clear();
+}
+
+void FreeSpaceMap::clear() {
+	capacity = 1;
+	count = 0;
+	tree.assign(2, SHRT_MIN);
+}
+
+/*
+ * Double the number of leaves and rebuild the inner nodes.
+ */
+void FreeSpaceMap::grow() {
+	vector<short> newTree(4 * capacity, SHRT_MIN);
+	for (unsigned i = 0; i < count; ++i)
+		newTree[2 * capacity + i] = tree[capacity + i];
+	capacity *= 2;
+	tree.swap(newTree);
+	for (unsigned i = capacity - 1; i > 0; --i)
+		tree[i] = max(tree[2 * i], tree[2 * i + 1]);
+}
+
+void FreeSpaceMap::append(short freeSpace) {
+	if (count == capacity)
+		grow();
+	count++;
+	set(count - 1, freeSpace);
+}
+
+void FreeSpaceMap::set(PageNum pageNum, short freeSpace) {
+	if (pageNum >= count)
+		return;
+	unsigned i = capacity + pageNum;
+	tree[i] = freeSpace;
+	for (i /= 2; i > 0; i /= 2)
+		tree[i] = max(tree[2 * i], tree[2 * i + 1]);
+}
+
+short FreeSpaceMap::get(PageNum pageNum) {
+	if (pageNum >= count)
+		return -1;
+	return tree[capacity + pageNum];
+}
+
+/*
+ * Walk down from the root, going left whenever the left subtree has a page
+ * with enough free space, so that the lowest such page number is found.
+ */
+int FreeSpaceMap::findFirst(int requiredSpace) {
+	if (count == 0 || tree[1] < requiredSpace)
+		return -1;
+	unsigned i = 1;
+	while (i < capacity) {
+		if (tree[2 * i] >= requiredSpace)
+			i = 2 * i;
+		else
+			i = 2 * i + 1;
+	}
+	return i - capacity;
+}
+
+/*
+ * Forget the pages from pageCount on.
+ */
+void FreeSpaceMap::truncate(unsigned pageCount) {
+	while (count > pageCount) {
+		set(count - 1, SHRT_MIN);
+		count--;
+	}
+}
+
+unsigned FreeSpaceMap::size() {
+	return count;
+}
+
 FileHandle::FileHandle() {
 	readPageCounter = 0;
 	writePageCounter = 0;
 	appendPageCounter = 0;
-	pageCount = 0;
-	file = NULL;
+	compactionCounter = 0;
+	compactedBytesCounter = 0;
+	fileInfo = NULL;
+	fd = -1;
+	writeBackHook = NULL;
+	memoryMapped = false;
+	mapping = NULL;
+	mappingSize = 0;
 }
 
 FileHandle::~FileHandle() {
@@ -168,30 +280,30 @@ FileHandle::~FileHandle() {
  *	readPageCount = readPageCount + 1;
  *	return 0;
  *}
+ * Reads and writes use positional I/O (pread/pwrite), so several threads can
+ * read pages through the same handle at the same time without locking.
  */
 RC FileHandle::readPage(PageNum pageNum, void *data) {
 
-	if (file != NULL) {
-
-		//refresh the pageCount with the pageCount stored
-		//in the first header page of the file
-		fseek(file, 0, SEEK_SET);
-		fread(&(this->pageCount), sizeof(int), 1, file);
+	if (fd != -1) {
 
 		//check that the page exists
-		if (pageCount <= pageNum) {
+		if (fileInfo->pageCount <= pageNum) {
 			cout
 					<< "Read failed. Trying to  access a pageNum beyond the current range ( "
-					<< pageCount << " )" << endl;
+					<< fileInfo->pageCount << " )" << endl;
 			return -1;
 		}
 
-		int pageOffset = ((pageNum / maxPagesPerHeader)
-				* (maxPagesPerHeader + 1) + (pageNum % maxPagesPerHeader + 1))
-				* PAGE_SIZE;
-
-		fseek(file, pageOffset, SEEK_SET);
-		fread(data, 1, PAGE_SIZE, file);
+		if (memoryMapped) {
+			char *page = getPagePointer(pageNum);
+			if (page == NULL)
+				return -1;
+			memcpy(data, page, PAGE_SIZE);
+		} else if (pread(fd, data, PAGE_SIZE, dataPageOffset(pageNum))
+				!= PAGE_SIZE) {
+			return -1;
+		}
 
 		this->readPageCounter++;
 
@@ -202,32 +314,63 @@ RC FileHandle::readPage(PageNum pageNum, void *data) {
 	return -1;
 }
 
+/*
+ * Read the data pages from pageNum to pageNum + count - 1, which are stored one
+ * after the other since no header page is in between, with one positional read.
+ * Several threads can read through the same handle at the same time.
+ */
+RC FileHandle::readPages(PageNum pageNum, unsigned count, void *data) {
+
+	if (fd == -1)
+		return -1;
+
+	if (fileInfo->pageCount < pageNum + count
+			|| count > contiguousPages(pageNum)) {
+		cout << "ERROR: cannot read " << count << " pages from page "
+				<< pageNum << " at once" << endl;
+		return -1;
+	}
+
+	size_t size = (size_t) count * PAGE_SIZE;
+	if (memoryMapped) {
+		char *pages = getPagePointer(pageNum + count - 1);
+		if (pages == NULL)
+			return -1;
+		memcpy(data, pages - (count - 1) * PAGE_SIZE, size);
+	} else if (pread(fd, data, size, dataPageOffset(pageNum)) != (ssize_t) size) {
+		return -1;
+	}
+
+	this->readPageCounter += count;
+	return 0;
+}
+
+/*
+ * Number of data pages from pageNum to the next header page (or beyond the
+ * end of the file), which can be read at once.
+ */
+unsigned FileHandle::contiguousPages(PageNum pageNum) {
+	return maxPagesPerHeader - pageNum % maxPagesPerHeader;
+}
+
 /*
  * This method writes the given data into a page specified by pageNum.
  * The page should exist. Page numbers start from 0.
  */
 RC FileHandle::writePage(PageNum pageNum, const void *data) {
 
-	if (file != NULL) {
-
-		//refresh the pageCount with the pageCount stored
-		//in the first header page of the file
-		int pageCount = getNumberOfPages();
+	if (fd != -1) {
 
 		//check that the page exists
-		if (pageCount <= pageNum) {
+		if (fileInfo->pageCount <= pageNum) {
 			cout
 					<< "Read failed. Trying to  access a pageNum beyond the current range ( "
-					<< pageCount << " )" << endl;
+					<< fileInfo->pageCount << " )" << endl;
 			return -1;
 		}
 
-		int pageOffset = ((pageNum / maxPagesPerHeader)
-				* (maxPagesPerHeader + 1) + (pageNum % maxPagesPerHeader + 1))
-				* PAGE_SIZE;
-
-		fseek(file, pageOffset, SEEK_SET);
-		fwrite(data, 1, PAGE_SIZE, file);
+		if (pwrite(fd, data, PAGE_SIZE, dataPageOffset(pageNum)) != PAGE_SIZE)
+			return -1;
 
 		this->writePageCounter++;
 
@@ -239,124 +382,285 @@ RC FileHandle::writePage(PageNum pageNum, const void *data) {
 
 /*
  * This method appends a new page to the end of the file and writes
- *  the given data into the newly allocated page.
+ *  the given data into the newly allocated page. If all the header pages
+ *  are full, a new (empty) header page is appended first.
  */
 RC FileHandle::appendPage(const void *data) {
-	if (file != NULL) {
-		fseek(file, 0, SEEK_END);
-		fwrite(data, 1, PAGE_SIZE, file);
+	if (fd != -1) {
+		lock_guard<mutex> lock(fileInfo->metadataMutex);
+		unsigned pageCount = fileInfo->pageCount;
+		if (allocate(pageCount, 1) != 0)
+			return -1;
+
+		//a new header page is written by flushMetadata, until then it is zeroed
+		if (pageCount % maxPagesPerHeader == 0) {
+			if (pageCount > 0)
+				fileInfo->headerCount++;
+			fileInfo->dirtyHeaders.insert(pageCount / maxPagesPerHeader);
+		}
+
+		if (pwrite(fd, data, PAGE_SIZE, dataPageOffset(pageCount)) != PAGE_SIZE)
+			return -1;
 		this->appendPageCounter++;
 
-		//updating total number of pages in the first header
-		int pageCount = getNumberOfPages();
-		fseek(file, 0, SEEK_SET);
-		pageCount++;
-		fwrite(&pageCount,sizeof(int),1,file);
+		//the total number of pages is written to the first header
+		//page only when the file is closed
+		fileInfo->freeSpaceMap.append(0);
+		fileInfo->dirty = true;
+		fileInfo->pageCount++;
 
 		return 0;
 	}
 	return -1;
 }
 
-void FileHandle::readHeaderPage(int headerNum, void * data) {
-//	cout << "------------------" << endl;
-//	cout << "from fileHandle:: readHeaderPage()" << endl;
-
-	if (file != NULL) {
-		int headerPageOffset = headerNum * (maxPagesPerHeader + 1) * PAGE_SIZE;
+/*
+ * Append count pages at once, with one positional write for each run of pages
+ * between two header pages. The new header pages are only written by
+ * flushMetadata, once, so until then they are zeroed. The free space of the new
+ * pages is 0 until it is set.
+ */
+RC FileHandle::appendPages(const void *data, unsigned count) {
+	if (fd == -1)
+		return -1;
+	lock_guard<mutex> lock(fileInfo->metadataMutex);
+
+	const char *pages = (const char*) data;
+	while (count > 0) {
+		unsigned pageCount = fileInfo->pageCount;
+		unsigned run = min(count, contiguousPages(pageCount));
+		size_t size = (size_t) run * PAGE_SIZE;
+		if (allocate(pageCount, run) != 0)
+			return -1;
 
-//		cout << "headerPageOffset = " << headerPageOffset << endl;
+		if (pageCount % maxPagesPerHeader == 0) {
+			if (pageCount > 0)
+				fileInfo->headerCount++;
+			fileInfo->dirtyHeaders.insert(pageCount / maxPagesPerHeader);
+		}
 
-		fseek(file, headerPageOffset, SEEK_SET);
-		fread(data, 1, PAGE_SIZE, file);
+		if (pwrite(fd, pages, size, dataPageOffset(pageCount)) != (ssize_t) size)
+			return -1;
+		this->appendPageCounter += run;
+
+		for (unsigned i = 0; i < run; ++i)
+			fileInfo->freeSpaceMap.append(0);
+		fileInfo->dirty = true;
+		fileInfo->pageCount += run;
+		pages += size;
+		count -= run;
 	}
+	return 0;
 }
 
-void FileHandle::writeHeaderPage(int headerNum, const void * data) {
-//	cout << "-----------------------" << endl;
-//	cout << "from filehandle::writeHeaderPage()" << endl;
+RC FileHandle::readHeaderPage(int headerNum, void * data) {
+//	cout << "------------------" << endl;
+//	cout << "from fileHandle:: readHeaderPage()" << endl;
 
-	if (file != NULL) {
-		int headerPageOffset = headerNum * (maxPagesPerHeader + 1) * PAGE_SIZE;
+	if (fd == -1
+			|| pread(fd, data, PAGE_SIZE, headerPageOffset(headerNum))
+					!= PAGE_SIZE)
+		return -1;
+	return 0;
+}
 
-//		cout << "headerPageOffset = " << headerPageOffset << endl,
+RC FileHandle::writeHeaderPage(int headerNum, const void * data) {
+//	cout << "-----------------------" << endl;
+//	cout << "from filehandle::writeHeaderPage()" << endl;
 
-		fseek(file, headerPageOffset, SEEK_SET);
-		fwrite(data, 1, PAGE_SIZE, file);
-	}
+	if (fd == -1
+			|| pwrite(fd, data, PAGE_SIZE, headerPageOffset(headerNum))
+					!= PAGE_SIZE)
+		return -1;
+	return 0;
 }
 
 /*
  * Returns the pageNum of the first page with enough space found (if any),
- * or -1 by default.
+ * or -1 by default. The lookup is done in the in-memory free space map,
+ * which mirrors the free space stored in the header pages.
  */
 int FileHandle::findPageWithEnoughSpace(int requiredSpace) {
 
-	if (file != NULL) {
+	if (fd != -1) {
+		lock_guard<mutex> lock(fileInfo->metadataMutex);
+		return fileInfo->freeSpaceMap.findFirst(requiredSpace);
+	}
 
-		int totalPages = getNumberOfPages();
+	cout << " ERROR: file is not open" << endl;
+	return -1;
+}
+
+/*
+ * The fill targets are shared by the handles of the file, so that inserts through
+ * any of them keep filling the same pages. Records of different sizes fill
+ * different pages: a large record that doesn't fit in the page of the small ones
+ * doesn't make them move on to another page.
+ */
+int FileHandle::findInsertPage(int requiredSpace) {
+	if (fd == -1) {
+		cout << " ERROR: file is not open" << endl;
+		return -1;
+	}
 
-//		cout << "------------------------" << endl;
-//		cout << "from findPageWithEnoughSpace() " << endl;
-//
-//		cout << "requiredSpace = " << requiredSpace << endl;
-//
-//		cout << "totalPages = " << totalPages << endl;
+	lock_guard<mutex> lock(fileInfo->metadataMutex);
+	int target = fileInfo->fillTargets[sizeClass(requiredSpace)];
+	if (target != -1 && (unsigned) target < fileInfo->freeSpaceMap.size()
+			&& fileInfo->freeSpaceMap.get(target) >= requiredSpace)
+		return target;
+	return fileInfo->freeSpaceMap.findFirst(requiredSpace);
+}
 
+void FileHandle::setFillTarget(int requiredSpace, int pageNum) {
+	if (fd != -1) {
+		lock_guard<mutex> lock(fileInfo->metadataMutex);
+		fileInfo->fillTargets[sizeClass(requiredSpace)] = pageNum;
+	}
+}
 
-		int totalHeaders = (int)ceil((double)totalPages / maxPagesPerHeader);
-		int pn = 0;
+//size classes of 64, 256 and 1024 bytes, and then the rest
+int FileHandle::sizeClass(int requiredSpace) {
+	int sizeClass = 0;
+	for (int limit = 64; sizeClass < FILL_TARGETS - 1 && requiredSpace >= limit;
+			limit *= 4)
+		sizeClass++;
+	return sizeClass;
+}
 
-//		cout << "totalHeaders = " << totalHeaders << endl;
+short FileHandle::getPageFreeSpace(PageNum pageNum) {
+	lock_guard<mutex> lock(fileInfo->metadataMutex);
+	return fileInfo->freeSpaceMap.get(pageNum);
+}
 
-		int pageSlotOffset;
-		int headerPageOffset = 0;
-		short freeSpace;
+/*
+ * Update the free space of a page both in the free space map and in its
+ * header page (only the 2 bytes of the page's entry are written). Without
+ * writeThrough only the map is updated, and the whole header page is
+ * written once by flushMetadata.
+ */
+RC FileHandle::setPageFreeSpace(PageNum pageNum, short freeSpace,
+		bool writeThrough) {
+	if (fd == -1 || fileInfo->pageCount <= pageNum)
+		return -1;
 
-		int FULL_HEADER_SCOPE_SIZE = (maxPagesPerHeader + 1) * PAGE_SIZE;
+	lock_guard<mutex> lock(fileInfo->metadataMutex);
+	fileInfo->freeSpaceMap.set(pageNum, freeSpace);
 
-		for(int hn = 0; hn < totalHeaders; ++hn) {
-//			cout << "\theaderPageOffset = " << headerPageOffset << endl;
-			for(int j = 0; j < maxPagesPerHeader; ++j) {
-				if(pn >= totalPages) {
-//					cout << "no page with enough space was found among a total of " << totalPages <<" pages" << endl;
-					return -1;
-				}
-				pageSlotOffset = headerPageOffset + 4 + j * sizeof(short);
-				fseek(file,pageSlotOffset,SEEK_SET);
-				fread(&freeSpace,sizeof(short),1,file);
+	if (!writeThrough) {
+		fileInfo->dirtyHeaders.insert(pageNum / maxPagesPerHeader);
+		return 0;
+	}
 
-//				cout << "\t\tpageSlotOffset = " << pageSlotOffset << endl;
-//				cout << "\t\tfreeSpace = " << freeSpace << endl;
+	long entryOffset = headerPageOffset(pageNum / maxPagesPerHeader)
+			+ headerPrefixSize
+			+ (pageNum % maxPagesPerHeader) * sizeof(short);
+	if (pwrite(fd, &freeSpace, sizeof(short), entryOffset) != sizeof(short))
+		return -1;
+	return 0;
+}
 
-				if(freeSpace >= requiredSpace) {
+/*
+ * Drop the data pages from pageCount on (and the header pages left without
+ * data pages), shrinking the file. The new page count is persisted by
+ * flushMetadata.
+ */
+RC FileHandle::truncate(unsigned pageCount) {
+	if (fd == -1 || pageCount > fileInfo->pageCount)
+		return -1;
 
-//					cout << "freeSpace = "<<freeSpace<<" found in page " <<pn << " !!"<< endl;
+	lock_guard<mutex> lock(fileInfo->metadataMutex);
+	off_t size =
+			pageCount == 0 ?
+					PAGE_SIZE : dataPageOffset(pageCount - 1) + PAGE_SIZE;
+	if (ftruncate(fd, size) != 0)
+		return -1;
+	fileInfo->allocatedSize = size;
+
+	fileInfo->pageCount = pageCount;
+	fileInfo->headerCount =
+			pageCount == 0 ? 1 : (pageCount - 1) / maxPagesPerHeader + 1;
+	fileInfo->freeSpaceMap.truncate(pageCount);
+	for (int i = 0; i < FILL_TARGETS; ++i) //the pages left were rewritten
+		fileInfo->fillTargets[i] = -1;
+	fileInfo->dirtyHeaders.erase(
+			fileInfo->dirtyHeaders.lower_bound(fileInfo->headerCount),
+			fileInfo->dirtyHeaders.end());
+	fileInfo->dirty = true;
+	return 0;
+}
 
-					return pn;
-				}
-				pn++;
-			}
-			headerPageOffset += FULL_HEADER_SCOPE_SIZE;
-		}
+/*
+ * Make room in the file for count pages from pageNum on. The file grows by whole
+ * extents of getExtentSize() pages, allocated with fallocate, which takes the
+ * header pages in them along with the data pages. Appends then write into space
+ * already allocated, instead of extending the file page by page. The size of the
+ * file is thus the end of its last extent, while the number of pages is the one
+ * in header page 0. Where fallocate is not supported, nothing is allocated and
+ * the pages are just written past the end of the file, one by one. Any other
+ * failure (such as a full disk) fails the append. The caller holds the metadata
+ * mutex.
+ */
+RC FileHandle::allocate(PageNum pageNum, unsigned count) {
+	off_t end = dataPageOffset(pageNum + count - 1) + PAGE_SIZE;
+	off_t extentSize = (off_t) PagedFileManager::instance()->getExtentSize()
+			* PAGE_SIZE;
+	if (end <= fileInfo->allocatedSize || extentSize == 0)
+		return 0;
 
-//		cout << "No page with enough space has been found " << endl;
+	off_t allocatedSize = (end + extentSize - 1) / extentSize * extentSize;
+	if (fallocate(fd, 0, fileInfo->allocatedSize,
+			allocatedSize - fileInfo->allocatedSize) != 0) {
+		if (errno == EOPNOTSUPP || errno == ENOSYS)
+			return 0;
+		cout << "ERROR: could not allocate an extent of the file " << fileName
+				<< endl;
 		return -1;
+	}
+	fileInfo->allocatedSize = allocatedSize;
+	return 0;
+}
 
+/*
+ * Build the free space map from the header pages, reading each
+ * header page once.
+ */
+RC FileHandle::loadFreeSpaceMap() {
+	FreeSpaceMap &freeSpaceMap = fileInfo->freeSpaceMap;
+	freeSpaceMap.clear();
+
+	char *header = (char*) malloc(PAGE_SIZE);
+	short freeSpace;
+	unsigned pn = 0;
+	for (unsigned hn = 0; hn < fileInfo->headerCount; ++hn) {
+		if (readHeaderPage(hn, header) != 0) {
+			free(header);
+			freeSpaceMap.clear();
+			return -1;
+		}
+		for (int j = 0; j < maxPagesPerHeader && pn < fileInfo->pageCount;
+				++j, ++pn) {
+			memcpy(&freeSpace, header + headerPrefixSize + j * sizeof(short),
+					sizeof(short));
+			freeSpaceMap.append(freeSpace);
+		}
 	}
+	free(header);
+	return 0;
+}
 
-	cout << " ERROR: file is not open" << endl;
-	return -1;
+/*
+ * Type of the file, as given to PagedFileManager::createFile.
+ */
+int FileHandle::getFileType() {
+	if (fileInfo != NULL)
+		return fileInfo->fileType;
+	return 0;
 }
 
 unsigned FileHandle::getNumberOfPages() {
-//refresh the pageCount with the pageCount stored
-//in the first header page of the file
-	if (file != NULL) {
-		fseek(file, 0, SEEK_SET);
-		fread(&(this->pageCount), sizeof(int), 1, file);
-	}
-	return pageCount;
+	if (fileInfo != NULL)
+		return fileInfo->pageCount;
+	return 0;
 }
 
 RC FileHandle::collectCounterValues(unsigned &readPageCount,
@@ -367,8 +671,15 @@ RC FileHandle::collectCounterValues(unsigned &readPageCount,
 	return 0;
 }
 
+RC FileHandle::collectCompactionCounters(unsigned &compactionCount,
+		unsigned &compactedBytes) {
+	compactionCount = this->compactionCounter;
+	compactedBytes = this->compactedBytesCounter;
+	return 0;
+}
+
 bool FileHandle::hasOpenFile() {
-	return file != NULL;
+	return fd != -1;
 }
 
 void FileHandle::setFileName(const string & fileName) {
@@ -379,15 +690,207 @@ string FileHandle::getFileName() {
 	return this->fileName;
 }
 
-void FileHandle::openFile() {
-	if (file == NULL) {
-		file = fopen(fileName.c_str(), "rb+");
+/*
+ * Open the file. The first handle opened on a file loads the metadata
+ * shared by all of them from the header pages; the file is left closed
+ * if they can't be read in full.
+ */
+RC FileHandle::openFile(FileInfo *fileInfo, bool memoryMapped) {
+	if (fd != -1)
+		return -1;
+	fd = open(fileName.c_str(), O_RDWR);
+	if (fd == -1)
+		return -1;
+	this->fileInfo = fileInfo;
+	this->memoryMapped = memoryMapped;
+	if (fileInfo->handleCount == 0) {
+		int pageCount = 0;
+		int fileType = 0;
+		bool loaded = pread(fd, &pageCount, sizeof(int), 0)
+				== (ssize_t) sizeof(int)
+				&& pread(fd, &fileType, sizeof(int), sizeof(int))
+						== (ssize_t) sizeof(int) && pageCount >= 0;
+		if (loaded) {
+			fileInfo->pageCount = pageCount;
+			fileInfo->fileType = fileType;
+			fileInfo->headerCount =
+					pageCount == 0 ?
+							1 : (pageCount - 1) / maxPagesPerHeader + 1;
+			fileInfo->dirty = false;
+			fileInfo->dirtyHeaders.clear();
+			struct stat stFileInfo;
+			fileInfo->allocatedSize =
+					fstat(fd, &stFileInfo) == 0 ? stFileInfo.st_size : 0;
+			loaded = loadFreeSpaceMap() == 0;
+		}
+		if (!loaded) {
+			close(fd);
+			fd = -1;
+			this->fileInfo = NULL;
+			return -1;
+		}
 	}
+	if (memoryMapped && mapFile(0) != 0)
+		this->memoryMapped = false;
+	return 0;
 }
 
-void FileHandle::closeFile() {
-	if (file != NULL) {
-		fclose(file);
-		file = NULL;
+/*
+ * Close the file, persisting the metadata first. The file is closed
+ * even if that fails, but the failure is reported.
+ */
+RC FileHandle::closeFile() {
+	if (fd == -1)
+		return -1;
+	RC rc = flushMetadata();
+	unmapFile();
+	close(fd);
+	fd = -1;
+	fileInfo = NULL;
+	writeBackHook = NULL;
+	return rc;
+}
+
+shared_mutex& FileHandle::getRecordLock() {
+	return fileInfo->recordLock;
+}
+
+bool FileHandle::isMemoryMapped() {
+	return memoryMapped;
+}
+
+void FileHandle::setWriteBackHook(WriteBackHook hook) {
+	writeBackHook = hook;
+}
+
+WriteBackHook FileHandle::getWriteBackHook() {
+	return writeBackHook;
+}
+
+/*
+ * In memory-mapped mode, the address of the page in the mapping. Pages
+ * appended after the file was mapped are beyond the mapping, in which case
+ * the file is mapped again.
+ */
+char* FileHandle::getPagePointer(PageNum pageNum) {
+	if (!memoryMapped || fileInfo->pageCount <= pageNum)
+		return NULL;
+
+	size_t end = dataPageOffset(pageNum) + PAGE_SIZE;
+	if (end > mappingSize.load(memory_order_acquire)) {
+		if (mapFile(end) != 0)
+			return NULL;
+	}
+	return mapping.load() + dataPageOffset(pageNum);
+}
+
+/*
+ * Map the file in memory, reserving room for it to at least double in size
+ * so that appending pages rarely requires a new mapping.
+ */
+RC FileHandle::mapFile(size_t minSize) {
+	lock_guard<mutex> lock(mappingMutex);
+	if (minSize != 0 && minSize <= mappingSize)
+		return 0; //another thread already did it
+
+	struct stat stFileInfo;
+	if (fstat(fd, &stFileInfo) != 0)
+		return -1;
+	size_t size = max((size_t) stFileInfo.st_size, minSize) * 2;
+	size = max(size, (size_t) MIN_MAPPING_SIZE);
+
+	char *newMapping = (char*) mmap(NULL, size, PROT_READ | PROT_WRITE,
+			MAP_SHARED, fd, 0);
+	if (newMapping == MAP_FAILED) {
+		cout << "ERROR: could not map the file " << fileName << endl;
+		return -1;
+	}
+
+	if (mapping != NULL)
+		retiredMappings.push_back(make_pair(mapping.load(), mappingSize.load()));
+	mapping.store(newMapping);
+	mappingSize.store(size, memory_order_release);
+	return 0;
+}
+
+void FileHandle::unmapFile() {
+	lock_guard<mutex> lock(mappingMutex);
+	if (mapping != NULL)
+		munmap(mapping, mappingSize);
+	for (unsigned i = 0; i < retiredMappings.size(); ++i)
+		munmap(retiredMappings[i].first, retiredMappings[i].second);
+	retiredMappings.clear();
+	mapping = NULL;
+	mappingSize = 0;
+	memoryMapped = false;
+}
+
+/*
+ * Write the total number of pages back to the first header page,
+ * if it changed since the last time. The last header page also keeps
+ * the number of pages it tracks. Header pages whose entries were
+ * deferred are rebuilt from the free space map and written whole.
+ */
+RC FileHandle::flushMetadata() {
+	if (fd == -1)
+		return -1;
+	lock_guard<mutex> lock(fileInfo->metadataMutex);
+
+	//headers that fail to be written stay dirty, so that a later flush retries them
+	RC rc = 0;
+	if (!fileInfo->dirtyHeaders.empty()) {
+		char *header = (char*) calloc(PAGE_SIZE, 1);
+		unsigned pageCount = fileInfo->pageCount;
+		for (set<unsigned>::iterator it = fileInfo->dirtyHeaders.begin();
+				it != fileInfo->dirtyHeaders.end();) {
+			unsigned firstPage = *it * maxPagesPerHeader;
+			int count = min(pageCount - firstPage, (unsigned) maxPagesPerHeader);
+			int headerCount = *it == 0 ? pageCount : count;
+			memcpy(header, &headerCount, sizeof(int));
+			memcpy(header + sizeof(int), &fileInfo->fileType, sizeof(int));
+			for (int j = 0; j < count; ++j) {
+				short freeSpace = fileInfo->freeSpaceMap.get(firstPage + j);
+				memcpy(header + headerPrefixSize + j * sizeof(short),
+						&freeSpace, sizeof(short));
+			}
+			if (writeHeaderPage(*it, header) == 0) {
+				fileInfo->dirtyHeaders.erase(it++);
+			} else {
+				rc = -1;
+				++it;
+			}
+		}
+		free(header);
+	}
+
+	if (fileInfo->dirty) {
+		int pageCount = fileInfo->pageCount;
+		bool written = pwrite(fd, &pageCount, sizeof(int), 0)
+				== (ssize_t) sizeof(int);
+
+		int lastHeader = fileInfo->headerCount - 1;
+		if (written && lastHeader > 0) {
+			pageCount -= lastHeader * maxPagesPerHeader;
+			written = pwrite(fd, &pageCount, sizeof(int),
+					headerPageOffset(lastHeader)) == (ssize_t) sizeof(int);
+		}
+		if (written)
+			fileInfo->dirty = false;
+		else
+			rc = -1;
 	}
+	return rc;
+}
+
+/*
+ * Every maxPagesPerHeader data pages are preceded by the header page
+ * that keeps track of their free space.
+ */
+off_t FileHandle::dataPageOffset(PageNum pageNum) {
+	return ((off_t) (pageNum / maxPagesPerHeader) * (maxPagesPerHeader + 1)
+			+ (pageNum % maxPagesPerHeader + 1)) * PAGE_SIZE;
+}
+
+off_t FileHandle::headerPageOffset(int headerNum) {
+	return (off_t) headerNum * (maxPagesPerHeader + 1) * PAGE_SIZE;
 }
@@ -6,29 +6,99 @@ typedef char byte;
 typedef unsigned PageNum;
 
 #define PAGE_SIZE 4096
+#define MIN_MAPPING_SIZE (64 * 1024 * 1024) // address space reserved by mmap
+#define FILL_TARGETS 4 // size classes of records with a page of their own to fill
+#define DEFAULT_EXTENT_SIZE 256 // pages a file grows by at once (1 MB)
 #include <string>
 #include <climits>
 #include <cstdio>
 #include <map>
+#include <set>
+#include <vector>
+#include <mutex>
+#include <shared_mutex>
+#include <atomic>
 #include <iostream>
 #include <stdlib.h>
 #include <stdio.h>
 #include <sys/stat.h>
+#include <sys/types.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
 #include <cmath>
+#include <cstring>
+#include <cerrno>
 
 using namespace std;
 
 class FileHandle;
 
+// Called by the buffer pool on a page right before writing it back, while it is
+// not pinned, so that the page can still be modified
+typedef void (*WriteBackHook)(FileHandle &fileHandle, char *data);
+
+// Free space of every data page of a file, kept as a max segment tree so that
+// the first page with at least n bytes free is found in O(log n) without
+// reading the header pages.
+class FreeSpaceMap {
+public:
+	FreeSpaceMap();
+
+	void clear();
+	void append(short freeSpace);                // register a new page
+	void set(PageNum pageNum, short freeSpace);
+	short get(PageNum pageNum);
+	void truncate(unsigned pageCount);          // forget the last pages
+	int findFirst(int requiredSpace);            // -1 if there is no such page
+	unsigned size();
+
+private:
+	vector<short> tree; // tree[1] is the root, leaves start at tree[capacity]
+	unsigned capacity;
+	unsigned count;
+
+	void grow();
+};
+
+// Metadata of an open file, shared by all the handles open on it. It is
+// loaded from header page 0 when the first handle is opened and persisted
+// back when it changes, at the latest when a handle is closed.
+struct FileInfo {
+	int handleCount;      // number of handles open on the file
+	atomic<unsigned> pageCount; // number of data pages
+	unsigned headerCount; // number of header pages
+	int fileType;         // given at creation, kept in header page 0
+	bool dirty;           // pageCount has to be written back to header page 0
+	set<unsigned> dirtyHeaders; // header pages whose entries are only in the map
+	FreeSpaceMap freeSpaceMap; // free space of each data page
+	shared_mutex recordLock;   // shared by readers, exclusive for writers
+	mutex metadataMutex;       // protects the counts and the free space map
+	int fillTargets[FILL_TARGETS]; // page being filled by each size class, -1 if none
+	off_t allocatedSize;  // bytes allocated to the file, beyond its last page
+
+	FileInfo() :
+			handleCount(0), pageCount(0), headerCount(1), fileType(0), dirty(false),
+			allocatedSize(0) {
+		for (int i = 0; i < FILL_TARGETS; ++i)
+			fillTargets[i] = -1;
+	}
+};
+
 class PagedFileManager {
 public:
 	static PagedFileManager* instance();   // Access to the _pf_manager instance
 
-	RC createFile(const string &fileName);                  // Create a new file
+	RC createFile(const string &fileName, int fileType = 0); // Create a new file
 	RC destroyFile(const string &fileName);                    // Destroy a file
-	RC openFile(const string &fileName, FileHandle &fileHandle); // Open a file
+	RC openFile(const string &fileName, FileHandle &fileHandle,
+			bool memoryMapped = false);                      // Open a file
 	RC closeFile(FileHandle &fileHandle);                        // Close a file
 
+	// Number of pages allocated at once when a file grows; 0 to grow page by page
+	void setExtentSize(unsigned numPages);
+	unsigned getExtentSize();
+
 	void printfileTracker();
 
 protected:
@@ -37,7 +107,9 @@ protected:
 
 private:
 	static PagedFileManager *_pf_manager;
-	map<string, int> fileTracker; // file name -> handle counter
+	map<string, FileInfo> fileTracker; // file name -> shared metadata
+	mutex trackerMutex;
+	atomic<unsigned> extentSize;
 	void initializefileTracker();
 	bool FileExists(const string & fileName);
 };
@@ -46,33 +118,84 @@ class FileHandle {
 public:
 
 	// variables to keep counter for each operation
-	unsigned readPageCounter;
-	unsigned writePageCounter;
-	unsigned appendPageCounter;
+	atomic<unsigned> readPageCounter;
+	atomic<unsigned> writePageCounter;
+	atomic<unsigned> appendPageCounter;
+
+	// in-page compactions done through this handle, and bytes they moved
+	atomic<unsigned> compactionCounter;
+	atomic<unsigned> compactedBytesCounter;
 
 	FileHandle();                                         // Default constructor
 	~FileHandle();                                                 // Destructor
 
 	RC readPage(PageNum pageNum, void *data);             // Get a specific page
+	// Read count consecutive data pages with a single read. They must not be
+	// separated by a header page (see contiguousPages)
+	RC readPages(PageNum pageNum, unsigned count, void *data);
+	static unsigned contiguousPages(PageNum pageNum); // up to the next header page
 	RC writePage(PageNum pageNum, const void *data);    // Write a specific page
 	RC appendPage(const void *data);                   // Append a specific page
+	// Append count pages with as few writes as possible; the header pages of the
+	// new pages are written by flushMetadata
+	RC appendPages(const void *data, unsigned count);
 	unsigned getNumberOfPages();          // Get the number of pages in the file
+	int getFileType();                         // Type given to createFile
 	RC collectCounterValues(unsigned &readPageCount, unsigned &writePageCount,
 			unsigned &appendPageCount); // put the current counter values into variables
+	RC collectCompactionCounters(unsigned &compactionCount,
+			unsigned &compactedBytes);
 	bool hasOpenFile();
 	void setFileName(const string & fileName);
 	string getFileName();
-	void openFile();
-	void closeFile();
+	RC openFile(FileInfo *fileInfo, bool memoryMapped);
+	RC closeFile();
+	RC flushMetadata(); // persist the page count and the deferred header pages
+	shared_mutex& getRecordLock(); // lock on the records of the file
+
+	// Memory-mapped mode: the page can be used in place, without any copy
+	bool isMemoryMapped();
+	char* getPagePointer(PageNum pageNum); // NULL if the page doesn't exist
+
+	void setWriteBackHook(WriteBackHook hook);
+	WriteBackHook getWriteBackHook();
 
-	void readHeaderPage(int headerNum, void *data);
-	void writeHeaderPage(int headerNum, const void * data);
+	RC readHeaderPage(int headerNum, void *data);
+	RC writeHeaderPage(int headerNum, const void * data);
 	int findPageWithEnoughSpace(int requiredSpace);
+	// Page to insert requiredSpace bytes into: the fill target of their size class
+	// if it still has room, the first page with enough space otherwise (-1 if none)
+	int findInsertPage(int requiredSpace);
+	void setFillTarget(int requiredSpace, int pageNum); // -1 to forget the page
+	short getPageFreeSpace(PageNum pageNum);
+	RC setPageFreeSpace(PageNum pageNum, short freeSpace,
+			bool writeThrough = true);
+	RC truncate(unsigned pageCount); // keep only the first pageCount data pages
 
 private:
-	unsigned pageCount; //number of pages
+	FileInfo *fileInfo; //metadata shared with the other handles of the file
 	string fileName; //name of the file this handle is handling
-	FILE * file; //pointer to the file
+	int fd; //descriptor of the file (all the I/O is positional)
+	WriteBackHook writeBackHook; //NULL if none
+
+	//mapping of the whole file, in memory-mapped mode. When the file outgrows
+	//it, a bigger one is created; the old ones stay valid until the file is
+	//closed since other threads may still be using pointers into them
+	bool memoryMapped;
+	atomic<char*> mapping;
+	atomic<size_t> mappingSize;
+	vector<pair<char*, size_t> > retiredMappings;
+	mutex mappingMutex;
+
+	RC mapFile(size_t minSize);
+	void unmapFile();
+
+	RC loadFreeSpaceMap();
+	RC allocate(PageNum pageNum, unsigned count);
+
+	static off_t dataPageOffset(PageNum pageNum);
+	static off_t headerPageOffset(int headerNum);
+	static int sizeClass(int requiredSpace);
 };
 
 #endif
@@ -0,0 +1,627 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <cassert>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "recordkernels.h"
+#include "test_util.h"
+
+using namespace std;
+
+// Benchmarks of the record-based file manager. This file has its own main and
+// is not part of the test build.
+
+static double elapsedSeconds(chrono::steady_clock::time_point start) {
+	return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// Insert numRecords records of the large descriptor into a new file
+static void loadBenchFile(RecordBasedFileManager *rbfm, const string &fileName,
+		int numRecords, vector<RID> &rids) {
+
+	vector<Attribute> recordDescriptor;
+	createLargeRecordDescriptor2(recordDescriptor);
+	int nullsSize = getActualByteForNullsIndicator(recordDescriptor.size());
+	unsigned char *nullsIndicator = (unsigned char *) calloc(nullsSize, 1);
+	void *record = malloc(1000);
+
+	RC rc = rbfm->createFile(fileName);
+	assert(rc == success && "Creating the file should not fail.");
+
+	FileHandle fileHandle;
+	rc = rbfm->openFile(fileName, fileHandle);
+	assert(rc == success && "Opening the file should not fail.");
+
+	rids.clear();
+	RID rid;
+	int size;
+	for (int i = 0; i < numRecords; i++) {
+		prepareLargeRecord2(recordDescriptor.size(), nullsIndicator, i, record,
+				&size);
+		rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+		assert(rc == success && "Inserting a record should not fail.");
+		rids.push_back(rid);
+	}
+
+	rbfm->closeFile(fileHandle);
+	free(record);
+	free(nullsIndicator);
+}
+
+/*
+ * Random point reads of the same file from 1, 2, 4, ... threads, each one
+ * with its own file handle. The buffer pool is large enough to keep the
+ * whole file, so this measures how readRecord scales with the cores.
+ */
+int benchConcurrentReads(RecordBasedFileManager *rbfm, int numRecords,
+		int readsPerThread) {
+
+	cout << endl << "***** Concurrent readRecord benchmark *****" << endl;
+
+	string fileName = "bench_reads";
+	vector<RID> rids;
+	loadBenchFile(rbfm, fileName, numRecords, rids);
+
+	vector<Attribute> recordDescriptor;
+	createLargeRecordDescriptor2(recordDescriptor);
+
+	BufferManager::instance()->setPoolSize(rids.back().pageNum + 16);
+
+	unsigned maxThreads = max(4u, thread::hardware_concurrency());
+	double baseline = 0;
+
+	for (unsigned numThreads = 1; numThreads <= maxThreads; numThreads *= 2) {
+		vector<FileHandle> fileHandles(numThreads);
+		for (unsigned t = 0; t < numThreads; t++)
+			rbfm->openFile(fileName, fileHandles[t]);
+
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+		vector<thread> threads;
+		for (unsigned t = 0; t < numThreads; t++) {
+			threads.push_back(thread([&, t]() {
+				char data[1000];
+				unsigned seed = 12345 + t;
+				for (int i = 0; i < readsPerThread; i++) {
+					seed = seed * 1103515245 + 12345;
+					const RID &rid = rids[(seed >> 8) % rids.size()];
+					rbfm->readRecord(fileHandles[t], recordDescriptor, rid, data);
+				}
+			}));
+		}
+		for (unsigned t = 0; t < numThreads; t++)
+			threads[t].join();
+
+		double seconds = elapsedSeconds(start);
+		double readsPerSecond = numThreads * (double) readsPerThread / seconds;
+		if (numThreads == 1)
+			baseline = readsPerSecond;
+
+		printf("threads = %2u   reads/s = %12.0f   speedup = %.2f\n",
+				numThreads, readsPerSecond, readsPerSecond / baseline);
+
+		for (unsigned t = 0; t < numThreads; t++)
+			rbfm->closeFile(fileHandles[t]);
+	}
+
+	rbfm->destroyFile(fileName);
+	BufferManager::instance()->setPoolSize(DEFAULT_POOL_SIZE);
+	return 0;
+}
+
+// Make every step-th field of the record (in the API format) null
+static void nullFields(const vector<Attribute> &recordDescriptor, char *record,
+		int step) {
+	int nullsSize = getActualByteForNullsIndicator(recordDescriptor.size());
+	vector<char> fields;
+	int offset = nullsSize;
+	for (unsigned i = 0; i < recordDescriptor.size(); i++) {
+		int length = sizeof(int);
+		if (recordDescriptor[i].type == TypeVarChar) {
+			memcpy(&length, record + offset, sizeof(int));
+			length += sizeof(int);
+		}
+		if (i % step == 0)
+			record[i / 8] |= 1 << (7 - i % 8);
+		else
+			fields.insert(fields.end(), record + offset, record + offset + length);
+		offset += length;
+	}
+	memcpy(record + nullsSize, &fields[0], fields.size());
+}
+
+/*
+ * Single-threaded insertRecord and readRecord throughput, which is bound by the
+ * translation between the API format and the stored format since the buffer pool
+ * keeps the whole file. Half of the records have null fields.
+ */
+int benchRecordFormat(RecordBasedFileManager *rbfm, int numRecords) {
+
+	cout << endl << "***** insertRecord / readRecord benchmark *****" << endl;
+
+	string fileName = "bench_format";
+	vector<Attribute> recordDescriptor;
+	createLargeRecordDescriptor2(recordDescriptor);
+	int nullsSize = getActualByteForNullsIndicator(recordDescriptor.size());
+	unsigned char *nullsIndicator = (unsigned char *) calloc(nullsSize, 1);
+
+	//prepare the records beforehand, so that only the record manager is measured
+	vector<vector<char> > records(numRecords, vector<char>(1000));
+	for (int i = 0; i < numRecords; i++) {
+		int size;
+		prepareLargeRecord2(recordDescriptor.size(), nullsIndicator, i,
+				&records[i][0], &size);
+		if (i % 2 == 1)
+			nullFields(recordDescriptor, &records[i][0], 7);
+	}
+
+	RC rc = rbfm->createFile(fileName);
+	assert(rc == success && "Creating the file should not fail.");
+	BufferManager::instance()->setPoolSize(numRecords / 4 + 16);
+
+	FileHandle fileHandle;
+	rc = rbfm->openFile(fileName, fileHandle);
+	assert(rc == success && "Opening the file should not fail.");
+
+	vector<RID> rids(numRecords);
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for (int i = 0; i < numRecords; i++)
+		rbfm->insertRecord(fileHandle, recordDescriptor, &records[i][0],
+				rids[i]);
+	double insertSeconds = elapsedSeconds(start);
+
+	char data[1000];
+	start = chrono::steady_clock::now();
+	for (int round = 0; round < 5; round++)
+		for (int i = 0; i < numRecords; i++)
+			rbfm->readRecord(fileHandle, recordDescriptor, rids[i], data);
+	double readSeconds = elapsedSeconds(start);
+
+	printf("inserts/s = %12.0f\n", numRecords / insertSeconds);
+	printf("reads/s   = %12.0f\n", 5 * numRecords / readSeconds);
+
+	rbfm->closeFile(fileHandle);
+	rbfm->destroyFile(fileName);
+	BufferManager::instance()->setPoolSize(DEFAULT_POOL_SIZE);
+	free(nullsIndicator);
+	return 0;
+}
+
+/*
+ * insertRecord throughput on a schema of 128 fields (one varchar out of eight)
+ * where a tenth of the fields are null, with each level of the record kernels.
+ */
+int benchWideRecords(RecordBasedFileManager *rbfm, int numRecords) {
+
+	cout << endl << "***** insertRecord benchmark on 128 fields *****" << endl;
+
+	vector<Attribute> recordDescriptor;
+	for (int i = 0; i < 128; i++) {
+		Attribute attr;
+		attr.name = "field" + to_string(i);
+		attr.type = (i % 8 == 7) ? TypeVarChar : (i % 2 == 0) ? TypeInt : TypeReal;
+		attr.length = (attr.type == TypeVarChar) ? 20 : 4;
+		recordDescriptor.push_back(attr);
+	}
+	int nullsSize = getActualByteForNullsIndicator(recordDescriptor.size());
+
+	vector<vector<char> > records(numRecords);
+	unsigned seed = 12345;
+	for (int r = 0; r < numRecords; r++) {
+		vector<char> &record = records[r];
+		record.assign(nullsSize, 0);
+		for (int i = 0; i < 128; i++) {
+			seed = seed * 1103515245 + 12345;
+			if ((seed >> 16) % 10 == 0) {
+				record[i / 8] |= 1 << (7 - i % 8);
+				continue;
+			}
+			int value = r + i;
+			if (recordDescriptor[i].type == TypeVarChar) {
+				int length = (seed >> 8) % 8;
+				record.insert(record.end(), (char*) &length,
+						(char*) &length + sizeof(int));
+				record.insert(record.end(), length, 'a' + i % 26);
+			} else {
+				record.insert(record.end(), (char*) &value,
+						(char*) &value + sizeof(int));
+			}
+		}
+	}
+
+	const char *levels[] = { "scalar", "sse4.2", "avx2" };
+	KernelLevel bestLevel = detectKernelLevel();
+	for (int level = ScalarKernels; level <= bestLevel; level++) {
+		setKernelLevel((KernelLevel) level);
+
+		string fileName = "bench_wide";
+		rbfm->createFile(fileName);
+		FileHandle fileHandle;
+		rbfm->openFile(fileName, fileHandle);
+
+		RID rid;
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		for (int r = 0; r < numRecords; r++)
+			rbfm->insertRecord(fileHandle, recordDescriptor, &records[r][0],
+					rid);
+		double seconds = elapsedSeconds(start);
+		printf("%-8s inserts/s = %12.0f\n", levels[level], numRecords / seconds);
+
+		rbfm->closeFile(fileHandle);
+		rbfm->destroyFile(fileName);
+	}
+	setKernelLevel(defaultKernelLevel());
+	return 0;
+}
+
+/*
+ * Scan of a table of 32 fields with a condition on one int field that about 1%
+ * of the records satisfy, with the slotted and the PAX layouts. The buffer
+ * pool keeps the whole file, so this measures how the scan goes through the
+ * pages.
+ */
+int benchPaxScan(RecordBasedFileManager *rbfm, int numRecords, int numScans) {
+
+	cout << endl << "***** filter scan benchmark on 32 fields *****" << endl;
+
+	vector<Attribute> recordDescriptor;
+	for (int i = 0; i < 32; i++) {
+		Attribute attr;
+		attr.name = "field" + to_string(i);
+		attr.type = (i == 31) ? TypeVarChar : (i % 2 == 0) ? TypeInt : TypeReal;
+		attr.length = (attr.type == TypeVarChar) ? 20 : 4;
+		recordDescriptor.push_back(attr);
+	}
+	int nullsSize = getActualByteForNullsIndicator(recordDescriptor.size());
+
+	char record[PAGE_SIZE];
+	memset(record, 0, nullsSize);
+	const char *layouts[] = { "slotted", "fixed", "pax" };
+	PageLayout tested[] = { SlottedLayout, PaxLayout };
+	for (int l = 0; l < 2; l++) {
+		string fileName = "bench_scan";
+		rbfm->createFile(fileName, tested[l]);
+		FileHandle fileHandle;
+		rbfm->openFile(fileName, fileHandle);
+
+		RID rid;
+		for (int r = 0; r < numRecords; r++) {
+			char *field = record + nullsSize;
+			for (int i = 0; i < 31; i++) {
+				int value = (i == 4) ? r % 100 : r + i;
+				memcpy(field, &value, sizeof(int));
+				field += sizeof(int);
+			}
+			int length = 8 + r % 8;
+			memcpy(field, &length, sizeof(int));
+			memset(field + sizeof(int), 'a' + r % 26, length);
+			rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+		}
+
+		BufferManager::instance()->setPoolSize(fileHandle.getNumberOfPages() + 16);
+		vector<string> attributeNames;
+		attributeNames.push_back("field0");
+		int value = 0;
+		int matches = 0;
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		for (int s = 0; s < numScans; s++) {
+			RBFM_ScanIterator rbfmScanIterator;
+			rbfm->scan(fileHandle, recordDescriptor, "field4", EQ_OP, &value,
+					attributeNames, rbfmScanIterator);
+			while (rbfmScanIterator.getNextRecord(rid, record) != RBFM_EOF)
+				matches++;
+			rbfmScanIterator.close();
+		}
+		double seconds = elapsedSeconds(start);
+		printf("%-8s pages = %6u  records scanned/s = %12.0f  (%d matches)\n",
+				layouts[tested[l]], fileHandle.getNumberOfPages(),
+				(double) numRecords * numScans / seconds, matches / numScans);
+
+		rbfm->closeFile(fileHandle);
+		rbfm->destroyFile(fileName);
+		BufferManager::instance()->setPoolSize(DEFAULT_POOL_SIZE);
+	}
+	return 0;
+}
+
+/*
+ * Scans of 1% of a table whose Salary grows with the insertion order, as a
+ * timestamp would: on Salary the zone map lets the scan skip the pages before
+ * the range, while on Age, whose values are spread over the file, it can't.
+ */
+int benchRangeScan(RecordBasedFileManager *rbfm, int numRecords, int numScans) {
+
+	cout << endl << "***** range scan benchmark *****" << endl;
+
+	vector<Attribute> recordDescriptor;
+	createRecordDescriptor(recordDescriptor);
+	string fileName = "bench_range";
+	rbfm->createFile(fileName);
+	FileHandle fileHandle;
+	rbfm->openFile(fileName, fileHandle);
+
+	unsigned char nullsIndicator = 0;
+	char record[PAGE_SIZE];
+	int size;
+	RID rid;
+	for (int i = 0; i < numRecords; i++) {
+		string name(8 + i % 16, 'a' + i % 26);
+		prepareRecord(recordDescriptor.size(), &nullsIndicator, name.size(),
+				name, (int) ((i * 7919L) % numRecords), 1.75f, i, record,
+				&size);
+		rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+	}
+	BufferManager::instance()->setPoolSize(fileHandle.getNumberOfPages() + 16);
+
+	vector<string> attributeNames;
+	attributeNames.push_back("EmpName");
+	const char *columns[] = { "Salary", "Age" };
+	int from = numRecords - numRecords / 100;
+	for (int c = 0; c < 2; c++) {
+		int matches = 0;
+		unsigned skippedPages = 0;
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		for (int s = 0; s < numScans; s++) {
+			RBFM_ScanIterator rbfmScanIterator;
+			rbfm->scan(fileHandle, recordDescriptor, columns[c], GE_OP, &from,
+					attributeNames, rbfmScanIterator);
+			while (rbfmScanIterator.getNextRecord(rid, record) != RBFM_EOF)
+				matches++;
+			skippedPages += rbfmScanIterator.getSkippedPages();
+			rbfmScanIterator.close();
+		}
+		double seconds = elapsedSeconds(start);
+		printf("%-6s pages read = %5u of %5u  scans/s = %9.1f  (%d matches)\n",
+				columns[c],
+				fileHandle.getNumberOfPages() - skippedPages / numScans,
+				fileHandle.getNumberOfPages(), numScans / seconds,
+				matches / numScans);
+	}
+
+	rbfm->closeFile(fileHandle);
+	rbfm->destroyFile(fileName);
+	BufferManager::instance()->setPoolSize(DEFAULT_POOL_SIZE);
+	return 0;
+}
+
+static void countBatch(int /*worker*/, const ScanBatch &batch, void *context) {
+	((atomic<long>*) context)->fetch_add(batch.rids.size());
+}
+
+/*
+ * Full scans of the file of the concurrent reads with 1, 2, 4, ... threads
+ * through parallelScan. The file is in the page cache after the first scan,
+ * so this measures how the scan scales with the cores.
+ */
+int benchParallelScan(RecordBasedFileManager *rbfm, int numRecords,
+		int numScans) {
+
+	cout << endl << "***** parallel scan benchmark *****" << endl;
+
+	string fileName = "bench_parallel";
+	vector<RID> rids;
+	loadBenchFile(rbfm, fileName, numRecords, rids);
+
+	vector<Attribute> recordDescriptor;
+	createLargeRecordDescriptor2(recordDescriptor);
+	FileHandle fileHandle;
+	rbfm->openFile(fileName, fileHandle);
+
+	vector<string> attributeNames;
+	attributeNames.push_back(recordDescriptor[0].name);
+	atomic<long> matches(0);
+	rbfm->parallelScan(fileHandle, recordDescriptor, "", NO_OP, NULL,
+			attributeNames, 1, countBatch, &matches);
+
+	unsigned maxThreads = max(4u, thread::hardware_concurrency());
+	double baseline = 0;
+	for (unsigned numThreads = 1; numThreads <= maxThreads; numThreads *= 2) {
+		matches = 0;
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		for (int s = 0; s < numScans; s++)
+			rbfm->parallelScan(fileHandle, recordDescriptor, "", NO_OP, NULL,
+					attributeNames, numThreads, countBatch, &matches);
+		double seconds = elapsedSeconds(start);
+		double recordsPerSecond = (double) matches / seconds;
+		if (numThreads == 1)
+			baseline = recordsPerSecond;
+
+		printf("threads = %2u   records/s = %12.0f   speedup = %.2f\n",
+				numThreads, recordsPerSecond, recordsPerSecond / baseline);
+	}
+
+	rbfm->closeFile(fileHandle);
+	rbfm->destroyFile(fileName);
+	return 0;
+}
+
+// Records of the large descriptor for a bulk load, from next to count
+struct LargeRecordSource {
+	int next;
+	int count;
+	int numFields;
+	unsigned char *nullsIndicator;
+};
+
+static bool nextLargeRecord(void *context, void *data) {
+	LargeRecordSource *source = (LargeRecordSource*) context;
+	if (source->next == source->count)
+		return false;
+	int size;
+	prepareLargeRecord2(source->numFields, source->nullsIndicator,
+			source->next++, data, &size);
+	return true;
+}
+
+/*
+ * Load numRecords records into a new file with insertRecords, in batches of
+ * 1000, and with bulkLoad, with and without free space. The time includes
+ * closing the file, so that every page is written.
+ */
+int benchBulkLoad(RecordBasedFileManager *rbfm, int numRecords) {
+
+	cout << endl << "***** bulk load benchmark *****" << endl;
+
+	string fileName = "bench_bulk";
+	vector<Attribute> recordDescriptor;
+	createLargeRecordDescriptor2(recordDescriptor);
+	int nullsSize = getActualByteForNullsIndicator(recordDescriptor.size());
+	unsigned char *nullsIndicator = (unsigned char *) calloc(nullsSize, 1);
+	LargeRecordSource source = { 0, numRecords, (int) recordDescriptor.size(),
+			nullsIndicator };
+
+	const char *methods[] = { "insertRecords", "bulkLoad", "bulkLoad, no free space" };
+	for (int m = 0; m < 3; m++) {
+		rbfm->createFile(fileName);
+		FileHandle fileHandle;
+		rbfm->openFile(fileName, fileHandle);
+		source.next = 0;
+
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		if (m == 0) {
+			vector<char> records(1000 * PAGE_SIZE);
+			vector<const void*> batch;
+			vector<RID> rids;
+			while (source.next < numRecords) {
+				batch.clear();
+				while (batch.size() < 1000
+						&& nextLargeRecord(&source,
+								&records[batch.size() * PAGE_SIZE]))
+					batch.push_back(&records[batch.size() * PAGE_SIZE]);
+				RC rc = rbfm->insertRecords(fileHandle, recordDescriptor, batch,
+						rids);
+				assert(rc == success && "Inserting the records should not fail.");
+			}
+		} else {
+			RC rc = rbfm->bulkLoad(fileHandle, recordDescriptor, nextLargeRecord,
+					&source, m == 2);
+			assert(rc == success && "Bulk loading the file should not fail.");
+		}
+		unsigned numPages = fileHandle.getNumberOfPages();
+		rbfm->closeFile(fileHandle);
+		double seconds = elapsedSeconds(start);
+
+		printf("%-24s records/s = %10.0f   MB/s = %8.1f\n", methods[m],
+				numRecords / seconds,
+				(double) numPages * PAGE_SIZE / (1 << 20) / seconds);
+		rbfm->destroyFile(fileName);
+	}
+
+	free(nullsIndicator);
+	return 0;
+}
+
+/*
+ * Insert numRecords records into one file, and then into numFiles files in
+ * turns. Each file keeps filling its own pages, so taking turns should cost
+ * nothing more than inserting into a single file.
+ */
+int benchInterleavedInserts(RecordBasedFileManager *rbfm, int numRecords,
+		int numFiles) {
+
+	cout << endl << "***** interleaved inserts benchmark *****" << endl;
+
+	vector<Attribute> recordDescriptor;
+	createLargeRecordDescriptor2(recordDescriptor);
+	int nullsSize = getActualByteForNullsIndicator(recordDescriptor.size());
+	unsigned char *nullsIndicator = (unsigned char *) calloc(nullsSize, 1);
+	void *record = malloc(1000);
+
+	for (int fileCount = 1; fileCount <= numFiles; fileCount *= numFiles) {
+		vector<FileHandle> fileHandles(fileCount);
+		for (int f = 0; f < fileCount; f++) {
+			string fileName = "bench_interleaved" + to_string(f);
+			rbfm->createFile(fileName);
+			rbfm->openFile(fileName, fileHandles[f]);
+		}
+
+		RID rid;
+		int size;
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		for (int i = 0; i < numRecords; i++) {
+			prepareLargeRecord2(recordDescriptor.size(), nullsIndicator, i,
+					record, &size);
+			RC rc = rbfm->insertRecord(fileHandles[i % fileCount],
+					recordDescriptor, record, rid);
+			assert(rc == success && "Inserting a record should not fail.");
+		}
+		double seconds = elapsedSeconds(start);
+
+		unsigned numPages = 0;
+		for (int f = 0; f < fileCount; f++) {
+			numPages += fileHandles[f].getNumberOfPages();
+			rbfm->closeFile(fileHandles[f]);
+			rbfm->destroyFile("bench_interleaved" + to_string(f));
+		}
+		printf("files = %2d   records/s = %10.0f   pages = %u\n", fileCount,
+				numRecords / seconds, numPages);
+	}
+
+	free(record);
+	free(nullsIndicator);
+	return 0;
+}
+
+/*
+ * Append numPages pages to a new file with the file growing page by page, and
+ * then by extents of increasing size. The time includes an fsync, so that the
+ * allocation of the blocks is written as well.
+ */
+int benchFileGrowth(PagedFileManager *pfm, int numPages) {
+
+	cout << endl << "***** file growth benchmark *****" << endl;
+
+	string fileName = "bench_growth";
+	char data[PAGE_SIZE];
+	memset(data, 1, PAGE_SIZE);
+	unsigned extentSizes[] = { 0, DEFAULT_EXTENT_SIZE, 16 * DEFAULT_EXTENT_SIZE };
+	for (int e = 0; e < 3; e++) {
+		pfm->setExtentSize(extentSizes[e]);
+		pfm->createFile(fileName);
+		FileHandle fileHandle;
+		pfm->openFile(fileName, fileHandle);
+
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		for (int i = 0; i < numPages; i++) {
+			RC rc = fileHandle.appendPage(data);
+			assert(rc == success && "Appending a page should not fail.");
+		}
+		pfm->closeFile(fileHandle);
+		int fd = open(fileName.c_str(), O_RDONLY);
+		fsync(fd);
+		close(fd);
+		double seconds = elapsedSeconds(start);
+
+		printf("extent = %5u pages   MB/s = %8.1f\n", extentSizes[e],
+				(double) numPages * PAGE_SIZE / (1 << 20) / seconds);
+		pfm->destroyFile(fileName);
+	}
+
+	pfm->setExtentSize(DEFAULT_EXTENT_SIZE);
+	return 0;
+}
+
+int main() {
+
+	RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+
+	benchConcurrentReads(rbfm, 100000, 200000);
+	benchRecordFormat(rbfm, 200000);
+	benchWideRecords(rbfm, 100000);
+	benchPaxScan(rbfm, 100000, 20);
+	benchRangeScan(rbfm, 200000, 50);
+	benchParallelScan(rbfm, 200000, 10);
+	benchBulkLoad(rbfm, 500000);
+	benchInterleavedInserts(rbfm, 200000, 4);
+	benchFileGrowth(PagedFileManager::instance(), 100000);
+
+	return 0;
+}
@@ -1,10 +1,27 @@
+#include <thread>
+
 #include "rbfm.h"
+#include "recordkernels.h"
+#include "zonemap.h"
+
+//A record that grows too much for its page is moved to another page, and its
+//slot (so its rid) keeps a forwarding stub: [FORWARDING_STUB][pageNum][slotNum].
+//The moved record is stored after [MOVED_RECORD][home pageNum][home slotNum].
+//Both markers take the place of the number of attributes of a record.
+const short FORWARDING_STUB = -1;
+const short MOVED_RECORD = -2;
+const int FORWARDING_SIZE = sizeof(short) + 2 * sizeof(unsigned);
 
-const int maxPagesPerHeader = (PAGE_SIZE - 4) / sizeof(short);
+//a moved record must still fit in a page
+const int MAX_RECORD_SIZE = PAGE_SIZE - 6 - 4 - FORWARDING_SIZE;
 
-const int MAX_RECORD_SIZE = PAGE_SIZE - 6 - 4;
+//the slot directory can't take more than the page
+const int MAX_SLOTS = (PAGE_SIZE - 6) / 4;
 
 RecordBasedFileManager* RecordBasedFileManager::_rbf_manager = NULL;
+bool RecordBasedFileManager::lazyCompaction = false;
+short RecordBasedFileManager::compactionThreshold =
+		DEFAULT_COMPACTION_THRESHOLD;
 
 RecordBasedFileManager* RecordBasedFileManager::instance() {
 	if (!_rbf_manager)
@@ -15,12 +32,7 @@ RecordBasedFileManager* RecordBasedFileManager::instance() {
 
 RecordBasedFileManager::RecordBasedFileManager() {
 	pfm = PagedFileManager::instance();
-	pageBuffer = (char*) malloc(PAGE_SIZE);
-	headerBuffer = (char*) malloc(PAGE_SIZE);
-	recordBuffer = (char*) malloc(MAX_RECORD_SIZE);
-	pageFreeSpace = -1;
-	pageNum = -1;
-	headerNum = -1;
+	bpm = BufferManager::instance();
 //	pfm->printfileTracker();
 }
 
@@ -31,9 +43,14 @@ RecordBasedFileManager::~RecordBasedFileManager() {
  * This method creates a record-based file called fileName.The file should not
  * already exist. Please note that this method should internally use the method
  * PagedFileManager::createFile (const char *fileName).
+ * The layout of the pages is kept as the type of the file.
  */
-RC RecordBasedFileManager::createFile(const string &fileName) {
-	return pfm->createFile(fileName);
+RC RecordBasedFileManager::createFile(const string &fileName,
+		PageLayout layout) {
+	RC rc = pfm->createFile(fileName, layout);
+	if (rc == 0) //a zone map left by another file of the same name
+		ZoneMap::discard(fileName);
+	return rc;
 }
 /*
  * This method destroys the record-based file whose name is fileName. The file should
@@ -41,7 +58,10 @@ RC RecordBasedFileManager::createFile(const string &fileName) {
  *  PagedFileManager::destroyFile (const char *fileName).
  */
 RC RecordBasedFileManager::destroyFile(const string &fileName) {
-	return pfm->destroyFile(fileName);
+	RC rc = pfm->destroyFile(fileName);
+	if (rc == 0)
+		ZoneMap::discard(fileName);
+	return rc;
 }
 
 /*
@@ -51,473 +71,701 @@ RC RecordBasedFileManager::destroyFile(const string &fileName) {
  * parameter becomes a "handle" for the open file. The file handle rules in the method
  * PagedFileManager::openFile apply here too. Also note that this method should internally
  * use the method PagedFileManager::openFile(const char *fileName, FileHandle &fileHandle).
+ * With memoryMapped, records are read directly from the mapping of the file.
+ * The first handle opened on the file loads its zone map.
  */
 RC RecordBasedFileManager::openFile(const string &fileName,
-		FileHandle &fileHandle) {
-	return pfm->openFile(fileName, fileHandle);
+		FileHandle &fileHandle, bool memoryMapped) {
+	RC rc = pfm->openFile(fileName, fileHandle, memoryMapped);
+	if (rc != 0)
+		return rc;
+	if (lazyCompaction && fileHandle.getFileType() == SlottedLayout)
+		fileHandle.setWriteBackHook(compactOnWriteBack);
+
+	lock_guard<mutex> lock(zoneMapsMutex);
+	ZoneMap *&fileZoneMap = zoneMaps[fileName];
+	if (fileZoneMap == NULL) {
+		fileZoneMap = new ZoneMap();
+		fileZoneMap->load(fileName, fileHandle.getNumberOfPages());
+	}
+	fileZoneMap->handleCount++;
+	return 0;
 }
 
 /*
  * This method closes the open file instance referred to by fileHandle. The file must have
  * been opened using the RecordBasedFileManager::openFile method. Note that this method should
  * internally use the method PagedFileManager::closeFile(FileHandle &fileHandle).
+ * The last handle closed on the file saves its zone map.
  */
 RC RecordBasedFileManager::closeFile(FileHandle &fileHandle) {
-	return pfm->closeFile(fileHandle);
+	string fileName = fileHandle.getFileName();
+	unsigned pageCount = fileHandle.getNumberOfPages();
+	RC rc = pfm->closeFile(fileHandle);
+	if (rc != 0)
+		return rc;
+
+	lock_guard<mutex> lock(zoneMapsMutex);
+	map<string, ZoneMap*>::iterator it = zoneMaps.find(fileName);
+	if (it != zoneMaps.end() && --it->second->handleCount == 0) {
+		rc = it->second->save(fileName, pageCount);
+		delete it->second;
+		zoneMaps.erase(it);
+	}
+	return rc;
+}
+
+/*
+ * Zone map of the file of the handle, NULL if the file was not opened by the
+ * record manager.
+ */
+ZoneMap* RecordBasedFileManager::zoneMap(FileHandle &fileHandle) {
+	lock_guard<mutex> lock(zoneMapsMutex);
+	map<string, ZoneMap*>::iterator it = zoneMaps.find(
+			fileHandle.getFileName());
+	return it == zoneMaps.end() ? NULL : it->second;
+}
+
+/*
+ * Add the values of the record to the zone of the page it is stored in. Without a
+ * zone map, the sidecar of the file is removed since it would no longer hold.
+ */
+void RecordBasedFileManager::addToZoneMap(FileHandle &fileHandle,
+		const vector<Attribute> &recordDescriptor, const void *data,
+		PageNum pageNum) {
+	ZoneMap *fileZoneMap = zoneMap(fileHandle);
+	if (fileZoneMap == NULL) {
+		ZoneMap::discard(fileHandle.getFileName());
+		return;
+	}
+	if (pageNum < fileHandle.getNumberOfPages())
+		fileZoneMap->add(pageNum, recordDescriptor, data);
 }
 
 RC RecordBasedFileManager::insertRecord(FileHandle &fileHandle,
 		const vector<Attribute> &recordDescriptor, const void *data, RID &rid) {
 
-	/******************************************************************************
-	 ***** TRANSLATE THE RECORD INTO NEW FORMAT AND COPY INTO RECORD BUFFER *******
-	 ******************************************************************************/
-	short attrNum = recordDescriptor.size();
-	int nullsize = (int) ceil((double) attrNum / 8);
-
-//	cout << "--------------------------------" << endl;
-//	cout << "FROM insertRecord()" << endl;
-//	cout << "nullsize = " << nullsize << endl;
-//	cout << "attrNum = " << (int) attrNum << endl;
+	const RecordCodec &codec = recordCodec(recordDescriptor);
+	bool slotted = !fixedLayout(fileHandle) && !paxLayout(fileHandle);
+	if (fixedLayout(fileHandle) && checkFixedSchema(codec) != 0)
+		return -1;
 
-	unsigned char nullBuff[nullsize];
-	memcpy(nullBuff, data, nullsize);
+	//the other layouts translate the record straight into the page
+	char recordBuffer[PAGE_SIZE];
+	short recordSize = 0;
+	if (slotted && (recordSize = encodeRecord(codec, data, recordBuffer)) == -1)
+		return -1;
 
-	//record format: number of attributes | null bits | offsets | fields
+	/***************************************************************************************************
+	 ***** INSERTING RECORD EITHER IN CURRENT WORKING PAGE OR IN ANOTHER ONE WITH ENOUGH SPACE   *******
+	 ***************************************************************************************************/
 
-	unsigned char bit;
-	unsigned char nullbyte;
+	//the rest of the insertion modifies the file, so it is done by one thread at a time
+	unique_lock<shared_mutex> fileLock(fileHandle.getRecordLock());
+
+	RC rc;
+	if (fixedLayout(fileHandle))
+		rc = insertFixedRecord(fileHandle, codec, data, rid);
+	else if (paxLayout(fileHandle))
+		rc = insertPaxRecord(fileHandle, codec, data, rid, false);
+	else
+		rc = storeRecord(fileHandle, recordBuffer, recordSize, rid);
+
+	//before the lock is released, so that no scan skips the page of the record
+	if (rc == 0)
+		addToZoneMap(fileHandle, recordDescriptor, data, rid.pageNum);
+	return rc;
+}
 
-	int index = 0;
-	vector<int> indexes;
+/*
+ * Store an already translated record in the file: either in the current working page or
+ * in another one with enough space. The caller holds the file's record lock exclusively.
+ */
+RC RecordBasedFileManager::storeRecord(FileHandle &fileHandle,
+		const char *recordBuffer, short recordSize, RID &rid) {
+
+	//the page records of this size are filling, or else the first page with
+	//enough space. If there is none, we will have to append a new page at the
+	//end (and possibly a new header page if the last header page was full).
+	int pageNum = fileHandle.findInsertPage(recordSize + 4);
+	short pageFreeSpace;
+	if (pageNum != -1)
+		pageFreeSpace = fileHandle.getPageFreeSpace(pageNum);
+
+	if (pageNum == -1) { //no page with enough space, we have to append a new page
+
+		//build the new page with the record in memory and append it
+		char pageBuffer[PAGE_SIZE];
+		initializePage(pageBuffer);
+		pageFreeSpace = PAGE_SIZE - 6
+				- storeRecordInCurrentPage(fileHandle, pageBuffer, recordBuffer,
+						recordSize,
+						rid);
+		PageNum appendedPageNum;
+		if (bpm->appendPage(fileHandle, pageBuffer, appendedPageNum) != 0)
+			return -1;
+		pageNum = appendedPageNum;
+
+	} else { //there is a page with enough space (normally still cached in the buffer pool)
+
+		char *page;
+		if (bpm->fetchPage(fileHandle, pageNum, page) != 0)
+			return -1;
+		pageFreeSpace -= storeRecordInCurrentPage(fileHandle, page, recordBuffer,
+				recordSize,
+				rid);
+		bpm->unpinPage(fileHandle, pageNum, true);
+	}
 
-	// read the null bits, skip null fields, collect indexes
-	// of non-null fields
-	for (int i = 0; i < nullsize; ++i) {
-		nullbyte = nullBuff[i];
-		for (bit = (1 << 7); bit > 0; bit >>= 1) {
+	//register the free space of the page (in the free space map and in its header page)
+	fileHandle.setPageFreeSpace(pageNum, pageFreeSpace);
+	fileHandle.setFillTarget(recordSize + 4, pageNum);
+	rid.pageNum = pageNum;
 
-			if (index >= attrNum)
-				goto quitfors;
+	return 0;
+}
 
-			if ((nullbyte & bit) == 0) {
+/*
+ * Insert a batch of records, returning their rids in the same order. The records are
+ * packed into each page in memory: every data page touched by the batch is fetched (or,
+ * for new pages, appended) once, and the free space of the pages is only registered in
+ * the free space map until the end of the batch, when each affected header page is
+ * written once. If a record cannot be inserted, the previous ones stay inserted.
+ */
+RC RecordBasedFileManager::insertRecords(FileHandle &fileHandle,
+		const vector<Attribute> &recordDescriptor,
+		const vector<const void *> &records, vector<RID> &rids) {
 
-				indexes.push_back(index);
+	rids.resize(records.size());
+	const RecordCodec &codec = recordCodec(recordDescriptor);
+	if (fixedLayout(fileHandle) && checkFixedSchema(codec) != 0)
+		return -1;
 
-			}
-			index++;
+	unique_lock<shared_mutex> fileLock(fileHandle.getRecordLock());
+
+	if (fixedLayout(fileHandle) || paxLayout(fileHandle)) {
+		for (unsigned i = 0; i < records.size(); ++i) {
+			RC rc = fixedLayout(fileHandle) ?
+					insertFixedRecord(fileHandle, codec, records[i], rids[i]) :
+					insertPaxRecord(fileHandle, codec, records[i], rids[i],
+							false);
+			if (rc != 0)
+				return -1;
+			addToZoneMap(fileHandle, recordDescriptor, records[i],
+					rids[i].pageNum);
 		}
+		return 0;
 	}
-	quitfors:
 
-	//copy the number of attributes
-	int offset = 0;
-	memcpy(recordBuffer, &attrNum, sizeof(short));
-	offset += 2;
+	char recordBuffer[PAGE_SIZE];
+	char newPageBuffer[PAGE_SIZE];
 
-	//copy the null bits
-	memcpy(recordBuffer + offset, data, nullsize);
-	offset += nullsize;
+	//page being filled: either pinned in the pool or a new page built in newPageBuffer
+	char *page = NULL;
+	bool newPage = false;
+	int pageNum = -1;
+	short pageFreeSpace = -1;
+	RC rc = 0;
 
-	//copy the offsets
-	short baseAttributesOffset = 1 + nullsize + indexes.size() * sizeof(short);
+	for (unsigned i = 0; i < records.size(); ++i) {
 
-//	cout << "baseAttributsOffset = " << baseAttributesOffset << endl;
-
-	short attributeOffset;
-	short attributesLengthSum = 0;
-	int length;
-	Attribute attr;
-	AttrType type;
-	for (unsigned i = 0; i < indexes.size(); ++i) {
-		index = indexes[i];
-		attr = recordDescriptor[index];
-		type = attr.type;
-		length = attr.length;
-
-		attributeOffset = baseAttributesOffset + attributesLengthSum;
-
-		if (type == TypeVarChar) {
+		short recordSize = encodeRecord(codec, records[i], recordBuffer);
+		if (recordSize == -1) {
+			rc = -1;
+			break;
+		}
 
-			int stringLength;
-			memcpy(&stringLength, (char*) data + nullsize + attributesLengthSum,
-					sizeof(int));
-			attributesLengthSum += sizeof(int);
-			length = stringLength;
+		if (pageFreeSpace < recordSize + 4) {
+			//done with the current page, move on to another one
+			if (page != NULL && finishBatchPage(fileHandle, page, newPage,
+					pageNum, pageFreeSpace) != 0) {
+				page = NULL;
+				rc = -1;
+				break;
+			}
+			page = NULL;
 
+			pageNum = fileHandle.findInsertPage(recordSize + 4);
+			if (pageNum != -1) {
+				pageFreeSpace = fileHandle.getPageFreeSpace(pageNum);
+				newPage = false;
+			} else {
+				initializePage(newPageBuffer);
+				page = newPageBuffer;
+				pageNum = fileHandle.getNumberOfPages();
+				pageFreeSpace = PAGE_SIZE - 6;
+				newPage = true;
+			}
+			fileHandle.setFillTarget(recordSize + 4, pageNum);
 		}
 
-		memcpy(recordBuffer + offset, &attributeOffset, sizeof(short));
-		offset += sizeof(short);
+		if (page == NULL) {
+			if (bpm->fetchPage(fileHandle, pageNum, page) != 0) {
+				page = NULL;
+				rc = -1;
+				break;
+			}
+			newPage = false;
+		}
 
-		attributesLengthSum += length;
+		pageFreeSpace -= storeRecordInCurrentPage(fileHandle, page, recordBuffer,
+				recordSize, rids[i]);
+		rids[i].pageNum = pageNum;
 	}
 
-	//copy the fields
-	memcpy(recordBuffer + baseAttributesOffset, (char*) data + nullsize,
-			attributesLengthSum);
+	if (page != NULL
+			&& finishBatchPage(fileHandle, page, newPage, pageNum,
+					pageFreeSpace) != 0)
+		rc = -1;
+	//write the header pages of the batch
+	if (fileHandle.flushMetadata() != 0)
+		rc = -1;
+
+	//after a failure it is not known which records made it to the file
+	ZoneMap *fileZoneMap = zoneMap(fileHandle);
+	if (rc != 0 && fileZoneMap != NULL)
+		fileZoneMap->invalidate();
+	for (unsigned i = 0; rc == 0 && i < records.size(); ++i)
+		addToZoneMap(fileHandle, recordDescriptor, records[i],
+				rids[i].pageNum);
+
+	return rc;
+}
 
-//	cout << "attributesLengthSum = " << attributesLengthSum << endl;
-//	cout << "baseAttributesOffset = " << baseAttributesOffset << endl;
+/*
+ * Write back a page filled by insertRecords: a new page is appended to the file and
+ * an existing one is unpinned as dirty. Its free space is registered in the free
+ * space map only; the header page is written at the end of the batch.
+ */
+RC RecordBasedFileManager::finishBatchPage(FileHandle &fileHandle, char *page,
+		bool newPage, int pageNum, short pageFreeSpace) {
+	if (newPage) {
+		PageNum appendedPageNum;
+		if (bpm->appendPage(fileHandle, page, appendedPageNum) != 0)
+			return -1;
+		pageNum = appendedPageNum;
+	} else {
+		bpm->unpinPage(fileHandle, pageNum, true);
+	}
+	return fileHandle.setPageFreeSpace(pageNum, pageFreeSpace, false);
+}
 
-	//check that the record fits at least within a single page
+/*
+ * The pages are built in memory, BULK_LOAD_PAGES at a time, without going through
+ * the buffer pool, and appended to the file with FileHandle::appendPages. Their
+ * free space is only kept in the free space map, and the header pages are written
+ * once, at the end. If a record cannot be stored, the load stops there, and the
+ * records written before it stay in the file.
+ */
+RC RecordBasedFileManager::bulkLoad(FileHandle &fileHandle,
+		const vector<Attribute> &recordDescriptor, RecordSource source,
+		void *context, bool skipFreeSpace) {
 
-	short recordSize = baseAttributesOffset + attributesLengthSum;
+	const RecordCodec &codec = recordCodec(recordDescriptor);
+	if (fixedLayout(fileHandle) && checkFixedSchema(codec) != 0)
+		return -1;
 
-	if (recordSize > MAX_RECORD_SIZE) {
-		cout << "ERROR: MAX_RECORD_SIZE = " << MAX_RECORD_SIZE
-				<< " but this record has size = " << recordSize << endl;
+	unique_lock<shared_mutex> fileLock(fileHandle.getRecordLock());
+	if (skipFreeSpace && fileHandle.getNumberOfPages() != 0) {
+		cout << "ERROR: only an empty file can be loaded without free space"
+				<< endl;
 		return -1;
 	}
 
-	/***************************************************************************************************
-	 ***** INSERTING RECORD EITHER IN CURRENT WORKING PAGE OR IN ANOTHER ONE WITH ENOUGH SPACE   *******
-	 ***************************************************************************************************/
-
-	//if there is enough space in the current page
-	if (pageFreeSpace >= recordSize + 4) {
-
-//		cout <<"there is enough space:  pageFreeSpace = " <<  pageFreeSpace << " | recordSize = " << recordSize << endl;
-
-		storeRecordInCurrentPage(recordSize, rid, fileHandle);
+	vector<char> pages((size_t) BULK_LOAD_PAGES * PAGE_SIZE);
+	vector<short> freeSpace; //of the pages of the batch, the last one being filled
+	PageNum firstPage = fileHandle.getNumberOfPages();
+	ZoneMap *fileZoneMap = zoneMap(fileHandle);
+	char data[PAGE_SIZE];
+	short recordSpace = 0; //taken by the last record in its page
+	RC rc = 0;
+
+	while (rc == 0 && source(context, data)) {
+		int slot = -1;
+		if (!freeSpace.empty())
+			slot = bulkInsert(fileHandle, codec,
+					&pages[(freeSpace.size() - 1) * PAGE_SIZE], false, data,
+					freeSpace.back(), recordSpace);
+		if (slot == -1) {
+			if (freeSpace.size() == BULK_LOAD_PAGES) {
+				rc = writeBulkPages(fileHandle, &pages[0], freeSpace,
+						skipFreeSpace);
+				firstPage += freeSpace.size();
+				freeSpace.clear();
+			}
+			freeSpace.push_back(0);
+			slot = bulkInsert(fileHandle, codec,
+					&pages[(freeSpace.size() - 1) * PAGE_SIZE], true, data,
+					freeSpace.back(), recordSpace);
+			if (slot == -1) {
+				freeSpace.pop_back();
+				rc = -1;
+			}
+		}
 
-	} else { //else, there is not enough space in the page, so we search all the pages
-		// until either we find a page with enough space or we get to the end of the file,
-		// in which case we will have to append a new page at the end (and possibly
-		// a new header page if the last header page was full).
+		if (rc == 0 && fileZoneMap != NULL)
+			fileZoneMap->add(firstPage + freeSpace.size() - 1, recordDescriptor,
+					data);
+	}
 
-//		cout <<"oops! there was not enough free space:  pageFreeSpace = " <<  pageFreeSpace << " | recordSize = " << recordSize << endl;
+	if (!freeSpace.empty()
+			&& writeBulkPages(fileHandle, &pages[0], freeSpace, skipFreeSpace)
+					!= 0)
+		rc = -1;
+	//inserts go on filling the last page, if it is in the free space map
+	fileHandle.setFillTarget(recordSpace,
+			skipFreeSpace ? -1 : (int) fileHandle.getNumberOfPages() - 1);
+	if (fileHandle.flushMetadata() != 0)
+		rc = -1;
+
+	if (fileZoneMap == NULL)
+		ZoneMap::discard(fileHandle.getFileName());
+	else if (rc != 0)
+		fileZoneMap->invalidate();
+	return rc;
+}
 
-		int pageNumFound = fileHandle.findPageWithEnoughSpace(recordSize + 4);
+/*
+ * Store the record in a page being built by bulkLoad, in the format of the
+ * layout of the file; a new page is initialized first. Returns the slot of the
+ * record, or -1 if the page has no room for it, and the space the record takes.
+ */
+int RecordBasedFileManager::bulkInsert(FileHandle &fileHandle,
+		const RecordCodec &codec, char *page, bool newPage, const void *data,
+		short &freeSpace, short &recordSpace) {
+
+	int attrNum = codec.getNumberOfFields();
+	int slot;
+	if (fixedLayout(fileHandle)) {
+		FixedPage fixedPage(page, attrNum);
+		if (newPage)
+			fixedPage.initialize();
+		slot = fixedPage.insert(data);
+		freeSpace = fixedPage.getFreeSpace();
+		recordSpace = attrNum * sizeof(int);
+
+	} else if (paxLayout(fileHandle)) {
+		const vector<short> &varCharFields = codec.getVarCharFields();
+		int chunkSize = PaxPage::chunkSize(data, attrNum, varCharFields);
+		recordSpace = PaxPage::recordSpace(attrNum, chunkSize);
+		if (newPage) {
+			if (!PaxPage::fitsEmptyPage(attrNum, chunkSize)) {
+				cout << "ERROR: the record doesn't fit in a page" << endl;
+				return -1;
+			}
+			PaxPage(page, attrNum, varCharFields, chunkSize);
+		}
+		PaxPage paxPage(page);
+		slot = paxPage.insert(data);
+		freeSpace = paxPage.getFreeSpace();
+
+	} else {
+		char recordBuffer[PAGE_SIZE];
+		short recordSize = encodeRecord(codec, data, recordBuffer);
+		if (recordSize == -1)
+			return -1;
+		recordSpace = recordSize + 4;
+		if (newPage) {
+			initializePage(page);
+			freeSpace = PAGE_SIZE - 6;
+		}
+		if (freeSpace < recordSize + 4)
+			return -1;
+		RID rid;
+		freeSpace -= storeRecordInCurrentPage(fileHandle, page, recordBuffer,
+				recordSize, rid);
+		return rid.slotNum;
+	}
+	return slot == -1 ? -1 : slot + 1;
+}
 
-		if (pageNumFound == -1) { //no page with enough space, we have to append a new page
+/*
+ * Append the pages of a batch of bulkLoad, and register their free space.
+ */
+RC RecordBasedFileManager::writeBulkPages(FileHandle &fileHandle,
+		const char *pages, const vector<short> &freeSpace, bool skipFreeSpace) {
+	PageNum firstPage = fileHandle.getNumberOfPages();
+	if (fileHandle.appendPages(pages, freeSpace.size()) != 0)
+		return -1;
+	for (unsigned i = 0; !skipFreeSpace && i < freeSpace.size(); ++i)
+		if (fileHandle.setPageFreeSpace(firstPage + i, freeSpace[i], false)
+				!= 0)
+			return -1;
+	return 0;
+}
 
-			int numPages = fileHandle.getNumberOfPages();
+/*
+ * Translate the record from the format of insertRecord into the format it is stored
+ * in, in recordBuffer. Returns the size of the stored record, or -1 if it does not
+ * fit in a page.
+ */
+short RecordBasedFileManager::encodeRecord(const RecordCodec &codec,
+		const void *data, char *recordBuffer) {
 
-			//if all the headers are full, we have to append a new header
+	short recordSize = codec.encode(data, recordBuffer);
 
-//			cout
-//					<< "\t----------------------------------------------------------------"
-//					<< endl;
-//			cout
-//					<< "\tno page found with enough space. we will have to append a new page"
-//					<< endl;
+	//a record can always be replaced in place by a forwarding stub
+	if (recordSize < FORWARDING_SIZE)
+		recordSize = FORWARDING_SIZE;
 
-			headerNum = numPages / maxPagesPerHeader;
-			pageNum = numPages;
-			pageFreeSpace = PAGE_SIZE - recordSize - 6 - 4;
+	//check that the record fits at least within a single page
+	if (recordSize > MAX_RECORD_SIZE) {
+		cout << "ERROR: MAX_RECORD_SIZE = " << MAX_RECORD_SIZE
+				<< " but this record has size = " << recordSize << endl;
+		return -1;
+	}
 
-//			cout << "\trecordSize = " << recordSize << endl;
-//			cout << "\theaderNum = " << headerNum << endl;
-//			cout << "\tpageNum = " << pageNum << endl;
-//			cout << "\tpageFreeSpace = " << pageFreeSpace << endl;
+	return recordSize;
+}
 
-			//if the number of pages is positive and they
-			//they are completing all the header pages, then
-			//we need to append a new header page before appending
-			//a new page
-			if (numPages > 0 && numPages % maxPagesPerHeader == 0) {
+/*
+ * Store the record (which is assumed to be stored in the recordBuffer) into the page
+ * (either pinned in the buffer pool or being built in memory, the caller writes it back).
+ * The record takes the first slot of the list of free slots, or a new slot at the end
+ * of the slot directory if there is none.
+ * Sets the slot number of the rid and returns the free space used by the record, which
+ * the caller has to register for the page.
+ */
+short RecordBasedFileManager::storeRecordInCurrentPage(FileHandle &fileHandle,
+		char *pageBuffer, const char *recordBuffer, short recordSize, RID& rid) {
 
-				int numPages = 0;
-				memcpy(headerBuffer, &numPages, sizeof(int));
-				//append header at the end
-				fileHandle.writeHeaderPage(headerNum, headerBuffer);
+	short slotsNumber;
+	short firstFreeSlotIndex;
+	memcpy(&slotsNumber, pageBuffer + PAGE_SIZE - 4, sizeof(short));
+	memcpy(&firstFreeSlotIndex, pageBuffer + PAGE_SIZE - 6, sizeof(short));
 
-			}
+	bool noFreeSlot = (firstFreeSlotIndex == -1);
+	short slotNum;
+
+	if (noFreeSlot) {
+		//a new slot at the bottom of the slot directory (added by placeRecord)
+		slotNum = slotsNumber + 1;
+	} else {
+		//take the first free slot; the length of a free slot holds the next one
+		slotNum = firstFreeSlotIndex;
+		short nextFreeSlotIndex;
+		memcpy(&nextFreeSlotIndex, pageBuffer + PAGE_SIZE - 6 - slotNum * 4,
+				sizeof(short));
+		memcpy(pageBuffer + PAGE_SIZE - 6, &nextFreeSlotIndex, sizeof(short));
+	}
 
-			numPages++;
+	placeRecord(fileHandle, pageBuffer, slotNum, recordBuffer, recordSize);
 
-			//append a new page and store record there
-			short freeSpaceOffset = recordSize;
-			short slotsNumber = 1;
-			short freeSlotIndex = -1;
-			short recordOffset = 0;
-			short recordLength = recordSize;
-			memcpy(pageBuffer, recordBuffer, recordLength);
-			memcpy(pageBuffer + PAGE_SIZE - 6, &freeSlotIndex, sizeof(short));
-			memcpy(pageBuffer + PAGE_SIZE - 4, &slotsNumber, sizeof(short));
-			memcpy(pageBuffer + PAGE_SIZE - 2, &freeSpaceOffset, sizeof(short));
-			memcpy(pageBuffer + PAGE_SIZE - 10, &recordLength, sizeof(short));
-			memcpy(pageBuffer + PAGE_SIZE - 8, &recordOffset, sizeof(short));
-			fileHandle.appendPage(pageBuffer);
+	//set slot number in rid
+	rid.slotNum = slotNum;
 
-//			cout << "recordLength = " << recordLength << endl;
+	//space used, considering whether we reused a slot or not
+	return recordSize + (noFreeSlot ? 4 : 0);
+}
 
-			//we have to update the number of pages in the last header
-			//we have to update the free space for this page in the last header
-			//we have to update the total number of pages in the first header
+/*
+ * Copy the record into the page and point the slot slotNum (which must not hold a
+ * record, or be the slot right after the last one, which is then appended) to it.
+ * Since we know that the page has enough free space, first we try to store the record
+ * in the contiguous free space. If the contiguous free space is not big enough, we
+ * compact all the other records and then store it in the free space.
+ */
+void RecordBasedFileManager::placeRecord(FileHandle &fileHandle,
+		char *pageBuffer, int slotNum, const char *recordBuffer,
+		short recordSize) {
 
-			//updating number of pages and this new page's free space in the last header
-			fileHandle.readHeaderPage(headerNum, headerBuffer);
-			int pageCount = numPages - headerNum * maxPagesPerHeader;
-			memcpy(headerBuffer, &pageCount, sizeof(int));
+	short freeSpaceOffset;
+	short slotsNumber;
+	memcpy(&freeSpaceOffset, pageBuffer + PAGE_SIZE - 2, sizeof(short));
+	memcpy(&slotsNumber, pageBuffer + PAGE_SIZE - 4, sizeof(short));
 
-//			cout << "pageCount = " << pageCount << endl;
+	//the new slot (if any) is written only after the compaction, since it may
+	//still overlap the records
+	bool newSlot = slotNum > slotsNumber;
+	int contiguousFreeSpace = PAGE_SIZE - freeSpaceOffset - 6
+			- (newSlot ? slotNum : slotsNumber) * 2 * sizeof(short);
 
-			//
-			int pageSlotOffset = 4
-					+ sizeof(short) * (pageNum % maxPagesPerHeader);
-			memcpy(headerBuffer + pageSlotOffset, &pageFreeSpace,
-					sizeof(short));
+	//if there is not enough contiguous free space we have to compact the records
+	if (contiguousFreeSpace < recordSize)
+		freeSpaceOffset = compactPage(fileHandle, pageBuffer);
 
-//			cout << "pageSlotOffset = " << pageSlotOffset << endl;
+	if (newSlot) {
+		slotsNumber = slotNum;
+		memcpy(pageBuffer + PAGE_SIZE - 4, &slotsNumber, sizeof(short));
+	}
 
-			//
-			fileHandle.writeHeaderPage(headerNum, headerBuffer);
+	//copy the record at the beginning of the free space
+	memcpy(pageBuffer + freeSpaceOffset, recordBuffer, recordSize);
 
-			//set rid
-			rid.pageNum = pageNum;
-			rid.slotNum = 1;
+	//copy the record metadata in the slot
+	int slotOffset = PAGE_SIZE - 6 - slotNum * 2 * sizeof(short);
+	memcpy(pageBuffer + slotOffset, &recordSize, sizeof(short));
+	memcpy(pageBuffer + slotOffset + 2, &freeSpaceOffset, sizeof(short));
 
-//			cout << "rid.pageNum = " << rid.pageNum << endl;
-//			cout << "rid.slotNum = " << rid.slotNum << endl;
+	//update freeSpaceOffset at the end of the page
+	freeSpaceOffset += recordSize;
+	memcpy(pageBuffer + PAGE_SIZE - 2, &freeSpaceOffset, sizeof(short));
+}
 
-		} else { //else, we were able to find an existing page with enough space, so let's use it
+/*
+ * Move all the records of the page to its beginning, one after the other, so that
+ * all the free space is contiguous. Returns the new freeSpaceOffset.
+ * The records are moved in the order of their offsets. The slots are sorted by offset
+ * in a fixed array on the stack, by insertion as they are read: a page has a bounded
+ * number of slots, and they are mostly in offset order already, so this is close to
+ * linear and never allocates. Records before the first hole don't move.
+ */
+short RecordBasedFileManager::compactPage(FileHandle &fileHandle,
+		char *pageBuffer) {
 
-			pageNum = pageNumFound;
-			headerNum = pageNum / maxPagesPerHeader;
+	short slotsNumber;
+	memcpy(&slotsNumber, pageBuffer + PAGE_SIZE - 4, sizeof(short));
 
-//			cout << "--------------------" << endl;
-//			cout << "We were able to find an existing page with enough space!" << endl;
-//			cout << "pageNumFound = " << pageNumFound << endl;
-//			cout << "headerNum " << headerNum << endl;
+	struct SlotEntry {
+		short offset;
+		short length;
+		short index;
+	} entries[MAX_SLOTS];
+	int entriesNumber = 0;
 
-			//udpate page free space
-			fileHandle.readHeaderPage(headerNum, headerBuffer);
-			int pageSlotOffset = 4
-					+ sizeof(short) * (pageNum % maxPagesPerHeader);
-			memcpy(&pageFreeSpace, headerBuffer + pageSlotOffset,
-					sizeof(short));
+	short recordLength;
+	short recordOffset;
 
-//			cout << "pageSlotOffset = " << pageSlotOffset << endl;
-//			cout << "pageFreeSpace = " << pageFreeSpace << endl;
+	for (int i = 1, offset = PAGE_SIZE - 6 - 4; i <= slotsNumber;
+			++i, offset -= 4) {
+		memcpy(&recordLength, pageBuffer + offset, sizeof(short));
+		memcpy(&recordOffset, pageBuffer + offset + 2, sizeof(short));
 
-			//store record in the page found
-			fileHandle.readPage(pageNum, pageBuffer);
-			storeRecordInCurrentPage(recordSize, rid, fileHandle);
+		if (recordOffset == -1)
+			continue;
 
+		//insert in increasing order of recordOffset
+		int j = entriesNumber++;
+		while (j > 0 && entries[j - 1].offset > recordOffset) {
+			entries[j] = entries[j - 1];
+			j--;
 		}
+		entries[j].offset = recordOffset;
+		entries[j].length = recordLength;
+		entries[j].index = i;
+	}
 
+	short offset = 0;
+	unsigned movedBytes = 0;
+
+	//compact
+	for (int i = 0; i < entriesNumber; ++i) {
+		if (offset < entries[i].offset) {
+			memmove(pageBuffer + offset, pageBuffer + entries[i].offset,
+					entries[i].length);
+			memcpy(pageBuffer + PAGE_SIZE - 6 - 4 * entries[i].index + 2,
+					&offset, sizeof(short));
+			movedBytes += entries[i].length;
+		}
+		offset += entries[i].length;
 	}
 
-	return 0;
+	memcpy(pageBuffer + PAGE_SIZE - 2, &offset, sizeof(short));
+
+	fileHandle.compactionCounter++;
+	fileHandle.compactedBytesCounter += movedBytes;
+	return offset;
 }
 
 /*
- * Store the record (which is assumed to be stored in the recordBuffer) into the current page
- * (which is assumed to be cached in the pageBuffer).
- * Since we know that the page has enough free space, first we try to store the record
- * in the contiguous free space. If the contiguous free space is not big enough, we compact
- * all the previous records and then store the new record in the free space.
+ * Bytes of the page that only a compaction can turn into contiguous free space:
+ * the holes left between the records by deletions and updates.
  */
-void RecordBasedFileManager::storeRecordInCurrentPage(int recordSize, RID& rid,
-		FileHandle& fileHandle) {
-
-//	cout << "\t" << "------------------------------ " << endl;
-//	cout << "\t" << "from rbfm:storeRecordInCurrentPage() " << endl;
-
-	//check if there is enough contiguous free space to store the record
-
+short RecordBasedFileManager::reclaimableSpace(const char *pageBuffer) {
 	short freeSpaceOffset;
 	short slotsNumber;
-	short firstFreeSlotIndex;
-
-	bool noFreeSlot;
-
 	memcpy(&freeSpaceOffset, pageBuffer + PAGE_SIZE - 2, sizeof(short));
 	memcpy(&slotsNumber, pageBuffer + PAGE_SIZE - 4, sizeof(short));
-	memcpy(&firstFreeSlotIndex, pageBuffer + PAGE_SIZE - 6, sizeof(short));
-
-	int contiguousFreeSpace = PAGE_SIZE - freeSpaceOffset - 6
-			- slotsNumber * 2 * sizeof(short);
-
-//	cout << "\tfreeSpaceOffset = " << freeSpaceOffset << endl;
-//	cout << "\tslotsNumber = " << slotsNumber << endl;
-//	cout << "\tfirstFreeSlotIndex = " << firstFreeSlotIndex << endl;
-
-
-	noFreeSlot = (firstFreeSlotIndex == -1);
-
-//	cout << "\tnoFreeSlot = " << noFreeSlot << endl;
-
-	//we check if there is any free slot we can reuse, otherwise we have to append a new
-	// slot at the bottom to store the address and the length of this new record
-	if (noFreeSlot)
-		contiguousFreeSpace -= sizeof(short) * 2;
-
-	//if there is enough contiguous free space
-	//we store the record at the beginning of it
-	if (contiguousFreeSpace >= recordSize) {
-
-//		cout << "\t" << " there is enough contiguous free space, yay! " << endl;
-
-		//copy the record
-		memcpy(pageBuffer + freeSpaceOffset, recordBuffer, recordSize);
-
-		//copy the record metadata either in a new slot or in a free slot
-		if (noFreeSlot) {
-//			cout << "\t\t" << " no free slot -> we have to use a new one " << endl;
-			slotsNumber++;
-			int newSlotOffset = PAGE_SIZE - 6 - slotsNumber * 2 * sizeof(short);
-			//copy the record size
-			memcpy(pageBuffer + newSlotOffset, &recordSize, sizeof(short));
-			//copy the record offset
-			memcpy(pageBuffer + newSlotOffset + 2, &freeSpaceOffset,
-					sizeof(short));
-			//update slotsNumber
-			memcpy(pageBuffer + PAGE_SIZE - 4, &slotsNumber, sizeof(short));
-
-			//set slot number in rid
-			rid.slotNum = slotsNumber;
-
-		} else { //we can reuse a free slot
-//			cout << "\t\t" << " there is a free slot -> let's use it" << endl;
-			int newSlotOffset = PAGE_SIZE - 6
-					- firstFreeSlotIndex * 2 * sizeof(short);
-			//copy the record size
-			memcpy(pageBuffer + newSlotOffset, &recordSize, sizeof(short));
-			//copy the record offset
-			memcpy(pageBuffer + newSlotOffset + 2, &freeSpaceOffset,
-					sizeof(short));
-
-			//we have to find a new free slot and update firstFreeSlotIndex in the page
-			firstFreeSlotIndex = -1;
-			short aux;
-			for (int index = 1, offset = PAGE_SIZE - 6 - 2;
-					index <= slotsNumber; ++index, offset -= 4) {
-				//read the slotOffset
-				memcpy(&aux, pageBuffer + offset, sizeof(short));
-				if (aux == -1) { //free slot
-					firstFreeSlotIndex = index;
-					break;
-				}
-			}
-			memcpy(pageBuffer + PAGE_SIZE - 6, &firstFreeSlotIndex,
-					sizeof(short));
-
-			//set slot number in rid
-			rid.slotNum = firstFreeSlotIndex;
-		}
-
-		//update freeSpaceOffset at the end of the page
-		freeSpaceOffset += recordSize;
-		memcpy(pageBuffer + PAGE_SIZE - 2, &freeSpaceOffset, sizeof(short));
-
-	} else { //there is not enough contiguous space, so we have to compact the records
-
-//		cout << "\t" << "not enough contiguous free space -> we are going to compact records" << endl;
-
-		//index,length,offset per record
-		vector<pair<int, pair<short, short> > > indexSlotDataPairs;
 
+	short reclaimable = freeSpaceOffset;
+	for (int i = 1, offset = PAGE_SIZE - 6 - 4; i <= slotsNumber;
+			++i, offset -= 4) {
 		short recordLength;
 		short recordOffset;
+		memcpy(&recordLength, pageBuffer + offset, sizeof(short));
+		memcpy(&recordOffset, pageBuffer + offset + 2, sizeof(short));
+		if (recordOffset != -1)
+			reclaimable -= recordLength;
+	}
+	return reclaimable;
+}
 
-		for (int i = 1, offset = PAGE_SIZE - 6 - 4; i <= slotsNumber;
-				++i, offset -= 4) {
-			memcpy(&recordLength, pageBuffer + offset, sizeof(short));
-			memcpy(&recordOffset, pageBuffer + offset + 2, sizeof(short));
-
-			if (recordOffset == -1)
-				continue;
-
-			indexSlotDataPairs.push_back(
-					std::make_pair(i,
-							std::make_pair(recordLength, recordOffset)));
-		}
-
-		//sort in increasing order based on recordOffset
-		sort(indexSlotDataPairs.begin(), indexSlotDataPairs.end(), pairCompare);
-
-		short offset = 0;
-		int index;
-
-		//compact
-		for (unsigned i = 0; i < indexSlotDataPairs.size(); ++i) {
-
-			index = indexSlotDataPairs[i].first;
-			recordLength = indexSlotDataPairs[i].second.first;
-			recordOffset = indexSlotDataPairs[i].second.second;
-
-			if (offset < recordOffset) {
-				memmove(pageBuffer + offset, pageBuffer + recordOffset,
-						recordLength);
-				memmove(pageBuffer + PAGE_SIZE - 6 - 4 * index + 2, &offset,
-						sizeof(short));
-			}
+/*
+ * With lazy compaction, pages are also compacted when the buffer pool writes them
+ * back (nobody has them pinned then), so that later insertions find the free space
+ * contiguous and don't have to compact them. Pages with less reclaimable space than
+ * the threshold are not worth it and are left alone.
+ */
+void RecordBasedFileManager::compactOnWriteBack(FileHandle &fileHandle,
+		char *pageBuffer) {
+	if (reclaimableSpace(pageBuffer) >= compactionThreshold)
+		compactPage(fileHandle, pageBuffer);
+}
 
-			offset += recordLength;
-		}
-
-		//store the record at the beginning of the now compacted free space
-		memcpy(pageBuffer + offset, recordBuffer, recordSize);
-
-		//copy the record metadata either in a new slot or in a free slot
-		if (noFreeSlot) {
-			slotsNumber++;
-			int newSlotOffset = PAGE_SIZE - 6 - slotsNumber * 2 * sizeof(short);
-			//copy the record size
-			memcpy(pageBuffer + newSlotOffset, &recordSize, sizeof(short));
-			//copy the record offset
-			memcpy(pageBuffer + newSlotOffset + 2, &offset, sizeof(short));
-			//update slotsNumber
-			memcpy(pageBuffer + PAGE_SIZE - 4, &slotsNumber, sizeof(short));
-
-			//set slot number in rid
-			rid.slotNum = slotsNumber;
-
-		} else { //we can reuse a free slot
-
-			int newSlotOffset = PAGE_SIZE - 6
-					- firstFreeSlotIndex * 2 * sizeof(short);
-			//copy the record size
-			memcpy(pageBuffer + newSlotOffset, &recordSize, sizeof(short));
-			//copy the record offset
-			memcpy(pageBuffer + newSlotOffset + 2, &offset, sizeof(short));
-
-			//we have to find a new free slot and update firstFreeSlotIndex in the page
-			firstFreeSlotIndex = -1;
-			short aux;
-			for (int index = 1, offset = PAGE_SIZE - 6 - 2;
-					index <= slotsNumber; ++index, offset -= 4) {
-				//read the slotOffset
-				memcpy(&aux, pageBuffer + offset, sizeof(short));
-				if (aux == -1) { //free slot
-					firstFreeSlotIndex = index;
-					break;
-				}
-			}
-			memcpy(pageBuffer + PAGE_SIZE - 6, &firstFreeSlotIndex,
-					sizeof(short));
+/*
+ * Enable or disable the compaction of pages on write back (see compactOnWriteBack)
+ * for the files opened from now on. Pages are always compacted when an insertion
+ * or an update needs the space.
+ */
+void RecordBasedFileManager::setLazyCompaction(bool lazy, short threshold) {
+	lazyCompaction = lazy;
+	compactionThreshold = threshold;
+}
 
-			//set slot number in rid
-			rid.slotNum = firstFreeSlotIndex;
-		}
+/*
+ * Replace the record in slot slotNum with another one (the page must have enough
+ * free space for the difference). It is overwritten in place if it is not bigger,
+ * otherwise it is moved to the free space of the page.
+ */
+void RecordBasedFileManager::replaceRecord(FileHandle &fileHandle,
+		char *pageBuffer, int slotNum, const char *recordBuffer,
+		short recordSize) {
 
-		//update freeSpaceOffset at the end of the page
-		offset += recordSize;
-		memcpy(pageBuffer + PAGE_SIZE - 2, &offset, sizeof(short));
+	int slotOffset = PAGE_SIZE - 6 - slotNum * 4;
+	short recordLength;
+	short recordOffset;
+	memcpy(&recordLength, pageBuffer + slotOffset, sizeof(short));
+	memcpy(&recordOffset, pageBuffer + slotOffset + 2, sizeof(short));
 
+	if (recordSize <= recordLength) {
+		memcpy(pageBuffer + recordOffset, recordBuffer, recordSize);
+		memcpy(pageBuffer + slotOffset, &recordSize, sizeof(short));
+	} else {
+		//the old record is left out of the compaction
+		recordOffset = -1;
+		memcpy(pageBuffer + slotOffset + 2, &recordOffset, sizeof(short));
+		placeRecord(fileHandle, pageBuffer, slotNum, recordBuffer,
+				recordSize);
 	}
+}
 
-	//write the pageBuffer back to the page on disk
-	fileHandle.writePage(pageNum,pageBuffer);
+/*
+ * Free the slot slotNum, putting it at the head of the list of free slots of the
+ * page. A free slot has offset -1 and keeps the next free slot in its length.
+ */
+void RecordBasedFileManager::freeSlot(char *pageBuffer, int slotNum) {
+	short firstFreeSlotIndex;
+	memcpy(&firstFreeSlotIndex, pageBuffer + PAGE_SIZE - 6, sizeof(short));
 
-	//set page number in rid
-	rid.pageNum = pageNum;
+	int slotOffset = PAGE_SIZE - 6 - slotNum * 4;
+	short recordOffset = -1;
+	memcpy(pageBuffer + slotOffset, &firstFreeSlotIndex, sizeof(short));
+	memcpy(pageBuffer + slotOffset + 2, &recordOffset, sizeof(short));
 
-	//update page free space in its corresponding headerPage (considering whether we reused a slot or not)
-	pageFreeSpace -= recordSize + (noFreeSlot ? 4 : 0);
-	fileHandle.readHeaderPage(headerNum, headerBuffer);
-	int pageSlotOffset = 4 + (pageNum % maxPagesPerHeader) * sizeof(short);
-	memcpy(headerBuffer + pageSlotOffset, &pageFreeSpace, sizeof(short));
-	fileHandle.writeHeaderPage(headerNum, headerBuffer);
+	firstFreeSlotIndex = slotNum;
+	memcpy(pageBuffer + PAGE_SIZE - 6, &firstFreeSlotIndex, sizeof(short));
 }
 
-bool RecordBasedFileManager::pairCompare(
-		const pair<int, pair<short, short> >& firstElem,
-		const pair<int, pair<short, short> >& secondElem) {
-	return firstElem.second.second < secondElem.second.second;
+/*
+ * Format an empty data page: no records, no slots and no free slot.
+ */
+void RecordBasedFileManager::initializePage(char *pageBuffer) {
+	short freeSpaceOffset = 0;
+	short slotsNumber = 0;
+	short freeSlotIndex = -1;
+	memcpy(pageBuffer + PAGE_SIZE - 6, &freeSlotIndex, sizeof(short));
+	memcpy(pageBuffer + PAGE_SIZE - 4, &slotsNumber, sizeof(short));
+	memcpy(pageBuffer + PAGE_SIZE - 2, &freeSpaceOffset, sizeof(short));
 }
 
 /*
@@ -543,124 +791,1312 @@ RC RecordBasedFileManager::readRecord(FileHandle &fileHandle,
 		return -1;
 	}
 
-	pageNum = rid.pageNum;
-	headerNum = pageNum / maxPagesPerHeader;
-
-//	cout << "pageNum = " << pageNum << endl;
-//	cout << "headerNum = " << headerNum << endl;
+	//records are read under a shared lock, so that concurrent readers of the
+	//file don't block each other but don't see a page while it is modified
+	shared_lock<shared_mutex> fileLock(fileHandle.getRecordLock());
+
+	if (fixedLayout(fileHandle)) {
+		char *page = fetchFixedPage(fileHandle, rid);
+		if (page == NULL)
+			return -1;
+		FixedPage(page).read(rid.slotNum - 1, data);
+		bpm->unpinPage(fileHandle, rid.pageNum, false);
+		return 0;
+	}
+	if (paxLayout(fileHandle)) {
+		PageNum pageNum;
+		int slot;
+		char *page = fetchPaxRecord(fileHandle, rid, pageNum, slot);
+		if (page == NULL)
+			return -1;
+		PaxPage(page).read(slot, data);
+		bpm->unpinPage(fileHandle, pageNum, false);
+		return 0;
+	}
 
-	fileHandle.readPage(pageNum, pageBuffer);
+	PageNum recordPageNum;
+	short recordLength;
+	const char *record = fetchRecord(fileHandle, rid, recordPageNum,
+			recordLength);
+	if (record == NULL)
+		return -1;
 
-	short slotsNumber;
-	memcpy(&slotsNumber, pageBuffer + PAGE_SIZE - 4, sizeof(short));
+	//the fields are contiguous in the stored record, so it is copied straight
+	//from the page into data
+	decodeRecord(record, recordDescriptor, data);
+	bpm->unpinPage(fileHandle, recordPageNum, false);
+	return 0;
+}
 
-//	cout << "slotsNumber = " << slotsNumber << endl;
+/*
+ * Read the records of a list of rids, as if readRecord was called for each of
+ * them: data[i] receives the record of rids[i]. The rids are sorted by page,
+ * so that each page is fetched only once no matter how many of the records
+ * it holds. Returns -1 if some rid is invalid (the other records are still
+ * read).
+ */
+RC RecordBasedFileManager::readRecords(FileHandle &fileHandle,
+		const vector<Attribute> &recordDescriptor, const vector<RID> &rids,
+		const vector<void *> &data) {
 
-	if (slotsNumber < rid.slotNum || rid.slotNum < 1) {
-		cout << "rid.slotNum = " << rid.slotNum
-				<< " points to a nonexistent slot" << endl;
+	if (rids.size() != data.size()) {
+		cout << "ERROR: " << rids.size() << " rids but " << data.size()
+				<< " output buffers" << endl;
 		return -1;
 	}
 
-	//copy the record into recordBuffer
-	short recordLength;
-	short recordOffset;
-	int slotOffset = PAGE_SIZE - 6 - rid.slotNum * 4;
-	memcpy(&recordLength, pageBuffer + slotOffset, sizeof(short));
-	memcpy(&recordOffset, pageBuffer + slotOffset + 2, sizeof(short));
-
-//	cout << "recordLength = " << recordLength << endl;
-//	cout << "recordOffset = " << recordOffset << endl;
-//	cout << "slotOffset = " << slotOffset << endl;
+	if (fixedLayout(fileHandle) || paxLayout(fileHandle)) {
+		RC rc = 0;
+		for (unsigned i = 0; i < rids.size(); ++i)
+			if (readRecord(fileHandle, recordDescriptor, rids[i], data[i]) != 0)
+				rc = -1;
+		return rc;
+	}
 
-	memcpy(recordBuffer, pageBuffer + recordOffset, recordLength);
+	//positions of the rids, in page order
+	vector<pair<PageNum, unsigned> > order(rids.size());
+	for (unsigned i = 0; i < rids.size(); ++i)
+		order[i] = make_pair(rids[i].pageNum, i);
+	sort(order.begin(), order.end());
 
-	//change record format and copy into data
-	short attrNum;
-	memcpy(&attrNum, recordBuffer, sizeof(short));
+	unsigned totalPages = fileHandle.getNumberOfPages();
+	RC rc = 0;
+
+	shared_lock<shared_mutex> fileLock(fileHandle.getRecordLock());
+
+	unsigned i = 0;
+	while (i < order.size()) {
+		PageNum pageNum = order[i].first;
+		unsigned end = i;
+		while (end < order.size() && order[end].first == pageNum)
+			end++;
+
+		char *page;
+		if (totalPages <= pageNum) {
+			cout << "rid.pageNum = " << pageNum
+					<< " points to a nonexistent page" << endl;
+			rc = -1;
+		} else if (bpm->fetchPage(fileHandle, pageNum, page) != 0) {
+			rc = -1;
+		} else {
+			for (; i < end; ++i) {
+				unsigned index = order[i].second;
+				short recordLength;
+				const char *record = recordAddress(page, rids[index].slotNum,
+						recordLength);
+				if (record == NULL) {
+					rc = -1;
+				} else if (recordMarker(record) == FORWARDING_STUB) {
+					//the record was moved to another page
+					PageNum recordPageNum;
+					record = fetchRecord(fileHandle, rids[index], recordPageNum,
+							recordLength);
+					if (record == NULL) {
+						rc = -1;
+						continue;
+					}
+					decodeRecord(record, recordDescriptor, data[index]);
+					bpm->unpinPage(fileHandle, recordPageNum, false);
+				} else {
+					if (recordMarker(record) == MOVED_RECORD)
+						record += FORWARDING_SIZE;
+					decodeRecord(record, recordDescriptor, data[index]);
+				}
+			}
+			bpm->unpinPage(fileHandle, pageNum, false);
+		}
+		i = end;
+	}
 
-//	cout << "attrNum = " << attrNum << endl;
+	return rc;
+}
 
-	int nullsize = (int) ceil((double) attrNum / 8);
-	unsigned char nullbits[nullsize];
-	memcpy(nullbits, recordBuffer + sizeof(short), nullsize);
+/*
+ * Point the view to the record identified by the rid, without copying it.
+ * The page stays pinned and the file stays locked for reading until the
+ * view is released (or destroyed).
+ */
+RC RecordBasedFileManager::readRecordView(FileHandle &fileHandle,
+		const RID &rid, RecordView &recordView) {
+
+	recordView.release();
+
+	shared_lock<shared_mutex> fileLock(fileHandle.getRecordLock());
+
+	if (fixedLayout(fileHandle)) {
+		char *page = fetchFixedPage(fileHandle, rid);
+		if (page == NULL)
+			return -1;
+		FixedPage fixedPage(page);
+		recordView.fileHandle = &fileHandle;
+		recordView.pageNum = rid.pageNum;
+		recordView.record = fixedPage.field(rid.slotNum - 1, 0);
+		recordView.fixedNulls = fixedPage.nullBits(rid.slotNum - 1);
+		recordView.fixedFields = fixedPage.getNumberOfFields();
+		recordView.fileLock = move(fileLock);
+		return 0;
+	}
+	if (paxLayout(fileHandle)) {
+		PageNum pageNum;
+		int slot;
+		char *page = fetchPaxRecord(fileHandle, rid, pageNum, slot);
+		if (page == NULL)
+			return -1;
+		recordView.fileHandle = &fileHandle;
+		recordView.pageNum = pageNum;
+		recordView.record = page;
+		recordView.paxSlot = slot;
+		recordView.fileLock = move(fileLock);
+		return 0;
+	}
 
-//	cout << "nullsize = " << nullsize << endl;
+	PageNum pageNum;
+	short recordLength;
+	const char *record = fetchRecord(fileHandle, rid, pageNum, recordLength);
+	if (record == NULL)
+		return -1;
 
-	unsigned char bit;
-	unsigned char nullbyte;
+	recordView.fileHandle = &fileHandle;
+	recordView.pageNum = pageNum;
+	recordView.record = record;
+	recordView.fileLock = move(fileLock);
+	return 0;
+}
 
-	int index = 0;
-	vector<int> nonNullAttrIndexes;
+/*
+ * Address of the record stored in slot slotNum of the page, or NULL if the
+ * slot doesn't exist or its record was deleted.
+ */
+const char* RecordBasedFileManager::recordAddress(const char *page,
+		unsigned slotNum, short &recordLength) {
 
-	// read the null bits, skip null fields, collect indexes
-	// of non-null fields
-	for (int i = 0; i < nullsize; ++i) {
-		nullbyte = nullbits[i];
-		for (bit = (1 << 7); bit > 0; bit >>= 1) {
+	short slotsNumber;
+	memcpy(&slotsNumber, page + PAGE_SIZE - 4, sizeof(short));
 
-			if (index >= attrNum)
-				goto quitfors;
+	if (slotNum < 1 || (unsigned) slotsNumber < slotNum) {
+		cout << "rid.slotNum = " << slotNum << " points to a nonexistent slot"
+				<< endl;
+		return NULL;
+	}
 
-			if ((nullbyte & bit) == 0) {
+	short recordOffset;
+	int slotOffset = PAGE_SIZE - 6 - slotNum * 4;
+	memcpy(&recordLength, page + slotOffset, sizeof(short));
+	memcpy(&recordOffset, page + slotOffset + 2, sizeof(short));
+
+	if (recordOffset == -1) {
+		cout << "rid.slotNum = " << slotNum << " points to a deleted record"
+				<< endl;
+		return NULL;
+	}
+	return page + recordOffset;
+}
 
-				nonNullAttrIndexes.push_back(index);
+/*
+ * Pin the page of the record identified by the rid and return the address of the
+ * record in it, following its forwarding stub if the record was moved to another
+ * page. pageNum receives the page that has to be unpinned. NULL if the rid doesn't
+ * identify a record.
+ */
+const char* RecordBasedFileManager::fetchRecord(FileHandle &fileHandle,
+		const RID &rid, PageNum &pageNum, short &recordLength) {
 
-			}
-			index++;
-		}
+	if (fileHandle.getNumberOfPages() <= rid.pageNum) {
+		cout << "rid.pageNum = " << rid.pageNum
+				<< " points to a nonexistent page" << endl;
+		return NULL;
 	}
-	quitfors:
 
-//	cout << "non null attr: " <<nonNullAttrIndexes.size() << endl;
+	char *page;
+	if (bpm->fetchPage(fileHandle, rid.pageNum, page) != 0)
+		return NULL;
+	pageNum = rid.pageNum;
+
+	const char *record = recordAddress(page, rid.slotNum, recordLength);
+	if (record != NULL && recordMarker(record) == FORWARDING_STUB) {
+		RID target = forwardingRid(record);
+		bpm->unpinPage(fileHandle, pageNum, false);
+		if (bpm->fetchPage(fileHandle, target.pageNum, page) != 0)
+			return NULL;
+		pageNum = target.pageNum;
+		record = recordAddress(page, target.slotNum, recordLength);
+	}
 
-	short baseAttributesOffset = 1 + nullsize
-			+ nonNullAttrIndexes.size() * sizeof(short);
-	short attributeOffset;
-	short attributesLengthSum = 0;
-	int length;
-	Attribute attr;
-	AttrType type;
+	if (record == NULL) {
+		bpm->unpinPage(fileHandle, pageNum, false);
+		return NULL;
+	}
 
-//	cout << "baseAttributesOffset = " << baseAttributesOffset << endl;
+	if (recordMarker(record) == MOVED_RECORD) {
+		record += FORWARDING_SIZE;
+		recordLength -= FORWARDING_SIZE;
+	}
+	return record;
+}
 
-	for (unsigned i = 0; i < nonNullAttrIndexes.size(); ++i) {
-		index = nonNullAttrIndexes[i];
-		attr = recordDescriptor[index];
-		type = attr.type;
-		length = attr.length;
+/*
+ * Number of attributes of a stored record, or the marker of a forwarding stub
+ * or a moved record.
+ */
+short RecordBasedFileManager::recordMarker(const char *record) {
+	short marker;
+	memcpy(&marker, record, sizeof(short));
+	return marker;
+}
 
-		if (type == TypeVarChar) {
+/*
+ * The rid kept after the marker of a forwarding stub (where the record is) or
+ * of a moved record (where the record comes from).
+ */
+RID RecordBasedFileManager::forwardingRid(const char *record) {
+	RID rid;
+	memcpy(&rid.pageNum, record + sizeof(short), sizeof(unsigned));
+	memcpy(&rid.slotNum, record + sizeof(short) + sizeof(unsigned),
+			sizeof(unsigned));
+	return rid;
+}
 
-			int stringLength;
-			attributeOffset = baseAttributesOffset + attributesLengthSum;
-			memcpy(&stringLength, recordBuffer + attributeOffset, sizeof(int));
-			attributesLengthSum += sizeof(int);
-			length = stringLength;
+void RecordBasedFileManager::writeForwarding(char *record, short marker,
+		const RID &rid) {
+	memcpy(record, &marker, sizeof(short));
+	memcpy(record + sizeof(short), &rid.pageNum, sizeof(unsigned));
+	memcpy(record + sizeof(short) + sizeof(unsigned), &rid.slotNum,
+			sizeof(unsigned));
+}
 
-		}
+/*
+ * Copy the stored record into data, in the format of insertRecord (see
+ * RecordCodec::decode).
+ */
+void RecordBasedFileManager::decodeRecord(const char *record,
+		const vector<Attribute> &recordDescriptor, void *data) {
+	recordCodec(recordDescriptor).decode(record, data);
+}
 
-		attributesLengthSum += length;
-	}
+/*
+ * Codec of the record descriptor. The codec of the last descriptor used by the
+ * thread is kept, and only compiled again when the types of the fields change,
+ * so a sequence of calls on the same table compiles it once.
+ */
+const RecordCodec& RecordBasedFileManager::recordCodec(
+		const vector<Attribute> &recordDescriptor) {
 
-	//copy null bits
-	memcpy((char*) data, nullbits, nullsize);
+	thread_local RecordCodec lastCodec;
 
-	//copy the fields at the end of data
-	memcpy((char*) data + nullsize, recordBuffer + baseAttributesOffset,
-			attributesLengthSum);
-	return 0;
+	if (!lastCodec.matches(recordDescriptor))
+		lastCodec.compile(recordDescriptor);
+	return lastCodec;
 }
 
 /*
- * This is a utility method that will be mainly used for debugging/testing. It should be
- * able to interpret the bytes of each record using the passed-in record descriptor and
- * then print its content to the screen. For instance, suppose a record consists of two
- * fields: age (int) and height (float), which means the record will be of size 9 (1 byte
- * for the null-fields-indicator, 4 bytes for int, and 4 bytes for float). The printRecord
- * method should recognize the record format using the record descriptor. It should then
- * check the null-fields-indicator to skip certain fields if there are any NULL fields.
- * Then, it should be able to convert the four bytes after the first byte into an int
+ * Delete the record identified by the rid. Its slot goes to the list of free slots
+ * of the page, to be reused by a later insertion; if the record had been moved to
+ * another page, it is removed from there too.
+ */
+RC RecordBasedFileManager::deleteRecord(FileHandle &fileHandle,
+		const vector<Attribute> &/*recordDescriptor*/, const RID &rid) {
+
+	if (fileHandle.getNumberOfPages() <= rid.pageNum) {
+		cout << "rid.pageNum = " << rid.pageNum
+				<< " points to a nonexistent page" << endl;
+		return -1;
+	}
+
+	if (fixedLayout(fileHandle))
+		return deleteFixedRecord(fileHandle, rid);
+	if (paxLayout(fileHandle))
+		return deletePaxRecord(fileHandle, rid);
+
+	unique_lock<shared_mutex> fileLock(fileHandle.getRecordLock());
+
+	char *page;
+	if (bpm->fetchPage(fileHandle, rid.pageNum, page) != 0)
+		return -1;
+
+	short recordLength;
+	const char *record = recordAddress(page, rid.slotNum, recordLength);
+	bool forwarded = record != NULL
+			&& recordMarker(record) == FORWARDING_STUB;
+	RID target;
+	if (forwarded)
+		target = forwardingRid(record);
+	bpm->unpinPage(fileHandle, rid.pageNum, false);
+
+	if (record == NULL)
+		return -1;
+	if (forwarded && removeRecord(fileHandle, target) != 0)
+		return -1;
+	return removeRecord(fileHandle, rid);
+}
+
+/*
+ * Update the record identified by the rid, which doesn't change. The record is
+ * overwritten in place if it is not bigger, and otherwise moved within its page
+ * if the page has enough free space. If it doesn't fit in its page anymore, it is
+ * moved to another page and a forwarding stub to it is left in its slot. A record
+ * is never forwarded more than once: when a moved record grows again, it is moved
+ * from the page it was moved to and the stub in its home page is updated, and
+ * when it fits in its home page again it goes back there.
+ * The new values are added to the zone map of the home page before the update,
+ * and to the one of the page the record moves to as soon as it is stored there,
+ * before the lock of the file is released, so that no scan skips the record.
+ */
+RC RecordBasedFileManager::updateRecord(FileHandle &fileHandle,
+		const vector<Attribute> &recordDescriptor, const void *data,
+		const RID &rid) {
+
+	const RecordCodec &codec = recordCodec(recordDescriptor);
+	if (fixedLayout(fileHandle) && checkFixedSchema(codec) != 0)
+		return -1;
+
+	addToZoneMap(fileHandle, recordDescriptor, data, rid.pageNum);
+
+	if (fixedLayout(fileHandle))
+		return updateFixedRecord(fileHandle, codec, data, rid);
+	if (paxLayout(fileHandle))
+		return updatePaxRecord(fileHandle, recordDescriptor, codec, data, rid);
+	return updateSlottedRecord(fileHandle, recordDescriptor, codec, data, rid);
+}
+
+/*
+ * updateRecord for a file with the slotted layout.
+ */
+RC RecordBasedFileManager::updateSlottedRecord(FileHandle &fileHandle,
+		const vector<Attribute> &recordDescriptor, const RecordCodec &codec,
+		const void *data, const RID &rid) {
+
+	//the record is translated after room for the header of a moved record
+	char recordBuffer[PAGE_SIZE];
+	char *newRecord = recordBuffer + FORWARDING_SIZE;
+	short recordSize = encodeRecord(codec, data, newRecord);
+	if (recordSize == -1)
+		return -1;
+
+	if (fileHandle.getNumberOfPages() <= rid.pageNum) {
+		cout << "rid.pageNum = " << rid.pageNum
+				<< " points to a nonexistent page" << endl;
+		return -1;
+	}
+
+	unique_lock<shared_mutex> fileLock(fileHandle.getRecordLock());
+
+	char *homePage;
+	if (bpm->fetchPage(fileHandle, rid.pageNum, homePage) != 0)
+		return -1;
+
+	short homeLength;
+	const char *record = recordAddress(homePage, rid.slotNum, homeLength);
+	if (record == NULL) {
+		bpm->unpinPage(fileHandle, rid.pageNum, false);
+		return -1;
+	}
+	bool forwarded = recordMarker(record) == FORWARDING_STUB;
+	RID target;
+	if (forwarded)
+		target = forwardingRid(record);
+
+	//the record fits in its home page: if it was moved, the moved copy is removed
+	if (fileHandle.getPageFreeSpace(rid.pageNum) + homeLength >= recordSize) {
+		replaceRecord(fileHandle, homePage, rid.slotNum, newRecord,
+				recordSize);
+		bpm->unpinPage(fileHandle, rid.pageNum, true);
+		addPageFreeSpace(fileHandle, rid.pageNum, homeLength - recordSize);
+		if (forwarded)
+			return removeRecord(fileHandle, target);
+		return 0;
+	}
+
+	//otherwise it lives in another page, after a header pointing back to its home
+	writeForwarding(recordBuffer, MOVED_RECORD, rid);
+	short movedSize = recordSize + FORWARDING_SIZE;
+
+	//it was already moved and it still fits in the page it was moved to
+	if (forwarded) {
+		char *page;
+		if (bpm->fetchPage(fileHandle, target.pageNum, page) != 0) {
+			bpm->unpinPage(fileHandle, rid.pageNum, false);
+			return -1;
+		}
+		short movedLength;
+		if (recordAddress(page, target.slotNum, movedLength) != NULL
+				&& fileHandle.getPageFreeSpace(target.pageNum) + movedLength
+						>= movedSize) {
+			replaceRecord(fileHandle, page, target.slotNum, recordBuffer,
+					movedSize);
+			addToZoneMap(fileHandle, recordDescriptor, data, target.pageNum);
+			bpm->unpinPage(fileHandle, target.pageNum, true);
+			bpm->unpinPage(fileHandle, rid.pageNum, false);
+			addPageFreeSpace(fileHandle, target.pageNum,
+					movedLength - movedSize);
+			return 0;
+		}
+		bpm->unpinPage(fileHandle, target.pageNum, false);
+	}
+
+	//move it to a page with enough space (neither its home page nor the page it
+	//was moved to have it) and point the stub in its home slot to it
+	RID newTarget;
+	if (storeRecord(fileHandle, recordBuffer, movedSize, newTarget) != 0) {
+		bpm->unpinPage(fileHandle, rid.pageNum, false);
+		return -1;
+	}
+	addToZoneMap(fileHandle, recordDescriptor, data, newTarget.pageNum);
+	if (forwarded && removeRecord(fileHandle, target) != 0) {
+		//the stub still points to the old copy, so the new one goes away
+		removeRecord(fileHandle, newTarget);
+		bpm->unpinPage(fileHandle, rid.pageNum, false);
+		return -1;
+	}
+
+	char stub[FORWARDING_SIZE];
+	writeForwarding(stub, FORWARDING_STUB, newTarget);
+	replaceRecord(fileHandle, homePage, rid.slotNum, stub, FORWARDING_SIZE);
+	bpm->unpinPage(fileHandle, rid.pageNum, true);
+	addPageFreeSpace(fileHandle, rid.pageNum, homeLength - FORWARDING_SIZE);
+	return 0;
+}
+
+/*
+ * Remove what is stored in the slot of the rid (a record, a moved record or a
+ * forwarding stub) and free the slot. The caller holds the record lock.
+ */
+RC RecordBasedFileManager::removeRecord(FileHandle &fileHandle,
+		const RID &rid) {
+
+	char *page;
+	if (bpm->fetchPage(fileHandle, rid.pageNum, page) != 0)
+		return -1;
+
+	short recordLength;
+	if (recordAddress(page, rid.slotNum, recordLength) == NULL) {
+		bpm->unpinPage(fileHandle, rid.pageNum, false);
+		return -1;
+	}
+
+	freeSlot(page, rid.slotNum);
+	bpm->unpinPage(fileHandle, rid.pageNum, true);
+	return addPageFreeSpace(fileHandle, rid.pageNum, recordLength);
+}
+
+RC RecordBasedFileManager::addPageFreeSpace(FileHandle &fileHandle,
+		PageNum pageNum, int freeSpace) {
+	return fileHandle.setPageFreeSpace(pageNum,
+			fileHandle.getPageFreeSpace(pageNum) + freeSpace);
+}
+
+/*
+ * Offline reorganization of the file, after many deletions and updates: the live
+ * records are packed, in file order, into as few pages as possible, and the file is
+ * truncated to them. Forwarding stubs disappear, since moved records are stored again
+ * as regular records. Every record whose rid changes is reported in ridMap, as a pair
+ * (old rid, new rid), so that the caller can fix the references to it.
+ * The pages are rewritten in place: the packed records of the first n pages never
+ * need more than n pages, so a page is only overwritten after it has been read.
+ * No other handle may be using the file meanwhile. The zone map follows the
+ * records to their new pages.
+ */
+RC RecordBasedFileManager::reorganizeFile(FileHandle &fileHandle,
+		vector<pair<RID, RID> > &ridMap) {
+
+	unique_lock<shared_mutex> fileLock(fileHandle.getRecordLock());
+
+	ridMap.clear();
+	RC rc;
+	if (fixedLayout(fileHandle))
+		rc = reorganizeFixedFile(fileHandle, ridMap);
+	else if (paxLayout(fileHandle))
+		rc = reorganizePaxFile(fileHandle, ridMap);
+	else
+		rc = reorganizeSlottedFile(fileHandle, ridMap);
+
+	ZoneMap *fileZoneMap = zoneMap(fileHandle);
+	if (fileZoneMap == NULL)
+		ZoneMap::discard(fileHandle.getFileName());
+	else if (rc == 0)
+		fileZoneMap->remap(ridMap, fileHandle.getNumberOfPages());
+	else
+		fileZoneMap->invalidate();
+	return rc;
+}
+
+/*
+ * reorganizeFile for a file with the slotted layout. The caller holds the
+ * exclusive lock of the file.
+ */
+RC RecordBasedFileManager::reorganizeSlottedFile(FileHandle &fileHandle,
+		vector<pair<RID, RID> > &ridMap) {
+
+	//the pages are read and written directly, so the pool must not keep any
+	if (bpm->flushFile(fileHandle) != 0)
+		return -1;
+	bpm->discardFile(fileHandle.getFileName());
+
+	unsigned numPages = fileHandle.getNumberOfPages();
+	char pageBuffer[PAGE_SIZE];
+	char packedPage[PAGE_SIZE];
+	initializePage(packedPage);
+	short packedFreeSpace = PAGE_SIZE - 6;
+	PageNum packedPageNum = 0;
+
+	for (PageNum pageNum = 0; pageNum < numPages; ++pageNum) {
+		if (fileHandle.readPage(pageNum, pageBuffer) != 0)
+			return -1;
+
+		short slotsNumber;
+		memcpy(&slotsNumber, pageBuffer + PAGE_SIZE - 4, sizeof(short));
+
+		for (int slotNum = 1; slotNum <= slotsNumber; ++slotNum) {
+			short recordLength;
+			short recordOffset;
+			int slotOffset = PAGE_SIZE - 6 - slotNum * 4;
+			memcpy(&recordLength, pageBuffer + slotOffset, sizeof(short));
+			memcpy(&recordOffset, pageBuffer + slotOffset + 2, sizeof(short));
+			if (recordOffset == -1)
+				continue;
+
+			//stubs are skipped, moved records are found in their new page
+			const char *record = pageBuffer + recordOffset;
+			RID rid;
+			rid.pageNum = pageNum;
+			rid.slotNum = slotNum;
+			if (recordMarker(record) == FORWARDING_STUB)
+				continue;
+			if (recordMarker(record) == MOVED_RECORD) {
+				rid = forwardingRid(record);
+				record += FORWARDING_SIZE;
+				recordLength -= FORWARDING_SIZE;
+			}
+
+			//the packed page is full
+			if (packedFreeSpace < recordLength + 4) {
+				if (fileHandle.writePage(packedPageNum, packedPage) != 0)
+					return -1;
+				fileHandle.setPageFreeSpace(packedPageNum, packedFreeSpace,
+						false);
+				packedPageNum++;
+				initializePage(packedPage);
+				packedFreeSpace = PAGE_SIZE - 6;
+			}
+
+			RID newRid;
+			packedFreeSpace -= storeRecordInCurrentPage(fileHandle, packedPage,
+					record, recordLength, newRid);
+			newRid.pageNum = packedPageNum;
+			if (newRid.pageNum != rid.pageNum || newRid.slotNum != rid.slotNum)
+				ridMap.push_back(make_pair(rid, newRid));
+		}
+	}
+
+	//the last packed page, unless there are no records at all
+	short packedSlots;
+	memcpy(&packedSlots, packedPage + PAGE_SIZE - 4, sizeof(short));
+	if (packedSlots > 0) {
+		if (fileHandle.writePage(packedPageNum, packedPage) != 0)
+			return -1;
+		fileHandle.setPageFreeSpace(packedPageNum, packedFreeSpace, false);
+		packedPageNum++;
+	}
+
+	//drop the rest of the pages and write the new header pages
+	if (fileHandle.truncate(packedPageNum) != 0)
+		return -1;
+	return fileHandle.flushMetadata();
+}
+
+/*
+ * Online reorganization of the file, that keeps all the rids: every page with holes
+ * is compacted, the free slots at the end of the slot directories are dropped, and
+ * the free space of every page is recomputed and written to the header pages.
+ */
+RC RecordBasedFileManager::compactFile(FileHandle &fileHandle) {
+
+	unique_lock<shared_mutex> fileLock(fileHandle.getRecordLock());
+
+	unsigned numPages = fileHandle.getNumberOfPages();
+	RC rc = 0;
+
+	for (PageNum pageNum = 0; pageNum < numPages; ++pageNum) {
+		char *page;
+		if (bpm->fetchPage(fileHandle, pageNum, page) != 0)
+			return -1;
+
+		//the slots of a fixed layout page leave no holes to reclaim
+		if (fixedLayout(fileHandle)) {
+			short freeSpace = FixedPage(page).getFreeSpace();
+			bpm->unpinPage(fileHandle, pageNum, false);
+			if (fileHandle.setPageFreeSpace(pageNum, freeSpace, false) != 0)
+				rc = -1;
+			continue;
+		}
+
+		//a PAX page is laid out again without the holes of its heap
+		if (paxLayout(fileHandle)) {
+			PaxPage paxPage(page);
+			bool modified = paxPage.compact();
+			short freeSpace = paxPage.getFreeSpace();
+			bpm->unpinPage(fileHandle, pageNum, modified);
+			if (fileHandle.setPageFreeSpace(pageNum, freeSpace, false) != 0)
+				rc = -1;
+			continue;
+		}
+
+		bool modified = trimSlotDirectory(page);
+		if (reclaimableSpace(page) > 0) {
+			compactPage(fileHandle, page);
+			modified = true;
+		}
+
+		short freeSpaceOffset;
+		short slotsNumber;
+		memcpy(&freeSpaceOffset, page + PAGE_SIZE - 2, sizeof(short));
+		memcpy(&slotsNumber, page + PAGE_SIZE - 4, sizeof(short));
+		short freeSpace = PAGE_SIZE - 6 - slotsNumber * 4 - freeSpaceOffset;
+
+		bpm->unpinPage(fileHandle, pageNum, modified);
+		if (fileHandle.setPageFreeSpace(pageNum, freeSpace, false) != 0)
+			rc = -1;
+	}
+
+	if (fileHandle.flushMetadata() != 0)
+		rc = -1;
+	return rc;
+}
+
+/*
+ * Build the zone map of the file again from a scan of all its records, which
+ * gives the tightest bounds: a record is added both to the page of its rid and
+ * to the page the scan finds it in.
+ */
+RC RecordBasedFileManager::rebuildZoneMap(FileHandle &fileHandle,
+		const vector<Attribute> &recordDescriptor) {
+
+	ZoneMap *fileZoneMap = zoneMap(fileHandle);
+	if (fileZoneMap == NULL) {
+		cout << "ERROR: the file " << fileHandle.getFileName()
+				<< " was not opened by the record manager" << endl;
+		return -1;
+	}
+
+	vector<string> attributeNames;
+	for (unsigned i = 0; i < recordDescriptor.size(); ++i)
+		attributeNames.push_back(recordDescriptor[i].name);
+	RBFM_ScanIterator rbfmScanIterator;
+	if (scan(fileHandle, recordDescriptor, "", NO_OP, NULL, attributeNames,
+			rbfmScanIterator) != 0)
+		return -1;
+
+	fileZoneMap->reset(recordDescriptor, fileHandle.getNumberOfPages());
+	RID rid;
+	char data[PAGE_SIZE];
+	RC rc;
+	while ((rc = rbfmScanIterator.getNextRecord(rid, data)) == 0) {
+		fileZoneMap->add(rid.pageNum, recordDescriptor, data);
+		fileZoneMap->add(rbfmScanIterator.currentPage, recordDescriptor, data);
+	}
+	rbfmScanIterator.close();
+
+	if (rc != RBFM_EOF) {
+		fileZoneMap->invalidate();
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * Drop the free slots at the end of the slot directory of the page, and rebuild the
+ * list of the remaining free slots in increasing order. Returns whether the page
+ * changed.
+ */
+bool RecordBasedFileManager::trimSlotDirectory(char *pageBuffer) {
+	short slotsNumber;
+	memcpy(&slotsNumber, pageBuffer + PAGE_SIZE - 4, sizeof(short));
+
+	short recordOffset;
+	short lastSlot = slotsNumber;
+	while (lastSlot > 0) {
+		memcpy(&recordOffset, pageBuffer + PAGE_SIZE - 6 - lastSlot * 4 + 2,
+				sizeof(short));
+		if (recordOffset != -1)
+			break;
+		lastSlot--;
+	}
+	if (lastSlot == slotsNumber)
+		return false;
+
+	memcpy(pageBuffer + PAGE_SIZE - 4, &lastSlot, sizeof(short));
+
+	short firstFreeSlotIndex = -1;
+	for (int slotNum = lastSlot; slotNum >= 1; --slotNum) {
+		int slotOffset = PAGE_SIZE - 6 - slotNum * 4;
+		memcpy(&recordOffset, pageBuffer + slotOffset + 2, sizeof(short));
+		if (recordOffset == -1) {
+			memcpy(pageBuffer + slotOffset, &firstFreeSlotIndex, sizeof(short));
+			firstFreeSlotIndex = slotNum;
+		}
+	}
+	memcpy(pageBuffer + PAGE_SIZE - 6, &firstFreeSlotIndex, sizeof(short));
+	return true;
+}
+
+/*
+ * Whether the file was created with the fixed layout, whose pages are FixedPages
+ * rather than slotted pages.
+ */
+bool RecordBasedFileManager::fixedLayout(FileHandle &fileHandle) {
+	return fileHandle.getFileType() == FixedLayout;
+}
+
+RC RecordBasedFileManager::checkFixedSchema(const RecordCodec &codec) {
+	if (!codec.isFixedWidth() || FixedPage::capacity(codec.getNumberOfFields())
+			== 0) {
+		cout << "ERROR: the fixed layout only takes ints and reals" << endl;
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * Insert the record into a file with the fixed layout: in the page of the last
+ * insertion if it has a free slot, otherwise in the first page with one, or in
+ * a new page. The caller holds the exclusive lock of the file.
+ */
+RC RecordBasedFileManager::insertFixedRecord(FileHandle &fileHandle,
+		const RecordCodec &codec, const void *data, RID &rid) {
+
+	int attrNum = codec.getNumberOfFields();
+	short recordSize = attrNum * sizeof(int);
+	int pageNum = fileHandle.findInsertPage(recordSize);
+
+	int slot;
+	short freeSpace;
+	if (pageNum == -1) { //a new page
+		char pageBuffer[PAGE_SIZE];
+		FixedPage fixedPage(pageBuffer, attrNum);
+		fixedPage.initialize();
+		slot = fixedPage.insert(data);
+		freeSpace = fixedPage.getFreeSpace();
+		PageNum appendedPageNum;
+		if (bpm->appendPage(fileHandle, pageBuffer, appendedPageNum) != 0)
+			return -1;
+		pageNum = appendedPageNum;
+
+	} else {
+		char *page;
+		if (bpm->fetchPage(fileHandle, pageNum, page) != 0)
+			return -1;
+		FixedPage fixedPage(page);
+		if (fixedPage.getNumberOfFields() != attrNum) {
+			cout << "ERROR: page " << pageNum << " has records of "
+					<< fixedPage.getNumberOfFields() << " fields, not "
+					<< attrNum << endl;
+			bpm->unpinPage(fileHandle, pageNum, false);
+			return -1;
+		}
+		slot = fixedPage.insert(data);
+		freeSpace = fixedPage.getFreeSpace();
+		bpm->unpinPage(fileHandle, pageNum, true);
+	}
+
+	rid.pageNum = pageNum;
+	rid.slotNum = slot + 1;
+	fileHandle.setFillTarget(recordSize, pageNum);
+	return fileHandle.setPageFreeSpace(pageNum, freeSpace);
+}
+
+/*
+ * Pin the page of the record identified by the rid, in a file with the fixed
+ * layout. NULL if the rid doesn't identify a record.
+ */
+char* RecordBasedFileManager::fetchFixedPage(FileHandle &fileHandle,
+		const RID &rid) {
+
+	if (fileHandle.getNumberOfPages() <= rid.pageNum) {
+		cout << "rid.pageNum = " << rid.pageNum
+				<< " points to a nonexistent page" << endl;
+		return NULL;
+	}
+
+	char *page;
+	if (bpm->fetchPage(fileHandle, rid.pageNum, page) != 0)
+		return NULL;
+
+	if (!FixedPage(page).isUsed(rid.slotNum - 1)) {
+		cout << "rid.slotNum = " << rid.slotNum
+				<< " points to a deleted or nonexistent record" << endl;
+		bpm->unpinPage(fileHandle, rid.pageNum, false);
+		return NULL;
+	}
+	return page;
+}
+
+RC RecordBasedFileManager::deleteFixedRecord(FileHandle &fileHandle,
+		const RID &rid) {
+
+	unique_lock<shared_mutex> fileLock(fileHandle.getRecordLock());
+
+	char *page = fetchFixedPage(fileHandle, rid);
+	if (page == NULL)
+		return -1;
+
+	FixedPage fixedPage(page);
+	fixedPage.erase(rid.slotNum - 1);
+	short freeSpace = fixedPage.getFreeSpace();
+	bpm->unpinPage(fileHandle, rid.pageNum, true);
+	return fileHandle.setPageFreeSpace(rid.pageNum, freeSpace);
+}
+
+/*
+ * The records of a schema all have the same size, so they are always updated
+ * in place.
+ */
+RC RecordBasedFileManager::updateFixedRecord(FileHandle &fileHandle,
+		const RecordCodec &codec, const void *data, const RID &rid) {
+
+	unique_lock<shared_mutex> fileLock(fileHandle.getRecordLock());
+
+	char *page = fetchFixedPage(fileHandle, rid);
+	if (page == NULL)
+		return -1;
+
+	FixedPage fixedPage(page);
+	if (fixedPage.getNumberOfFields() != codec.getNumberOfFields()) {
+		cout << "ERROR: the record has " << fixedPage.getNumberOfFields()
+				<< " fields, not " << codec.getNumberOfFields() << endl;
+		bpm->unpinPage(fileHandle, rid.pageNum, false);
+		return -1;
+	}
+	fixedPage.write(rid.slotNum - 1, data);
+	bpm->unpinPage(fileHandle, rid.pageNum, true);
+	return 0;
+}
+
+/*
+ * reorganizeFile for a file with the fixed layout: the records are packed into
+ * full pages, in file order. The caller holds the exclusive lock of the file.
+ */
+RC RecordBasedFileManager::reorganizeFixedFile(FileHandle &fileHandle,
+		vector<pair<RID, RID> > &ridMap) {
+
+	if (bpm->flushFile(fileHandle) != 0)
+		return -1;
+	bpm->discardFile(fileHandle.getFileName());
+
+	unsigned numPages = fileHandle.getNumberOfPages();
+	char pageBuffer[PAGE_SIZE];
+	char packedPage[PAGE_SIZE];
+	char record[PAGE_SIZE];
+	PageNum packedPageNum = 0;
+	int attrNum = -1;
+
+	for (PageNum pageNum = 0; pageNum < numPages; ++pageNum) {
+		if (fileHandle.readPage(pageNum, pageBuffer) != 0)
+			return -1;
+
+		FixedPage fixedPage(pageBuffer);
+		if (attrNum == -1) {
+			attrNum = fixedPage.getNumberOfFields();
+			FixedPage(packedPage, attrNum).initialize();
+		} else if (fixedPage.getNumberOfFields() != attrNum) {
+			cout << "ERROR: page " << pageNum << " has records of "
+					<< fixedPage.getNumberOfFields() << " fields, not "
+					<< attrNum << endl;
+			return -1;
+		}
+
+		for (int slot = 0; slot < fixedPage.getSlotsNumber(); ++slot) {
+			if (!fixedPage.isUsed(slot))
+				continue;
+
+			FixedPage packed(packedPage);
+			if (packed.getUsedCount() == FixedPage::capacity(attrNum)) {
+				if (fileHandle.writePage(packedPageNum, packedPage) != 0)
+					return -1;
+				fileHandle.setPageFreeSpace(packedPageNum, 0, false);
+				packedPageNum++;
+				packed.initialize();
+			}
+
+			fixedPage.read(slot, record);
+			RID rid;
+			rid.pageNum = pageNum;
+			rid.slotNum = slot + 1;
+			RID newRid;
+			newRid.pageNum = packedPageNum;
+			newRid.slotNum = packed.insert(record) + 1;
+			if (newRid.pageNum != rid.pageNum || newRid.slotNum != rid.slotNum)
+				ridMap.push_back(make_pair(rid, newRid));
+		}
+	}
+
+	//the last packed page, unless there are no records at all
+	if (attrNum != -1 && FixedPage(packedPage).getUsedCount() > 0) {
+		if (fileHandle.writePage(packedPageNum, packedPage) != 0)
+			return -1;
+		fileHandle.setPageFreeSpace(packedPageNum,
+				FixedPage(packedPage).getFreeSpace(), false);
+		packedPageNum++;
+	}
+
+	if (fileHandle.truncate(packedPageNum) != 0)
+		return -1;
+	return fileHandle.flushMetadata();
+}
+
+/*
+ * Whether the file was created with the PAX layout, whose pages are PaxPages.
+ */
+bool RecordBasedFileManager::paxLayout(FileHandle &fileHandle) {
+	return fileHandle.getFileType() == PaxLayout;
+}
+
+/*
+ * Insert the record into a file with the PAX layout: in the page of the last
+ * insertion if it has room for it, otherwise in the first page with room, or in
+ * a new page laid out for records like this one. A moved record is marked as
+ * such, to be reached only through its forwarding stub. The caller holds the
+ * exclusive lock of the file.
+ */
+RC RecordBasedFileManager::insertPaxRecord(FileHandle &fileHandle,
+		const RecordCodec &codec, const void *data, RID &rid, bool moved) {
+
+	int attrNum = codec.getNumberOfFields();
+	const vector<short> &varCharFields = codec.getVarCharFields();
+	int chunkSize = PaxPage::chunkSize(data, attrNum, varCharFields);
+	if (!PaxPage::fitsEmptyPage(attrNum, chunkSize)) {
+		cout << "ERROR: the record doesn't fit in a page" << endl;
+		return -1;
+	}
+
+	short recordSpace = PaxPage::recordSpace(attrNum, chunkSize);
+	int pageNum = fileHandle.findInsertPage(recordSpace);
+
+	int slot = -1;
+	short freeSpace;
+	if (pageNum != -1) {
+		char *page;
+		if (bpm->fetchPage(fileHandle, pageNum, page) != 0)
+			return -1;
+		PaxPage paxPage(page);
+		if (!paxPage.hasSchema(attrNum, varCharFields)) {
+			cout << "ERROR: page " << pageNum
+					<< " has records of another schema" << endl;
+			bpm->unpinPage(fileHandle, pageNum, false);
+			return -1;
+		}
+		slot = paxPage.insert(data);
+		if (slot != -1 && moved)
+			paxPage.setMoved(slot);
+		freeSpace = paxPage.getFreeSpace();
+		bpm->unpinPage(fileHandle, pageNum, slot != -1);
+	}
+
+	if (slot == -1) { //a new page
+		char pageBuffer[PAGE_SIZE];
+		PaxPage paxPage(pageBuffer, attrNum, varCharFields, chunkSize);
+		slot = paxPage.insert(data);
+		if (moved)
+			paxPage.setMoved(slot);
+		freeSpace = paxPage.getFreeSpace();
+		PageNum appendedPageNum;
+		if (bpm->appendPage(fileHandle, pageBuffer, appendedPageNum) != 0)
+			return -1;
+		pageNum = appendedPageNum;
+	}
+
+	rid.pageNum = pageNum;
+	rid.slotNum = slot + 1;
+	fileHandle.setFillTarget(recordSpace, pageNum);
+	return fileHandle.setPageFreeSpace(pageNum, freeSpace);
+}
+
+/*
+ * Pin the page of the rid, in a file with the PAX layout. NULL if the rid
+ * doesn't identify a record (or the stub of a moved one).
+ */
+char* RecordBasedFileManager::fetchPaxPage(FileHandle &fileHandle,
+		const RID &rid) {
+
+	if (fileHandle.getNumberOfPages() <= rid.pageNum) {
+		cout << "rid.pageNum = " << rid.pageNum
+				<< " points to a nonexistent page" << endl;
+		return NULL;
+	}
+
+	char *page;
+	if (bpm->fetchPage(fileHandle, rid.pageNum, page) != 0)
+		return NULL;
+
+	PaxPage paxPage(page);
+	if (!paxPage.isUsed(rid.slotNum - 1) || paxPage.isMoved(rid.slotNum - 1)) {
+		cout << "rid.slotNum = " << rid.slotNum
+				<< " points to a deleted or nonexistent record" << endl;
+		bpm->unpinPage(fileHandle, rid.pageNum, false);
+		return NULL;
+	}
+	return page;
+}
+
+/*
+ * Pin the page the record of the rid is in, following its forwarding stub if it
+ * was moved, and return its page number and slot.
+ */
+char* RecordBasedFileManager::fetchPaxRecord(FileHandle &fileHandle,
+		const RID &rid, PageNum &pageNum, int &slot) {
+
+	char *page = fetchPaxPage(fileHandle, rid);
+	if (page == NULL)
+		return NULL;
+
+	pageNum = rid.pageNum;
+	slot = rid.slotNum - 1;
+	PaxPage paxPage(page);
+	if (!paxPage.isForwarded(slot))
+		return page;
+
+	unsigned slotNum;
+	paxPage.getForwarding(slot, pageNum, slotNum);
+	bpm->unpinPage(fileHandle, rid.pageNum, false);
+	slot = slotNum - 1;
+	if (bpm->fetchPage(fileHandle, pageNum, page) != 0)
+		return NULL;
+	if (!PaxPage(page).isMoved(slot)) {
+		cout << "ERROR: the record of rid (" << rid.pageNum << ", "
+				<< rid.slotNum << ") is not where its stub points" << endl;
+		bpm->unpinPage(fileHandle, pageNum, false);
+		return NULL;
+	}
+	return page;
+}
+
+/*
+ * Free the slot of a PAX page, be it a record, a moved record or a stub. The
+ * caller holds the record lock.
+ */
+RC RecordBasedFileManager::erasePaxRecord(FileHandle &fileHandle,
+		PageNum pageNum, int slot) {
+
+	char *page;
+	if (bpm->fetchPage(fileHandle, pageNum, page) != 0)
+		return -1;
+	PaxPage paxPage(page);
+	paxPage.erase(slot);
+	short freeSpace = paxPage.getFreeSpace();
+	bpm->unpinPage(fileHandle, pageNum, true);
+	return fileHandle.setPageFreeSpace(pageNum, freeSpace);
+}
+
+RC RecordBasedFileManager::deletePaxRecord(FileHandle &fileHandle,
+		const RID &rid) {
+
+	unique_lock<shared_mutex> fileLock(fileHandle.getRecordLock());
+
+	char *page = fetchPaxPage(fileHandle, rid);
+	if (page == NULL)
+		return -1;
+
+	PaxPage paxPage(page);
+	int slot = rid.slotNum - 1;
+	bool forwarded = paxPage.isForwarded(slot);
+	unsigned targetPageNum, targetSlotNum;
+	if (forwarded)
+		paxPage.getForwarding(slot, targetPageNum, targetSlotNum);
+	bpm->unpinPage(fileHandle, rid.pageNum, false);
+
+	if (forwarded
+			&& erasePaxRecord(fileHandle, targetPageNum, targetSlotNum - 1) != 0)
+		return -1;
+	return erasePaxRecord(fileHandle, rid.pageNum, slot);
+}
+
+/*
+ * updateRecord for a file with the PAX layout, along the lines of the slotted
+ * one: the record is rewritten in its home page if it still fits there (the page
+ * is laid out again if needed), otherwise in the page it was moved to if it fits
+ * there, and otherwise it is moved to another page and its home slot becomes a
+ * forwarding stub. A record is never forwarded more than once.
+ */
+RC RecordBasedFileManager::updatePaxRecord(FileHandle &fileHandle,
+		const vector<Attribute> &recordDescriptor, const RecordCodec &codec,
+		const void *data, const RID &rid) {
+
+	unique_lock<shared_mutex> fileLock(fileHandle.getRecordLock());
+
+	char *homePage = fetchPaxPage(fileHandle, rid);
+	if (homePage == NULL)
+		return -1;
+
+	PaxPage home(homePage);
+	int slot = rid.slotNum - 1;
+	if (!home.hasSchema(codec.getNumberOfFields(), codec.getVarCharFields())) {
+		cout << "ERROR: the record has another schema" << endl;
+		bpm->unpinPage(fileHandle, rid.pageNum, false);
+		return -1;
+	}
+	bool forwarded = home.isForwarded(slot);
+	RID target;
+	if (forwarded)
+		home.getForwarding(slot, target.pageNum, target.slotNum);
+
+	//the record fits in its home page: if it was moved, the moved copy is removed
+	if (home.write(slot, data)) {
+		short freeSpace = home.getFreeSpace();
+		bpm->unpinPage(fileHandle, rid.pageNum, true);
+		if (fileHandle.setPageFreeSpace(rid.pageNum, freeSpace) != 0)
+			return -1;
+		if (forwarded)
+			return erasePaxRecord(fileHandle, target.pageNum,
+					target.slotNum - 1);
+		return 0;
+	}
+
+	//it was already moved and it still fits in the page it was moved to
+	if (forwarded) {
+		char *page;
+		if (bpm->fetchPage(fileHandle, target.pageNum, page) != 0) {
+			bpm->unpinPage(fileHandle, rid.pageNum, false);
+			return -1;
+		}
+		PaxPage paxPage(page);
+		if (paxPage.write(target.slotNum - 1, data)) {
+			paxPage.setMoved(target.slotNum - 1);
+			addToZoneMap(fileHandle, recordDescriptor, data, target.pageNum);
+			short freeSpace = paxPage.getFreeSpace();
+			bpm->unpinPage(fileHandle, target.pageNum, true);
+			bpm->unpinPage(fileHandle, rid.pageNum, false);
+			return fileHandle.setPageFreeSpace(target.pageNum, freeSpace);
+		}
+		bpm->unpinPage(fileHandle, target.pageNum, false);
+	}
+
+	//move it to a page with room for it and point the stub in its home slot to it
+	RID newTarget;
+	if (insertPaxRecord(fileHandle, codec, data, newTarget, true) != 0) {
+		bpm->unpinPage(fileHandle, rid.pageNum, false);
+		return -1;
+	}
+	addToZoneMap(fileHandle, recordDescriptor, data, newTarget.pageNum);
+	if (forwarded
+			&& erasePaxRecord(fileHandle, target.pageNum, target.slotNum - 1)
+					!= 0) {
+		//the stub still points to the old copy, so the new one goes away
+		erasePaxRecord(fileHandle, newTarget.pageNum, newTarget.slotNum - 1);
+		bpm->unpinPage(fileHandle, rid.pageNum, false);
+		return -1;
+	}
+
+	PaxPage stubPage(homePage);
+	stubPage.forward(slot, newTarget.pageNum, newTarget.slotNum);
+	short freeSpace = stubPage.getFreeSpace();
+	bpm->unpinPage(fileHandle, rid.pageNum, true);
+	return fileHandle.setPageFreeSpace(rid.pageNum, freeSpace);
+}
+
+/*
+ * reorganizeFile for a file with the PAX layout: the records are packed into as
+ * few pages as possible, in file order. Moved records are packed where they were
+ * moved to, so the stubs are read first to know the rid of each moved record.
+ * The caller holds the exclusive lock of the file.
+ */
+RC RecordBasedFileManager::reorganizePaxFile(FileHandle &fileHandle,
+		vector<pair<RID, RID> > &ridMap) {
+
+	if (bpm->flushFile(fileHandle) != 0)
+		return -1;
+	bpm->discardFile(fileHandle.getFileName());
+
+	unsigned numPages = fileHandle.getNumberOfPages();
+	char pageBuffer[PAGE_SIZE];
+	char packedPage[PAGE_SIZE];
+	char record[PAGE_SIZE];
+
+	//(page, slot) of each moved record -> rid of its stub
+	map<pair<unsigned, unsigned>, RID> homes;
+	for (PageNum pageNum = 0; pageNum < numPages; ++pageNum) {
+		if (fileHandle.readPage(pageNum, pageBuffer) != 0)
+			return -1;
+		PaxPage paxPage(pageBuffer);
+		for (int slot = 0; slot < paxPage.getSlotsNumber(); ++slot) {
+			if (!paxPage.isForwarded(slot))
+				continue;
+			RID home;
+			home.pageNum = pageNum;
+			home.slotNum = slot + 1;
+			unsigned targetPageNum, targetSlotNum;
+			paxPage.getForwarding(slot, targetPageNum, targetSlotNum);
+			homes[make_pair(targetPageNum, targetSlotNum)] = home;
+		}
+	}
+
+	PageNum packedPageNum = 0;
+	bool packing = false; //whether packedPage has been laid out
+	for (PageNum pageNum = 0; pageNum < numPages; ++pageNum) {
+		if (fileHandle.readPage(pageNum, pageBuffer) != 0)
+			return -1;
+
+		PaxPage paxPage(pageBuffer);
+		vector<short> varCharFields = paxPage.getVarCharFields();
+		int attrNum = paxPage.getNumberOfFields();
+
+		for (int slot = 0; slot < paxPage.getSlotsNumber(); ++slot) {
+			if (!paxPage.isUsed(slot) || paxPage.isForwarded(slot))
+				continue;
+
+			RID rid;
+			rid.pageNum = pageNum;
+			rid.slotNum = slot + 1;
+			if (paxPage.isMoved(slot))
+				rid = homes[make_pair(pageNum, slot + 1)];
+
+			paxPage.read(slot, record);
+			int newSlot = -1;
+			if (packing) {
+				newSlot = PaxPage(packedPage).insert(record);
+				if (newSlot == -1) { //the packed page is full
+					if (fileHandle.writePage(packedPageNum, packedPage) != 0)
+						return -1;
+					fileHandle.setPageFreeSpace(packedPageNum,
+							PaxPage(packedPage).getFreeSpace(), false);
+					packedPageNum++;
+				}
+			}
+			if (newSlot == -1) {
+				PaxPage packed(packedPage, attrNum, varCharFields,
+						PaxPage::chunkSize(record, attrNum, varCharFields));
+				newSlot = packed.insert(record);
+				packing = true;
+			}
+
+			RID newRid;
+			newRid.pageNum = packedPageNum;
+			newRid.slotNum = newSlot + 1;
+			if (newRid.pageNum != rid.pageNum || newRid.slotNum != rid.slotNum)
+				ridMap.push_back(make_pair(rid, newRid));
+		}
+	}
+
+	//the last packed page, unless there are no records at all
+	if (packing) {
+		if (fileHandle.writePage(packedPageNum, packedPage) != 0)
+			return -1;
+		fileHandle.setPageFreeSpace(packedPageNum,
+				PaxPage(packedPage).getFreeSpace(), false);
+		packedPageNum++;
+	}
+
+	if (fileHandle.truncate(packedPageNum) != 0)
+		return -1;
+	return fileHandle.flushMetadata();
+}
+
+/*
+ * This is a utility method that will be mainly used for debugging/testing. It should be
+ * able to interpret the bytes of each record using the passed-in record descriptor and
+ * then print its content to the screen. For instance, suppose a record consists of two
+ * fields: age (int) and height (float), which means the record will be of size 9 (1 byte
+ * for the null-fields-indicator, 4 bytes for int, and 4 bytes for float). The printRecord
+ * method should recognize the record format using the record descriptor. It should then
+ * check the null-fields-indicator to skip certain fields if there are any NULL fields.
+ * Then, it should be able to convert the four bytes after the first byte into an int
  * object and the last four bytes to a float object and print their values. It should also
  * print NULL for those fields that are skipped because they are null. Thus, an example for
  * three records would be:
@@ -668,67 +2104,1351 @@ RC RecordBasedFileManager::readRecord(FileHandle &fileHandle,
  *  age: NULL    height: 7.5
  *	age: 32      height: NULL
  */
-RC RecordBasedFileManager::printRecord(
-		const vector<Attribute> &recordDescriptor, const void *data) {
+RC RecordBasedFileManager::printRecord(
+		const vector<Attribute> &recordDescriptor, const void *data) {
+
+	stringstream ss;
+	int attrNum = recordDescriptor.size();
+	int nullsize = recordCodec(recordDescriptor).getNullsSize();
+	vector<short> indexes(attrNum + KERNEL_SLACK);
+	int nonNull = nonNullFields((const unsigned char*) data, attrNum,
+			indexes.data());
+
+	const char *field = (const char*) data + nullsize;
+	int next = 0; //next non-null field in indexes
+
+	for (int index = 0; index < attrNum; ++index) {
+		const Attribute &attr = recordDescriptor[index];
+		ss << attr.name << ": ";
+
+		if (next == nonNull || indexes[next] != index) {
+			ss << "NULL\t";
+			continue;
+		}
+		next++;
+
+		//TypeInt = 0, TypeReal, TypeVarChar
+		if (attr.type == TypeInt) {
+			int value;
+			memcpy(&value, field, sizeof(int));
+			ss << value;
+			field += sizeof(int);
+		} else if (attr.type == TypeReal) {
+			float value;
+			memcpy(&value, field, sizeof(float));
+			ss << value;
+			field += sizeof(float);
+		} else if (attr.type == TypeVarChar) {
+			int stringLength;
+			memcpy(&stringLength, field, sizeof(int));
+			ss << string(field + sizeof(int), stringLength);
+			field += sizeof(int) + stringLength;
+		} else {
+			cout << "ERROR: type doesn't match any of the valid types defined "
+					<< endl;
+		}
+		ss << "\t";
+	}
+
+	cout << ss.str() << endl;
+
+	return 0;
+}
+
+/*
+ * Read a single attribute of the record identified by the rid. data receives a
+ * null indicator byte followed by the value (if it is not null), in the same
+ * format as readRecord. The field is located through the null bits and the
+ * offsets stored in the record, without decoding the rest of it.
+ */
+RC RecordBasedFileManager::readAttribute(FileHandle &fileHandle,
+		const vector<Attribute> &recordDescriptor, const RID &rid,
+		const string &attributeName, void *data) {
+
+	int index = attributeIndex(recordDescriptor, attributeName);
+	if (index == -1) {
+		cout << "ERROR: unknown attribute " << attributeName << endl;
+		return -1;
+	}
+
+	shared_lock<shared_mutex> fileLock(fileHandle.getRecordLock());
+
+	if (fixedLayout(fileHandle)) {
+		char *page = fetchFixedPage(fileHandle, rid);
+		if (page == NULL)
+			return -1;
+		FixedPage fixedPage(page);
+		int slot = rid.slotNum - 1;
+		if (index >= fixedPage.getNumberOfFields()
+				|| fixedPage.isNull(slot, index)) {
+			*(unsigned char*) data = 1 << 7;
+		} else {
+			*(unsigned char*) data = 0;
+			memcpy((char*) data + 1, fixedPage.field(slot, index), sizeof(int));
+		}
+		bpm->unpinPage(fileHandle, rid.pageNum, false);
+		return 0;
+	}
+
+	PageNum pageNum;
+	if (paxLayout(fileHandle)) {
+		int slot;
+		char *page = fetchPaxRecord(fileHandle, rid, pageNum, slot);
+		if (page == NULL)
+			return -1;
+		PaxPage paxPage(page);
+		if (index >= paxPage.getNumberOfFields()
+				|| paxPage.isNull(slot, index)) {
+			*(unsigned char*) data = 1 << 7;
+		} else if (paxPage.isVarChar(index)) {
+			int stringLength;
+			const char *chars = paxPage.varChar(slot, index, stringLength);
+			*(unsigned char*) data = 0;
+			memcpy((char*) data + 1, &stringLength, sizeof(int));
+			memcpy((char*) data + 1 + sizeof(int), chars, stringLength);
+		} else {
+			*(unsigned char*) data = 0;
+			memcpy((char*) data + 1, paxPage.field(slot, index), sizeof(int));
+		}
+		bpm->unpinPage(fileHandle, pageNum, false);
+		return 0;
+	}
+
+	short recordLength;
+	const char *record = fetchRecord(fileHandle, rid, pageNum, recordLength);
+	if (record == NULL)
+		return -1;
+
+	//fields added to the descriptor after the record was stored are null
+	short attrNum;
+	memcpy(&attrNum, record, sizeof(short));
+	if (index >= attrNum || fieldIsNull(record, index)) {
+		*(unsigned char*) data = 1 << 7;
+	} else {
+		*(unsigned char*) data = 0;
+		const char *field = record + fieldOffset(record, index);
+		memcpy((char*) data + 1, field,
+				fieldLength(field, recordDescriptor[index].type));
+	}
+
+	bpm->unpinPage(fileHandle, pageNum, false);
+	return 0;
+}
+
+/*
+ * Read several attributes of the record identified by the rid. data receives
+ * them as a record of just these attributes (null bits for attributeNames.size()
+ * fields followed by the non-null values), the same format scan returns.
+ */
+RC RecordBasedFileManager::readAttributes(FileHandle &fileHandle,
+		const vector<Attribute> &recordDescriptor, const RID &rid,
+		const vector<string> &attributeNames, void *data) {
+
+	vector<int> projection(attributeNames.size());
+	for (unsigned i = 0; i < attributeNames.size(); ++i) {
+		projection[i] = attributeIndex(recordDescriptor, attributeNames[i]);
+		if (projection[i] == -1) {
+			cout << "ERROR: unknown attribute " << attributeNames[i] << endl;
+			return -1;
+		}
+	}
+
+	shared_lock<shared_mutex> fileLock(fileHandle.getRecordLock());
+
+	if (fixedLayout(fileHandle)) {
+		char *page = fetchFixedPage(fileHandle, rid);
+		if (page == NULL)
+			return -1;
+		projectFixedRecord(FixedPage(page), rid.slotNum - 1, projection, data);
+		bpm->unpinPage(fileHandle, rid.pageNum, false);
+		return 0;
+	}
+
+	PageNum pageNum;
+	if (paxLayout(fileHandle)) {
+		int slot;
+		char *page = fetchPaxRecord(fileHandle, rid, pageNum, slot);
+		if (page == NULL)
+			return -1;
+		projectPaxRecord(PaxPage(page), slot, projection, data);
+		bpm->unpinPage(fileHandle, pageNum, false);
+		return 0;
+	}
+
+	short recordLength;
+	const char *record = fetchRecord(fileHandle, rid, pageNum, recordLength);
+	if (record == NULL)
+		return -1;
+
+	projectRecord(record, recordDescriptor, projection, data);
+
+	bpm->unpinPage(fileHandle, pageNum, false);
+	return 0;
+}
+
+/*
+ * Index of the attribute in the descriptor, or -1 if there is no such attribute.
+ * The last index found for each name is cached (per thread), and only checked
+ * against the descriptor, so repeated lookups don't compare against every name.
+ */
+int RecordBasedFileManager::attributeIndex(
+		const vector<Attribute> &recordDescriptor, const string &attributeName) {
+
+	thread_local unordered_map<string, int> lastIndex;
+
+	unordered_map<string, int>::iterator it = lastIndex.find(attributeName);
+	if (it != lastIndex.end() && it->second < (int) recordDescriptor.size()
+			&& recordDescriptor[it->second].name == attributeName)
+		return it->second;
+
+	for (unsigned i = 0; i < recordDescriptor.size(); ++i) {
+		if (recordDescriptor[i].name == attributeName) {
+			lastIndex[attributeName] = i;
+			return i;
+		}
+	}
+	return -1;
+}
+
+/*
+ * Given a record descriptor, scan the file and return, through the iterator, the
+ * projection (attributeNames) of the records that satisfy the condition
+ * "conditionAttribute compOp value". The iterator works page at a time: every
+ * page is read once and the condition is evaluated on the stored records. The
+ * pages whose zone map shows that no record satisfies the condition are not read.
+ */
+RC RecordBasedFileManager::scan(FileHandle &fileHandle,
+		const vector<Attribute> &recordDescriptor,
+		const string &conditionAttribute, const CompOp compOp,
+		const void *value, const vector<string> &attributeNames,
+		RBFM_ScanIterator &rbfm_ScanIterator) {
+
+	if (!fileHandle.hasOpenFile()) {
+		cout << "ERROR: scan on a file handle that is not open" << endl;
+		return -1;
+	}
+
+	rbfm_ScanIterator.close();
+
+	//resolve the condition attribute
+	int conditionIndex = -1;
+	if (compOp != NO_OP) {
+		conditionIndex = attributeIndex(recordDescriptor, conditionAttribute);
+		if (conditionIndex == -1 || value == NULL) {
+			cout << "ERROR: invalid condition attribute " << conditionAttribute
+					<< endl;
+			return -1;
+		}
+	}
+
+	//resolve the projected attributes
+	vector<int> projection;
+	for (unsigned i = 0; i < attributeNames.size(); ++i) {
+		int index = attributeIndex(recordDescriptor, attributeNames[i]);
+		if (index == -1) {
+			cout << "ERROR: unknown attribute " << attributeNames[i] << endl;
+			return -1;
+		}
+		projection.push_back(index);
+	}
+
+	rbfm_ScanIterator.fileHandle = &fileHandle;
+	rbfm_ScanIterator.recordDescriptor = recordDescriptor;
+	rbfm_ScanIterator.conditionIndex = conditionIndex;
+	rbfm_ScanIterator.compOp = compOp;
+	rbfm_ScanIterator.projection = projection;
+	rbfm_ScanIterator.zoneMap = zoneMap(fileHandle);
+	rbfm_ScanIterator.skippedPages = 0;
+	rbfm_ScanIterator.value.clear();
+	if (conditionIndex != -1) {
+		int length = fieldLength((const char*) value,
+				recordDescriptor[conditionIndex].type);
+		rbfm_ScanIterator.value.assign((const char*) value,
+				(const char*) value + length);
+	}
+	return 0;
+}
+
+//morsels of a parallel scan left to a worker: it takes them from the front of
+//its range, and the workers done with their own steal them from the back
+struct alignas(64) MorselQueue {
+	mutex queueMutex;
+	unsigned next;
+	unsigned end;
+};
+
+//what the workers of a parallel scan share
+struct ParallelScan {
+	FileHandle *fileHandle;
+	const vector<Attribute> *recordDescriptor;
+	const string *conditionAttribute;
+	CompOp compOp;
+	const void *value;
+	const vector<string> *attributeNames;
+	ScanBatchHandler handler;
+	void *context;
+	vector<pair<PageNum, unsigned> > morsels; // (first page, number of pages)
+	vector<MorselQueue> queues;               // one per worker
+	atomic<bool> failed;
+};
+
+//index of the next morsel the worker has to scan, false if none is left
+static bool takeMorsel(vector<MorselQueue> &queues, int worker,
+		unsigned &morsel) {
+	{
+		MorselQueue &own = queues[worker];
+		lock_guard<mutex> lock(own.queueMutex);
+		if (own.next < own.end) {
+			morsel = own.next++;
+			return true;
+		}
+	}
+	for (unsigned i = 1; i < queues.size(); ++i) {
+		MorselQueue &victim = queues[(worker + i) % queues.size()];
+		lock_guard<mutex> lock(victim.queueMutex);
+		if (victim.next < victim.end) {
+			morsel = --victim.end;
+			return true;
+		}
+	}
+	return false;
+}
+
+//size of a record in the format of getNextRecord with the projected fields
+static int projectedSize(const char *data,
+		const vector<Attribute> &recordDescriptor,
+		const vector<int> &projection) {
+	int size = (projection.size() + 7) / 8;
+	for (unsigned i = 0; i < projection.size(); ++i)
+		if (!(data[i / 8] & (1 << (7 - i % 8))))
+			size += RecordBasedFileManager::fieldLength(data + size,
+					recordDescriptor[projection[i]].type);
+	return size;
+}
+
+/*
+ * Scan the file with numThreads workers. The data pages that the zone map
+ * doesn't exclude are split into morsels of up to MORSEL_PAGES consecutive
+ * pages, never across a header page, so that each morsel is read at once with
+ * a positional read (or used in place in a memory-mapped file) without going
+ * through the buffer pool. Each worker starts with an equal share of the
+ * morsels, and steals them from the others when it is done with it, so that
+ * they all finish at about the same time. The file is locked for reading
+ * during the whole scan, and the dirty pages of the pool written to it first.
+ */
+RC RecordBasedFileManager::parallelScan(FileHandle &fileHandle,
+		const vector<Attribute> &recordDescriptor,
+		const string &conditionAttribute, const CompOp compOp,
+		const void *value, const vector<string> &attributeNames,
+		int numThreads, ScanBatchHandler handler, void *context) {
+
+	//check the arguments once, for all the workers
+	RBFM_ScanIterator rbfmScanIterator;
+	if (scan(fileHandle, recordDescriptor, conditionAttribute, compOp, value,
+			attributeNames, rbfmScanIterator) != 0)
+		return -1;
+
+	shared_lock<shared_mutex> fileLock(fileHandle.getRecordLock());
+	if (bpm->flushFile(fileHandle) != 0)
+		return -1;
+
+	ParallelScan parallelScan;
+	parallelScan.fileHandle = &fileHandle;
+	parallelScan.recordDescriptor = &recordDescriptor;
+	parallelScan.conditionAttribute = &conditionAttribute;
+	parallelScan.compOp = compOp;
+	parallelScan.value = value;
+	parallelScan.attributeNames = &attributeNames;
+	parallelScan.handler = handler;
+	parallelScan.context = context;
+	parallelScan.failed = false;
+
+	ZoneMap *fileZoneMap = rbfmScanIterator.zoneMap;
+	int conditionIndex = rbfmScanIterator.conditionIndex;
+	unsigned numPages = fileHandle.getNumberOfPages();
+	vector<pair<PageNum, unsigned> > &morsels = parallelScan.morsels;
+	for (PageNum pageNum = 0; pageNum < numPages; ++pageNum) {
+		if (fileZoneMap != NULL && conditionIndex != -1
+				&& !fileZoneMap->mayMatch(pageNum, recordDescriptor,
+						conditionIndex, compOp, &rbfmScanIterator.value[0]))
+			continue;
+		if (!morsels.empty()) {
+			pair<PageNum, unsigned> &last = morsels.back();
+			if (last.first + last.second == pageNum
+					&& last.second < MORSEL_PAGES
+					&& last.second < FileHandle::contiguousPages(last.first)) {
+				last.second++;
+				continue;
+			}
+		}
+		morsels.push_back(make_pair(pageNum, 1));
+	}
+	rbfmScanIterator.close();
+
+	if (numThreads <= 0)
+		numThreads = max(1u, thread::hardware_concurrency());
+	numThreads = max(1, min(numThreads, (int) morsels.size()));
+	parallelScan.queues = vector<MorselQueue>(numThreads);
+	for (int i = 0; i < numThreads; ++i) {
+		parallelScan.queues[i].next = morsels.size() * i / numThreads;
+		parallelScan.queues[i].end = morsels.size() * (i + 1) / numThreads;
+	}
+
+	//this thread is the first worker
+	vector<thread> workers;
+	for (int i = 1; i < numThreads; ++i)
+		workers.push_back(thread(scanMorsels, &parallelScan, i));
+	scanMorsels(&parallelScan, 0);
+	for (unsigned i = 0; i < workers.size(); ++i)
+		workers[i].join();
+
+	return parallelScan.failed ? -1 : 0;
+}
+
+/*
+ * Worker of a parallel scan: its own scan iterator goes through the pages of
+ * each morsel it takes, without locking the file (parallelScan did).
+ */
+void RecordBasedFileManager::scanMorsels(ParallelScan *parallelScan,
+		int worker) {
+
+	FileHandle &fileHandle = *parallelScan->fileHandle;
+	RBFM_ScanIterator rbfmScanIterator;
+	if (instance()->scan(fileHandle, *parallelScan->recordDescriptor,
+			*parallelScan->conditionAttribute, parallelScan->compOp,
+			parallelScan->value, *parallelScan->attributeNames,
+			rbfmScanIterator) != 0) {
+		parallelScan->failed = true;
+		return;
+	}
+	rbfmScanIterator.zoneMap = NULL; //already applied to the morsels
+
+	vector<char> buffer;
+	if (!fileHandle.isMemoryMapped())
+		buffer.resize(MORSEL_PAGES * PAGE_SIZE);
+	ScanBatch batch;
+	char record[PAGE_SIZE];
+	unsigned morsel;
+
+	while (!parallelScan->failed
+			&& takeMorsel(parallelScan->queues, worker, morsel)) {
+		PageNum first = parallelScan->morsels[morsel].first;
+		unsigned count = parallelScan->morsels[morsel].second;
+
+		char *pages;
+		if (fileHandle.isMemoryMapped()) {
+			//the mapping grows with the file, so the whole morsel is in it
+			if (fileHandle.getPagePointer(first + count - 1) == NULL) {
+				parallelScan->failed = true;
+				break;
+			}
+			pages = fileHandle.getPagePointer(first);
+		} else {
+			if (fileHandle.readPages(first, count, &buffer[0]) != 0) {
+				parallelScan->failed = true;
+				break;
+			}
+			pages = &buffer[0];
+		}
+
+		rbfmScanIterator.morsel = pages;
+		rbfmScanIterator.morselFirst = first;
+		rbfmScanIterator.morselEnd = first + count;
+		rbfmScanIterator.currentPage = first;
+
+		RID rid;
+		RC rc;
+		while ((rc = rbfmScanIterator.nextRecord(rid, record)) == 0) {
+			batch.offsets.push_back(batch.data.size());
+			batch.rids.push_back(rid);
+			batch.data.insert(batch.data.end(), record,
+					record
+							+ projectedSize(record, *parallelScan->recordDescriptor,
+									rbfmScanIterator.projection));
+			if (batch.rids.size() == SCAN_BATCH_SIZE) {
+				parallelScan->handler(worker, batch, parallelScan->context);
+				batch.rids.clear();
+				batch.data.clear();
+				batch.offsets.clear();
+			}
+		}
+		if (rc != RBFM_EOF)
+			parallelScan->failed = true;
+	}
+
+	if (!batch.rids.empty())
+		parallelScan->handler(worker, batch, parallelScan->context);
+	rbfmScanIterator.close();
+}
+
+/*
+ * Whether the field is null according to the null bits of the stored record.
+ */
+bool RecordBasedFileManager::fieldIsNull(const char *record, int fieldIndex) {
+	return (record[sizeof(short) + fieldIndex / 8] & (1 << (7 - fieldIndex % 8)))
+			!= 0;
+}
+
+/*
+ * Offset of a (non-null) field from the beginning of the stored record. The
+ * record keeps an offset for each non-null field, so we only have to count
+ * the non-null fields before this one.
+ */
+short RecordBasedFileManager::fieldOffset(const char *record, int fieldIndex) {
+	short attrNum;
+	memcpy(&attrNum, record, sizeof(short));
+	int nullsize = (attrNum + 7) / 8;
+	const unsigned char *nullbits = (const unsigned char*) record
+			+ sizeof(short);
+
+	int nonNullBefore = 0;
+	for (int i = 0; i < fieldIndex / 8; ++i)
+		nonNullBefore += 8 - __builtin_popcount(nullbits[i]);
+	int bits = fieldIndex % 8;
+	if (bits > 0)
+		nonNullBefore += bits
+				- __builtin_popcount(nullbits[fieldIndex / 8] >> (8 - bits));
+
+	short offset;
+	memcpy(&offset,
+			record + sizeof(short) + nullsize + nonNullBefore * sizeof(short),
+			sizeof(short));
+	return offset;
+}
+
+/*
+ * Number of bytes a field value takes, both in the stored record and in the
+ * API format: 4 for int and real, 4 + length for varchar.
+ */
+int RecordBasedFileManager::fieldLength(const char *field, AttrType type) {
+	if (type == TypeVarChar) {
+		int stringLength;
+		memcpy(&stringLength, field, sizeof(int));
+		return sizeof(int) + stringLength;
+	}
+	return sizeof(int);
+}
+
+/*
+ * Evaluate "field compOp value", where both are in the API format.
+ */
+bool RecordBasedFileManager::compareField(const char *field, AttrType type,
+		CompOp compOp, const void *value) {
+
+	if (compOp == NO_OP)
+		return true;
+
+	int cmp;
+	if (type == TypeInt) {
+		int a, b;
+		memcpy(&a, field, sizeof(int));
+		memcpy(&b, value, sizeof(int));
+		cmp = (a > b) - (a < b);
+	} else if (type == TypeReal) {
+		float a, b;
+		memcpy(&a, field, sizeof(float));
+		memcpy(&b, value, sizeof(float));
+		cmp = (a > b) - (a < b);
+	} else {
+		int lengthA, lengthB;
+		memcpy(&lengthA, field, sizeof(int));
+		memcpy(&lengthB, value, sizeof(int));
+		cmp = memcmp(field + sizeof(int), (const char*) value + sizeof(int),
+				min(lengthA, lengthB));
+		if (cmp == 0)
+			cmp = (lengthA > lengthB) - (lengthA < lengthB);
+	}
+
+	switch (compOp) {
+	case EQ_OP:
+		return cmp == 0;
+	case LT_OP:
+		return cmp < 0;
+	case GT_OP:
+		return cmp > 0;
+	case LE_OP:
+		return cmp <= 0;
+	case GE_OP:
+		return cmp >= 0;
+	case NE_OP:
+		return cmp != 0;
+	default:
+		return true;
+	}
+}
+
+/*
+ * Copy the projected fields of a stored record into data, in the API format
+ * (null bits for the projected fields followed by their values).
+ */
+void RecordBasedFileManager::projectRecord(const char *record,
+		const vector<Attribute> &recordDescriptor,
+		const vector<int> &projection, void *data) {
+
+	int nullsize = (projection.size() + 7) / 8;
+	memset(data, 0, nullsize);
+	char *out = (char*) data + nullsize;
+
+	//fields added to the descriptor after the record was stored are null
+	short attrNum;
+	memcpy(&attrNum, record, sizeof(short));
+
+	for (unsigned i = 0; i < projection.size(); ++i) {
+		int index = projection[i];
+		if (index >= attrNum || fieldIsNull(record, index)) {
+			((char*) data)[i / 8] |= 1 << (7 - i % 8);
+			continue;
+		}
+		const char *field = record + fieldOffset(record, index);
+		int length = fieldLength(field, recordDescriptor[index].type);
+		memcpy(out, field, length);
+		out += length;
+	}
+}
+
+/*
+ * projectRecord for the record in a slot of a fixed layout page.
+ */
+void RecordBasedFileManager::projectFixedRecord(const FixedPage &fixedPage,
+		int slot, const vector<int> &projection, void *data) {
+
+	int nullsize = (projection.size() + 7) / 8;
+	memset(data, 0, nullsize);
+	char *out = (char*) data + nullsize;
+
+	for (unsigned i = 0; i < projection.size(); ++i) {
+		int index = projection[i];
+		if (index >= fixedPage.getNumberOfFields()
+				|| fixedPage.isNull(slot, index)) {
+			((char*) data)[i / 8] |= 1 << (7 - i % 8);
+			continue;
+		}
+		memcpy(out, fixedPage.field(slot, index), sizeof(int));
+		out += sizeof(int);
+	}
+}
+
+/*
+ * projectRecord for the record in a slot of a PAX page.
+ */
+void RecordBasedFileManager::projectPaxRecord(const PaxPage &paxPage, int slot,
+		const vector<int> &projection, void *data) {
+
+	int nullsize = (projection.size() + 7) / 8;
+	memset(data, 0, nullsize);
+	char *out = (char*) data + nullsize;
+
+	for (unsigned i = 0; i < projection.size(); ++i) {
+		int index = projection[i];
+		if (index >= paxPage.getNumberOfFields() || paxPage.isNull(slot, index)) {
+			((char*) data)[i / 8] |= 1 << (7 - i % 8);
+			continue;
+		}
+		if (paxPage.isVarChar(index)) {
+			int stringLength;
+			const char *chars = paxPage.varChar(slot, index, stringLength);
+			memcpy(out, &stringLength, sizeof(int));
+			memcpy(out + sizeof(int), chars, stringLength);
+			out += sizeof(int) + stringLength;
+		} else {
+			memcpy(out, paxPage.field(slot, index), sizeof(int));
+			out += sizeof(int);
+		}
+	}
+}
+
+RecordView::RecordView() {
+	fileHandle = NULL;
+	pageNum = 0;
+	record = NULL;
+	fixedNulls = NULL;
+	fixedFields = 0;
+	paxSlot = -1;
+}
+
+RecordView::~RecordView() {
+	release();
+}
+
+void RecordView::release() {
+	if (record != NULL) {
+		BufferManager::instance()->unpinPage(*fileHandle, pageNum, false);
+		record = NULL;
+		fixedNulls = NULL;
+		paxSlot = -1;
+		fileHandle = NULL;
+	}
+	if (fileLock.owns_lock())
+		fileLock.unlock();
+}
+
+int RecordView::getNumberOfFields() const {
+	if (fixedNulls != NULL)
+		return fixedFields;
+	if (paxSlot != -1)
+		return PaxPage((char*) record).getNumberOfFields();
+	short attrNum;
+	memcpy(&attrNum, record, sizeof(short));
+	return attrNum;
+}
+
+bool RecordView::isNull(int fieldIndex) const {
+	if (fixedNulls != NULL)
+		return fixedNulls[fieldIndex / 8] & (1 << (7 - fieldIndex % 8));
+	if (paxSlot != -1)
+		return PaxPage((char*) record).isNull(paxSlot, fieldIndex);
+	return RecordBasedFileManager::fieldIsNull(record, fieldIndex);
+}
+
+//the values of a fixed layout record are at fixed offsets, and the ones of a
+//PAX record in the minipages of its page
+int RecordView::getInt(int fieldIndex) const {
+	int value;
+	if (paxSlot != -1)
+		memcpy(&value, PaxPage((char*) record).field(paxSlot, fieldIndex),
+				sizeof(int));
+	else
+		memcpy(&value, record + (fixedNulls != NULL ? fieldIndex * sizeof(int) :
+				RecordBasedFileManager::fieldOffset(record, fieldIndex)),
+				sizeof(int));
+	return value;
+}
+
+float RecordView::getReal(int fieldIndex) const {
+	float value;
+	if (paxSlot != -1)
+		memcpy(&value, PaxPage((char*) record).field(paxSlot, fieldIndex),
+				sizeof(float));
+	else
+		memcpy(&value, record + (fixedNulls != NULL ? fieldIndex * sizeof(float) :
+				RecordBasedFileManager::fieldOffset(record, fieldIndex)),
+				sizeof(float));
+	return value;
+}
+
+string_view RecordView::getVarChar(int fieldIndex) const {
+	if (paxSlot != -1) {
+		int length;
+		const char *chars = PaxPage((char*) record).varChar(paxSlot, fieldIndex,
+				length);
+		return string_view(chars, length);
+	}
+	const char *field = record
+			+ RecordBasedFileManager::fieldOffset(record, fieldIndex);
+	int length;
+	memcpy(&length, field, sizeof(int));
+	return string_view(field + sizeof(int), length);
+}
+
+/*
+ * The codec of an empty descriptor, to be compiled later.
+ */
+RecordCodec::RecordCodec() {
+	attrNum = 0;
+	nullsSize = 0;
+	lastNullsMask = 0;
+	fixedPrefix = 0;
+}
+
+RecordCodec::RecordCodec(const vector<Attribute> &recordDescriptor) {
+	compile(recordDescriptor);
+}
+
+void RecordCodec::compile(const vector<Attribute> &recordDescriptor) {
+	attrNum = recordDescriptor.size();
+	nullsSize = (attrNum + 7) / 8;
+	lastNullsMask = (attrNum % 8 == 0) ? 0xFF : 0xFF << (8 - attrNum % 8);
+
+	types.resize(attrNum);
+	for (int i = 0; i < attrNum; ++i)
+		types[i] = recordDescriptor[i].type;
+
+	//without nulls, the fields start after attrNum offsets
+	fixedPrefix = 0;
+	while (fixedPrefix < attrNum && types[fixedPrefix] != TypeVarChar)
+		fixedPrefix++;
+	short baseAttributesOffset = sizeof(short) + nullsSize
+			+ attrNum * sizeof(short);
+	prefixOffsets.resize(fixedPrefix);
+	for (int i = 0; i < fixedPrefix; ++i)
+		prefixOffsets[i] = baseAttributesOffset + i * sizeof(int);
+
+	varCharFields.clear();
+	for (int i = 0; i < attrNum; ++i)
+		if (types[i] == TypeVarChar)
+			varCharFields.push_back(i);
+}
+
+bool RecordCodec::matches(const vector<Attribute> &recordDescriptor) const {
+	if ((int) recordDescriptor.size() != attrNum)
+		return false;
+	for (int i = 0; i < attrNum; ++i)
+		if (recordDescriptor[i].type != types[i])
+			return false;
+	return true;
+}
+
+bool RecordCodec::isFixedWidth() const {
+	return fixedPrefix == attrNum;
+}
+
+int RecordCodec::getNumberOfFields() const {
+	return attrNum;
+}
+
+int RecordCodec::getNullsSize() const {
+	return nullsSize;
+}
+
+const vector<short>& RecordCodec::getVarCharFields() const {
+	return varCharFields;
+}
+
+/*
+ * Stored format: number of attributes | null bits | offsets of the non-null fields
+ * | fields. The fields are copied from data in one go, so only their offsets are
+ * computed here: the null bits are expanded into the list of non-null fields, every
+ * one of them is 4 bytes long plus the characters of the varchars, and the offsets
+ * are the prefix sums of the lengths (see recordkernels.h). The varchars have to be
+ * found one after the other, each one after the previous ones, but the fields in
+ * between are skipped. When no field is null, the offsets of the fixed-width prefix
+ * are the precomputed ones. Without vector instructions, the fields are just gone
+ * through one by one (see encodeScalar), which is faster than the kernels.
+ */
+short RecordCodec::encode(const void *data, char *record) const {
+	if (getKernelLevel() == ScalarKernels)
+		return encodeScalar(data, record);
+
+	const unsigned char *nullbits = (const unsigned char*) data;
+	const char *fields = (const char*) data + nullsSize;
+
+	short storedAttrNum = attrNum;
+	memcpy(record, &storedAttrNum, sizeof(short));
+	memcpy(record + sizeof(short), nullbits, nullsSize);
+
+	//outputs of the kernels, kept by each thread from one record to the next
+	thread_local vector<short> indexes, lengths, offsets;
+	if (indexes.size() < (size_t) attrNum + KERNEL_SLACK) {
+		indexes.resize(attrNum + KERNEL_SLACK);
+		lengths.resize(attrNum + KERNEL_SLACK);
+		offsets.resize(attrNum + KERNEL_SLACK);
+	}
+
+	int nonNull = nonNullFields(nullbits, attrNum, indexes.data());
+	short baseAttributesOffset = sizeof(short) + nullsSize
+			+ nonNull * sizeof(short);
+
+	for (int i = 0; i < nonNull; ++i)
+		lengths[i] = sizeof(int);
+
+	//rank of each varchar among the non-null fields (its index minus the null
+	//fields before it), and the characters before it
+	int nullsBefore = 0;
+	int countedBytes = 0;
+	int characters = 0;
+	for (unsigned i = 0; i < varCharFields.size(); ++i) {
+		int index = varCharFields[i];
+		if (nullbits[index / 8] & (1 << (7 - index % 8)))
+			continue;
+		for (; countedBytes < index / 8; ++countedBytes)
+			nullsBefore += __builtin_popcount(nullbits[countedBytes]);
+		int rank = index - nullsBefore
+				- __builtin_popcount(nullbits[index / 8] >> (8 - index % 8));
+
+		int stringLength;
+		memcpy(&stringLength, fields + rank * sizeof(int) + characters,
+				sizeof(int));
+		if (stringLength < 0 || stringLength > PAGE_SIZE)
+			return SHRT_MAX; //certainly too big
+		lengths[rank] += stringLength;
+		characters += stringLength;
+	}
+
+	int attributesLengthSum = nonNull * sizeof(int) + characters;
+	if (baseAttributesOffset + attributesLengthSum > PAGE_SIZE)
+		return SHRT_MAX;
+
+	if (nonNull == attrNum) {
+		if (fixedPrefix > 0)
+			memcpy(offsets.data(), prefixOffsets.data(),
+					fixedPrefix * sizeof(short));
+		fieldOffsets(lengths.data() + fixedPrefix, nonNull - fixedPrefix,
+				baseAttributesOffset + fixedPrefix * sizeof(int),
+				offsets.data() + fixedPrefix);
+	} else {
+		fieldOffsets(lengths.data(), nonNull, baseAttributesOffset,
+				offsets.data());
+	}
+	memcpy(record + sizeof(short) + nullsSize, offsets.data(),
+			nonNull * sizeof(short));
+
+	memcpy(record + baseAttributesOffset, fields, attributesLengthSum);
+	return baseAttributesOffset + attributesLengthSum;
+}
+
+/*
+ * The same stored record as encode, with the offsets written as the fields are
+ * gone through, one after the other.
+ */
+short RecordCodec::encodeScalar(const void *data, char *record) const {
+	const unsigned char *nullbits = (const unsigned char*) data;
+	const char *fields = (const char*) data + nullsSize;
+
+	short storedAttrNum = attrNum;
+	memcpy(record, &storedAttrNum, sizeof(short));
+	memcpy(record + sizeof(short), nullbits, nullsSize);
+
+	int nonNull = nonNullCount(nullbits);
+	short baseAttributesOffset = sizeof(short) + nullsSize
+			+ nonNull * sizeof(short);
+	char *offsets = record + sizeof(short) + nullsSize;
 
-	stringstream ss;
-	int attrNum = recordDescriptor.size();
-	int nullsize = (int) ceil((double) attrNum / 8);
-	unsigned char nullbytes[nullsize];
-	memcpy(nullbytes, data, nullsize);
-	unsigned char nullbyte;
 	int index = 0;
-	AttrType type;
-	AttrLength length;
-
-	int offset = nullsize;
-
-	for (int i = 0; i < nullsize; ++i) {
-		nullbyte = nullbytes[i];
-		for (unsigned char b = 1 << 7; b > 0; b >>= 1) {
-
-			if (index >= attrNum)
-				goto exitLoops;
-			ss << recordDescriptor[index].name << ": ";
-
-			if ((nullbyte & b) == 0) { //the field is not null
-
-				//TypeInt = 0, TypeReal, TypeVarChar
-				type = recordDescriptor[index].type;
-				length = recordDescriptor[index].length;
-
-				if (type == TypeInt) {
-					int field;
-					memcpy(&field, (char*) data + offset, length);
-					ss << field;
-				} else if (type == TypeReal) {
-					float field;
-					memcpy(&field, (char*) data + offset, length);
-					ss << field;
-				} else if (type == TypeVarChar) {
-					int stringLength;
-					memcpy(&stringLength, (char*) data + offset, sizeof(int));
-					offset += sizeof(int);
-					char field[stringLength];
-					memcpy(field, (char*) data + offset, stringLength);
-					length = stringLength;
-					ss << string(field, field + stringLength);
-				} else {
-					cout
-							<< "ERROR: type doesn't match any of the valid types defined "
-							<< endl;
-				}
-				ss << "\t";
-				offset += length;
-			} else {
-				ss << "NULL\t";
+	int attributesLengthSum = 0;
+	if (nonNull == attrNum) {
+		if (fixedPrefix > 0)
+			memcpy(offsets, prefixOffsets.data(), fixedPrefix * sizeof(short));
+		offsets += fixedPrefix * sizeof(short);
+		index = fixedPrefix;
+		attributesLengthSum = fixedPrefix * sizeof(int);
+	}
+
+	for (; index < attrNum; ++index) {
+		if (nullbits[index / 8] & (1 << (7 - index % 8)))
+			continue;
+
+		short attributeOffset = baseAttributesOffset + attributesLengthSum;
+		memcpy(offsets, &attributeOffset, sizeof(short));
+		offsets += sizeof(short);
+
+		attributesLengthSum += sizeof(int);
+		if (types[index] == TypeVarChar) {
+			int stringLength;
+			memcpy(&stringLength, fields + attributesLengthSum - sizeof(int),
+					sizeof(int));
+			if (stringLength < 0 || stringLength > PAGE_SIZE)
+				return SHRT_MAX; //certainly too big
+			attributesLengthSum += stringLength;
+		}
+	}
+
+	if (baseAttributesOffset + attributesLengthSum > PAGE_SIZE)
+		return SHRT_MAX;
+	memcpy(record + baseAttributesOffset, fields, attributesLengthSum);
+	return baseAttributesOffset + attributesLengthSum;
+}
+
+/*
+ * Number of non-null fields, given the null bits of a record of this descriptor.
+ * The bits after the last field are ignored.
+ */
+int RecordCodec::nonNullCount(const unsigned char *nullbits) const {
+	int nullCount = 0;
+	for (int i = 0; i < nullsSize - 1; ++i)
+		nullCount += __builtin_popcount(nullbits[i]);
+	if (nullsSize > 0)
+		nullCount += __builtin_popcount(nullbits[nullsSize - 1] & lastNullsMask);
+	return attrNum - nullCount;
+}
+
+/*
+ * After the number of attributes, the stored record has the null bits, the offsets
+ * of the non-null fields and then the fields themselves, one after the other just
+ * like in data; so only the null bits and the fields have to be copied. The fields
+ * end where the last non-null one does (a short record may be followed by padding),
+ * and its offset is the last one stored. A record stored before fields were added
+ * to the descriptor keeps its own number of fields.
+ */
+void RecordCodec::decode(const char *record, void *data) const {
+	short storedAttrNum;
+	memcpy(&storedAttrNum, record, sizeof(short));
+	int storedNullsSize = (storedAttrNum + 7) / 8;
+	const unsigned char *nullbits = (const unsigned char*) record
+			+ sizeof(short);
+
+	//copy null bits
+	memcpy(data, nullbits, storedNullsSize);
+
+	//the last non-null field
+	int last = -1;
+	for (int i = storedNullsSize - 1; i >= 0 && last == -1; --i) {
+		unsigned char notNull = ~nullbits[i];
+		if (i == storedNullsSize - 1 && storedAttrNum % 8 != 0)
+			notNull &= 0xFF << (8 - storedAttrNum % 8);
+		if (notNull != 0)
+			last = i * 8 + 7 - __builtin_ctz(notNull);
+	}
+	if (last == -1)
+		return;
+
+	int nonNull = storedAttrNum;
+	for (int i = 0; i < storedNullsSize; ++i)
+		nonNull -= __builtin_popcount(nullbits[i]);
+	if (storedAttrNum % 8 != 0)
+		nonNull += __builtin_popcount(
+				nullbits[storedNullsSize - 1] & (0xFF >> (storedAttrNum % 8)));
+
+	short baseAttributesOffset = sizeof(short) + storedNullsSize
+			+ nonNull * sizeof(short);
+	short lastOffset;
+	memcpy(&lastOffset, record + baseAttributesOffset - sizeof(short),
+			sizeof(short));
+	int fieldsEnd = lastOffset
+			+ RecordBasedFileManager::fieldLength(record + lastOffset,
+					types[last]);
+
+	//copy the fields at the end of data
+	memcpy((char*) data + storedNullsSize, record + baseAttributesOffset,
+			fieldsEnd - baseAttributesOffset);
+}
+
+RBFM_ScanIterator::RBFM_ScanIterator() {
+	fileHandle = NULL;
+	conditionIndex = -1;
+	compOp = NO_OP;
+	currentPage = 0;
+	currentSlot = 0;
+	page = NULL;
+	zoneMap = NULL;
+	skippedPages = 0;
+	morsel = NULL;
+	morselFirst = 0;
+	morselEnd = 0;
+}
+
+RBFM_ScanIterator::~RBFM_ScanIterator() {
+	close();
+}
+
+/*
+ * Walk the slot directory of the current page, moving on to the next page
+ * when it is exhausted, until a record satisfies the condition.
+ */
+RC RBFM_ScanIterator::getNextRecord(RID &rid, void *data) {
+
+	if (fileHandle == NULL)
+		return RBFM_EOF;
+
+	shared_lock<shared_mutex> fileLock(fileHandle->getRecordLock());
+	return nextRecord(rid, data);
+}
+
+RC RBFM_ScanIterator::nextRecord(RID &rid, void *data) {
+
+	if (fileHandle->getFileType() == FixedLayout)
+		return getNextFixedRecord(rid, data);
+	if (fileHandle->getFileType() == PaxLayout)
+		return getNextPaxRecord(rid, data);
+
+	while (true) {
+		if (page == NULL && !nextPage())
+			return RBFM_EOF;
+
+		short slotsNumber;
+		memcpy(&slotsNumber, page + PAGE_SIZE - 4, sizeof(short));
+
+		while (++currentSlot <= (unsigned) slotsNumber) {
+			short recordOffset;
+			int slotOffset = PAGE_SIZE - 6 - currentSlot * 4;
+			memcpy(&recordOffset, page + slotOffset + 2, sizeof(short));
+			if (recordOffset == -1) //free slot
+				continue;
+
+			const char *record = page + recordOffset;
+
+			//a moved record is returned from the page it was moved to, with the rid
+			//of its home slot (the forwarding stub there is skipped)
+			short marker = RecordBasedFileManager::recordMarker(record);
+			if (marker == FORWARDING_STUB)
+				continue;
+			rid.pageNum = currentPage;
+			rid.slotNum = currentSlot;
+			if (marker == MOVED_RECORD) {
+				rid = RecordBasedFileManager::forwardingRid(record);
+				record += FORWARDING_SIZE;
+			}
+
+			if (conditionIndex != -1) {
+				if (RecordBasedFileManager::fieldIsNull(record, conditionIndex))
+					continue;
+				const char *field = record
+						+ RecordBasedFileManager::fieldOffset(record,
+								conditionIndex);
+				if (!RecordBasedFileManager::compareField(field,
+						recordDescriptor[conditionIndex].type, compOp,
+						&value[0]))
+					continue;
 			}
-			index++;
+
+			RecordBasedFileManager::projectRecord(record, recordDescriptor,
+					projection, data);
+			return 0;
 		}
+
+		//the page is exhausted
+		releasePage();
+		currentPage++;
 	}
-	exitLoops:
+}
 
-	cout << ss.str() << endl;
+/*
+ * getNextRecord for a file with the fixed layout: the used slots of each page,
+ * in order. The condition field is read in place, at its fixed offset.
+ */
+RC RBFM_ScanIterator::getNextFixedRecord(RID &rid, void *data) {
+	while (true) {
+		if (page == NULL && !nextPage())
+			return RBFM_EOF;
+
+		FixedPage fixedPage(page);
+		int slotsNumber = fixedPage.getSlotsNumber();
+
+		while (++currentSlot <= (unsigned) slotsNumber) {
+			int slot = currentSlot - 1;
+			if (!fixedPage.isUsed(slot))
+				continue;
+
+			if (conditionIndex != -1) {
+				if (conditionIndex >= fixedPage.getNumberOfFields()
+						|| fixedPage.isNull(slot, conditionIndex))
+					continue;
+				if (!RecordBasedFileManager::compareField(
+						fixedPage.field(slot, conditionIndex),
+						recordDescriptor[conditionIndex].type, compOp,
+						&value[0]))
+					continue;
+			}
+
+			rid.pageNum = currentPage;
+			rid.slotNum = currentSlot;
+			RecordBasedFileManager::projectFixedRecord(fixedPage, slot,
+					projection, data);
+			return 0;
+		}
+
+		//the page is exhausted
+		releasePage();
+		currentPage++;
+	}
+}
+
+/*
+ * getNextRecord for a file with the PAX layout. When a page is pinned, the
+ * condition is evaluated on the minipage of its attribute as a whole (see
+ * selectPaxSlots), and then only the selected slots are visited. The page may
+ * change between two calls, so each of them is checked again before it is
+ * returned. Stubs are followed to the page their record was moved to.
+ */
+RC RBFM_ScanIterator::getNextPaxRecord(RID &rid, void *data) {
+	BufferManager *bpm = BufferManager::instance();
+	while (true) {
+		if (page == NULL) {
+			if (!nextPage())
+				return RBFM_EOF;
+			selectPaxSlots();
+		}
+
+		PaxPage paxPage(page);
+		int slotsNumber = min(paxPage.getSlotsNumber(),
+				(int) (selected.size() - KERNEL_SLACK) * 8);
+
+		while (++currentSlot <= (unsigned) slotsNumber) {
+			int slot = currentSlot - 1;
+			if (!(selected[slot / 8] & (1 << (slot % 8)))
+					|| !paxPage.isUsed(slot) || paxPage.isMoved(slot))
+				continue;
+
+			rid.pageNum = currentPage;
+			rid.slotNum = currentSlot;
+			if (!paxPage.isForwarded(slot)) {
+				if (!paxConditionHolds(paxPage, slot))
+					continue;
+				RecordBasedFileManager::projectPaxRecord(paxPage, slot,
+						projection, data);
+				return 0;
+			}
+
+			//the record was moved to another page
+			unsigned targetPageNum, targetSlotNum;
+			paxPage.getForwarding(slot, targetPageNum, targetSlotNum);
+			char *targetPage;
+			if (bpm->fetchPage(*fileHandle, targetPageNum, targetPage) != 0)
+				return -1;
+			PaxPage target(targetPage);
+			bool holds = paxConditionHolds(target, targetSlotNum - 1);
+			if (holds)
+				RecordBasedFileManager::projectPaxRecord(target,
+						targetSlotNum - 1, projection, data);
+			bpm->unpinPage(*fileHandle, targetPageNum, false);
+			if (holds)
+				return 0;
+		}
+
+		//the page is exhausted
+		releasePage();
+		currentPage++;
+	}
+}
+
+//bits of the slots where "field compOp value" holds, from the bits of the ones
+//where the field is less than and equal to the value
+static unsigned char comparisonBits(CompOp compOp, unsigned char less,
+		unsigned char equal) {
+	switch (compOp) {
+	case EQ_OP:
+		return equal;
+	case LT_OP:
+		return less;
+	case GT_OP:
+		return ~(less | equal);
+	case LE_OP:
+		return less | equal;
+	case GE_OP:
+		return ~less;
+	case NE_OP:
+		return ~equal;
+	default:
+		return 0xFF;
+	}
+}
+
+/*
+ * Select the slots of the page just pinned that have to be visited: the records
+ * (not the moved ones, which are visited through their stub) whose field is not
+ * null and satisfies the condition, and the stubs. Ints and reals are compared
+ * a whole minipage at a time (see recordkernels.h).
+ */
+void RBFM_ScanIterator::selectPaxSlots() {
+	PaxPage paxPage(page);
+	int slotsNumber = paxPage.getSlotsNumber();
+	int bytes = (slotsNumber + 7) / 8;
+	selected.assign(bytes + KERNEL_SLACK, 0);
+
+	const unsigned char *used = paxPage.usedSlots();
+	const unsigned char *moved = paxPage.movedSlots();
+	const unsigned char *forwarded = paxPage.forwardedSlots();
+	if (conditionIndex == -1) {
+		for (int i = 0; i < bytes; ++i)
+			selected[i] = used[i] & ~moved[i];
+		return;
+	}
+	if (conditionIndex >= paxPage.getNumberOfFields()) { //null everywhere
+		for (int i = 0; i < bytes; ++i)
+			selected[i] = used[i] & forwarded[i];
+		return;
+	}
+
+	vector<unsigned char> less(bytes + KERNEL_SLACK);
+	vector<unsigned char> equal(bytes + KERNEL_SLACK);
+	AttrType type = recordDescriptor[conditionIndex].type;
+	if (type == TypeInt) {
+		int intValue;
+		memcpy(&intValue, &value[0], sizeof(int));
+		compareInts((const int*) paxPage.column(conditionIndex), slotsNumber,
+				intValue, &less[0], &equal[0]);
+	} else if (type == TypeReal) {
+		float realValue;
+		memcpy(&realValue, &value[0], sizeof(float));
+		compareReals((const float*) paxPage.column(conditionIndex),
+				slotsNumber, realValue, &less[0], &equal[0]);
+	}
+
+	const unsigned char *nulls = paxPage.nullSlots(conditionIndex);
+	for (int i = 0; i < bytes; ++i) {
+		unsigned char matches;
+		if (type == TypeVarChar) { //one record at a time
+			matches = 0;
+			for (int slot = i * 8; slot < i * 8 + 8 && slot < slotsNumber;
+					++slot)
+				if (paxPage.isUsed(slot) && !paxPage.isForwarded(slot)
+						&& !paxPage.isNull(slot, conditionIndex)
+						&& paxConditionHolds(paxPage, slot))
+					matches |= 1 << (slot % 8);
+		} else {
+			matches = comparisonBits(compOp, less[i], equal[i]) & ~nulls[i];
+		}
+		selected[i] = used[i] & ~moved[i] & (forwarded[i] | matches);
+	}
+}
+
+/*
+ * Whether the record in the slot of the PAX page satisfies the condition.
+ */
+bool RBFM_ScanIterator::paxConditionHolds(const PaxPage &paxPage, int slot) {
+	if (conditionIndex == -1)
+		return true;
+	if (conditionIndex >= paxPage.getNumberOfFields()
+			|| paxPage.isNull(slot, conditionIndex))
+		return false;
+
+	AttrType type = recordDescriptor[conditionIndex].type;
+	if (type != TypeVarChar)
+		return RecordBasedFileManager::compareField(
+				paxPage.field(slot, conditionIndex), type, compOp, &value[0]);
+
+	//compareField takes the varchar with its length in front
+	int stringLength;
+	const char *chars = paxPage.varChar(slot, conditionIndex, stringLength);
+	if (stringLength < 0 || stringLength > PAGE_SIZE - (int) sizeof(int))
+		return false; //not a varchar of this page
+	char field[PAGE_SIZE];
+	memcpy(field, &stringLength, sizeof(int));
+	memcpy(field + sizeof(int), chars, stringLength);
+	return RecordBasedFileManager::compareField(field, type, compOp, &value[0]);
+}
+
+/*
+ * Pin the page currentPage (if it exists) and start from its first slot. The
+ * pages the zone map excludes are passed over. A worker of a parallel scan only
+ * goes through the pages of its morsel, which it has read itself.
+ */
+bool RBFM_ScanIterator::nextPage() {
+	if (morsel != NULL) {
+		if (currentPage >= morselEnd)
+			return false;
+		page = morsel + (size_t) (currentPage - morselFirst) * PAGE_SIZE;
+		currentSlot = 0;
+		return true;
+	}
+
+	unsigned numPages = fileHandle->getNumberOfPages();
+	while (zoneMap != NULL && conditionIndex != -1 && currentPage < numPages
+			&& !zoneMap->mayMatch(currentPage, recordDescriptor,
+					conditionIndex, compOp, &value[0])) {
+		currentPage++;
+		skippedPages++;
+	}
+	if (currentPage >= numPages)
+		return false;
+	if (BufferManager::instance()->fetchPage(*fileHandle, currentPage, page)
+			!= 0) {
+		page = NULL;
+		return false;
+	}
+	currentSlot = 0;
+	return true;
+}
+
+void RBFM_ScanIterator::releasePage() {
+	if (page != NULL && morsel != NULL) {
+		page = NULL;
+	} else if (page != NULL) {
+		BufferManager::instance()->unpinPage(*fileHandle, currentPage, false);
+		page = NULL;
+	}
+}
+
+unsigned RBFM_ScanIterator::getSkippedPages() {
+	return skippedPages;
+}
 
+RC RBFM_ScanIterator::close() {
+	if (fileHandle != NULL)
+		releasePage();
+	fileHandle = NULL;
+	zoneMap = NULL;
+	morsel = NULL;
+	currentPage = 0;
+	currentSlot = 0;
 	return 0;
 }
@@ -2,15 +2,25 @@
 #define _rbfm_h_
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <climits>
 #include <sstream>
 #include <algorithm>
+#include <unordered_map>
 
 #include "pfm.h"
+#include "bpm.h"
+#include "fixedpage.h"
+#include "paxpage.h"
 
 using namespace std;
 
+class ZoneMap;
+struct ParallelScan;
+
+#define DEFAULT_COMPACTION_THRESHOLD (PAGE_SIZE / 8) // see setLazyCompaction
+
 // Record ID
 typedef struct {
 	unsigned pageNum;	// page number
@@ -30,6 +40,13 @@ struct Attribute {
 	AttrLength length; // attribute length
 };
 
+// Page format of a record-based file, chosen when the file is created
+typedef enum {
+	SlottedLayout = 0, // records of any schema, with a slot directory
+	FixedLayout,       // only ints and reals, in fixed-size slots (see FixedPage)
+	PaxLayout          // records grouped by attribute within each page (see PaxPage)
+} PageLayout;
+
 // Comparison Operator (NOT needed for part 1 of the project)
 typedef enum {
 	NO_OP = 0,  // no condition
@@ -41,6 +58,29 @@ typedef enum {
 	NE_OP,      // !=
 } CompOp;
 
+#define MORSEL_PAGES 32       // most pages a worker of a parallel scan reads at once
+#define SCAN_BATCH_SIZE 1024  // records of a batch of a parallel scan
+
+// Records found by a worker of RecordBasedFileManager::parallelScan: the i-th
+// one has rid rids[i], and its projection (in the format of getNextRecord) is at
+// data[offsets[i]]
+struct ScanBatch {
+	vector<RID> rids;
+	vector<char> data;
+	vector<unsigned> offsets;
+};
+
+// Called with every batch a worker of a parallel scan fills, on the thread of the
+// worker, so possibly on several threads at the same time
+typedef void (*ScanBatchHandler)(int worker, const ScanBatch &batch,
+		void *context);
+
+#define BULK_LOAD_PAGES 256 // pages bulkLoad writes at once
+
+// Gives the next record of a bulk load into data (PAGE_SIZE bytes), in the
+// format of insertRecord: false when there is none left
+typedef bool (*RecordSource)(void *context, void *data);
+
 /****************************************************************************
  The scan iterator is NOT required to be implemented for part 1 of the project
  *****************************************************************************/
@@ -58,33 +98,132 @@ typedef enum {
 
 class RBFM_ScanIterator {
 public:
-	RBFM_ScanIterator() {
-	}
-	;
-	~RBFM_ScanIterator() {
-	}
-	;
+	RBFM_ScanIterator();
+	~RBFM_ScanIterator();
 
 	// "data" follows the same format as RecordBasedFileManager::insertRecord()
-	RC getNextRecord(RID &rid, void *data) {
-		return RBFM_EOF;
-	}
-	;
-	RC close() {
-		return -1;
-	}
-	;
+	RC getNextRecord(RID &rid, void *data);
+	RC close();
+
+	// pages passed over because their zone map excludes the condition
+	unsigned getSkippedPages();
+
+private:
+	friend class RecordBasedFileManager;
+
+	FileHandle *fileHandle;
+	vector<Attribute> recordDescriptor;
+	int conditionIndex;            // -1 if there is no condition
+	CompOp compOp;
+	vector<char> value;            // value to compare with, as in the API format
+	vector<int> projection;        // indexes of the projected attributes
+	ZoneMap *zoneMap;              // NULL if the file has none
+	unsigned skippedPages;
+
+	PageNum currentPage;
+	unsigned currentSlot;          // last slot returned in the current page
+	char *page;                    // current page, pinned in the buffer pool
+
+	vector<unsigned char> selected; // slots of the current PAX page to look at
+
+	char *morsel;                  // pages read by a worker of a parallel scan,
+	PageNum morselFirst;           // from morselFirst to morselEnd - 1 (NULL in
+	PageNum morselEnd;             // a regular scan)
+
+	RC nextRecord(RID &rid, void *data); // with the file already locked
+	bool nextPage();
+	void releasePage();
+	RC getNextFixedRecord(RID &rid, void *data);
+	RC getNextPaxRecord(RID &rid, void *data);
+	void selectPaxSlots();
+	bool paxConditionHolds(const PaxPage &paxPage, int slot);
+};
+
+// RecordCodec translates records of one record descriptor between the format of
+// insertRecord and the format they are stored in. It is compiled once from the
+// descriptor, so that it doesn't have to be walked for every record: the size of the
+// null bits, the offsets of the leading fixed-width fields (in a record without
+// nulls) and the positions of the varchars are computed in advance, and only the
+// types of the fields are kept.
+// RecordBasedFileManager::recordCodec caches the codec of the last descriptor used.
+class RecordCodec {
+public:
+	RecordCodec();
+	RecordCodec(const vector<Attribute> &recordDescriptor);
+
+	void compile(const vector<Attribute> &recordDescriptor);
+	bool matches(const vector<Attribute> &recordDescriptor) const; // same types
+	bool isFixedWidth() const; // no varchars, so it fits the fixed layout
+
+	// Write the stored record (without any padding) and return its size
+	short encode(const void *data, char *record) const;
+	// Write the record back in the format of insertRecord
+	void decode(const char *record, void *data) const;
+
+	int getNumberOfFields() const;
+	int getNullsSize() const;
+	const vector<short>& getVarCharFields() const;
+
+private:
+	short encodeScalar(const void *data, char *record) const;
+	int nonNullCount(const unsigned char *nullbits) const;
+
+	int attrNum;
+	int nullsSize;
+	unsigned char lastNullsMask;  // bits of the last null byte that belong to fields
+	vector<AttrType> types;
+	int fixedPrefix;              // number of leading fields that are not varchars
+	vector<short> prefixOffsets;  // their offsets when no field is null
+	vector<short> varCharFields;  // indexes of the varchars
+};
+
+// RecordView gives access to the fields of a stored record in place, without
+// copying it out of its page. It is filled by RecordBasedFileManager::readRecordView:
+//  RecordView view;
+//  rbfm->readRecordView(fileHandle, rid, view);
+//  if (!view.isNull(2)) age = view.getInt(2);
+// The page stays pinned and the file is locked for reading while the view points
+// to a record, so release the view before modifying the file. The typed getters
+// must only be used on non-null fields of the right type.
+class RecordView {
+public:
+	RecordView();
+	~RecordView();
+
+	int getNumberOfFields() const;
+	bool isNull(int fieldIndex) const;
+	int getInt(int fieldIndex) const;
+	float getReal(int fieldIndex) const;
+	string_view getVarChar(int fieldIndex) const; // valid until the view is released
+
+	void release(); // unpin the page and unlock the file
+
+private:
+	friend class RecordBasedFileManager;
+
+	RecordView(const RecordView &);
+	RecordView& operator=(const RecordView &);
+
+	FileHandle *fileHandle;
+	PageNum pageNum;
+	const char *record;            // record in the pinned page, NULL if none
+	const unsigned char *fixedNulls; // null bits of a record of a fixed layout
+	int fixedFields;               // page, whose record has just the values
+	int paxSlot;                   // slot of a record of a PAX page (then record
+	                               // is the page), -1 for the other layouts
+	shared_lock<shared_mutex> fileLock;
 };
 
 class RecordBasedFileManager {
 public:
 	static RecordBasedFileManager* instance();
 
-	RC createFile(const string &fileName);
+	RC createFile(const string &fileName, PageLayout layout = SlottedLayout);
 
 	RC destroyFile(const string &fileName);
 
-	RC openFile(const string &fileName, FileHandle &fileHandle);
+	RC openFile(const string &fileName, FileHandle &fileHandle,
+			bool memoryMapped = false);
 
 	RC closeFile(FileHandle &fileHandle);
 
@@ -105,10 +244,37 @@ public:
 			const vector<Attribute> &recordDescriptor, const void *data,
 			RID &rid);
 
+	// Insert many records at once, with far less I/O than one insertRecord per record.
+	// rids[i] is the rid of records[i].
+	RC insertRecords(FileHandle &fileHandle,
+			const vector<Attribute> &recordDescriptor,
+			const vector<const void *> &records, vector<RID> &rids);
+
+	// Load the records of source, in their order, into new pages at the end of the
+	// file, each one filled before the next. With skipFreeSpace, the file has to be
+	// empty, and its pages are left out of the free space map, as if they were full.
+	RC bulkLoad(FileHandle &fileHandle,
+			const vector<Attribute> &recordDescriptor, RecordSource source,
+			void *context, bool skipFreeSpace = false);
+
 	RC readRecord(FileHandle &fileHandle,
 			const vector<Attribute> &recordDescriptor, const RID &rid,
 			void *data);
 
+	// Compact pages with at least threshold bytes of holes when the buffer pool writes
+	// them back, rather than when an insertion runs out of contiguous space in them
+	void setLazyCompaction(bool lazy, short threshold =
+			DEFAULT_COMPACTION_THRESHOLD);
+
+	// Read many records at once, each page only once. data[i] receives the record of rids[i].
+	RC readRecords(FileHandle &fileHandle,
+			const vector<Attribute> &recordDescriptor, const vector<RID> &rids,
+			const vector<void *> &data);
+
+	// Point recordView to the record, which stays in its page (see RecordView)
+	RC readRecordView(FileHandle &fileHandle, const RID &rid,
+			RecordView &recordView);
+
 	// This method will be mainly used for debugging/testing
 	RC printRecord(const vector<Attribute> &recordDescriptor, const void *data);
 
@@ -127,6 +293,23 @@ public:
 			const vector<Attribute> &recordDescriptor, const RID &rid,
 			const string &attributeName, void *data);
 
+	// Like readAttribute for several attributes; data has the format scan returns
+	RC readAttributes(FileHandle &fileHandle,
+			const vector<Attribute> &recordDescriptor, const RID &rid,
+			const vector<string> &attributeNames, void *data);
+
+	// Pack the records of the file into as few pages as possible and shrink it.
+	// The rids of the moved records are returned as (old rid, new rid) pairs.
+	RC reorganizeFile(FileHandle &fileHandle, vector<pair<RID, RID> > &ridMap);
+
+	// Compact every page of the file in place, keeping the rids
+	RC compactFile(FileHandle &fileHandle);
+
+	// Recompute the zone map of the file (see ZoneMap), which deletions leave wider
+	// than needed, from its records. No other handle may be modifying the file meanwhile.
+	RC rebuildZoneMap(FileHandle &fileHandle,
+			const vector<Attribute> &recordDescriptor);
+
 	// scan returns an iterator to allow the caller to go through the results one by one.
 	RC scan(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor,
 			const string &conditionAttribute, const CompOp compOp, // comparision type such as "<" and "="
@@ -134,17 +317,44 @@ public:
 			const vector<string> &attributeNames, // a list of projected attributes
 			RBFM_ScanIterator &rbfm_ScanIterator);
 
-	static bool pairCompare(const pair<int, pair<short, short> > &firstElem,
-			const pair<int, pair<short, short> > &secondElem);
+	// Same scan with numThreads threads (0 for one per core), which pass the records
+	// they find to handler in batches. It returns when the whole file is scanned.
+	RC parallelScan(FileHandle &fileHandle,
+			const vector<Attribute> &recordDescriptor,
+			const string &conditionAttribute, const CompOp compOp,
+			const void *value, const vector<string> &attributeNames,
+			int numThreads, ScanBatchHandler handler, void *context);
+
+	// Helpers to work directly on a record stored in a page
+	static bool fieldIsNull(const char *record, int fieldIndex);
+	static short fieldOffset(const char *record, int fieldIndex);
+	static int fieldLength(const char *field, AttrType type);
+	static bool compareField(const char *field, AttrType type, CompOp compOp,
+			const void *value);
+	static void projectRecord(const char *record,
+			const vector<Attribute> &recordDescriptor,
+			const vector<int> &projection, void *data);
+	static void projectFixedRecord(const FixedPage &fixedPage, int slot,
+			const vector<int> &projection, void *data);
+	static void projectPaxRecord(const PaxPage &paxPage, int slot,
+			const vector<int> &projection, void *data);
+
+	static int attributeIndex(const vector<Attribute> &recordDescriptor,
+			const string &attributeName);
+	static const char* recordAddress(const char *page, unsigned slotNum,
+			short &recordLength);
+	static short recordMarker(const char *record);
+	static RID forwardingRid(const char *record);
+	static void writeForwarding(char *record, short marker, const RID &rid);
+	static void decodeRecord(const char *record,
+			const vector<Attribute> &recordDescriptor, void *data);
+	static const RecordCodec& recordCodec(
+			const vector<Attribute> &recordDescriptor);
+
 public:
 
 	PagedFileManager* pfm;
-	char *pageBuffer;
-	char *headerBuffer;
-	char *recordBuffer;
-	int pageNum;
-	int headerNum;
-	short pageFreeSpace;
+	BufferManager* bpm;
 
 protected:
 	RecordBasedFileManager();
@@ -152,8 +362,71 @@ protected:
 
 private:
 	static RecordBasedFileManager *_rbf_manager;
-	void storeRecordInCurrentPage(int recordSize, RID& rid,
-			FileHandle& fileHandle);
+	static bool lazyCompaction;
+	static short compactionThreshold; // reclaimable bytes worth a lazy compaction
+	map<string, ZoneMap*> zoneMaps; // zone maps of the open files, by file name
+	mutex zoneMapsMutex;
+	ZoneMap* zoneMap(FileHandle &fileHandle);
+	static void scanMorsels(ParallelScan *parallelScan, int worker);
+	void addToZoneMap(FileHandle &fileHandle,
+			const vector<Attribute> &recordDescriptor, const void *data,
+			PageNum pageNum);
+	RC updateSlottedRecord(FileHandle &fileHandle,
+			const vector<Attribute> &recordDescriptor, const RecordCodec &codec,
+			const void *data, const RID &rid);
+	RC reorganizeSlottedFile(FileHandle &fileHandle,
+			vector<pair<RID, RID> > &ridMap);
+	short encodeRecord(const RecordCodec &codec, const void *data,
+			char *recordBuffer);
+	RC storeRecord(FileHandle &fileHandle, const char *recordBuffer,
+			short recordSize, RID &rid);
+	short storeRecordInCurrentPage(FileHandle &fileHandle, char *pageBuffer,
+			const char *recordBuffer, short recordSize, RID& rid);
+	static void placeRecord(FileHandle &fileHandle, char *pageBuffer,
+			int slotNum, const char *recordBuffer, short recordSize);
+	static short compactPage(FileHandle &fileHandle, char *pageBuffer);
+	static short reclaimableSpace(const char *pageBuffer);
+	static void compactOnWriteBack(FileHandle &fileHandle, char *pageBuffer);
+	static bool trimSlotDirectory(char *pageBuffer);
+	static bool fixedLayout(FileHandle &fileHandle);
+	static RC checkFixedSchema(const RecordCodec &codec);
+	RC insertFixedRecord(FileHandle &fileHandle, const RecordCodec &codec,
+			const void *data, RID &rid);
+	char* fetchFixedPage(FileHandle &fileHandle, const RID &rid);
+	RC deleteFixedRecord(FileHandle &fileHandle, const RID &rid);
+	RC updateFixedRecord(FileHandle &fileHandle, const RecordCodec &codec,
+			const void *data, const RID &rid);
+	RC reorganizeFixedFile(FileHandle &fileHandle,
+			vector<pair<RID, RID> > &ridMap);
+	static bool paxLayout(FileHandle &fileHandle);
+	RC insertPaxRecord(FileHandle &fileHandle, const RecordCodec &codec,
+			const void *data, RID &rid, bool moved);
+	char* fetchPaxPage(FileHandle &fileHandle, const RID &rid);
+	char* fetchPaxRecord(FileHandle &fileHandle, const RID &rid,
+			PageNum &pageNum, int &slot);
+	RC erasePaxRecord(FileHandle &fileHandle, PageNum pageNum, int slot);
+	RC deletePaxRecord(FileHandle &fileHandle, const RID &rid);
+	RC updatePaxRecord(FileHandle &fileHandle,
+			const vector<Attribute> &recordDescriptor, const RecordCodec &codec,
+			const void *data, const RID &rid);
+	RC reorganizePaxFile(FileHandle &fileHandle,
+			vector<pair<RID, RID> > &ridMap);
+	void replaceRecord(FileHandle &fileHandle, char *pageBuffer, int slotNum,
+			const char *recordBuffer, short recordSize);
+	void freeSlot(char *pageBuffer, int slotNum);
+	void initializePage(char *pageBuffer);
+	const char* fetchRecord(FileHandle &fileHandle, const RID &rid,
+			PageNum &pageNum, short &recordLength);
+	RC removeRecord(FileHandle &fileHandle, const RID &rid);
+	RC addPageFreeSpace(FileHandle &fileHandle, PageNum pageNum,
+			int freeSpace);
+	RC finishBatchPage(FileHandle &fileHandle, char *page, bool newPage,
+			int pageNum, short pageFreeSpace);
+	int bulkInsert(FileHandle &fileHandle, const RecordCodec &codec,
+			char *page, bool newPage, const void *data, short &freeSpace,
+			short &recordSpace);
+	RC writeBulkPages(FileHandle &fileHandle, const char *pages,
+			const vector<short> &freeSpace, bool skipFreeSpace);
 
 };
 
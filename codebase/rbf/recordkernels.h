@@ -0,0 +1,47 @@
+#ifndef _recordkernels_h_
+#define _recordkernels_h_
+
+using namespace std;
+
+// Slack the output arrays of the kernels need after their last element: the
+// vector versions write whole vectors
+#define KERNEL_SLACK 16
+
+// Instruction sets the kernels can use. The default one (see defaultKernelLevel)
+// is picked at startup.
+typedef enum {
+	ScalarKernels = 0, SSE42Kernels, AVX2Kernels
+} KernelLevel;
+
+KernelLevel detectKernelLevel(); // best level supported by the processor
+KernelLevel defaultKernelLevel(); // fastest level supported by the processor
+KernelLevel getKernelLevel();
+void setKernelLevel(KernelLevel level); // capped to the supported level
+
+/*
+ * Write to indexes the positions of the non-null fields, given the null bits of
+ * a record of attrNum fields (most significant bit first, as in the record
+ * formats), and return how many there are. indexes needs room for attrNum +
+ * KERNEL_SLACK elements.
+ */
+int nonNullFields(const unsigned char *nullbits, int attrNum, short *indexes);
+
+/*
+ * offsets[i] = base + lengths[0] + ... + lengths[i - 1], for i < count; the
+ * offsets of the fields of a record from their lengths, which must add up to
+ * less than a page. offsets needs room for count + KERNEL_SLACK elements.
+ */
+void fieldOffsets(const short *lengths, int count, short base, short *offsets);
+
+/*
+ * Compare the count values of a column with value: bit i of less (least
+ * significant bit first) is set if values[i] < value, and bit i of equal if
+ * neither is smaller than the other, as RecordBasedFileManager::compareField
+ * does. less and equal need room for (count + 7) / 8 + KERNEL_SLACK bytes.
+ */
+void compareInts(const int *values, int count, int value, unsigned char *less,
+		unsigned char *equal);
+void compareReals(const float *values, int count, float value,
+		unsigned char *less, unsigned char *equal);
+
+#endif
@@ -3,13 +3,18 @@
 #include <string>
 #include <cassert>
 #include <sys/stat.h>
+#include <unistd.h>
 #include <stdlib.h> 
 #include <string.h>
 #include <stdexcept>
 #include <stdio.h> 
+#include <mutex>
+#include <set>
 
 #include "pfm.h"
+#include "bpm.h"
 #include "rbfm.h"
+#include "recordkernels.h"
 #include "test_util.h"
 
 using namespace std;
@@ -105,15 +110,2199 @@ int RBFTest_12(RecordBasedFileManager *rbfm) {
 	return 0;
 }
 
+int RBFTest_13(RecordBasedFileManager *rbfm) {
+	// Functions tested
+	// 1. Create Record-Based File
+	// 2. Insert Multiple Records
+	// 3. Scan with a condition and a projection
+	// 4. Destroy Record-Based File
+	cout << endl << "***** In RBF Test Case 13 *****" << endl;
+
+	RC rc;
+	string fileName = "test13";
+
+	// Create and open the file "test13"
+	rc = rbfm->createFile(fileName);
+	assert(rc == success && "Creating the file should not fail.");
+
+	FileHandle fileHandle;
+	rc = rbfm->openFile(fileName, fileHandle);
+	assert(rc == success && "Opening the file should not fail.");
+
+	vector<Attribute> recordDescriptor;
+	createRecordDescriptor(recordDescriptor);
+
+	void *record = malloc(100);
+	void *returnedData = malloc(100);
+	int numRecords = 2000;
+	int recordSize = 0;
+	RID rid;
+
+	unsigned char nullsIndicator = 0;
+	unsigned char nullsIndicatorWithNull = 0x40; // the age is null
+
+	// Insert records with age = i % 100 (every tenth record has a null age)
+	for (int i = 0; i < numRecords; i++) {
+		string name = "Employee" + string(1, 'A' + i % 26);
+		prepareRecord(recordDescriptor.size(),
+				i % 10 == 0 ? &nullsIndicatorWithNull : &nullsIndicator,
+				name.size(), name, i % 100, 170.5, i, record, &recordSize);
+		rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+		assert(rc == success && "Inserting a record should not fail.");
+	}
+
+	// Scan the records with age > 90, projecting the salary and the age
+	vector<string> attributeNames;
+	attributeNames.push_back("Salary");
+	attributeNames.push_back("Age");
+	int ageLimit = 90;
+
+	RBFM_ScanIterator rbfmScanIterator;
+	rc = rbfm->scan(fileHandle, recordDescriptor, "Age", GT_OP, &ageLimit,
+			attributeNames, rbfmScanIterator);
+	assert(rc == success && "Scanning the file should not fail.");
+
+	int count = 0;
+	while (rbfmScanIterator.getNextRecord(rid, returnedData) != RBFM_EOF) {
+		int salary;
+		int age;
+		memcpy(&salary, (char *) returnedData + 1, sizeof(int));
+		memcpy(&age, (char *) returnedData + 1 + sizeof(int), sizeof(int));
+		if (*(unsigned char *) returnedData != 0 || age <= ageLimit
+				|| age != salary % 100) {
+			cout << "Test Case 13 Failed!" << endl << endl;
+			rbfmScanIterator.close();
+			rbfm->closeFile(fileHandle);
+			free(record);
+			free(returnedData);
+			return -1;
+		}
+		count++;
+	}
+	rbfmScanIterator.close();
+
+	// ages 91..99 appear numRecords / 100 times each
+	assert(count == 9 * numRecords / 100 && "The scan should return all the matching records.");
+
+	rc = rbfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+
+	rc = rbfm->destroyFile(fileName);
+	assert(rc == success && "Destroying the file should not fail.");
+
+	free(record);
+	free(returnedData);
+
+	cout << "[PASS] Test Case 13 Passed!" << endl << endl;
+
+	return 0;
+}
+
+int RBFTest_14(RecordBasedFileManager *rbfm) {
+	// Functions tested
+	// 1. Create Record-Based File
+	// 2. Insert Multiple Records in batches
+	// 3. Close and reopen Record-Based File
+	// 4. Read Multiple Records
+	// 5. Destroy Record-Based File
+	cout << endl << "***** In RBF Test Case 14 *****" << endl;
+
+	RC rc;
+	string fileName = "test14";
+
+	// Create and open the file "test14"
+	rc = rbfm->createFile(fileName);
+	assert(rc == success && "Creating the file should not fail.");
+
+	FileHandle fileHandle;
+	rc = rbfm->openFile(fileName, fileHandle);
+	assert(rc == success && "Opening the file should not fail.");
+
+	vector<Attribute> recordDescriptor;
+	createRecordDescriptor(recordDescriptor);
+
+	int numRecords = 5000;
+	int batchSize = 1000;
+	int recordSize = 0;
+	unsigned char nullsIndicator = 0;
+	char *records = (char *) malloc(numRecords * 100);
+	void *returnedData = malloc(100);
+	vector<int> sizes;
+
+	// Insert the records in batches, with names of different lengths
+	vector<RID> rids;
+	for (int i = 0; i < numRecords; i += batchSize) {
+		vector<const void *> batch;
+		for (int j = i; j < i + batchSize; j++) {
+			string name(1 + j % 30, 'a' + j % 26);
+			prepareRecord(recordDescriptor.size(), &nullsIndicator, name.size(),
+					name, j % 100, 160.5 + j % 40, j, records + j * 100,
+					&recordSize);
+			sizes.push_back(recordSize);
+			batch.push_back(records + j * 100);
+		}
+		vector<RID> batchRids;
+		rc = rbfm->insertRecords(fileHandle, recordDescriptor, batch,
+				batchRids);
+		assert(rc == success && "Inserting a batch of records should not fail.");
+		rids.insert(rids.end(), batchRids.begin(), batchRids.end());
+	}
+
+	rc = rbfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+
+	rc = rbfm->openFile(fileName, fileHandle);
+	assert(rc == success && "Opening the file should not fail.");
+
+	// Read the records back
+	for (int i = 0; i < numRecords; i++) {
+		rc = rbfm->readRecord(fileHandle, recordDescriptor, rids[i],
+				returnedData);
+		assert(rc == success && "Reading a record should not fail.");
+
+		if (memcmp(returnedData, records + i * 100, sizes[i]) != 0) {
+			cout << "Test Case 14 Failed!" << endl << endl;
+			rbfm->closeFile(fileHandle);
+			free(records);
+			free(returnedData);
+			return -1;
+		}
+	}
+
+	rc = rbfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+
+	rc = rbfm->destroyFile(fileName);
+	assert(rc == success && "Destroying the file should not fail.");
+
+	free(records);
+	free(returnedData);
+
+	cout << "[PASS] Test Case 14 Passed!" << endl << endl;
+
+	return 0;
+}
+
+int RBFTest_15(RecordBasedFileManager *rbfm) {
+	// Functions tested
+	// 1. Create Record-Based File
+	// 2. Insert Multiple Records
+	// 3. Update records so that they have to move to other pages, and back
+	// 4. Delete Multiple Records
+	// 5. Read and Scan the remaining records
+	// 6. Destroy Record-Based File
+	cout << endl << "***** In RBF Test Case 15 *****" << endl;
+
+	RC rc;
+	string fileName = "test15";
+
+	// Create and open the file "test15"
+	rc = rbfm->createFile(fileName);
+	assert(rc == success && "Creating the file should not fail.");
+
+	FileHandle fileHandle;
+	rc = rbfm->openFile(fileName, fileHandle);
+	assert(rc == success && "Opening the file should not fail.");
+
+	vector<Attribute> recordDescriptor;
+	createLargeRecordDescriptor(recordDescriptor);
+
+	int numRecords = 1000;
+	int nullsSize = getActualByteForNullsIndicator(recordDescriptor.size());
+	unsigned char *nullsIndicator = (unsigned char *) calloc(nullsSize, 1);
+	void *record = malloc(1000);
+	void *returnedData = malloc(1000);
+	int size = 0;
+	vector<RID> rids(numRecords);
+
+	// Insert small records (their index is a multiple of 50)
+	for (int i = 0; i < numRecords; i++) {
+		prepareLargeRecord(recordDescriptor.size(), nullsIndicator, i * 50,
+				record, &size);
+		rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rids[i]);
+		assert(rc == success && "Inserting a record should not fail.");
+	}
+
+	// Grow a third of the records (their pages are full, so most of them move)
+	// and delete another third
+	for (int i = 0; i < numRecords; i++) {
+		if (i % 3 == 0) {
+			prepareLargeRecord(recordDescriptor.size(), nullsIndicator,
+					i * 50 + 49, record, &size);
+			rc = rbfm->updateRecord(fileHandle, recordDescriptor, record,
+					rids[i]);
+			assert(rc == success && "Updating a record should not fail.");
+		} else if (i % 3 == 1) {
+			rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rids[i]);
+			assert(rc == success && "Deleting a record should not fail.");
+		}
+	}
+
+	// Shrink half of the grown records back
+	for (int i = 0; i < numRecords; i += 6) {
+		prepareLargeRecord(recordDescriptor.size(), nullsIndicator, i * 50,
+				record, &size);
+		rc = rbfm->updateRecord(fileHandle, recordDescriptor, record, rids[i]);
+		assert(rc == success && "Updating a record should not fail.");
+	}
+
+	// Read the remaining records through their original rids
+	for (int i = 0; i < numRecords; i++) {
+		if (i % 3 == 1)
+			continue;
+		int index = (i % 3 == 0 && i % 6 != 0) ? i * 50 + 49 : i * 50;
+		prepareLargeRecord(recordDescriptor.size(), nullsIndicator, index,
+				record, &size);
+		rc = rbfm->readRecord(fileHandle, recordDescriptor, rids[i],
+				returnedData);
+		assert(rc == success && "Reading a record should not fail.");
+
+		if (memcmp(returnedData, record, size) != 0) {
+			cout << "Test Case 15 Failed!" << endl << endl;
+			rbfm->closeFile(fileHandle);
+			free(record);
+			free(returnedData);
+			free(nullsIndicator);
+			return -1;
+		}
+	}
+
+	// The scan returns every remaining record once, with its original rid
+	vector<string> attributeNames;
+	attributeNames.push_back("attr1");
+	RBFM_ScanIterator rbfmScanIterator;
+	rc = rbfm->scan(fileHandle, recordDescriptor, "", NO_OP, NULL,
+			attributeNames, rbfmScanIterator);
+	assert(rc == success && "Scanning the file should not fail.");
+
+	int count = 0;
+	RID rid;
+	while (rbfmScanIterator.getNextRecord(rid, returnedData) != RBFM_EOF) {
+		int index;
+		memcpy(&index, (char *) returnedData + 1, sizeof(int));
+		int i = index / 50;
+		assert(i % 3 != 1 && rids[i].pageNum == rid.pageNum
+				&& rids[i].slotNum == rid.slotNum
+				&& "The scan should return the records with their rids.");
+		count++;
+	}
+	rbfmScanIterator.close();
+	assert(count == numRecords - (numRecords + 1) / 3 && "The scan should return all the remaining records.");
+
+	rc = rbfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+
+	rc = rbfm->destroyFile(fileName);
+	assert(rc == success && "Destroying the file should not fail.");
+
+	free(record);
+	free(returnedData);
+	free(nullsIndicator);
+
+	cout << "[PASS] Test Case 15 Passed!" << endl << endl;
+
+	return 0;
+}
+
+int RBFTest_16(RecordBasedFileManager *rbfm) {
+	// Functions tested
+	// 1. Create Record-Based File
+	// 2. Insert Multiple Records
+	// 3. Delete and grow records, leaving holes and forwarding stubs
+	// 4. Compact the file online and read the records through the same rids
+	// 5. Reorganize the file and read the records through the new rids
+	// 6. Destroy Record-Based File
+	cout << endl << "***** In RBF Test Case 16 *****" << endl;
+
+	RC rc;
+	string fileName = "test16";
+
+	// Create and open the file "test16"
+	rc = rbfm->createFile(fileName);
+	assert(rc == success && "Creating the file should not fail.");
+
+	FileHandle fileHandle;
+	rc = rbfm->openFile(fileName, fileHandle);
+	assert(rc == success && "Opening the file should not fail.");
+
+	vector<Attribute> recordDescriptor;
+	createLargeRecordDescriptor(recordDescriptor);
+
+	int numRecords = 1000;
+	int nullsSize = getActualByteForNullsIndicator(recordDescriptor.size());
+	unsigned char *nullsIndicator = (unsigned char *) calloc(nullsSize, 1);
+	void *record = malloc(1000);
+	void *returnedData = malloc(1000);
+	int size = 0;
+	vector<RID> rids(numRecords);
+
+	for (int i = 0; i < numRecords; i++) {
+		prepareLargeRecord(recordDescriptor.size(), nullsIndicator, i * 50,
+				record, &size);
+		rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rids[i]);
+		assert(rc == success && "Inserting a record should not fail.");
+	}
+
+	// Delete two thirds of the records and grow some of the others
+	for (int i = 0; i < numRecords; i++) {
+		if (i % 3 != 0) {
+			rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rids[i]);
+			assert(rc == success && "Deleting a record should not fail.");
+		} else if (i % 9 == 0) {
+			prepareLargeRecord(recordDescriptor.size(), nullsIndicator,
+					i * 50 + 49, record, &size);
+			rc = rbfm->updateRecord(fileHandle, recordDescriptor, record,
+					rids[i]);
+			assert(rc == success && "Updating a record should not fail.");
+		}
+	}
+
+	unsigned pagesBefore = fileHandle.getNumberOfPages();
+
+	// The online compaction keeps the rids
+	rc = rbfm->compactFile(fileHandle);
+	assert(rc == success && "Compacting the file should not fail.");
+
+	for (int i = 0; i < numRecords; i += 3) {
+		prepareLargeRecord(recordDescriptor.size(), nullsIndicator,
+				i % 9 == 0 ? i * 50 + 49 : i * 50, record, &size);
+		rc = rbfm->readRecord(fileHandle, recordDescriptor, rids[i],
+				returnedData);
+		assert(rc == success && "Reading a record should not fail.");
+		assert(memcmp(returnedData, record, size) == 0 && "The compacted records should not change.");
+	}
+
+	// The offline reorganization moves the records and shrinks the file
+	vector<pair<RID, RID> > ridMap;
+	rc = rbfm->reorganizeFile(fileHandle, ridMap);
+	assert(rc == success && "Reorganizing the file should not fail.");
+	assert(fileHandle.getNumberOfPages() < pagesBefore && "The file should have less pages.");
+
+	for (unsigned j = 0; j < ridMap.size(); j++) {
+		for (int i = 0; i < numRecords; i += 3) {
+			if (rids[i].pageNum == ridMap[j].first.pageNum
+					&& rids[i].slotNum == ridMap[j].first.slotNum) {
+				rids[i] = ridMap[j].second;
+				break;
+			}
+		}
+	}
+
+	for (int i = 0; i < numRecords; i += 3) {
+		prepareLargeRecord(recordDescriptor.size(), nullsIndicator,
+				i % 9 == 0 ? i * 50 + 49 : i * 50, record, &size);
+		rc = rbfm->readRecord(fileHandle, recordDescriptor, rids[i],
+				returnedData);
+		assert(rc == success && "Reading a record should not fail.");
+
+		if (memcmp(returnedData, record, size) != 0) {
+			cout << "Test Case 16 Failed!" << endl << endl;
+			rbfm->closeFile(fileHandle);
+			free(record);
+			free(returnedData);
+			free(nullsIndicator);
+			return -1;
+		}
+	}
+
+	rc = rbfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+
+	rc = rbfm->destroyFile(fileName);
+	assert(rc == success && "Destroying the file should not fail.");
+
+	free(record);
+	free(returnedData);
+	free(nullsIndicator);
+
+	cout << "[PASS] Test Case 16 Passed!" << endl << endl;
+
+	return 0;
+}
+
+// Numeric record: id (int), a (real), b (int, null when id % 4 == 1), c (real)
+static void prepareNumericRecord(int id, float a, char *buffer, int *size) {
+	int offset = 1;
+	buffer[0] = (id % 4 == 1) ? 1 << 5 : 0;
+	memcpy(buffer + offset, &id, sizeof(int));
+	offset += sizeof(int);
+	memcpy(buffer + offset, &a, sizeof(float));
+	offset += sizeof(float);
+	if (id % 4 != 1) {
+		int b = id * 2;
+		memcpy(buffer + offset, &b, sizeof(int));
+		offset += sizeof(int);
+	}
+	float c = id / 2.0f;
+	memcpy(buffer + offset, &c, sizeof(float));
+	offset += sizeof(float);
+	*size = offset;
+}
+
+int RBFTest_17(RecordBasedFileManager *rbfm) {
+	// Functions tested
+	// 1. Create Record-Based Files with the fixed and the slotted layouts
+	// 2. Insert the same numeric records in both
+	// 3. Update and delete records of the fixed layout file
+	// 4. Read and scan the remaining records
+	// 5. Destroy Record-Based Files
+	cout << endl << "***** In RBF Test Case 17 *****" << endl;
+
+	RC rc;
+	string fileName = "test17";
+	string slottedFileName = "test17_slotted";
+
+	rc = rbfm->createFile(fileName, FixedLayout);
+	assert(rc == success && "Creating the file should not fail.");
+	rc = rbfm->createFile(slottedFileName);
+	assert(rc == success && "Creating the file should not fail.");
+
+	FileHandle fileHandle;
+	FileHandle slottedFileHandle;
+	rc = rbfm->openFile(fileName, fileHandle);
+	assert(rc == success && "Opening the file should not fail.");
+	rc = rbfm->openFile(slottedFileName, slottedFileHandle);
+	assert(rc == success && "Opening the file should not fail.");
+
+	vector<Attribute> recordDescriptor;
+	Attribute attr;
+	const char *names[] = { "id", "a", "b", "c" };
+	for (int i = 0; i < 4; i++) {
+		attr.name = names[i];
+		attr.type = (i % 2 == 0) ? TypeInt : TypeReal;
+		attr.length = 4;
+		recordDescriptor.push_back(attr);
+	}
+
+	int numRecords = 2000;
+	char record[100];
+	char returnedData[100];
+	int size = 0;
+	vector<RID> rids(numRecords);
+	RID rid;
+
+	for (int i = 0; i < numRecords; i++) {
+		prepareNumericRecord(i, i + 0.5f, record, &size);
+		rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rids[i]);
+		assert(rc == success && "Inserting a record should not fail.");
+		rc = rbfm->insertRecord(slottedFileHandle, recordDescriptor, record,
+				rid);
+		assert(rc == success && "Inserting a record should not fail.");
+	}
+
+	// The fixed layout takes less pages
+	assert(fileHandle.getNumberOfPages() * 3 < slottedFileHandle.getNumberOfPages() * 2 && "The fixed layout should store more records per page.");
+
+	// Delete a third of the records and update another third
+	for (int i = 0; i < numRecords; i++) {
+		if (i % 3 == 0) {
+			rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rids[i]);
+			assert(rc == success && "Deleting a record should not fail.");
+		} else if (i % 3 == 1) {
+			prepareNumericRecord(i, -1.0f, record, &size);
+			rc = rbfm->updateRecord(fileHandle, recordDescriptor, record,
+					rids[i]);
+			assert(rc == success && "Updating a record should not fail.");
+		}
+	}
+
+	for (int i = 0; i < numRecords; i++) {
+		if (i % 3 == 0)
+			continue;
+		prepareNumericRecord(i, i % 3 == 1 ? -1.0f : i + 0.5f, record, &size);
+		rc = rbfm->readRecord(fileHandle, recordDescriptor, rids[i],
+				returnedData);
+		assert(rc == success && "Reading a record should not fail.");
+
+		if (memcmp(returnedData, record, size) != 0) {
+			cout << "Test Case 17 Failed!" << endl << endl;
+			rbfm->closeFile(fileHandle);
+			rbfm->closeFile(slottedFileHandle);
+			return -1;
+		}
+	}
+
+	// Scan the records whose b is at least 2000 (so id >= 1000, and b not null)
+	vector<string> attributeNames;
+	attributeNames.push_back("id");
+	int value = 2000;
+	RBFM_ScanIterator rbfmScanIterator;
+	rc = rbfm->scan(fileHandle, recordDescriptor, "b", GE_OP, &value,
+			attributeNames, rbfmScanIterator);
+	assert(rc == success && "Scanning the file should not fail.");
+
+	int count = 0;
+	while (rbfmScanIterator.getNextRecord(rid, returnedData) != RBFM_EOF) {
+		int id;
+		memcpy(&id, returnedData + 1, sizeof(int));
+		assert(id >= 1000 && id % 3 != 0 && id % 4 != 1 && rids[id].pageNum == rid.pageNum && rids[id].slotNum == rid.slotNum && "The scan should only return the matching records.");
+		count++;
+	}
+	rbfmScanIterator.close();
+
+	int expected = 0;
+	for (int i = 1000; i < numRecords; i++)
+		if (i % 3 != 0 && i % 4 != 1)
+			expected++;
+	assert(count == expected && "The scan should return all the matching records.");
+
+	rc = rbfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+	rc = rbfm->closeFile(slottedFileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+
+	rc = rbfm->destroyFile(fileName);
+	assert(rc == success && "Destroying the file should not fail.");
+	rc = rbfm->destroyFile(slottedFileName);
+	assert(rc == success && "Destroying the file should not fail.");
+
+	cout << "[PASS] Test Case 17 Passed!" << endl << endl;
+
+	return 0;
+}
+
+// Employee record of test 18: the name grows with grow, Height is null every
+// seventh record and Salary is the index of the record
+static void preparePaxRecord(int i, bool grow, void *buffer, int *size) {
+	unsigned char nullsIndicator = (i % 7 == 0) ? 1 << 5 : 0;
+	string name(grow ? 300 + i % 50 : 1 + i % 30, 'a' + i % 26);
+	prepareRecord(4, &nullsIndicator, name.size(), name, i % 100, i / 10.0f,
+			i, buffer, size);
+}
+
+int RBFTest_18(RecordBasedFileManager *rbfm) {
+	// Functions tested
+	// 1. Create Record-Based File with the PAX layout
+	// 2. Insert records with varchars and nulls
+	// 3. Grow (moving some of them to other pages), update and delete records
+	// 4. Read records and attributes, and scan with conditions on an int and a varchar
+	// 5. Reorganize the file and read the records through the new rids
+	// 6. Destroy Record-Based File
+	cout << endl << "***** In RBF Test Case 18 *****" << endl;
+
+	RC rc;
+	string fileName = "test18";
+
+	rc = rbfm->createFile(fileName, PaxLayout);
+	assert(rc == success && "Creating the file should not fail.");
+
+	FileHandle fileHandle;
+	rc = rbfm->openFile(fileName, fileHandle);
+	assert(rc == success && "Opening the file should not fail.");
+
+	vector<Attribute> recordDescriptor;
+	createRecordDescriptor(recordDescriptor);
+
+	int numRecords = 2000;
+	char record[PAGE_SIZE];
+	char returnedData[PAGE_SIZE];
+	int size = 0;
+	vector<RID> rids(numRecords);
+	RID rid;
+
+	for (int i = 0; i < numRecords; i++) {
+		preparePaxRecord(i, false, record, &size);
+		rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rids[i]);
+		assert(rc == success && "Inserting a record should not fail.");
+	}
+
+	// Delete a third of the records and grow a tenth of them
+	for (int i = 0; i < numRecords; i++) {
+		if (i % 3 == 0) {
+			rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rids[i]);
+			assert(rc == success && "Deleting a record should not fail.");
+		} else if (i % 10 == 1) {
+			preparePaxRecord(i, true, record, &size);
+			rc = rbfm->updateRecord(fileHandle, recordDescriptor, record,
+					rids[i]);
+			assert(rc == success && "Updating a record should not fail.");
+		}
+	}
+
+	for (int i = 0; i < numRecords; i++) {
+		if (i % 3 == 0)
+			continue;
+		preparePaxRecord(i, i % 10 == 1, record, &size);
+		rc = rbfm->readRecord(fileHandle, recordDescriptor, rids[i],
+				returnedData);
+		assert(rc == success && "Reading a record should not fail.");
+		assert(memcmp(returnedData, record, size) == 0 && "The records read should be the ones written.");
+
+		rc = rbfm->readAttribute(fileHandle, recordDescriptor, rids[i],
+				"Height", returnedData);
+		assert(rc == success && "Reading an attribute should not fail.");
+		assert((returnedData[0] != 0) == (i % 7 == 0) && "Height should only be null in every seventh record.");
+	}
+
+	// Scan the records whose Age is at least 90, and the ones with a given name
+	vector<string> attributeNames;
+	attributeNames.push_back("Salary");
+	int age = 90;
+	RBFM_ScanIterator rbfmScanIterator;
+	rc = rbfm->scan(fileHandle, recordDescriptor, "Age", GE_OP, &age,
+			attributeNames, rbfmScanIterator);
+	assert(rc == success && "Scanning the file should not fail.");
+
+	int count = 0;
+	while (rbfmScanIterator.getNextRecord(rid, returnedData) != RBFM_EOF) {
+		int salary;
+		memcpy(&salary, returnedData + 1, sizeof(int));
+		assert(salary % 100 >= 90 && salary % 3 != 0 && rids[salary].pageNum == rid.pageNum && rids[salary].slotNum == rid.slotNum && "The scan should only return the matching records.");
+		count++;
+	}
+	rbfmScanIterator.close();
+
+	int expected = 0;
+	for (int i = 0; i < numRecords; i++)
+		if (i % 100 >= 90 && i % 3 != 0)
+			expected++;
+	assert(count == expected && "The scan should return all the matching records.");
+
+	// The grown name of record 11 is also the one of every 650th record after it
+	string name(300 + 11 % 50, 'a' + 11 % 26);
+	int nameLength = name.size();
+	char value[sizeof(int) + 400];
+	memcpy(value, &nameLength, sizeof(int));
+	memcpy(value + sizeof(int), name.c_str(), nameLength);
+	rc = rbfm->scan(fileHandle, recordDescriptor, "EmpName", EQ_OP, value,
+			attributeNames, rbfmScanIterator);
+	assert(rc == success && "Scanning the file should not fail.");
+
+	count = 0;
+	while (rbfmScanIterator.getNextRecord(rid, returnedData) != RBFM_EOF) {
+		int salary;
+		memcpy(&salary, returnedData + 1, sizeof(int));
+		assert(salary % 650 == 11 && salary % 3 != 0 && "The scan should only return the records with this name.");
+		count++;
+	}
+	rbfmScanIterator.close();
+
+	expected = 0;
+	for (int i = 11; i < numRecords; i += 650)
+		if (i % 3 != 0)
+			expected++;
+	assert(count == expected && "The scan should return all the records with this name.");
+
+	// The moved records are packed with the others
+	vector<pair<RID, RID> > ridMap;
+	rc = rbfm->reorganizeFile(fileHandle, ridMap);
+	assert(rc == success && "Reorganizing the file should not fail.");
+
+	// A new rid may be the old one of another record, so each rid is mapped once
+	for (int i = 0; i < numRecords; i++) {
+		for (unsigned j = 0; j < ridMap.size(); j++) {
+			if (i % 3 != 0 && rids[i].pageNum == ridMap[j].first.pageNum
+					&& rids[i].slotNum == ridMap[j].first.slotNum) {
+				rids[i] = ridMap[j].second;
+				break;
+			}
+		}
+	}
+
+	for (int i = 0; i < numRecords; i++) {
+		if (i % 3 == 0)
+			continue;
+		preparePaxRecord(i, i % 10 == 1, record, &size);
+		rc = rbfm->readRecord(fileHandle, recordDescriptor, rids[i],
+				returnedData);
+		assert(rc == success && "Reading a record should not fail.");
+
+		if (memcmp(returnedData, record, size) != 0) {
+			cout << "Test Case 18 Failed!" << endl << endl;
+			rbfm->closeFile(fileHandle);
+			return -1;
+		}
+	}
+
+	rc = rbfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+
+	rc = rbfm->destroyFile(fileName);
+	assert(rc == success && "Destroying the file should not fail.");
+
+	cout << "[PASS] Test Case 18 Passed!" << endl << endl;
+
+	return 0;
+}
+
+// Count the records of a scan of the salaries from minSalary on, checking them,
+// and return the number of pages it skipped
+static unsigned scanSalariesFrom(RecordBasedFileManager *rbfm,
+		FileHandle &fileHandle, const vector<Attribute> &recordDescriptor,
+		int minSalary, int *count) {
+	vector<string> attributeNames;
+	attributeNames.push_back("Salary");
+	RBFM_ScanIterator rbfmScanIterator;
+	RC rc = rbfm->scan(fileHandle, recordDescriptor, "Salary", GE_OP,
+			&minSalary, attributeNames, rbfmScanIterator);
+	assert(rc == success && "Scanning the file should not fail.");
+
+	RID rid;
+	char returnedData[PAGE_SIZE];
+	*count = 0;
+	while (rbfmScanIterator.getNextRecord(rid, returnedData) != RBFM_EOF) {
+		int salary;
+		memcpy(&salary, returnedData + 1, sizeof(int));
+		assert(salary >= minSalary && "The scan should only return the matching records.");
+		(*count)++;
+	}
+	unsigned skippedPages = rbfmScanIterator.getSkippedPages();
+	rbfmScanIterator.close();
+	return skippedPages;
+}
+
+int RBFTest_19(RecordBasedFileManager *rbfm) {
+	// Functions tested
+	// 1. Create Record-Based File
+	// 2. Insert records in the order of their Salary, as in a time-ordered table
+	// 3. Scan a range of salaries, skipping the pages outside it
+	// 4. Close and open the file, keeping its zone map
+	// 5. Move a record with a new salary, delete records and rebuild the zone map
+	// 6. Destroy Record-Based File
+	cout << endl << "***** In RBF Test Case 19 *****" << endl;
+
+	RC rc;
+	string fileName = "test19";
+
+	rc = rbfm->createFile(fileName);
+	assert(rc == success && "Creating the file should not fail.");
+
+	FileHandle fileHandle;
+	rc = rbfm->openFile(fileName, fileHandle);
+	assert(rc == success && "Opening the file should not fail.");
+
+	vector<Attribute> recordDescriptor;
+	createRecordDescriptor(recordDescriptor);
+
+	int numRecords = 3000;
+	char record[PAGE_SIZE];
+	int size = 0;
+	vector<RID> rids(numRecords);
+
+	for (int i = 0; i < numRecords; i++) {
+		preparePaxRecord(i, false, record, &size);
+		rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rids[i]);
+		assert(rc == success && "Inserting a record should not fail.");
+	}
+
+	// Only the last pages have salaries from 2900 on
+	unsigned numPages = fileHandle.getNumberOfPages();
+	int count;
+	unsigned skippedPages = scanSalariesFrom(rbfm, fileHandle,
+			recordDescriptor, 2900, &count);
+	assert(count == 100 && "The scan should return all the matching records.");
+	assert(skippedPages + 3 >= numPages && "The scan should skip the pages before the range.");
+
+	// The zone map is kept while the file is closed
+	rc = rbfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+	rc = rbfm->openFile(fileName, fileHandle);
+	assert(rc == success && "Opening the file should not fail.");
+	assert(scanSalariesFrom(rbfm, fileHandle, recordDescriptor, 2900, &count) == skippedPages && count == 100 && "The zone map should be the same after opening the file again.");
+
+	// Record 5 grows out of its page with a salary in the range
+	unsigned char nullsIndicator = 0;
+	string name(1000, 'z');
+	prepareRecord(4, &nullsIndicator, name.size(), name, 5, 0.5f, 5000, record,
+			&size);
+	rc = rbfm->updateRecord(fileHandle, recordDescriptor, record, rids[5]);
+	assert(rc == success && "Updating a record should not fail.");
+	scanSalariesFrom(rbfm, fileHandle, recordDescriptor, 2900, &count);
+	assert(count == 101 && "The scan should return the updated record.");
+
+	// Deleting the records leaves the bounds as they were, until they are rebuilt
+	for (int i = 2900; i < numRecords; i++) {
+		rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rids[i]);
+		assert(rc == success && "Deleting a record should not fail.");
+	}
+	assert(scanSalariesFrom(rbfm, fileHandle, recordDescriptor, 2900, &count) < numPages - 2 && count == 1);
+
+	rc = rbfm->rebuildZoneMap(fileHandle, recordDescriptor);
+	assert(rc == success && "Rebuilding the zone map should not fail.");
+	assert(scanSalariesFrom(rbfm, fileHandle, recordDescriptor, 2900, &count) + 2 >= numPages && count == 1 && "Only the pages of record 5 should be read.");
+
+	rc = rbfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+
+	rc = rbfm->destroyFile(fileName);
+	assert(rc == success && "Destroying the file should not fail.");
+
+	cout << "[PASS] Test Case 19 Passed!" << endl << endl;
+
+	return 0;
+}
+
+// Salaries returned by a parallel scan, each at most once
+struct SalariesSeen {
+	mutex seenMutex;
+	vector<int> seen;
+	int batches;
+};
+
+static void collectSalaries(int /*worker*/, const ScanBatch &batch, void *context) {
+	SalariesSeen *salaries = (SalariesSeen*) context;
+	lock_guard<mutex> lock(salaries->seenMutex);
+	salaries->batches++;
+	for (unsigned i = 0; i < batch.rids.size(); i++) {
+		int salary;
+		memcpy(&salary, &batch.data[batch.offsets[i]] + 1, sizeof(int));
+		assert(salary >= 0 && salary < (int) salaries->seen.size() && "The scan should return the salary of the record.");
+		salaries->seen[salary]++;
+	}
+}
+
+int RBFTest_20(RecordBasedFileManager *rbfm) {
+	// Functions tested
+	// 1. Create Record-Based File
+	// 2. Insert records, some of which move to other pages
+	// 3. Scan the file with several threads, in both layouts that move records
+	// 4. Destroy Record-Based File
+	cout << endl << "***** In RBF Test Case 20 *****" << endl;
+
+	PageLayout layouts[] = { SlottedLayout, PaxLayout };
+	for (int l = 0; l < 2; l++) {
+		RC rc;
+		string fileName = "test20";
+
+		rc = rbfm->createFile(fileName, layouts[l]);
+		assert(rc == success && "Creating the file should not fail.");
+
+		FileHandle fileHandle;
+		rc = rbfm->openFile(fileName, fileHandle);
+		assert(rc == success && "Opening the file should not fail.");
+
+		vector<Attribute> recordDescriptor;
+		createRecordDescriptor(recordDescriptor);
+
+		int numRecords = 5000;
+		char record[PAGE_SIZE];
+		int size = 0;
+		vector<RID> rids(numRecords);
+
+		for (int i = 0; i < numRecords; i++) {
+			preparePaxRecord(i, false, record, &size);
+			rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rids[i]);
+			assert(rc == success && "Inserting a record should not fail.");
+		}
+		// every tenth record grows out of its page
+		for (int i = 0; i < numRecords; i += 10) {
+			preparePaxRecord(i, true, record, &size);
+			rc = rbfm->updateRecord(fileHandle, recordDescriptor, record, rids[i]);
+			assert(rc == success && "Updating a record should not fail.");
+		}
+
+		vector<string> attributeNames;
+		attributeNames.push_back("Salary");
+		int minSalary = 1000;
+		SalariesSeen salaries;
+		salaries.seen.assign(numRecords, 0);
+		salaries.batches = 0;
+		rc = rbfm->parallelScan(fileHandle, recordDescriptor, "Salary", GE_OP,
+				&minSalary, attributeNames, 4, collectSalaries, &salaries);
+		assert(rc == success && "Scanning the file in parallel should not fail.");
+		for (int i = 0; i < numRecords; i++)
+			assert(salaries.seen[i] == (i >= minSalary ? 1 : 0) && "The scan should return each matching record once.");
+		assert(salaries.batches > 1 && "The records should come in several batches.");
+
+		rc = rbfm->closeFile(fileHandle);
+		assert(rc == success && "Closing the file should not fail.");
+
+		rc = rbfm->destroyFile(fileName);
+		assert(rc == success && "Destroying the file should not fail.");
+	}
+
+	cout << "[PASS] Test Case 20 Passed!" << endl << endl;
+
+	return 0;
+}
+
+// Records of a bulk load, those of preparePaxRecord from next to count
+struct PaxRecordSource {
+	int next;
+	int count;
+};
+
+static bool nextPaxRecord(void *context, void *data) {
+	PaxRecordSource *source = (PaxRecordSource*) context;
+	if (source->next == source->count)
+		return false;
+	int size;
+	preparePaxRecord(source->next++, false, data, &size);
+	return true;
+}
+
+int RBFTest_21(RecordBasedFileManager *rbfm) {
+	// Functions tested
+	// 1. Create Record-Based File
+	// 2. Bulk load records, over several batches of pages
+	// 3. Scan the records, in the order they were loaded
+	// 4. Insert a record into the loaded file
+	// 5. Bulk load a new file without free space, and fail to do so on a full one
+	// 6. Destroy Record-Based File
+	cout << endl << "***** In RBF Test Case 21 *****" << endl;
+
+	PageLayout layouts[] = { SlottedLayout, PaxLayout };
+	for (int l = 0; l < 2; l++) {
+		RC rc;
+		string fileName = "test21";
+
+		rc = rbfm->createFile(fileName, layouts[l]);
+		assert(rc == success && "Creating the file should not fail.");
+
+		FileHandle fileHandle;
+		rc = rbfm->openFile(fileName, fileHandle);
+		assert(rc == success && "Opening the file should not fail.");
+
+		vector<Attribute> recordDescriptor;
+		createRecordDescriptor(recordDescriptor);
+
+		int numRecords = 60000;
+		PaxRecordSource source = { 0, numRecords };
+		rc = rbfm->bulkLoad(fileHandle, recordDescriptor, nextPaxRecord, &source);
+		assert(rc == success && "Bulk loading the file should not fail.");
+		unsigned numPages = fileHandle.getNumberOfPages();
+		assert(numPages > BULK_LOAD_PAGES && "The records should take several batches of pages.");
+		for (unsigned p = 0; p + 1 < numPages; p++)
+			assert(fileHandle.getPageFreeSpace(p) < 100 && "The pages should be full.");
+
+		vector<string> attributeNames;
+		for (unsigned i = 0; i < recordDescriptor.size(); i++)
+			attributeNames.push_back(recordDescriptor[i].name);
+		RBFM_ScanIterator rbfmScanIterator;
+		rc = rbfm->scan(fileHandle, recordDescriptor, "", NO_OP, NULL,
+				attributeNames, rbfmScanIterator);
+		assert(rc == success && "Scanning the file should not fail.");
+		RID rid;
+		char record[PAGE_SIZE];
+		char returnedData[PAGE_SIZE];
+		int size = 0;
+		int count = 0;
+		while (rbfmScanIterator.getNextRecord(rid, returnedData) != RBFM_EOF) {
+			preparePaxRecord(count++, false, record, &size);
+			assert(memcmp(record, returnedData, size) == 0 && "The records should be scanned in the order they were loaded.");
+		}
+		rbfmScanIterator.close();
+		assert(count == numRecords && "The scan should return all the records.");
+		assert(scanSalariesFrom(rbfm, fileHandle, recordDescriptor, numRecords - 100, &count) + 3 >= numPages && count == 100 && "The zone map should have the loaded pages.");
+
+		// The last page still has room for a record
+		preparePaxRecord(numRecords, false, record, &size);
+		rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+		assert(rc == success && "Inserting a record should not fail.");
+		assert(rid.pageNum == numPages - 1 && "The record should go in the last page.");
+		rc = rbfm->readRecord(fileHandle, recordDescriptor, rid, returnedData);
+		assert(rc == success && memcmp(record, returnedData, size) == 0 && "Reading the record should not fail.");
+
+		source.next = 0;
+		rc = rbfm->bulkLoad(fileHandle, recordDescriptor, nextPaxRecord, &source, true);
+		assert(rc != success && "A file with records can't be loaded without free space.");
+
+		rc = rbfm->closeFile(fileHandle);
+		assert(rc == success && "Closing the file should not fail.");
+		rc = rbfm->destroyFile(fileName);
+		assert(rc == success && "Destroying the file should not fail.");
+
+		// Without free space, the pages of the load are left alone by inserts
+		rc = rbfm->createFile(fileName, layouts[l]);
+		assert(rc == success && "Creating the file should not fail.");
+		rc = rbfm->openFile(fileName, fileHandle);
+		assert(rc == success && "Opening the file should not fail.");
+
+		source.next = 0;
+		rc = rbfm->bulkLoad(fileHandle, recordDescriptor, nextPaxRecord, &source, true);
+		assert(rc == success && "Bulk loading the file should not fail.");
+		assert(fileHandle.getNumberOfPages() == numPages && "The records should take the same pages.");
+		rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+		assert(rc == success && "Inserting a record should not fail.");
+		assert(rid.pageNum == numPages && "The record should go in a new page.");
+
+		rc = rbfm->scan(fileHandle, recordDescriptor, "", NO_OP, NULL,
+				attributeNames, rbfmScanIterator);
+		assert(rc == success && "Scanning the file should not fail.");
+		count = 0;
+		while (rbfmScanIterator.getNextRecord(rid, returnedData) != RBFM_EOF)
+			count++;
+		rbfmScanIterator.close();
+		assert(count == numRecords + 1 && "The scan should return all the records.");
+
+		rc = rbfm->closeFile(fileHandle);
+		assert(rc == success && "Closing the file should not fail.");
+		rc = rbfm->destroyFile(fileName);
+		assert(rc == success && "Destroying the file should not fail.");
+	}
+
+	cout << "[PASS] Test Case 21 Passed!" << endl << endl;
+
+	return 0;
+}
+
+int RBFTest_22(RecordBasedFileManager *rbfm) {
+	// Functions tested
+	// 1. Create two Record-Based Files, one of them open twice
+	// 2. Insert small and large records, which fill pages of their own
+	// 3. Insert into both files in turns, through both handles of the first one
+	// 4. Read the records back
+	// 5. Destroy Record-Based Files
+	cout << endl << "***** In RBF Test Case 22 *****" << endl;
+
+	RC rc;
+	string fileNames[] = { "test22a", "test22b" };
+	FileHandle fileHandles[3];
+	for (int f = 0; f < 2; f++) {
+		rc = rbfm->createFile(fileNames[f]);
+		assert(rc == success && "Creating the file should not fail.");
+		rc = rbfm->openFile(fileNames[f], fileHandles[f]);
+		assert(rc == success && "Opening the file should not fail.");
+	}
+	rc = rbfm->openFile(fileNames[0], fileHandles[2]);
+	assert(rc == success && "Opening the file twice should not fail.");
+
+	vector<Attribute> recordDescriptor;
+	createRecordDescriptor(recordDescriptor);
+	char record[PAGE_SIZE];
+	char returnedData[PAGE_SIZE];
+	int size = 0;
+	unsigned char nullsIndicator = 0;
+	string largeName(1500, 'l');
+	RID smallRid, largeRid, rid;
+
+	// The large records move on to a new page, the small ones stay in theirs
+	preparePaxRecord(0, false, record, &size);
+	rc = rbfm->insertRecord(fileHandles[0], recordDescriptor, record, smallRid);
+	assert(rc == success && "Inserting a record should not fail.");
+	prepareRecord(4, &nullsIndicator, largeName.size(), largeName, 1, 1.0f, 1,
+			record, &size);
+	for (int i = 0; i < 3; i++) {
+		rc = rbfm->insertRecord(fileHandles[0], recordDescriptor, record, largeRid);
+		assert(rc == success && "Inserting a record should not fail.");
+	}
+	assert(largeRid.pageNum != smallRid.pageNum && "The third large record should need another page.");
+	preparePaxRecord(1, false, record, &size);
+	rc = rbfm->insertRecord(fileHandles[0], recordDescriptor, record, rid);
+	assert(rc == success && rid.pageNum == smallRid.pageNum && "A small record should go in the page of the small ones.");
+
+	// The other handle of the file goes on filling the same pages
+	prepareRecord(4, &nullsIndicator, largeName.size(), largeName, 1, 1.0f, 1,
+			record, &size);
+	rc = rbfm->insertRecord(fileHandles[2], recordDescriptor, record, rid);
+	assert(rc == success && rid.pageNum == largeRid.pageNum && "The handles of a file should share the pages they fill.");
+
+	// Records in turns into both files, and through both handles of the first one
+	int numRecords = 4000;
+	vector<RID> rids[2];
+	for (int i = 0; i < numRecords; i++) {
+		preparePaxRecord(i, false, record, &size);
+		for (int f = 0; f < 2; f++) {
+			rids[f].push_back(RID());
+			rc = rbfm->insertRecord(fileHandles[f == 0 ? 2 * (i % 2) : 1],
+					recordDescriptor, record, rids[f].back());
+			assert(rc == success && "Inserting a record should not fail.");
+		}
+	}
+	for (unsigned p = 0; p + 1 < fileHandles[1].getNumberOfPages(); p++)
+		assert(fileHandles[1].getPageFreeSpace(p) < 100 && "The pages of a file should be filled one after the other.");
+
+	for (int i = 0; i < numRecords; i++) {
+		preparePaxRecord(i, false, record, &size);
+		for (int f = 0; f < 2; f++) {
+			rc = rbfm->readRecord(fileHandles[f], recordDescriptor, rids[f][i],
+					returnedData);
+			assert(rc == success && memcmp(record, returnedData, size) == 0 && "Reading a record should not fail.");
+		}
+	}
+
+	for (int h = 0; h < 3; h++) {
+		rc = rbfm->closeFile(fileHandles[h]);
+		assert(rc == success && "Closing the file should not fail.");
+	}
+	for (int f = 0; f < 2; f++) {
+		rc = rbfm->destroyFile(fileNames[f]);
+		assert(rc == success && "Destroying the file should not fail.");
+	}
+
+	cout << "[PASS] Test Case 22 Passed!" << endl << endl;
+
+	return 0;
+}
+
+// Size of the file on disk
+static off_t fileSize(const string &fileName) {
+	struct stat stFileInfo;
+	assert(stat(fileName.c_str(), &stFileInfo) == 0 && "The file should exist.");
+	return stFileInfo.st_size;
+}
+
+int RBFTest_23(PagedFileManager *pfm) {
+	// Functions tested
+	// 1. Create Paged File
+	// 2. Append pages past a header page, the file growing by whole extents
+	// 3. Open the file again: its number of pages is not its size
+	// 4. Grow a file page by page, without extents
+	// 5. Destroy Paged Files
+	cout << endl << "***** In RBF Test Case 23 *****" << endl;
+
+	unsigned extentSizes[] = { DEFAULT_EXTENT_SIZE, 0 };
+	for (int e = 0; e < 2; e++) {
+		RC rc;
+		string fileName = "test23";
+		pfm->setExtentSize(extentSizes[e]);
+
+		rc = pfm->createFile(fileName);
+		assert(rc == success && "Creating the file should not fail.");
+
+		FileHandle fileHandle;
+		rc = pfm->openFile(fileName, fileHandle);
+		assert(rc == success && "Opening the file should not fail.");
+
+		// 3000 pages take a second header page
+		int numPages = 3000;
+		char data[PAGE_SIZE];
+		for (int i = 0; i < numPages; i++) {
+			memset(data, i % 128, PAGE_SIZE);
+			rc = fileHandle.appendPage(data);
+			assert(rc == success && "Appending a page should not fail.");
+			rc = fileHandle.setPageFreeSpace(i, i % 4000);
+			assert(rc == success && "Setting the free space of a page should not fail.");
+		}
+		off_t pagesSize = (off_t) (numPages + 2) * PAGE_SIZE;
+		if (extentSizes[e] == 0)
+			assert(fileSize(fileName) == pagesSize && "The file should grow page by page.");
+		else
+			assert(fileSize(fileName) >= pagesSize && fileSize(fileName) < pagesSize + DEFAULT_EXTENT_SIZE * PAGE_SIZE && "The file should grow by extents.");
+
+		rc = pfm->closeFile(fileHandle);
+		assert(rc == success && "Closing the file should not fail.");
+		rc = pfm->openFile(fileName, fileHandle);
+		assert(rc == success && "Opening the file should not fail.");
+
+		assert(fileHandle.getNumberOfPages() == (unsigned) numPages && "The number of pages should be kept apart from the size of the file.");
+		char buffer[PAGE_SIZE];
+		for (int i = 0; i < numPages; i++) {
+			memset(data, i % 128, PAGE_SIZE);
+			rc = fileHandle.readPage(i, buffer);
+			assert(rc == success && memcmp(data, buffer, PAGE_SIZE) == 0 && "Reading a page should not fail.");
+			assert(fileHandle.getPageFreeSpace(i) == i % 4000 && "The free space of the pages should be kept.");
+		}
+		rc = fileHandle.readPage(numPages, buffer);
+		assert(rc != success && "The pages of the extent past the last one should not be readable.");
+
+		rc = pfm->closeFile(fileHandle);
+		assert(rc == success && "Closing the file should not fail.");
+		rc = pfm->destroyFile(fileName);
+		assert(rc == success && "Destroying the file should not fail.");
+	}
+	pfm->setExtentSize(DEFAULT_EXTENT_SIZE);
+
+	cout << "[PASS] Test Case 23 Passed!" << endl << endl;
+
+	return 0;
+}
+
+// Record of the schema in the format of insertRecord: field i is null with
+// probability nullPercent, and the varchars have from 0 to 40 characters
+static void prepareRandomRecord(const vector<Attribute> &recordDescriptor,
+		int nullPercent, char *buffer, int *size) {
+	int nullsSize = getActualByteForNullsIndicator(recordDescriptor.size());
+	memset(buffer, 0, nullsSize);
+	int offset = nullsSize;
+	for (unsigned i = 0; i < recordDescriptor.size(); i++) {
+		if (rand() % 100 < nullPercent) {
+			buffer[i / 8] |= 1 << (7 - i % 8);
+			continue;
+		}
+		int value = rand();
+		if (recordDescriptor[i].type == TypeVarChar) {
+			int length = value % 41;
+			memcpy(buffer + offset, &length, sizeof(int));
+			memset(buffer + offset + sizeof(int), 'a' + value % 26, length);
+			offset += sizeof(int) + length;
+		} else {
+			memcpy(buffer + offset, &value, sizeof(int));
+			offset += sizeof(int);
+		}
+	}
+	*size = offset;
+}
+
+int RBFTest_24(RecordBasedFileManager *rbfm) {
+	// Functions tested
+	// 1. Encode records of narrow and wide schemas, with more or less null fields
+	// 2. Encode them again with each level of kernels the processor supports
+	// 3. Compare the stored records, which must be the same
+	cout << endl << "***** In RBF Test Case 24 *****" << endl;
+
+	vector<vector<Attribute> > recordDescriptors(3);
+	createRecordDescriptor(recordDescriptors[0]);
+	createLargeRecordDescriptor2(recordDescriptors[1]);
+	for (int i = 0; i < 100; i++) { // varchars placed irregularly
+		Attribute attr;
+		attr.name = "field" + to_string(i);
+		attr.type = i % 7 == 3 || i % 11 == 0 ? TypeVarChar : (AttrType) (i % 2);
+		attr.length = attr.type == TypeVarChar ? 40 : 4;
+		recordDescriptors[2].push_back(attr);
+	}
+
+	KernelLevel supported = detectKernelLevel();
+	KernelLevel previous = getKernelLevel();
+	assert(previous == defaultKernelLevel() && previous <= SSE42Kernels && "The kernels encoding the fastest should be used by default.");
+	int nullPercents[] = { 0, 10, 50, 90, 100 };
+	char record[PAGE_SIZE];
+	char scalarRecord[PAGE_SIZE];
+	char stored[PAGE_SIZE];
+	int size = 0;
+	srand(24);
+	for (unsigned d = 0; d < recordDescriptors.size(); d++) {
+		RecordCodec codec(recordDescriptors[d]);
+		for (int n = 0; n < 5; n++) {
+			for (int r = 0; r < 200; r++) {
+				prepareRandomRecord(recordDescriptors[d], nullPercents[n], record,
+						&size);
+				setKernelLevel(ScalarKernels);
+				short scalarSize = codec.encode(record, scalarRecord);
+				assert(scalarSize > 0 && scalarSize <= PAGE_SIZE && "Encoding a record should not fail.");
+
+				for (int level = SSE42Kernels; level <= supported; level++) {
+					setKernelLevel((KernelLevel) level);
+					short storedSize = codec.encode(record, stored);
+					assert(storedSize == scalarSize && memcmp(stored, scalarRecord, scalarSize) == 0 && "Every level of kernels should store the same record.");
+
+					// and the record reads back the same
+					char returnedData[PAGE_SIZE];
+					codec.decode(stored, returnedData);
+					assert(memcmp(record, returnedData, size) == 0 && "The stored record should decode to the record.");
+				}
+			}
+		}
+	}
+	setKernelLevel(previous);
+
+	// a record of the API goes through the same kernels
+	string fileName = "test24";
+	RC rc = rbfm->createFile(fileName);
+	assert(rc == success && "Creating the file should not fail.");
+	FileHandle fileHandle;
+	rc = rbfm->openFile(fileName, fileHandle);
+	assert(rc == success && "Opening the file should not fail.");
+	prepareRandomRecord(recordDescriptors[2], 50, record, &size);
+	RID rid;
+	rc = rbfm->insertRecord(fileHandle, recordDescriptors[2], record, rid);
+	assert(rc == success && "Inserting a record should not fail.");
+	char returnedData[PAGE_SIZE];
+	rc = rbfm->readRecord(fileHandle, recordDescriptors[2], rid, returnedData);
+	assert(rc == success && memcmp(record, returnedData, size) == 0 && "Reading a record should not fail.");
+	rc = rbfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+	rc = rbfm->destroyFile(fileName);
+	assert(rc == success && "Destroying the file should not fail.");
+
+	cout << "[PASS] Test Case 24 Passed!" << endl << endl;
+
+	return 0;
+}
+
+// Pages read from the file by a workload on a small pool: the records of a few
+// hot pages are read twice in each round, between which a window of the other
+// pages is read once; every hot record is then updated. Checks the records.
+static unsigned hotAndColdReads(RecordBasedFileManager *rbfm,
+		FileHandle &fileHandle, const vector<Attribute> &recordDescriptor,
+		const vector<RID> &rids, const vector<int> &firstOfPage, int numHot) {
+	char record[PAGE_SIZE];
+	char returnedData[PAGE_SIZE];
+	int size = 0;
+	unsigned readBefore, writeCount, appendCount, readAfter;
+	fileHandle.collectCounterValues(readBefore, writeCount, appendCount);
+
+	int numPages = firstOfPage.size();
+	int window = 64;
+	for (int round = 0; round < 20; round++) {
+		for (int pass = 0; pass < 2; pass++)
+			for (int h = 0; h < numHot; h++) {
+				int i = firstOfPage[h];
+				RC rc = rbfm->readRecord(fileHandle, recordDescriptor, rids[i],
+						returnedData);
+				preparePaxRecord(i, false, record, &size);
+				assert(rc == success && memcmp(record, returnedData, size) == 0 && "Reading a record should not fail.");
+			}
+		for (int c = 0; c < window; c++) {
+			int i = firstOfPage[numHot
+					+ (round * window + c) % (numPages - numHot)];
+			RC rc = rbfm->readRecord(fileHandle, recordDescriptor, rids[i],
+					returnedData);
+			preparePaxRecord(i, false, record, &size);
+			assert(rc == success && memcmp(record, returnedData, size) == 0 && "Reading a record should not fail.");
+		}
+	}
+	fileHandle.collectCounterValues(readAfter, writeCount, appendCount);
+	return readAfter - readBefore;
+}
+
+int RBFTest_25(RecordBasedFileManager *rbfm) {
+	// Functions tested
+	// 1. Create Record-Based File, larger than a small buffer pool
+	// 2. Read hot pages among a stream of cold ones, with CLOCK and with LRU-K
+	// 3. Update records, the dirty pages being evicted, and read them back
+	// 4. Fail to resize the pool or to fetch more pages than it has while pinned
+	// 5. Destroy Record-Based File
+	cout << endl << "***** In RBF Test Case 25 *****" << endl;
+
+	BufferManager *bpm = BufferManager::instance();
+	RC rc;
+	string fileName = "test25";
+	rc = rbfm->createFile(fileName);
+	assert(rc == success && "Creating the file should not fail.");
+	FileHandle fileHandle;
+	rc = rbfm->openFile(fileName, fileHandle);
+	assert(rc == success && "Opening the file should not fail.");
+
+	vector<Attribute> recordDescriptor;
+	createRecordDescriptor(recordDescriptor);
+	char record[PAGE_SIZE];
+	char returnedData[PAGE_SIZE];
+	int size = 0;
+	int numRecords = 30000;
+	vector<RID> rids(numRecords);
+	vector<int> firstOfPage; // first record of each page
+	for (int i = 0; i < numRecords; i++) {
+		preparePaxRecord(i, false, record, &size);
+		rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rids[i]);
+		assert(rc == success && "Inserting a record should not fail.");
+		if (rids[i].pageNum == firstOfPage.size())
+			firstOfPage.push_back(i);
+	}
+	assert(firstOfPage.size() > 200 && "The file should be larger than the pool.");
+
+	// The cold pages, read once, push the hot ones out of CLOCK but not out of LRU-K
+	int poolSize = 32;
+	int numHot = 16;
+	rc = bpm->setPoolSize(poolSize);
+	assert(rc == success && "Resizing the pool should not fail.");
+	unsigned clockReads = hotAndColdReads(rbfm, fileHandle, recordDescriptor,
+			rids, firstOfPage, numHot);
+	rc = bpm->setReplacementPolicy(new LRUKPolicy(poolSize));
+	assert(rc == success && "Changing the replacement policy should not fail.");
+	unsigned lruKReads = hotAndColdReads(rbfm, fileHandle, recordDescriptor,
+			rids, firstOfPage, numHot);
+	assert(lruKReads < clockReads && lruKReads <= (unsigned) (20 * 64 + numHot + 2) && "LRU-K should keep the hot pages.");
+
+	// Updated pages are written back when they are evicted
+	for (int i = 0; i < numRecords; i += 7) {
+		preparePaxRecord(i + 1, false, record, &size);
+		rc = rbfm->updateRecord(fileHandle, recordDescriptor, record, rids[i]);
+		assert(rc == success && "Updating a record should not fail.");
+	}
+	rc = rbfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+	rc = rbfm->openFile(fileName, fileHandle);
+	assert(rc == success && "Opening the file should not fail.");
+	for (int i = 0; i < numRecords; i++) {
+		preparePaxRecord(i % 7 == 0 ? i + 1 : i, false, record, &size);
+		rc = rbfm->readRecord(fileHandle, recordDescriptor, rids[i], returnedData);
+		assert(rc == success && memcmp(record, returnedData, size) == 0 && "The updated records should be read back.");
+	}
+
+	// Pinned pages are never evicted
+	vector<char*> pinned(poolSize);
+	for (int p = 0; p < poolSize; p++) {
+		rc = bpm->fetchPage(fileHandle, p, pinned[p]);
+		assert(rc == success && "Fetching a page should not fail.");
+	}
+	char *page;
+	assert(bpm->fetchPage(fileHandle, poolSize, page) != success && "No frame should be left for another page.");
+	assert(bpm->setPoolSize(DEFAULT_POOL_SIZE) != success && "The pool should not be resized with pinned pages.");
+	for (int p = 0; p < poolSize; p++) {
+		rc = bpm->unpinPage(fileHandle, p, false);
+		assert(rc == success && "Unpinning a page should not fail.");
+	}
+
+	rc = rbfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+	rc = bpm->setReplacementPolicy(new ClockPolicy(poolSize));
+	assert(rc == success && "Changing the replacement policy should not fail.");
+	rc = bpm->setPoolSize(DEFAULT_POOL_SIZE);
+	assert(rc == success && "Resizing the pool should not fail.");
+	rc = rbfm->destroyFile(fileName);
+	assert(rc == success && "Destroying the file should not fail.");
+
+	cout << "[PASS] Test Case 25 Passed!" << endl << endl;
+
+	return 0;
+}
+
+int RBFTest_26(PagedFileManager *pfm) {
+	// Functions tested
+	// 1. Create Paged File, with two header pages
+	// 2. Cut the file in the middle of its second header page, then of its first one
+	// 3. Fail to open it, the handle being left closed
+	// 4. Destroy Paged File
+	cout << endl << "***** In RBF Test Case 26 *****" << endl;
+
+	RC rc;
+	string fileName = "test26";
+
+	rc = pfm->createFile(fileName);
+	assert(rc == success && "Creating the file should not fail.");
+
+	FileHandle fileHandle;
+	rc = pfm->openFile(fileName, fileHandle);
+	assert(rc == success && "Opening the file should not fail.");
+	int numPages = 3000;
+	char data[PAGE_SIZE];
+	memset(data, 0, PAGE_SIZE);
+	for (int i = 0; i < numPages; i++) {
+		rc = fileHandle.appendPage(data);
+		assert(rc == success && "Appending a page should not fail.");
+	}
+	rc = pfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+
+	// The second header page follows the pages tracked by the first one
+	off_t cuts[] = { (off_t) 2045 * PAGE_SIZE + PAGE_SIZE / 2, 2 };
+	for (int c = 0; c < 2; c++) {
+		assert(truncate(fileName.c_str(), cuts[c]) == 0 && "Truncating the file should not fail.");
+		rc = pfm->openFile(fileName, fileHandle);
+		assert(rc != success && "A file whose header pages can't be read should not be opened.");
+		assert(!fileHandle.hasOpenFile() && "The handle should be left closed.");
+		rc = pfm->closeFile(fileHandle);
+		assert(rc != success && "Closing a handle that was not opened should fail.");
+	}
+
+	rc = pfm->destroyFile(fileName);
+	assert(rc == success && "Destroying the file should not fail.");
+
+	cout << "[PASS] Test Case 26 Passed!" << endl << endl;
+
+	return 0;
+}
+
+// Record i of test 27, which takes about half a page (a grown one doesn't fit
+// next to another record)
+static void prepareWideRecord(int i, bool grow, void *buffer, int *size) {
+	unsigned char nullsIndicator = (i % 9 == 0) ? 1 << 6 : 0;
+	string name(grow ? 2500 + i % 100 : 1800 + i % 100, 'a' + i % 26);
+	prepareRecord(4, &nullsIndicator, name.size(), name, i % 100, i / 10.0f,
+			i, buffer, size);
+}
+
+// Check every record of test 27 against what was inserted, updated or deleted
+static void checkWideRecords(RecordBasedFileManager *rbfm,
+		FileHandle &fileHandle, const vector<Attribute> &recordDescriptor,
+		const vector<RID> &rids, int grownModulo) {
+	char record[PAGE_SIZE];
+	char returnedData[PAGE_SIZE];
+	int size;
+	for (unsigned i = 0; i < rids.size(); i++) {
+		RC rc = rbfm->readRecord(fileHandle, recordDescriptor, rids[i],
+				returnedData);
+		if (i % 7 == 0) {
+			assert(rc != success && "A deleted record should not be read.");
+			continue;
+		}
+		prepareWideRecord(i, i % 10 < (unsigned) grownModulo, record, &size);
+		assert(rc == success && memcmp(record, returnedData, size) == 0 && "The records should be read back.");
+	}
+}
+
+int RBFTest_27(RecordBasedFileManager *rbfm) {
+	// Functions tested
+	// 1. Create Record-Based File and open it memory-mapped
+	// 2. Insert records until the file outgrows its first mapping
+	// 3. Read, update (moving records to other pages), delete and scan records
+	// 4. Close the file and compare the records through an unmapped handle
+	// 5. Update records through an unmapped handle while a mapped one is open
+	// 6. Destroy Record-Based File
+	cout << endl << "***** In RBF Test Case 27 *****" << endl;
+
+	RC rc;
+	string fileName = "test27";
+
+	rc = rbfm->createFile(fileName);
+	assert(rc == success && "Creating the file should not fail.");
+
+	FileHandle fileHandle;
+	rc = rbfm->openFile(fileName, fileHandle, true);
+	assert(rc == success && "Opening the file should not fail.");
+	assert(fileHandle.isMemoryMapped() && "The file should be memory-mapped.");
+
+	vector<Attribute> recordDescriptor;
+	createRecordDescriptor(recordDescriptor);
+
+	// Two records per page, past the size of the first mapping
+	int numRecords = 2 * (MIN_MAPPING_SIZE / PAGE_SIZE) + 2000;
+	vector<RID> rids(numRecords);
+	char record[PAGE_SIZE];
+	char returnedData[PAGE_SIZE];
+	int size;
+	for (int i = 0; i < numRecords; i++) {
+		prepareWideRecord(i, false, record, &size);
+		rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rids[i]);
+		assert(rc == success && "Inserting a record should not fail.");
+	}
+	assert(fileSize(fileName) > MIN_MAPPING_SIZE && "The file should outgrow its first mapping.");
+	assert(fileHandle.isMemoryMapped() && "The file should still be memory-mapped.");
+	for (int i = 0; i < numRecords; i++) {
+		prepareWideRecord(i, false, record, &size);
+		rc = rbfm->readRecord(fileHandle, recordDescriptor, rids[i],
+				returnedData);
+		assert(rc == success && memcmp(record, returnedData, size) == 0 && "Reading a record should not fail.");
+	}
+
+	// Grow a tenth of the records, so that they move, then delete a seventh
+	for (int i = 0; i < numRecords; i += 10) {
+		prepareWideRecord(i, true, record, &size);
+		rc = rbfm->updateRecord(fileHandle, recordDescriptor, record, rids[i]);
+		assert(rc == success && "Updating a record should not fail.");
+	}
+	for (int i = 0; i < numRecords; i += 7) {
+		rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rids[i]);
+		assert(rc == success && "Deleting a record should not fail.");
+	}
+	checkWideRecords(rbfm, fileHandle, recordDescriptor, rids, 1);
+
+	// Scan the names and salaries (the salary of record i is i)
+	vector<string> attributeNames;
+	attributeNames.push_back("EmpName");
+	attributeNames.push_back("Salary");
+	RBFM_ScanIterator rbfmScanIterator;
+	rc = rbfm->scan(fileHandle, recordDescriptor, "", NO_OP, NULL,
+			attributeNames, rbfmScanIterator);
+	assert(rc == success && "Scanning the file should not fail.");
+	vector<bool> seen(numRecords, false);
+	int count = 0;
+	RID rid;
+	while (rbfmScanIterator.getNextRecord(rid, returnedData) != RBFM_EOF) {
+		int length;
+		int salary;
+		memcpy(&length, returnedData + 1, sizeof(int));
+		memcpy(&salary, returnedData + 1 + sizeof(int) + length, sizeof(int));
+		assert(salary >= 0 && salary < numRecords && salary % 7 != 0 && !seen[salary] && "The scan should return each remaining record once.");
+		prepareWideRecord(salary, salary % 10 == 0, record, &size);
+		assert(memcmp(record + 1, returnedData + 1, sizeof(int) + length) == 0 && "The scan should return the names of the records.");
+		seen[salary] = true;
+		count++;
+	}
+	rbfmScanIterator.close();
+	assert(count == numRecords - (numRecords + 6) / 7 && "The scan should return all the remaining records.");
+
+	rc = rbfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+
+	rc = rbfm->openFile(fileName, fileHandle);
+	assert(rc == success && "Opening the file should not fail.");
+	assert(!fileHandle.isMemoryMapped() && "The file should not be memory-mapped.");
+	checkWideRecords(rbfm, fileHandle, recordDescriptor, rids, 1);
+
+	// Updates through either handle are seen through the other one
+	FileHandle mappedHandle;
+	rc = rbfm->openFile(fileName, mappedHandle, true);
+	assert(rc == success && "Opening the file again should not fail.");
+	assert(mappedHandle.isMemoryMapped() && "The file should be memory-mapped.");
+	for (int i = 1; i < numRecords; i += 10) {
+		if (i % 7 == 0)
+			continue;
+		prepareWideRecord(i, true, record, &size);
+		rc = rbfm->updateRecord(fileHandle, recordDescriptor, record, rids[i]);
+		assert(rc == success && "Updating a record should not fail.");
+	}
+	checkWideRecords(rbfm, mappedHandle, recordDescriptor, rids, 2);
+	char mappedData[PAGE_SIZE];
+	for (int i = 0; i < numRecords; i++) {
+		if (i % 7 == 0)
+			continue;
+		rc = rbfm->readRecord(fileHandle, recordDescriptor, rids[i],
+				returnedData);
+		assert(rc == success && "Reading a record should not fail.");
+		rc = rbfm->readRecord(mappedHandle, recordDescriptor, rids[i],
+				mappedData);
+		assert(rc == success && "Reading a record should not fail.");
+		prepareWideRecord(i, i % 10 < 2, record, &size);
+		assert(memcmp(returnedData, mappedData, size) == 0 && "Both handles should read the same records.");
+	}
+
+	rc = rbfm->closeFile(mappedHandle);
+	assert(rc == success && "Closing the file should not fail.");
+	rc = rbfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+	rc = rbfm->destroyFile(fileName);
+	assert(rc == success && "Destroying the file should not fail.");
+
+	cout << "[PASS] Test Case 27 Passed!" << endl << endl;
+
+	return 0;
+}
+
+int RBFTest_28(RecordBasedFileManager *rbfm) {
+	// Functions tested
+	// 1. Create Record-Based File
+	// 2. Insert records and grow some of them, so that they move to other pages
+	// 3. Read shuffled rids, some of them twice, one at a time and all at once
+	// 4. Compare the records and the number of pages read
+	// 5. Destroy Record-Based File
+	cout << endl << "***** In RBF Test Case 28 *****" << endl;
+
+	RC rc;
+	string fileName = "test28";
+	BufferManager *bpm = BufferManager::instance();
+
+	rc = rbfm->createFile(fileName);
+	assert(rc == success && "Creating the file should not fail.");
+
+	FileHandle fileHandle;
+	rc = rbfm->openFile(fileName, fileHandle);
+	assert(rc == success && "Opening the file should not fail.");
+
+	vector<Attribute> recordDescriptor;
+	createRecordDescriptor(recordDescriptor);
+
+	int numRecords = 2000;
+	vector<RID> rids(numRecords);
+	char record[PAGE_SIZE];
+	int size;
+	for (int i = 0; i < numRecords; i++) {
+		preparePaxRecord(i, false, record, &size);
+		rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rids[i]);
+		assert(rc == success && "Inserting a record should not fail.");
+	}
+	// The pages are full, so the grown records move
+	int numGrown = 0;
+	for (int i = 0; i < numRecords; i += 10, numGrown++) {
+		preparePaxRecord(i, true, record, &size);
+		rc = rbfm->updateRecord(fileHandle, recordDescriptor, record, rids[i]);
+		assert(rc == success && "Updating a record should not fail.");
+	}
+
+	// Every fifth rid is read twice, in no particular order
+	vector<int> order;
+	for (int i = 0; i < numRecords; i++) {
+		order.push_back(i);
+		if (i % 5 == 0)
+			order.push_back(i);
+	}
+	srand(28);
+	for (unsigned i = order.size() - 1; i > 0; i--)
+		swap(order[i], order[rand() % (i + 1)]);
+	vector<RID> requested(order.size());
+	set<PageNum> pages;
+	for (unsigned i = 0; i < order.size(); i++) {
+		requested[i] = rids[order[i]];
+		pages.insert(requested[i].pageNum);
+	}
+
+	// The pool is too small to keep the pages between two reads of the same one
+	unsigned poolSize = 8;
+	unsigned readCount, writeCount, appendCount;
+	rc = bpm->setPoolSize(poolSize);
+	assert(rc == success && "Resizing the pool should not fail.");
+	rc = fileHandle.collectCounterValues(readCount, writeCount, appendCount);
+	assert(rc == success && "Collecting the counters should not fail.");
+	unsigned readsBefore = readCount;
+	vector<char*> expected(requested.size());
+	for (unsigned i = 0; i < requested.size(); i++) {
+		expected[i] = (char*) malloc(PAGE_SIZE);
+		rc = rbfm->readRecord(fileHandle, recordDescriptor, requested[i],
+				expected[i]);
+		assert(rc == success && "Reading a record should not fail.");
+	}
+	rc = fileHandle.collectCounterValues(readCount, writeCount, appendCount);
+	unsigned singleReads = readCount - readsBefore;
+
+	rc = bpm->setPoolSize(poolSize);
+	assert(rc == success && "Resizing the pool should not fail.");
+	readsBefore = readCount;
+	vector<void*> data(requested.size());
+	for (unsigned i = 0; i < requested.size(); i++)
+		data[i] = malloc(PAGE_SIZE);
+	rc = rbfm->readRecords(fileHandle, recordDescriptor, requested, data);
+	assert(rc == success && "Reading the records at once should not fail.");
+	rc = fileHandle.collectCounterValues(readCount, writeCount, appendCount);
+	unsigned batchReads = readCount - readsBefore;
+
+	for (unsigned i = 0; i < requested.size(); i++) {
+		preparePaxRecord(order[i], order[i] % 10 == 0, record, &size);
+		assert(memcmp(expected[i], record, size) == 0 && "Reading a record should return it.");
+		assert(memcmp(expected[i], data[i], size) == 0 && "Reading the records at once should return the same records.");
+		free(expected[i]);
+		free(data[i]);
+	}
+
+	// Each page holding a requested rid is read once, and so is the page
+	// holding a moved record (which may be one of them)
+	assert(batchReads >= pages.size() && batchReads <= pages.size() + numGrown && "Each page should be read once.");
+	assert(singleReads > batchReads && "Reading the records at once should read fewer pages.");
+
+	rc = bpm->setPoolSize(DEFAULT_POOL_SIZE);
+	assert(rc == success && "Resizing the pool should not fail.");
+	rc = rbfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+	rc = rbfm->destroyFile(fileName);
+	assert(rc == success && "Destroying the file should not fail.");
+
+	cout << "[PASS] Test Case 28 Passed!" << endl << endl;
+
+	return 0;
+}
+
+// Check the fields of the view against record i of preparePaxRecord
+static void checkRecordView(const RecordView &recordView, int i, bool grow) {
+	string name(grow ? 300 + i % 50 : 1 + i % 30, 'a' + i % 26);
+	assert(recordView.getNumberOfFields() == 4 && "The view should have all the fields.");
+	assert(!recordView.isNull(0) && recordView.getVarChar(0) == name && "The view should return the name.");
+	assert(!recordView.isNull(1) && recordView.getInt(1) == i % 100 && "The view should return the age.");
+	assert(recordView.isNull(2) == (i % 7 == 0) && "The view should tell the null height.");
+	if (i % 7 != 0)
+		assert(recordView.getReal(2) == i / 10.0f && "The view should return the height.");
+	assert(!recordView.isNull(3) && recordView.getInt(3) == i && "The view should return the salary.");
+}
+
+// True if the records of the file are neither locked nor pinned
+static bool recordsReleased(FileHandle &fileHandle) {
+	if (!fileHandle.getRecordLock().try_lock())
+		return false;
+	fileHandle.getRecordLock().unlock();
+	// the pool can only be resized without pinned pages
+	return BufferManager::instance()->setPoolSize(DEFAULT_POOL_SIZE) == success;
+}
+
+int RBFTest_29(RecordBasedFileManager *rbfm) {
+	// Functions tested
+	// 1. Create Record-Based Files with the slotted, PAX and fixed layouts
+	// 2. Insert records and grow some of them, so that they move to other pages
+	// 3. Read the fields of the records in place, through a view
+	// 4. Release the view, or destroy it, and insert another record
+	// 5. Destroy Record-Based Files
+	cout << endl << "***** In RBF Test Case 29 *****" << endl;
+
+	RC rc;
+	string fileName = "test29";
+	vector<Attribute> recordDescriptor;
+	createRecordDescriptor(recordDescriptor);
+	int numRecords = 500;
+	vector<RID> rids(numRecords);
+	char record[PAGE_SIZE];
+	int size;
+	RID rid;
+
+	PageLayout layouts[] = { SlottedLayout, PaxLayout };
+	for (int l = 0; l < 2; l++) {
+		rc = rbfm->createFile(fileName, layouts[l]);
+		assert(rc == success && "Creating the file should not fail.");
+
+		FileHandle fileHandle;
+		rc = rbfm->openFile(fileName, fileHandle);
+		assert(rc == success && "Opening the file should not fail.");
+
+		for (int i = 0; i < numRecords; i++) {
+			preparePaxRecord(i, false, record, &size);
+			rc = rbfm->insertRecord(fileHandle, recordDescriptor, record,
+					rids[i]);
+			assert(rc == success && "Inserting a record should not fail.");
+		}
+		for (int i = 0; i < numRecords; i += 10) {
+			preparePaxRecord(i, true, record, &size);
+			rc = rbfm->updateRecord(fileHandle, recordDescriptor, record,
+					rids[i]);
+			assert(rc == success && "Updating a record should not fail.");
+		}
+
+		// The same view is pointed to one record after the other
+		RecordView recordView;
+		for (int i = 0; i < numRecords; i++) {
+			rc = rbfm->readRecordView(fileHandle, rids[i], recordView);
+			assert(rc == success && "Reading a record in place should not fail.");
+			checkRecordView(recordView, i, i % 10 == 0);
+		}
+		assert(!recordsReleased(fileHandle) && "The view should keep its page pinned and the file locked.");
+		recordView.release();
+		assert(recordsReleased(fileHandle) && "Releasing the view should unpin its page and unlock the file.");
+
+		preparePaxRecord(numRecords, false, record, &size);
+		rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+		assert(rc == success && "Inserting a record after releasing the view should not fail.");
+
+		{
+			RecordView scopedView;
+			rc = rbfm->readRecordView(fileHandle, rid, scopedView);
+			assert(rc == success && "Reading a record in place should not fail.");
+			checkRecordView(scopedView, numRecords, false);
+		}
+		assert(recordsReleased(fileHandle) && "Destroying the view should unpin its page and unlock the file.");
+		rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rid);
+		assert(rc == success && "Deleting a record after destroying the view should not fail.");
+		rc = rbfm->readRecordView(fileHandle, rid, recordView);
+		assert(rc != success && recordsReleased(fileHandle) && "A deleted record should not be viewed.");
+
+		rc = rbfm->closeFile(fileHandle);
+		assert(rc == success && "Closing the file should not fail.");
+		rc = rbfm->destroyFile(fileName);
+		assert(rc == success && "Destroying the file should not fail.");
+	}
+
+	// Fixed layout, with the numeric records of test 17
+	rc = rbfm->createFile(fileName, FixedLayout);
+	assert(rc == success && "Creating the file should not fail.");
+	FileHandle fileHandle;
+	rc = rbfm->openFile(fileName, fileHandle);
+	assert(rc == success && "Opening the file should not fail.");
+
+	vector<Attribute> numericDescriptor;
+	Attribute attr;
+	const char *names[] = { "id", "a", "b", "c" };
+	for (int i = 0; i < 4; i++) {
+		attr.name = names[i];
+		attr.type = (i % 2 == 0) ? TypeInt : TypeReal;
+		attr.length = 4;
+		numericDescriptor.push_back(attr);
+	}
+	for (int i = 0; i < numRecords; i++) {
+		prepareNumericRecord(i, i + 0.5f, record, &size);
+		rc = rbfm->insertRecord(fileHandle, numericDescriptor, record, rids[i]);
+		assert(rc == success && "Inserting a record should not fail.");
+	}
+	RecordView recordView;
+	for (int i = 0; i < numRecords; i++) {
+		rc = rbfm->readRecordView(fileHandle, rids[i], recordView);
+		assert(rc == success && "Reading a record in place should not fail.");
+		assert(recordView.getNumberOfFields() == 4 && "The view should have all the fields.");
+		assert(!recordView.isNull(0) && recordView.getInt(0) == i && "The view should return the id.");
+		assert(!recordView.isNull(1) && recordView.getReal(1) == i + 0.5f && "The view should return a.");
+		assert(recordView.isNull(2) == (i % 4 == 1) && "The view should tell the null b.");
+		if (i % 4 != 1)
+			assert(recordView.getInt(2) == i * 2 && "The view should return b.");
+		assert(!recordView.isNull(3) && recordView.getReal(3) == i / 2.0f && "The view should return c.");
+	}
+	assert(!recordsReleased(fileHandle) && "The view should keep its page pinned and the file locked.");
+	recordView.release();
+	assert(recordsReleased(fileHandle) && "Releasing the view should unpin its page and unlock the file.");
+	prepareNumericRecord(numRecords, 0, record, &size);
+	rc = rbfm->insertRecord(fileHandle, numericDescriptor, record, rid);
+	assert(rc == success && "Inserting a record after releasing the view should not fail.");
+
+	rc = rbfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+	rc = rbfm->destroyFile(fileName);
+	assert(rc == success && "Destroying the file should not fail.");
+
+	cout << "[PASS] Test Case 29 Passed!" << endl << endl;
+
+	return 0;
+}
+
+int RBFTest_30(RecordBasedFileManager *rbfm) {
+	// Functions tested
+	// 1. Create Record-Based File, compacted lazily and larger than a small buffer pool
+	// 2. Grow, shrink, delete and insert records, the pages being evicted
+	// 3. Read the records back, before and after closing the file
+	// 4. Check the number of compactions and of bytes they moved
+	// 5. Destroy Record-Based File
+	cout << endl << "***** In RBF Test Case 30 *****" << endl;
+
+	RC rc;
+	string fileName = "test30";
+	BufferManager *bpm = BufferManager::instance();
+	unsigned poolSize = 4;
+	rc = bpm->setPoolSize(poolSize);
+	assert(rc == success && "Resizing the pool should not fail.");
+	rbfm->setLazyCompaction(true);
+
+	rc = rbfm->createFile(fileName);
+	assert(rc == success && "Creating the file should not fail.");
+	FileHandle fileHandle;
+	rc = rbfm->openFile(fileName, fileHandle);
+	assert(rc == success && "Opening the file should not fail.");
+
+	vector<Attribute> recordDescriptor;
+	createRecordDescriptor(recordDescriptor);
+
+	int numRecords = 3000;
+	vector<RID> rids(numRecords);
+	vector<bool> grown(numRecords, false);
+	char record[PAGE_SIZE];
+	char returnedData[PAGE_SIZE];
+	int size;
+	for (int i = 0; i < numRecords; i++) {
+		preparePaxRecord(i, false, record, &size);
+		rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rids[i]);
+		assert(rc == success && "Inserting a record should not fail.");
+	}
+	assert(fileHandle.getNumberOfPages() > 4 * poolSize && "The file should be larger than the pool.");
+
+	// Each round grows a quarter of the records and shrinks the ones grown by the
+	// previous round, deletes another quarter and inserts the ones it deleted before
+	for (int round = 0; round < 4; round++) {
+		for (int i = 0; i < numRecords; i++) {
+			if (i % 4 == round) {
+				rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rids[i]);
+				assert(rc == success && "Deleting a record should not fail.");
+				grown[i] = false;
+			} else if (round > 0 && i % 4 == round - 1) {
+				preparePaxRecord(i, false, record, &size);
+				rc = rbfm->insertRecord(fileHandle, recordDescriptor, record,
+						rids[i]);
+				assert(rc == success && "Inserting a record should not fail.");
+			} else if (i % 4 == (round + 2) % 4 || grown[i]) {
+				grown[i] = !grown[i];
+				preparePaxRecord(i, grown[i], record, &size);
+				rc = rbfm->updateRecord(fileHandle, recordDescriptor, record,
+						rids[i]);
+				assert(rc == success && "Updating a record should not fail.");
+			}
+		}
+	}
+
+	// (the slots of the deleted records may have been reused)
+	for (int i = 0; i < numRecords; i++) {
+		if (i % 4 == 3)
+			continue;
+		preparePaxRecord(i, grown[i], record, &size);
+		rc = rbfm->readRecord(fileHandle, recordDescriptor, rids[i],
+				returnedData);
+		assert(rc == success && memcmp(record, returnedData, size) == 0 && "The records should be read back.");
+	}
+
+	rc = rbfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+	unsigned compactionCount;
+	unsigned compactedBytes;
+	rc = fileHandle.collectCompactionCounters(compactionCount, compactedBytes);
+	assert(rc == success && "Collecting the counters should not fail.");
+	assert(compactionCount > 0 && "Pages should have been compacted.");
+	assert(compactedBytes > 0 && compactedBytes <= compactionCount * PAGE_SIZE && "Each compaction should move at most a page of records.");
+
+	rbfm->setLazyCompaction(false);
+	rc = bpm->setPoolSize(DEFAULT_POOL_SIZE);
+	assert(rc == success && "Resizing the pool should not fail.");
+	rc = rbfm->openFile(fileName, fileHandle);
+	assert(rc == success && "Opening the file should not fail.");
+	for (int i = 0; i < numRecords; i++) {
+		if (i % 4 == 3)
+			continue;
+		preparePaxRecord(i, grown[i], record, &size);
+		rc = rbfm->readRecord(fileHandle, recordDescriptor, rids[i],
+				returnedData);
+		assert(rc == success && memcmp(record, returnedData, size) == 0 && "The compacted pages should be written back.");
+	}
+
+	rc = rbfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+	rc = rbfm->destroyFile(fileName);
+	assert(rc == success && "Destroying the file should not fail.");
+
+	cout << "[PASS] Test Case 30 Passed!" << endl << endl;
+
+	return 0;
+}
+
+// Record i of preparePaxRecord, with its fields in the order Salary, Height,
+// Age, EmpName
+static void prepareReorderedRecord(int i, char *buffer, int *size) {
+	int offset = 1;
+	buffer[0] = (i % 7 == 0) ? 1 << 6 : 0;
+	memcpy(buffer + offset, &i, sizeof(int));
+	offset += sizeof(int);
+	if (i % 7 != 0) {
+		float height = i / 10.0f;
+		memcpy(buffer + offset, &height, sizeof(float));
+		offset += sizeof(float);
+	}
+	int age = i % 100;
+	memcpy(buffer + offset, &age, sizeof(int));
+	offset += sizeof(int);
+	int length = 1 + i % 30;
+	memcpy(buffer + offset, &length, sizeof(int));
+	memset(buffer + offset + sizeof(int), 'a' + i % 26, length);
+	*size = offset + sizeof(int) + length;
+}
+
+// Check a value returned by readAttribute: a null byte, then an int or a varchar
+static void checkAttribute(const char *data, bool isNull, const void *value,
+		int length) {
+	if (isNull) {
+		assert((unsigned char) data[0] == 1 << 7 && "The attribute should be null.");
+		return;
+	}
+	assert(data[0] == 0 && memcmp(data + 1, value, length) == 0 && "The attribute should be read.");
+}
+
+int RBFTest_31(RecordBasedFileManager *rbfm) {
+	// Functions tested
+	// 1. Create two Record-Based Files, with the same fields in different orders
+	// 2. Insert records with null fields, and move some of them to other pages
+	// 3. Read attributes of the records, alternating between both files
+	// 4. Read attributes added to the descriptor after the records were stored
+	// 5. Fail to read an attribute that is not in the descriptor
+	// 6. Destroy Record-Based Files
+	cout << endl << "***** In RBF Test Case 31 *****" << endl;
+
+	RC rc;
+	string fileNames[] = { "test31", "test31_reordered" };
+	FileHandle fileHandles[2];
+	for (int f = 0; f < 2; f++) {
+		rc = rbfm->createFile(fileNames[f]);
+		assert(rc == success && "Creating the file should not fail.");
+		rc = rbfm->openFile(fileNames[f], fileHandles[f]);
+		assert(rc == success && "Opening the file should not fail.");
+	}
+
+	vector<Attribute> recordDescriptors[2];
+	createRecordDescriptor(recordDescriptors[0]);
+	const int order[] = { 3, 2, 1, 0 };
+	for (int a = 0; a < 4; a++)
+		recordDescriptors[1].push_back(recordDescriptors[0][order[a]]);
+	// The bonus was added after the records were stored
+	vector<Attribute> extendedDescriptor = recordDescriptors[0];
+	Attribute attr;
+	attr.name = "Bonus";
+	attr.type = TypeInt;
+	attr.length = 4;
+	extendedDescriptor.push_back(attr);
+
+	int numRecords = 1000;
+	vector<RID> rids[2];
+	char record[PAGE_SIZE];
+	char data[PAGE_SIZE];
+	int size;
+	RID rid;
+	for (int i = 0; i < numRecords; i++) {
+		preparePaxRecord(i, false, record, &size);
+		rc = rbfm->insertRecord(fileHandles[0], recordDescriptors[0], record,
+				rid);
+		assert(rc == success && "Inserting a record should not fail.");
+		rids[0].push_back(rid);
+		prepareReorderedRecord(i, record, &size);
+		rc = rbfm->insertRecord(fileHandles[1], recordDescriptors[1], record,
+				rid);
+		assert(rc == success && "Inserting a record should not fail.");
+		rids[1].push_back(rid);
+	}
+	// The pages are full, so the grown records move
+	for (int i = 0; i < numRecords; i += 10) {
+		preparePaxRecord(i, true, record, &size);
+		rc = rbfm->updateRecord(fileHandles[0], recordDescriptors[0], record,
+				rids[0][i]);
+		assert(rc == success && "Updating a record should not fail.");
+	}
+
+	// The index of each name differs between the descriptors of the two files
+	const char *names[] = { "EmpName", "Age", "Height", "Salary" };
+	for (int i = 0; i < numRecords; i++) {
+		int age = i % 100;
+		float height = i / 10.0f;
+		for (int a = 0; a < 4; a++) {
+			for (int f = 0; f < 2; f++) {
+				rc = rbfm->readAttribute(fileHandles[f], recordDescriptors[f],
+						rids[f][i], names[a], data);
+				assert(rc == success && "Reading an attribute should not fail.");
+				if (a == 0) {
+					bool grow = f == 0 && i % 10 == 0;
+					string name(grow ? 300 + i % 50 : 1 + i % 30, 'a' + i % 26);
+					int length = name.size();
+					checkAttribute(data, false, &length, sizeof(int));
+					assert(memcmp(data + 1 + sizeof(int), name.data(), length) == 0 && "The name should be read.");
+				} else if (a == 1) {
+					checkAttribute(data, false, &age, sizeof(int));
+				} else if (a == 2) {
+					checkAttribute(data, i % 7 == 0, &height, sizeof(float));
+				} else {
+					checkAttribute(data, false, &i, sizeof(int));
+				}
+			}
+		}
+
+		rc = rbfm->readAttribute(fileHandles[0], extendedDescriptor, rids[0][i],
+				"Bonus", data);
+		assert(rc == success && "Reading an attribute should not fail.");
+		checkAttribute(data, true, NULL, 0);
+		rc = rbfm->readAttribute(fileHandles[0], recordDescriptors[0],
+				rids[0][i], "Bonus", data);
+		assert(rc != success && "An attribute that is not in the descriptor should not be read.");
+	}
+
+	// Several attributes at once, in the format of scan
+	vector<string> attributeNames;
+	attributeNames.push_back("Salary");
+	attributeNames.push_back("Bonus");
+	attributeNames.push_back("Height");
+	attributeNames.push_back("Age");
+	for (int i = 0; i < numRecords; i++) {
+		rc = rbfm->readAttributes(fileHandles[0], extendedDescriptor,
+				rids[0][i], attributeNames, data);
+		assert(rc == success && "Reading attributes should not fail.");
+		int offset = 1;
+		record[0] = (i % 7 == 0) ? (1 << 6 | 1 << 5) : 1 << 6;
+		memcpy(record + offset, &i, sizeof(int));
+		offset += sizeof(int);
+		if (i % 7 != 0) {
+			float height = i / 10.0f;
+			memcpy(record + offset, &height, sizeof(float));
+			offset += sizeof(float);
+		}
+		int age = i % 100;
+		memcpy(record + offset, &age, sizeof(int));
+		offset += sizeof(int);
+		assert(memcmp(record, data, offset) == 0 && "The attributes should be read.");
+	}
+	rc = rbfm->readAttributes(fileHandles[0], recordDescriptors[0], rids[0][0],
+			attributeNames, data);
+	assert(rc != success && "An attribute that is not in the descriptor should not be read.");
+
+	for (int f = 0; f < 2; f++) {
+		rc = rbfm->closeFile(fileHandles[f]);
+		assert(rc == success && "Closing the file should not fail.");
+		rc = rbfm->destroyFile(fileNames[f]);
+		assert(rc == success && "Destroying the file should not fail.");
+	}
+
+	cout << "[PASS] Test Case 31 Passed!" << endl << endl;
+
+	return 0;
+}
+
 int main() {
 
 	// To test the functionality of the paged file manager
-    // PagedFileManager *pfm = PagedFileManager::instance();
+    PagedFileManager *pfm = PagedFileManager::instance();
 
 	// To test the functionality of the record-based file manager
 	RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
 
-	RC rcmain = RBFTest_12(rbfm);
+	RC rcmain = RBFTest_13(rbfm);
+	if (rcmain == success)
+		rcmain = RBFTest_14(rbfm);
+	if (rcmain == success)
+		rcmain = RBFTest_15(rbfm);
+	if (rcmain == success)
+		rcmain = RBFTest_16(rbfm);
+	if (rcmain == success)
+		rcmain = RBFTest_17(rbfm);
+	if (rcmain == success)
+		rcmain = RBFTest_18(rbfm);
+	if (rcmain == success)
+		rcmain = RBFTest_19(rbfm);
+	if (rcmain == success)
+		rcmain = RBFTest_20(rbfm);
+	if (rcmain == success)
+		rcmain = RBFTest_21(rbfm);
+	if (rcmain == success)
+		rcmain = RBFTest_22(rbfm);
+	if (rcmain == success)
+		rcmain = RBFTest_23(pfm);
+	if (rcmain == success)
+		rcmain = RBFTest_24(rbfm);
+	if (rcmain == success)
+		rcmain = RBFTest_25(rbfm);
+	if (rcmain == success)
+		rcmain = RBFTest_26(pfm);
+	if (rcmain == success)
+		rcmain = RBFTest_27(rbfm);
+	if (rcmain == success)
+		rcmain = RBFTest_28(rbfm);
+	if (rcmain == success)
+		rcmain = RBFTest_29(rbfm);
+	if (rcmain == success)
+		rcmain = RBFTest_30(rbfm);
+	if (rcmain == success)
+		rcmain = RBFTest_31(rbfm);
+	if (rcmain == success)
+		rcmain = RBFTest_12(rbfm);
 
 	return rcmain;
 }
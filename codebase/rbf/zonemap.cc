@@ -0,0 +1,311 @@
+#include "zonemap.h"
+
+ZoneMap::ZoneMap() {
+	handleCount = 0;
+	pageCount = 0;
+}
+
+static Zone newZone(ZoneState state) {
+	Zone zone;
+	memset(&zone, 0, sizeof(Zone));
+	zone.state = state;
+	return zone;
+}
+
+/*
+ * The sidecar keeps the number of pages of the file, the types of the attributes
+ * and the zones. It is only trusted if the file still has that many pages;
+ * otherwise, or if there is none, every page is unknown until the first record
+ * gives the schema.
+ */
+void ZoneMap::load(const string &fileName, unsigned pageCount) {
+	lock_guard<mutex> lock(zoneMutex);
+	types.clear();
+	zones.clear();
+	this->pageCount = pageCount;
+
+	string zoneFileName = fileName + ZONE_MAP_SUFFIX;
+	FILE *file = fopen(zoneFileName.c_str(), "rb");
+	if (file == NULL)
+		return;
+
+	unsigned savedPages;
+	int attrNum;
+	bool valid = fread(&savedPages, sizeof(unsigned), 1, file) == 1
+			&& fread(&attrNum, sizeof(int), 1, file) == 1
+			&& savedPages == pageCount && attrNum > 0;
+	if (valid) {
+		types.resize(attrNum);
+		zones.resize((size_t) pageCount * attrNum);
+		valid = fread(&types[0], sizeof(int), attrNum, file)
+				== (size_t) attrNum
+				&& fread(zones.data(), sizeof(Zone), zones.size(), file)
+						== zones.size();
+	}
+	if (!valid) {
+		types.clear();
+		zones.clear();
+	}
+	fclose(file);
+
+	//from now on the file and the zones only agree in memory
+	remove(zoneFileName.c_str());
+}
+
+/*
+ * Write the zones to the sidecar of the file, which has pageCount data pages.
+ * Nothing is written before the first record gives the schema.
+ */
+RC ZoneMap::save(const string &fileName, unsigned pageCount) {
+	lock_guard<mutex> lock(zoneMutex);
+	if (types.empty())
+		return 0;
+
+	//pages the map doesn't know about may hold anything
+	zones.resize((size_t) pageCount * types.size(), newZone(UnknownZone));
+	this->pageCount = pageCount;
+
+	string zoneFileName = fileName + ZONE_MAP_SUFFIX;
+	FILE *file = fopen(zoneFileName.c_str(), "wb");
+	if (file == NULL) {
+		cout << "ERROR: could not write the zone map " << zoneFileName << endl;
+		return -1;
+	}
+	int attrNum = types.size();
+	bool written = fwrite(&pageCount, sizeof(unsigned), 1, file) == 1
+			&& fwrite(&attrNum, sizeof(int), 1, file) == 1
+			&& fwrite(&types[0], sizeof(int), attrNum, file)
+					== (size_t) attrNum
+			&& fwrite(zones.data(), sizeof(Zone), zones.size(), file)
+					== zones.size();
+	if (fclose(file) != 0 || !written) {
+		remove(zoneFileName.c_str());
+		return -1;
+	}
+	return 0;
+}
+
+void ZoneMap::discard(const string &fileName) {
+	remove((fileName + ZONE_MAP_SUFFIX).c_str());
+}
+
+/*
+ * Widen the zones of the page with the fields of the record that are not null.
+ * A record of another schema makes every page unknown first.
+ */
+void ZoneMap::add(PageNum pageNum, const vector<Attribute> &recordDescriptor,
+		const void *data) {
+	lock_guard<mutex> lock(zoneMutex);
+	if (!sameTypes(recordDescriptor))
+		setTypes(recordDescriptor);
+	Zone *pageZone = pageZones(pageNum);
+
+	int attrNum = recordDescriptor.size();
+	const unsigned char *nullbits = (const unsigned char*) data;
+	const char *field = (const char*) data + (attrNum + 7) / 8;
+	for (int i = 0; i < attrNum; ++i) {
+		if (nullbits[i / 8] & (1 << (7 - i % 8)))
+			continue;
+		AttrType type = recordDescriptor[i].type;
+		widen(pageZone[i], type, field);
+		field += RecordBasedFileManager::fieldLength(field, type);
+	}
+}
+
+/*
+ * Null fields never satisfy a condition, so a page without values can always be
+ * skipped. The bounds of a varchar are prefixes, so a value above the maximum
+ * may still be in the page if its prefix is not: the upper bound is compared
+ * with the prefix of the value.
+ */
+bool ZoneMap::mayMatch(PageNum pageNum,
+		const vector<Attribute> &recordDescriptor, int fieldIndex,
+		CompOp compOp, const void *value) {
+	if (compOp == NO_OP)
+		return true;
+
+	lock_guard<mutex> lock(zoneMutex);
+	if (pageNum >= pageCount || !sameTypes(recordDescriptor))
+		return true;
+	const Zone &zone = zones[(size_t) pageNum * types.size() + fieldIndex];
+	if (zone.state != BoundedZone)
+		return zone.state == UnknownZone;
+
+	AttrType type = recordDescriptor[fieldIndex].type;
+	const char *lowValue = (const char*) value;
+	const char *highValue = lowValue;
+	char prefix[sizeof(int) + ZONE_PREFIX];
+	bool truncated = false;
+	if (type == TypeVarChar) {
+		int length;
+		memcpy(&length, value, sizeof(int));
+		truncated = length >= ZONE_PREFIX;
+		length = min(length, ZONE_PREFIX);
+		memcpy(prefix, &length, sizeof(int));
+		memcpy(prefix + sizeof(int), lowValue + sizeof(int), length);
+		highValue = prefix;
+	}
+
+	switch (compOp) {
+	case EQ_OP:
+		return RecordBasedFileManager::compareField(zone.min, type, LE_OP,
+				lowValue)
+				&& RecordBasedFileManager::compareField(zone.max, type, GE_OP,
+						highValue);
+	case LT_OP:
+	case LE_OP:
+		return RecordBasedFileManager::compareField(zone.min, type, compOp,
+				lowValue);
+	case GT_OP:
+		return RecordBasedFileManager::compareField(zone.max, type,
+				type == TypeVarChar ? GE_OP : GT_OP, highValue);
+	case GE_OP:
+		return RecordBasedFileManager::compareField(zone.max, type, GE_OP,
+				highValue);
+	case NE_OP:
+		//only a page where every value is the value itself is skipped
+		return truncated
+				|| !RecordBasedFileManager::compareField(zone.min, type, EQ_OP,
+						lowValue)
+				|| !RecordBasedFileManager::compareField(zone.max, type, EQ_OP,
+						lowValue);
+	default:
+		return true;
+	}
+}
+
+void ZoneMap::invalidate() {
+	lock_guard<mutex> lock(zoneMutex);
+	zones.assign(zones.size(), newZone(UnknownZone));
+}
+
+/*
+ * Start over with every page empty, to add all the records of the file again.
+ */
+void ZoneMap::reset(const vector<Attribute> &recordDescriptor,
+		unsigned pageCount) {
+	lock_guard<mutex> lock(zoneMutex);
+	types.clear();
+	this->pageCount = pageCount;
+	for (unsigned i = 0; i < recordDescriptor.size(); ++i)
+		types.push_back(recordDescriptor[i].type);
+	zones.assign((size_t) pageCount * types.size(), newZone(EmptyZone));
+}
+
+/*
+ * After a reorganization, a page holds the records it kept and the ones moved
+ * to it, so its zone is the union of its old zone and the old zones of the
+ * pages they come from.
+ */
+void ZoneMap::remap(const vector<pair<RID, RID> > &ridMap,
+		unsigned pageCount) {
+	lock_guard<mutex> lock(zoneMutex);
+	unsigned oldCount = this->pageCount;
+	this->pageCount = pageCount;
+	if (types.empty())
+		return;
+
+	int attrNum = types.size();
+	vector<Zone> oldZones;
+	oldZones.swap(zones);
+	zones.assign((size_t) pageCount * attrNum, newZone(EmptyZone));
+
+	set<pair<PageNum, PageNum> > sources; //(new page, old page)
+	for (PageNum pageNum = 0; pageNum < pageCount; ++pageNum)
+		sources.insert(make_pair(pageNum, pageNum));
+	for (unsigned i = 0; i < ridMap.size(); ++i)
+		sources.insert(
+				make_pair(ridMap[i].second.pageNum, ridMap[i].first.pageNum));
+
+	for (set<pair<PageNum, PageNum> >::iterator it = sources.begin();
+			it != sources.end(); ++it) {
+		if (it->first >= pageCount)
+			continue;
+		Zone *pageZone = &zones[(size_t) it->first * attrNum];
+		for (int i = 0; i < attrNum; ++i) {
+			if (it->second < oldCount)
+				merge(pageZone[i], oldZones[(size_t) it->second * attrNum + i],
+						(AttrType) types[i]);
+			else
+				pageZone[i] = newZone(UnknownZone);
+		}
+	}
+}
+
+bool ZoneMap::sameTypes(const vector<Attribute> &recordDescriptor) const {
+	if (recordDescriptor.size() != types.size())
+		return false;
+	for (unsigned i = 0; i < types.size(); ++i)
+		if (recordDescriptor[i].type != types[i])
+			return false;
+	return true;
+}
+
+/*
+ * Nothing is known about the values of the other schema, so all the pages the
+ * map had become unknown.
+ */
+void ZoneMap::setTypes(const vector<Attribute> &recordDescriptor) {
+	types.clear();
+	for (unsigned i = 0; i < recordDescriptor.size(); ++i)
+		types.push_back(recordDescriptor[i].type);
+	zones.assign((size_t) pageCount * types.size(), newZone(UnknownZone));
+}
+
+/*
+ * Zones of the page. Pages after the ones the map has are new pages of the
+ * file, which start empty.
+ */
+Zone* ZoneMap::pageZones(PageNum pageNum) {
+	if (pageNum >= pageCount) {
+		pageCount = pageNum + 1;
+		zones.resize((size_t) pageCount * types.size(), newZone(EmptyZone));
+	}
+	return &zones[(size_t) pageNum * types.size()];
+}
+
+void ZoneMap::widen(Zone &zone, AttrType type, const char *field) {
+	if (zone.state == UnknownZone)
+		return;
+
+	char prefix[sizeof(int) + ZONE_PREFIX];
+	if (type == TypeVarChar) {
+		int length;
+		memcpy(&length, field, sizeof(int));
+		length = min(length, ZONE_PREFIX);
+		memcpy(prefix, &length, sizeof(int));
+		memcpy(prefix + sizeof(int), field + sizeof(int), length);
+		field = prefix;
+	} else if (type == TypeReal) {
+		//a NaN is equal to everything for compareField
+		float real;
+		memcpy(&real, field, sizeof(float));
+		if (real != real) {
+			zone.state = UnknownZone;
+			return;
+		}
+	}
+
+	int size = RecordBasedFileManager::fieldLength(field, type);
+	if (zone.state == EmptyZone) {
+		memcpy(zone.min, field, size);
+		memcpy(zone.max, field, size);
+		zone.state = BoundedZone;
+		return;
+	}
+	if (RecordBasedFileManager::compareField(field, type, LT_OP, zone.min))
+		memcpy(zone.min, field, size);
+	if (RecordBasedFileManager::compareField(field, type, GT_OP, zone.max))
+		memcpy(zone.max, field, size);
+}
+
+void ZoneMap::merge(Zone &zone, const Zone &other, AttrType type) {
+	if (other.state == EmptyZone || zone.state == UnknownZone)
+		return;
+	if (other.state == UnknownZone || zone.state == EmptyZone) {
+		zone = other;
+		return;
+	}
+	widen(zone, type, other.min);
+	widen(zone, type, other.max);
+}
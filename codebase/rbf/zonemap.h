@@ -0,0 +1,80 @@
+#ifndef _zonemap_h_
+#define _zonemap_h_
+
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+#include "rbfm.h"
+
+using namespace std;
+
+#define ZONE_MAP_SUFFIX ".zm" // sidecar file of the zone map of a file
+#define ZONE_PREFIX 8         // bytes of a varchar kept in the bounds
+
+// Range of the values of one attribute in one page
+struct Zone {
+	unsigned char state;             // see ZoneState
+	char min[sizeof(int) + ZONE_PREFIX]; // bounds in the API format: an int, a
+	char max[sizeof(int) + ZONE_PREFIX]; // real, or a prefix of a varchar
+};
+
+typedef enum {
+	EmptyZone = 0, // no value that isn't null
+	BoundedZone,   // every value is within [min, max]
+	UnknownZone    // the page may hold any value
+} ZoneState;
+
+/*
+ * ZoneMap summarizes every data page of a record-based file with the range of
+ * the values of each attribute in it (a prefix of ZONE_PREFIX bytes for the
+ * varchars), so that a scan can skip the pages where its condition cannot hold.
+ * The zone of a page covers the records whose rid points to the page as well as
+ * the moved records stored in it, which are the records the scan may return from
+ * it whatever the layout. The bounds are only ever widened: inserting or updating
+ * a record adds its values, and deleting it leaves them as they are, which still
+ * holds for the records left (see RecordBasedFileManager::rebuildZoneMap to make
+ * them tight again).
+ *
+ * It is kept in memory while the file is open, and in the sidecar file
+ * <fileName>.zm while it is closed. The sidecar is removed when the file is
+ * opened, so that a file that is not closed properly is left without zone map
+ * rather than with one that no longer holds: all its pages are then unknown.
+ */
+class ZoneMap {
+public:
+	int handleCount; // handles of the record manager open on the file
+
+	ZoneMap();
+
+	// read the sidecar of the file, of pageCount data pages, and remove it
+	void load(const string &fileName, unsigned pageCount);
+	RC save(const string &fileName, unsigned pageCount);
+	static void discard(const string &fileName); // remove the sidecar
+
+	// add the values of a record in the API format to the zones of the page
+	void add(PageNum pageNum, const vector<Attribute> &recordDescriptor,
+			const void *data);
+	// whether some value of the page may satisfy "field compOp value"
+	bool mayMatch(PageNum pageNum, const vector<Attribute> &recordDescriptor,
+			int fieldIndex, CompOp compOp, const void *value);
+
+	void invalidate(); // every page becomes unknown
+	void reset(const vector<Attribute> &recordDescriptor, unsigned pageCount);
+	// follow the records moved by RecordBasedFileManager::reorganizeFile
+	void remap(const vector<pair<RID, RID> > &ridMap, unsigned pageCount);
+
+private:
+	vector<int> types;   // AttrType of each attribute, empty until the first record
+	vector<Zone> zones;  // zones of page i at [i * types.size(), (i + 1) * types.size())
+	unsigned pageCount;  // pages of the map: the file's pages after them are new
+	mutex zoneMutex;
+
+	bool sameTypes(const vector<Attribute> &recordDescriptor) const;
+	void setTypes(const vector<Attribute> &recordDescriptor);
+	Zone* pageZones(PageNum pageNum); // grows the map up to the page
+	static void widen(Zone &zone, AttrType type, const char *field);
+	static void merge(Zone &zone, const Zone &other, AttrType type);
+};
+
+#endif